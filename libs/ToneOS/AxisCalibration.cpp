@@ -0,0 +1,46 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "AxisCalibration.h"
+
+void AxisCalibration::reset(int value) {
+    origin = (long) value << 8;
+    low = max(value - JOY_DEFAULT_SPAN, 0);
+    high = min(value + JOY_DEFAULT_SPAN, JOY_ADC_MAX);
+}
+
+int AxisCalibration::getOrigin() const {
+    return (origin + 128) >> 8;
+}
+
+void AxisCalibration::learn(int value) {
+    if (value < low) low = value;
+    if (value > high) high = value;
+}
+
+void AxisCalibration::recenter(int value) {
+    origin += (((long) value << 8) - origin) >> JOY_RECENTER_SHIFT;
+}
+
+int AxisCalibration::scale(int value) const {
+    int center = getOrigin();
+    int offset = value - center;
+    if (offset > 0) {
+        return (long) offset * JOY_AXIS_SPAN / max(high - center, 1);
+    }
+    return (long) offset * JOY_AXIS_SPAN / max(center - low, 1);
+}
+
+int AxisCalibration::median(int *samples, int count) {
+    // Insertion sort, count is small
+    for (int i = 1; i < count; i++) {
+        int value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = value;
+    }
+    return samples[count / 2];
+}
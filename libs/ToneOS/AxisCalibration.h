@@ -0,0 +1,76 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef AXISCALIBRATION_H
+#define AXISCALIBRATION_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Largest raw ADC value (12 bit).
+ */
+#define JOY_ADC_MAX 4095
+
+/**
+ * @brief Assumed travel on each side of the origin until a larger one has been seen (raw ADC).
+ */
+#define JOY_DEFAULT_SPAN 1800
+
+/**
+ * @brief Travel on each side of the origin after scaling: readX() and readY() return -JOY_AXIS_SPAN..JOY_AXIS_SPAN.
+ */
+#define JOY_AXIS_SPAN 2048
+
+/**
+ * @brief Speed of the idle re-centering: the origin moves 1/2^JOY_RECENTER_SHIFT of the way to the rest position per sample.
+ */
+#define JOY_RECENTER_SHIFT 8
+
+/**
+ * @brief AxisCalibration holds the origin and the travel of a single joystick axis.
+ * The travel on either side grows with the furthest value seen, the origin follows the rest position slowly.
+ */
+class AxisCalibration {
+private:
+    long origin = JOY_ADC_MAX / 2 << 8; ///< Origin in 1/256 ADC units
+    int low = 0; ///< Lowest value the axis reached (or the assumed one)
+    int high = JOY_ADC_MAX; ///< Highest value the axis reached (or the assumed one)
+
+public:
+    /**
+     * @brief Sets the origin and falls back to JOY_DEFAULT_SPAN on both sides.
+     * @param value Origin (raw ADC).
+     */
+    void reset(int value);
+
+    /**
+     * @brief Returns the origin (raw ADC).
+     */
+    int getOrigin() const;
+
+    /**
+     * @brief Widens the travel if the value is beyond the furthest one seen.
+     * @param value Filtered axis value (raw ADC).
+     */
+    void learn(int value);
+
+    /**
+     * @brief Moves the origin a step towards the rest position. Only call while the stick is idle.
+     * @param value Filtered axis value (raw ADC).
+     */
+    void recenter(int value);
+
+    /**
+     * @brief Offset of a value from the origin, scaled so that the travel on its side maps to JOY_AXIS_SPAN.
+     * @param value Filtered axis value (raw ADC).
+     */
+    int scale(int value) const;
+
+    /**
+     * @brief Median of a set of samples. Reorders the samples.
+     */
+    static int median(int *samples, int count);
+};
+
+#endif //AXISCALIBRATION_H
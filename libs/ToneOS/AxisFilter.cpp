@@ -0,0 +1,60 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "AxisFilter.h"
+
+void AxisFilter::setType(JoyFilter filter, int value) {
+    type = filter;
+    reset(value);
+}
+
+JoyFilter AxisFilter::getType() const {
+    return type;
+}
+
+void AxisFilter::reset(int value) {
+    for (int i = 0; i < JOY_MA_WINDOW; i++) {
+        window[i] = value;
+    }
+    windowSum = (long) value * JOY_MA_WINDOW;
+    windowIndex = 0;
+    ema = (long) value << 8;
+    euroValue = value;
+    euroSpeed = 0;
+    lastTime = millis();
+}
+
+float AxisFilter::lowPassAlpha(float cutoff, float dt) {
+    float tau = 1.0f / (2.0f * PI * cutoff);
+    return 1.0f / (1.0f + tau / dt);
+}
+
+int AxisFilter::apply(int value, unsigned long now) {
+    switch (type) {
+        case JOY_FILTER_MOVING_AVERAGE:
+            windowSum += value - window[windowIndex];
+            window[windowIndex] = value;
+            windowIndex = (windowIndex + 1) % JOY_MA_WINDOW;
+            return windowSum / JOY_MA_WINDOW;
+
+        case JOY_FILTER_EXPONENTIAL:
+            ema += (((long) value << 8) - ema) * JOY_EMA_ALPHA / 256;
+            return (ema + 128) >> 8;
+
+        case JOY_FILTER_ONE_EURO: {
+            float dt = (now - lastTime) / 1000.0f;
+            lastTime = now;
+            if (dt <= 0) return (int) round(euroValue);
+            float speed = (value - euroValue) / dt;
+            euroSpeed += lowPassAlpha(JOY_EURO_D_CUTOFF, dt) * (speed - euroSpeed);
+            float cutoff = JOY_EURO_MIN_CUTOFF + JOY_EURO_BETA * fabsf(euroSpeed);
+            euroValue += lowPassAlpha(cutoff, dt) * (value - euroValue);
+            return (int) round(euroValue);
+        }
+
+        case JOY_FILTER_NONE:
+        default:
+            return value;
+    }
+}
@@ -0,0 +1,86 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef AXISFILTER_H
+#define AXISFILTER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Window length of the moving average filter (samples).
+ */
+#define JOY_MA_WINDOW 4
+
+/**
+ * @brief Smoothing factor of the exponential filter in 1/256 (higher follows faster).
+ */
+#define JOY_EMA_ALPHA 64
+
+/**
+ * @brief 1€ filter tuning: minimum cutoff (Hz), speed coefficient and derivative cutoff (Hz).
+ */
+#define JOY_EURO_MIN_CUTOFF 1.0f
+#define JOY_EURO_BETA 0.005f
+#define JOY_EURO_D_CUTOFF 1.0f
+
+/**
+ * @brief Filters that can be applied to a joystick axis.
+ */
+enum JoyFilter {
+    JOY_FILTER_NONE,           ///< Raw (oversampled) value
+    JOY_FILTER_MOVING_AVERAGE, ///< Average of the last JOY_MA_WINDOW samples
+    JOY_FILTER_EXPONENTIAL,    ///< Integer exponential moving average
+    JOY_FILTER_ONE_EURO        ///< Speed adaptive 1€ low-pass filter
+};
+
+/**
+ * @brief AxisFilter denoises the samples of a single joystick axis.
+ */
+class AxisFilter {
+private:
+    JoyFilter type = JOY_FILTER_EXPONENTIAL;
+    int window[JOY_MA_WINDOW] = {}; ///< Last samples for the moving average
+    long windowSum = 0;             ///< Sum of the window
+    int windowIndex = 0;            ///< Next slot to overwrite in the window
+    long ema = 0;                   ///< Exponential average in 1/256 units
+    float euroValue = 0;            ///< Last 1€ output
+    float euroSpeed = 0;            ///< Filtered derivative of the 1€ input
+    unsigned long lastTime = 0;     ///< millis() of the previous sample
+
+    /**
+     * @brief Smoothing factor of a first order low-pass filter.
+     * @param cutoff Cutoff frequency in Hz.
+     * @param dt Sample period in seconds.
+     */
+    static float lowPassAlpha(float cutoff, float dt);
+
+public:
+    /**
+     * @brief Selects the filter type and resets its state to the given value.
+     * @param filter Filter to use.
+     * @param value Value to start from.
+     */
+    void setType(JoyFilter filter, int value);
+
+    /**
+     * @brief Returns the selected filter type.
+     */
+    JoyFilter getType() const;
+
+    /**
+     * @brief Resets the filter state so that the output equals the given value.
+     * @param value Value to start from.
+     */
+    void reset(int value);
+
+    /**
+     * @brief Feeds a new sample through the filter.
+     * @param value The new (oversampled) axis value.
+     * @param now millis() timestamp of the sample.
+     * @return int The filtered value.
+     */
+    int apply(int value, unsigned long now);
+};
+
+#endif //AXISFILTER_H
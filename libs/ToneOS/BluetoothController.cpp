@@ -4,13 +4,15 @@
 
 #include "BluetoothController.h"
 
+BluetoothController *BluetoothController::_gattsController = nullptr;
+
 /**
  * @brief BluetoothController handles Bluetooth Low Energy (BLE) communication.
  * It initializes the BLE server, manages connections, and sends/receives data.
  * @param deviceName Name of the Bluetooth device.
  */
 BluetoothController::BluetoothController(const String &deviceName)
-    : _deviceName(deviceName), _isConnected(false), _hasClient(false) {
+    : _deviceName(deviceName) {
     BLEDevice::init(_deviceName);
     _bleServer = BLEDevice::createServer();
     _bleAdvertising = _bleServer->getAdvertising();
@@ -29,6 +31,9 @@ BluetoothController::BluetoothController(const String &deviceName)
  */
 void BluetoothController::begin() {
     BLEDevice::init(_deviceName.c_str());
+    BLEDevice::setMTU(BLE_LOCAL_MTU);
+    _gattsController = this;
+    BLEDevice::setCustomGattsHandler(&BluetoothController::onGattsEvent);
 
     _bleServer = BLEDevice::createServer();
     _bleServer->setCallbacks(new MyServerCallbacks(this));
@@ -42,30 +47,101 @@ void BluetoothController::begin() {
         BLECharacteristic::PROPERTY_WRITE
     );
 
-    _bleCharacteristic->addDescriptor(new BLE2902());
+    _stateCccd = new BLE2902();
+    _bleCharacteristic->addDescriptor(_stateCccd);
+    _bleCharacteristic->setCallbacks(new MyCharacteristicCallbacks(this));
     _bleCharacteristic->setValue("Ready");
+
+#if TONE_METRICS
+    _metricsCharacteristic = _bleService->createCharacteristic(
+        METRICS_CHARACTERISTIC_UUID,
+        BLECharacteristic::PROPERTY_READ |
+        BLECharacteristic::PROPERTY_NOTIFY
+    );
+    _metricsCccd = new BLE2902();
+    _metricsCharacteristic->addDescriptor(_metricsCccd);
+    _metricsCharacteristic->setCallbacks(new MyMetricsCallbacks());
+#endif
     _bleService->start();
 
     _bleAdvertising = BLEDevice::getAdvertising();
     _bleAdvertising->addServiceUUID(SERVICE_UUID);
+    _bleAdvertising->setMinInterval(ADVERTISE_FAST_MIN);
+    _bleAdvertising->setMaxInterval(ADVERTISE_FAST_MAX);
     _bleAdvertising->start();
 }
 
 /**
- * @brief Updates the Bluetooth connection state.
- * This method checks if the device is connected and starts advertising if it is.
+ * @brief Sends queued states and restarts advertising while there is room for another client. Notify task only.
+ * States are published at the fastest client's rate, one frame carrying a state of every channel that
+ * has one pending; every client then gets at most one frame per own connection interval: one notification
+ * per connection event.
+ * @param now Current millis() timestamp.
  */
-void BluetoothController::update() {
-    if (_isConnected) {
+void BluetoothController::update(unsigned long now) {
+    bool slow = _slowAdvertising;
+    bool advertising = _clientCount < TONE_MAX_CLIENTS;
+    if (slow != _appliedSlowAdvertising) {
+        _appliedSlowAdvertising = slow;
+        _bleAdvertising->setMinInterval(slow ? ADVERTISE_SLOW_MIN : ADVERTISE_FAST_MIN);
+        _bleAdvertising->setMaxInterval(slow ? ADVERTISE_SLOW_MAX : ADVERTISE_FAST_MAX);
+        // New intervals take effect when advertising starts
+        if (advertising && !_restartAdvertising) {
+            _bleAdvertising->stop();
+            _bleAdvertising->start();
+        }
+    }
+
+    if (_restartAdvertising && advertising && now - _connectionChangedAt >= ADVERTISE_RESTART_MS) {
+        _restartAdvertising = false;
         BLEDevice::startAdvertising();
+        Serial.println("[BLE] - Advertising restarted.");
+    }
+
+    this->applyClientEvents();
+    this->sendMessages();
+    if (_fullFrameRequested.exchange(false)) {
+        _fanout.requestFullFrame();
+    }
+
+    if (_statesFlushed.exchange(false)) {
+        toneState state;
+        for (StateMailbox<toneState> &mailbox : _outbox) {
+            if (mailbox.take(state)) {
+                _scheduler.submit(state);
+            }
+        }
+    }
+    toneState states[TONE_MAX_CHANNELS];
+    uint8_t count = _scheduler.next(now, states);
+    if (count > 0) {
+        _fanout.publish(states, count);
+    }
+
+    // Frames wait while a message is part sent, they share its characteristic and would split it
+    fanoutSend send;
+    while (_messageSlots == 0 && _fanout.next(now, send)) {
+        uint16_t handle = _bleCharacteristic->getHandle();
+        if (this->notifyClient(send.connId, send.mtu, send.data, send.length, handle) < send.length) {
+            _fanout.lost(send.connId);
+        }
     }
+
+#if TONE_METRICS
+    uint8_t snapshot[METRIC_SNAPSHOT_SIZE];
+    size_t length = 0;
+    while (_fanout.nextMetrics(now, send)) {
+        if (length == 0) length = ToneMetrics::encode(snapshot, sizeof(snapshot));
+        this->notifyClient(send.connId, send.mtu, snapshot, length, _metricsCharacteristic->getHandle());
+    }
+#endif
 }
 
 /**
  * @brief Logs a message in JSON format.
  * @param message The message to log.
  */
-void BluetoothController::log(const String &message) {
+void BluetoothController::log(const char *message) {
     Serial.println(message);
 }
 
@@ -74,9 +150,9 @@ void BluetoothController::log(const String &message) {
  * @param key The key of the data.
  * @param value The value of the data.
  */
-void BluetoothController::log(const String &key, const String &value) {
-    String message = "{\"" + key + "\": \"" + value + "\"}";
-    Serial.println(message);
+void BluetoothController::log(const char *key, const char *value) {
+    const KVP data[1] = {{key, value}};
+    log(data);
 }
 
 /**
@@ -85,15 +161,9 @@ void BluetoothController::log(const String &key, const String &value) {
  * @param numKVP Number of key-value pairs.
  */
 void BluetoothController::log(const KVP *kvp, int numKVP) {
-    String message = "{";
-    for (int i = 0; i < numKVP; i++) {
-        message += "\"" + String(kvp[i].key) + "\": \"" + String(kvp[i].value) + "\"";
-        if (i < numKVP - 1) {
-            message += ", ";
-        }
-    }
-    message += "}";
-    Serial.println(message);
+    JsonMessage<KVP_MAX_FIELDS> message;
+    message.appendJson(kvp, min(numKVP, KVP_MAX_FIELDS));
+    Serial.println(message.c_str());
 }
 
 /**
@@ -101,7 +171,7 @@ void BluetoothController::log(const KVP *kvp, int numKVP) {
  * This method starts advertising the BLE service and makes the device discoverable.
  */
 void BluetoothController::connect() {
-    if (!_isConnected) {
+    if (_clientCount < TONE_MAX_CLIENTS) {
         _bleServer->startAdvertising();
         Serial.println("[BLE] - Bluetooth device is now discoverable.");
     }
@@ -112,7 +182,7 @@ void BluetoothController::connect() {
  * This method stops advertising the BLE service and makes the device undiscoverable.
  */
 void BluetoothController::disconnect() {
-    if (_isConnected) {
+    if (isConnected()) {
         _bleAdvertising->stop();
         Serial.println("[BLE] - Bluetooth device is no longer discoverable.");
     }
@@ -123,32 +193,270 @@ void BluetoothController::disconnect() {
  * @param kvp Array of key-value pairs to send.
  * @param numKVP Number of key-value pairs.
  */
-void BluetoothController::sendData(const KVP *kvp, int numKVP) {
-    String message = "{";
-    for (int i = 0; i < numKVP; i++) {
-        message += "\"" + String(kvp[i].key) + "\": \"" + String(kvp[i].value) + "\"";
-        if (i < numKVP - 1) {
-            message += ", ";
+void BluetoothController::sendData(const KVP *kvp, int numKVP, uint16_t to) {
+    JsonMessage<KVP_MAX_FIELDS> message;
+    message.appendJson(kvp, min(numKVP, KVP_MAX_FIELDS));
+    notify((const uint8_t *) message.c_str(), message.size(), to);
+}
+
+/**
+ * @brief Sends a line of text over BLE followed by a newline.
+ * @param text NUL terminated text, up to BLE_TEXT_MAX characters are sent.
+ * @param to Connection id of the client, TONE_ALL_CLIENTS for every client.
+ */
+void BluetoothController::sendText(const char *text, uint16_t to) {
+    // The newline ends a line that fills its last notification
+    char line[BLE_TEXT_MAX + 1];
+    size_t length = strnlen(text, BLE_TEXT_MAX);
+    memcpy(line, text, length);
+    line[length++] = '\n';
+    notify((const uint8_t *) line, length, to);
+}
+
+/**
+ * @brief Posts the state of a mode for sending, lock-free. Input task only.
+ * @param state State to send.
+ */
+void BluetoothController::sendState(const toneState &state) {
+    if (state.modeIndex < NOTIFY_MAX_MODES && state.channel < TONE_MAX_CHANNELS) {
+        _outbox[state.channel * NOTIFY_MAX_MODES + state.modeIndex].post(state);
+    }
+}
+
+/**
+ * @brief Releases the states posted since the last call to the notify task. Input task only.
+ */
+void BluetoothController::flushStates() {
+    _statesFlushed = true;
+}
+
+/**
+ * @brief Selects the slow advertising interval while no client is connected.
+ * @param slow true for ADVERTISE_SLOW_*, false for ADVERTISE_FAST_*.
+ */
+void BluetoothController::setSlowAdvertising(bool slow) {
+    _slowAdvertising = slow;
+}
+
+/**
+ * @brief Returns the notification scheduler (rate limit and statistics).
+ */
+const NotifyScheduler &BluetoothController::getScheduler() const {
+    return _scheduler;
+}
+
+/**
+ * @brief Queues a payload for the notify task, which sends it to one or all clients within their MTU.
+ * @param data Payload.
+ * @param length Payload length in bytes.
+ * @param to Connection id of the client, TONE_ALL_CLIENTS for every client.
+ */
+void BluetoothController::notify(const uint8_t *data, size_t length, uint16_t to) {
+    outgoingMessage message;
+    message.to = to;
+    message.length = min(length, (size_t) BLE_MESSAGE_MAX);
+    memcpy(message.data, data, message.length);
+    if (!_messages.push(message)) {
+        _messagesDropped++;
+    }
+}
+
+#if TONE_METRICS
+/**
+ * @brief Subscribes a client to live metrics on the metrics characteristic.
+ * @param intervalMs Time between two notifications, 0 stops them.
+ * @return false if the client is not connected.
+ */
+bool BluetoothController::setLiveMetrics(uint16_t to, unsigned long intervalMs) {
+    clientEvent event;
+    event.type = CLIENT_LIVE_METRICS;
+    event.connId = to;
+    event.value = min(intervalMs, 0xFFFFUL);
+    return _inputEvents.push(event);
+}
+#endif
+
+/**
+ * @brief Notifies one client. Parts are MTU-3 bytes (the ATT header takes 3); the receiver finds the end
+ * of a payload that fills its last part in the payload itself, so no empty part follows it.
+ * @return Bytes of the payload sent, less than length if the stack refused a part.
+ */
+size_t BluetoothController::notifyClient(uint16_t connId, uint16_t mtu, const uint8_t *data, size_t length,
+                                         uint16_t handle, size_t offset) {
+    TONE_METRIC_SCOPE(METRIC_NOTIFY);
+    const size_t partMax = mtu - 3;
+    while (offset < length) {
+        size_t part = min(length - offset, partMax);
+        if (esp_ble_gatts_send_indicate(_bleServer->getGattsIf(), connId, handle, part,
+                                        (uint8_t *) data + offset, false) != ESP_OK) {
+            _notifyFailures++;
+            return offset;
         }
+        _bytesSent += part;
+        _notifyCount++;
+        offset += part;
     }
-    message += "}";
-    _bleCharacteristic->setValue(message.c_str());
-    _bleCharacteristic->notify();
+    return offset;
 }
 
 /**
- * @brief Receives data from BLE.
- * This method checks if there is any data available and prints it to the serial monitor.
- * @return The received data as a String.
+ * @brief Sends the queued messages of the input task to their clients, in order.
+ * A message stays current until every client it was taken for got it or left, so a congested link
+ * delays the messages behind it instead of losing them.
  */
-String BluetoothController::receiveData() {
-    if (_bleCharacteristic->getValue().length() > 0) {
-        String data = _bleCharacteristic->getValue().c_str();
-        Serial.println("[BLE] - Received data: " + data);
-        return data;
+void BluetoothController::sendMessages() {
+    for (;;) {
+        if (_messageSlots == 0) {
+            if (!_messages.pop(_message)) return;
+            for (uint8_t slot = 0; slot < TONE_MAX_CLIENTS; slot++) {
+                const fanoutClient &client = _fanout.getSlot(slot);
+                if (!client.active || !client.subscribed) continue;
+                if (_message.to != TONE_ALL_CLIENTS && client.connId != _message.to) continue;
+                _messageSlots |= 1 << slot;
+                _messageConnIds[slot] = client.connId;
+                _messageOffsets[slot] = 0;
+            }
+        }
+
+        for (uint8_t slot = 0; slot < TONE_MAX_CLIENTS; slot++) {
+            if (!(_messageSlots & (1 << slot))) continue;
+            const fanoutClient &client = _fanout.getSlot(slot);
+            // A client that left (or whose slot was taken over) gets nothing more
+            if (client.active && client.subscribed && client.connId == _messageConnIds[slot]) {
+                _messageOffsets[slot] = this->notifyClient(client.connId, client.mtu, _message.data, _message.length,
+                                                           _bleCharacteristic->getHandle(), _messageOffsets[slot]);
+                if (_messageOffsets[slot] < _message.length) continue;
+            }
+            _messageSlots &= ~(1 << slot);
+        }
+        if (_messageSlots != 0) return;
     }
+}
 
-    return "";
+/**
+ * @brief Applies queued connection changes, then the requests of the input task, to the client table.
+ * The scheduler publishes at the rate of the fastest client.
+ */
+void BluetoothController::applyClientEvents() {
+    clientEvent event;
+    bool changed = false;
+    while (_clientEvents.pop(event) || _inputEvents.pop(event)) {
+        switch (event.type) {
+            case CLIENT_CONNECTED:
+                _fanout.addClient(event.connId, event.value ? event.value * 5 / 4 : NOTIFY_DEFAULT_INTERVAL_MS);
+                changed = true;
+                break;
+            case CLIENT_DISCONNECTED:
+                _fanout.removeClient(event.connId);
+                changed = true;
+                break;
+            case CLIENT_MTU:
+                _fanout.setMtu(event.connId, event.value);
+                break;
+            case CLIENT_FORMAT:
+                _fanout.setFormat(event.connId, (ToneFormat) event.value);
+                break;
+            case CLIENT_SUBSCRIBED:
+                _fanout.setSubscribed(event.connId, event.value & 0x0001);
+                break;
+            case CLIENT_METRICS_SUBSCRIBED:
+#if TONE_METRICS
+                _fanout.setMetricsSubscribed(event.connId, event.value & 0x0001);
+#endif
+                break;
+            case CLIENT_LIVE_METRICS:
+#if TONE_METRICS
+                _fanout.setMetricsInterval(event.connId, event.value, millis());
+#endif
+                break;
+        }
+    }
+    if (changed) {
+        _scheduler.setInterval(_fanout.getMinInterval());
+    }
+}
+
+/**
+ * @brief Handles a write to the characteristic.
+ * A format command (CMD_FORMAT) selects the notification format of the writing client here, like any other
+ * command it is then queued for its acknowledgement.
+ * @param value Written value.
+ * @param connId Connection the value was written on.
+ */
+void BluetoothController::onWrite(const std::string &value, uint16_t connId) {
+    toneCommand command;
+    parseToneCommand(value.data(), value.length(), command);
+    command.client = connId;
+    if (command.type == CMD_FORMAT) {
+        clientEvent event;
+        event.type = CLIENT_FORMAT;
+        event.connId = connId;
+        event.value = command.args[0];
+        _clientEvents.push(event);
+        Serial.println(command.args[0] == FORMAT_BINARY ? "[BLE] - Binary notifications enabled."
+                                                        : "[BLE] - JSON notifications enabled.");
+    }
+    if (!_commands.push(command)) {
+        _commandsDropped++;
+    }
+}
+
+/**
+ * @brief Returns the client table and frame statistics. Notify task only.
+ */
+const NotifyFanout &BluetoothController::getFanout() const {
+    return _fanout;
+}
+
+/**
+ * @brief Returns the number of payload bytes sent with notify().
+ */
+unsigned long BluetoothController::getBytesSent() const {
+    return _bytesSent;
+}
+
+/**
+ * @brief Returns the number of notifications sent.
+ */
+unsigned long BluetoothController::getNotifyCount() const {
+    return _notifyCount;
+}
+
+/**
+ * @brief Returns the number of notifications the stack refused.
+ */
+unsigned long BluetoothController::getNotifyFailures() const {
+    return _notifyFailures;
+}
+
+/**
+ * @brief Takes the oldest command written by the host. Main loop only.
+ * @param out Receives the command.
+ * @return true if a command was taken.
+ */
+bool BluetoothController::takeCommand(toneCommand &out) {
+    return _commands.pop(out);
+}
+
+/**
+ * @brief Makes the next binary frame carry name and color again.
+ */
+void BluetoothController::requestFullFrame() {
+    _fullFrameRequested = true;
+}
+
+/**
+ * @brief Returns the number of commands dropped because the queue was full.
+ */
+unsigned long BluetoothController::getCommandsDropped() const {
+    return _commandsDropped;
+}
+
+/**
+ * @brief Returns the number of payloads dropped because the message queue was full.
+ */
+unsigned long BluetoothController::getMessagesDropped() const {
+    return _messagesDropped;
 }
 
 /**
@@ -156,27 +464,101 @@ String BluetoothController::receiveData() {
  * @return true if connected, false otherwise.
  */
 bool BluetoothController::isConnected() const {
-    return _isConnected;
+    return _clientCount > 0;
+}
+
+/**
+ * @brief Returns the number of connected clients.
+ */
+uint8_t BluetoothController::getClientCount() const {
+    return _clientCount;
 }
 
 /**
- * @brief Callback for BLE server connection events.
- * This class handles the connection and disconnection events of the BLE server.
+ * @brief Custom GATT server handler, runs before the BLE library handles the event.
+ * A CCCD write is queued with its connection like the other connection changes.
  */
-void BluetoothController::MyServerCallbacks::onConnect(BLEServer *pServer) {
-    _controller->_isConnected = true;
-    _controller->_hasClient = true;
+void BluetoothController::onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf,
+                                       esp_ble_gatts_cb_param_t *param) {
+    BluetoothController *controller = _gattsController;
+    if (controller == nullptr || event != ESP_GATTS_WRITE_EVT || param->write.is_prep || param->write.len != 2) return;
+
+    clientEvent written;
+    written.connId = param->write.conn_id;
+    written.value = param->write.value[0] | (param->write.value[1] << 8);
+    if (controller->_stateCccd != nullptr && param->write.handle == controller->_stateCccd->getHandle()) {
+        written.type = CLIENT_SUBSCRIBED;
+#if TONE_METRICS
+    } else if (controller->_metricsCccd != nullptr && param->write.handle == controller->_metricsCccd->getHandle()) {
+        written.type = CLIENT_METRICS_SUBSCRIBED;
+#endif
+    } else {
+        return;
+    }
+    controller->_clientEvents.push(written);
+}
+
+/**
+ * @brief Callback for BLE server connection events with connection parameters.
+ * Queues the client with its connection interval and makes room for the next one.
+ */
+void BluetoothController::MyServerCallbacks::onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    clientEvent event;
+    event.type = CLIENT_CONNECTED;
+    event.connId = param->connect.conn_id;
+    event.value = param->connect.conn_params.interval;
+    _controller->_clientEvents.push(event);
+    _controller->_clientCount++;
+    // The stack stops advertising on a connection
+    _controller->_connectionChangedAt = millis();
+    _controller->_restartAdvertising = _controller->_clientCount < TONE_MAX_CLIENTS;
     Serial.println("Client connected.");
 }
 
 /**
  * @brief Callback for BLE server disconnection events.
- * This class handles the disconnection event of the BLE server.
+ * Drops the client and restarts advertising after ADVERTISE_RESTART_MS.
  */
-void BluetoothController::MyServerCallbacks::onDisconnect(BLEServer *pServer) {
-    _controller->_isConnected = false;
-    _controller->_hasClient = false;
+void BluetoothController::MyServerCallbacks::onDisconnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    clientEvent event;
+    event.type = CLIENT_DISCONNECTED;
+    event.connId = param->disconnect.conn_id;
+    _controller->_clientEvents.push(event);
+    if (_controller->_clientCount > 0) _controller->_clientCount--;
+    _controller->_connectionChangedAt = millis();
+    _controller->_restartAdvertising = true;
     Serial.println("[BLE] - Client disconnected.");
 }
 
+/**
+ * @brief Callback for MTU exchanges, notifications to the client are split at its MTU.
+ */
+void BluetoothController::MyServerCallbacks::onMtuChanged(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {
+    clientEvent event;
+    event.type = CLIENT_MTU;
+    event.connId = param->mtu.conn_id;
+    event.value = param->mtu.mtu;
+    _controller->_clientEvents.push(event);
+}
+
+/**
+ * @brief Callback for writes to the BLE characteristic.
+ * Forwards the written value and the writing connection to the controller.
+ */
+void BluetoothController::MyCharacteristicCallbacks::onWrite(BLECharacteristic *pCharacteristic,
+                                                             esp_ble_gatts_cb_param_t *param) {
+    _controller->onWrite(pCharacteristic->getValue(), param->write.conn_id);
+}
+
+#if TONE_METRICS
+/**
+ * @brief Callback for reads of the metrics characteristic.
+ * Encodes the current snapshot into the value the stack answers with.
+ */
+void BluetoothController::MyMetricsCallbacks::onRead(BLECharacteristic *pCharacteristic) {
+    uint8_t snapshot[METRIC_SNAPSHOT_SIZE];
+    pCharacteristic->setValue(snapshot, ToneMetrics::encode(snapshot, sizeof(snapshot)));
+}
+#endif
+
 // End of BluetoothController.cpp
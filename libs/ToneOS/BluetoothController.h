@@ -10,22 +10,119 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include "ToneProtocol.h"
+#include "NotifyScheduler.h"
+#include "NotifyFanout.h"
+#include "MessageWriter.h"
+#include "SpscQueue.h"
+#include "ToneCommand.h"
+#include "StateMailbox.h"
+#include "ToneMetrics.h"
+#include <atomic>
 
 #define SERVICE_UUID        "12345678-1234-1234-1234-1234567890ab"
 #define CHARACTERISTIC_UUID "abcdefab-1234-1234-1234-abcdefabcdef"
 
 /**
- * @brief Key-Value Pair structure for logging data.
- * This structure is used to represent a key-value pair for logging purposes.
+ * @brief Read/notify characteristic carrying the binary metrics snapshot (see ToneMetrics::encode()).
  */
-struct KVP {
-    String key{};
-    String value{};
+#define METRICS_CHARACTERISTIC_UUID "abcdefab-1234-1234-1234-abcdefab0002"
+
+/**
+ * @brief Time between a disconnect and the restart of advertising in milliseconds,
+ * gives the stack time to release the connection.
+ */
+#define ADVERTISE_RESTART_MS 500
+
+/**
+ * @brief Largest ATT MTU the server accepts; each connection uses the smaller of this and the client's.
+ */
+#define BLE_LOCAL_MTU 247
+
+/**
+ * @brief Connection changes that can wait for the notify task: every client connecting, negotiating
+ * its MTU and format, subscribing to both characteristics, and leaving again.
+ */
+#define TONE_CLIENT_EVENTS 24
+
+/**
+ * @brief Longest line sendText() sends, without its newline.
+ */
+#define BLE_TEXT_MAX 127
+
+/**
+ * @brief Largest payload sendData() and sendText() hand to the notify task: a mode snapshot of nine pairs.
+ */
+#define BLE_MESSAGE_MAX JSON_MESSAGE_SIZE(9)
+
+static_assert(BLE_TEXT_MAX + 1 <= BLE_MESSAGE_MAX, "a text line and its newline fit in a message");
+
+/**
+ * @brief Payloads the input task can queue for the notify task: the snapshot of every mode of a channel,
+ * its acknowledgement and a log line.
+ */
+#define TONE_MESSAGE_QUEUE (NOTIFY_MAX_MODES + 2)
+
+/**
+ * @brief Requests of the input task that change the client table (live metrics subscriptions).
+ */
+#define TONE_INPUT_EVENTS 4
+
+/**
+ * @brief Advertising interval range in 0.625 ms units: the stack default, and the slow one
+ * used while the device is idle (1 to 1.25 s).
+ */
+#define ADVERTISE_FAST_MIN 0x20
+#define ADVERTISE_FAST_MAX 0x40
+#define ADVERTISE_SLOW_MIN 0x640
+#define ADVERTISE_SLOW_MAX 0x7D0
+
+/**
+ * @brief Kinds of connection changes handed from the BLE task to the notify task.
+ */
+enum ClientEventType : uint8_t {
+    CLIENT_CONNECTED,    ///< value = connection interval in 1.25 ms units, 0 if unknown
+    CLIENT_DISCONNECTED, ///< No value
+    CLIENT_MTU,          ///< value = negotiated MTU
+    CLIENT_FORMAT,       ///< value = ToneFormat selected by the client
+    CLIENT_SUBSCRIBED,   ///< value = CCCD written for the state characteristic, bit 0 enables notifications
+    CLIENT_METRICS_SUBSCRIBED, ///< value = CCCD written for the metrics characteristic
+    CLIENT_LIVE_METRICS  ///< value = live metrics interval in milliseconds, 0 stops them (input task)
+};
+
+/**
+ * @brief A connection change, copied through the client event queue.
+ */
+struct clientEvent {
+    ClientEventType type = CLIENT_CONNECTED;
+    uint16_t connId = 0;
+    uint16_t value = 0;
+};
+
+/**
+ * @brief A payload of sendData() or sendText(), copied through the message queue to the notify task.
+ */
+struct outgoingMessage {
+    uint16_t to = TONE_ALL_CLIENTS;  ///< Connection id of the client, TONE_ALL_CLIENTS for every client
+    uint16_t length = 0;             ///< Payload length in bytes
+    uint8_t data[BLE_MESSAGE_MAX];   ///< Payload
 };
 
 /**
  * @brief BluetoothController handles Bluetooth Low Energy (BLE) communication.
  * It initializes the BLE server, manages connections, and sends/receives data.
+ * Up to TONE_MAX_CLIENTS clients can be connected at once; each has its own MTU and format,
+ * and states reach all of them through NotifyFanout. Only clients that enabled notifications in the CCCD
+ * of a characteristic are notified on it. Payloads longer than a client's MTU allows are split into MTU-3
+ * byte notifications; a shorter notification ends a payload, and so does a full one that completes it
+ * (every payload is self-delimiting: binary frames and snapshots by their layout, JSON by its closing
+ * bracket and text lines by their newline).
+ *
+ * Three tasks touch it: the BLE stack (callbacks), the input task (sendState(), flushStates(), takeCommand(), sendData())
+ * and the notify task (update()). They share only atomics and lock-free handoffs: state mailboxes, and queues for
+ * commands, client events and outgoing messages. Only the notify task touches the client table and sends, so the
+ * input task never waits for the radio. A message the link refuses is continued by the next update(), and
+ * state frames wait behind it. All three may be the same loop.
  */
 class BluetoothController {
 public:
@@ -42,14 +139,25 @@ public:
     void begin();
 
     /**
-     * @brief Updates the Bluetooth connection state.
-     * This method checks if the device is connected and starts advertising if it is.
+     * @brief Sends queued states and restarts advertising after a disconnect. Notify task only.
+     * Should be called on every loop iteration.
+     * @param now Current millis() timestamp.
      */
-    void update();
+    void update(unsigned long now);
+
+    void log(const char *message);  // Logs messages in JSON format
+    void log(const char *key, const char *value);  // Logs key-value pairs in JSON format
+    void log(const KVP *kvp, int numKVP);  // Logs up to KVP_MAX_FIELDS key-value pairs
 
-    void log(const String &message);  // Logs messages in JSON format
-    void log(const String &key, const String &value);  // Logs key-value pairs in JSON format
-    void log(const KVP *kvp, int numKVP);  // Logs multiple key-value pairs
+    /**
+     * @brief Logs key-value pairs in JSON format using a buffer sized for N pairs.
+     * @param kvp Array of key-value pairs.
+     */
+    template<size_t N>
+    void log(const KVP (&kvp)[N]) {
+        JsonMessage<N> message(kvp);
+        Serial.println(message.c_str());
+    }
 
     void connect();  // Connects to the BLE device
     void disconnect();  // Disconnects from the BLE device
@@ -57,41 +165,220 @@ public:
     /**
      * @brief Sends data over BLE.
      * @param kvp Array of key-value pairs to send.
-     * @param numKVP Number of key-value pairs.
+     * @param numKVP Number of key-value pairs (up to KVP_MAX_FIELDS).
+     * @param to Connection id of the client, TONE_ALL_CLIENTS for every client.
+     */
+    void sendData(const KVP *kvp, int numKVP, uint16_t to = TONE_ALL_CLIENTS);
+
+    /**
+     * @brief Sends key-value pairs over BLE using a buffer sized for N pairs.
+     * @param kvp Array of key-value pairs to send.
+     * @param to Connection id of the client, TONE_ALL_CLIENTS for every client.
+     */
+    template<size_t N>
+    void sendData(const KVP (&kvp)[N], uint16_t to = TONE_ALL_CLIENTS) {
+        JsonMessage<N> message(kvp);
+        notify((const uint8_t *) message.c_str(), message.size(), to);
+    }
+
+    /**
+     * @brief Sends a line of text over BLE followed by a newline (log dumps).
+     * @param text NUL terminated text.
+     * @param to Connection id of the client, TONE_ALL_CLIENTS for every client.
+     */
+    void sendText(const char *text, uint16_t to = TONE_ALL_CLIENTS);
+
+#if TONE_METRICS
+    /**
+     * @brief Notifies a client of the metrics snapshot every intervalMs, on the metrics characteristic.
+     * Applied by the notify task on its next update(). Reads of the characteristic always return a fresh
+     * snapshot. Input task only.
+     * @param intervalMs Time between two notifications, 0 stops them.
+     * @return false if the request queue is full.
+     */
+    bool setLiveMetrics(uint16_t to, unsigned long intervalMs);
+#endif
+
+    /**
+     * @brief Posts the state of a channel's mode for sending, lock-free. Input task only.
+     * Intermediate states of the same mode are coalesced, see update(). The state is picked up
+     * after the next flushStates().
+     * @param state State to send.
+     */
+    void sendState(const toneState &state);
+
+    /**
+     * @brief Releases the states posted since the last call to the notify task, lock-free. Input task only.
+     * Call once per input tick, so the states of all channels from one tick go out in one notification.
      */
-    void sendData(const KVP *kvp, int numKVP);
+    void flushStates();
 
     /**
-     * @brief Receives data from BLE.
-     * This method checks if there is any data available and prints it to the serial monitor.
+     * @brief Selects the slow advertising interval while no client is connected, to save power.
+     * Applied by the notify task on its next update().
+     * @param slow true for ADVERTISE_SLOW_*, false for ADVERTISE_FAST_*.
      */
-    String receiveData();  // Receives data from BLE
+    void setSlowAdvertising(bool slow);
+
+    /**
+     * @brief Returns the notification scheduler (rate limit and statistics).
+     */
+    const NotifyScheduler &getScheduler() const;
+
+    /**
+     * @brief Returns the client table and frame statistics. Notify task only.
+     */
+    const NotifyFanout &getFanout() const;
+
+    /**
+     * @brief Returns the number of payload bytes notified, over all clients.
+     */
+    unsigned long getBytesSent() const;
+
+    /**
+     * @brief Returns the number of notifications sent, over all clients (a split payload counts once per part).
+     */
+    unsigned long getNotifyCount() const;
+
+    /**
+     * @brief Returns the number of notifications the stack refused (congested link).
+     */
+    unsigned long getNotifyFailures() const;
+
+    /**
+     * @brief Takes the oldest command written by the host. Main loop only.
+     * @param out Receives the command, CMD_INVALID commands still need to be acknowledged.
+     * @return true if a command was taken.
+     */
+    bool takeCommand(toneCommand &out);
+
+    /**
+     * @brief Makes the next binary frame carry name and color again.
+     */
+    void requestFullFrame();
+
+    /**
+     * @brief Returns the number of commands dropped because the queue was full.
+     */
+    unsigned long getCommandsDropped() const;
+
+    /**
+     * @brief Returns the number of sendData() and sendText() payloads dropped because the queue was full.
+     */
+    unsigned long getMessagesDropped() const;
 
     /**
      * @brief Checks if the device is connected.
-     * @return true if connected, false otherwise.
+     * @return true if at least one client is connected, false otherwise.
      */
     bool isConnected() const;  // Checks if the device is connected
 
+    uint8_t getClientCount() const;  // Number of connected clients
+
 private:
     int _baudRate{};
     String _deviceName{};
-    bool _isConnected;
-    bool _hasClient;
+    std::atomic<uint8_t> _clientCount{0};  // Connected clients, written from the BLE task
+    std::atomic<bool> _restartAdvertising{false};  // Room for another client, advertising has to be restarted
+    std::atomic<unsigned long> _connectionChangedAt{0};  // millis() of the last connect or disconnect
+    std::atomic<bool> _slowAdvertising{false};  // Requested advertising interval, written from the input task
+    bool _appliedSlowAdvertising = false;  // Advertising interval in use
     BLEServer* _bleServer{};  // BLE server object
     BLEAdvertising* _bleAdvertising{};  // Advertising object for discoverability
     BLEService* _bleService{};  // BLE service
     BLECharacteristic* _bleCharacteristic{};  // BLE characteristic for communication
+    BLE2902* _stateCccd{};  // Client configuration of _bleCharacteristic, written per connection
+#if TONE_METRICS
+    BLECharacteristic* _metricsCharacteristic{};  // Metrics snapshot, read or notified
+    BLE2902* _metricsCccd{};  // Client configuration of _metricsCharacteristic
+#endif
+    static BluetoothController* _gattsController;  // Controller onGattsEvent() hands CCCD writes to
+    std::atomic<bool> _fullFrameRequested{false};  // Next binary frame of every client must be a full one
+    NotifyScheduler _scheduler{};  // Coalesces states and publishes them at the fastest client's rate
+    NotifyFanout _fanout{};  // Client table, shared frames and per client queues, notify task only
+    SpscQueue<clientEvent, TONE_CLIENT_EVENTS + 1> _clientEvents{};  // BLE task to _fanout
+    SpscQueue<clientEvent, TONE_INPUT_EVENTS + 1> _inputEvents{};  // Input task to _fanout
+    unsigned long _bytesSent = 0;  // Payload bytes notified
+    std::atomic<unsigned long> _notifyCount{0};  // Number of notifications sent, read from the input task
+    unsigned long _notifyFailures = 0;  // Notifications refused by the stack
+    SpscQueue<outgoingMessage, TONE_MESSAGE_QUEUE + 1> _messages{};  // sendData()/sendText(), input to notify task
+    outgoingMessage _message{};  // Message being sent by the notify task
+    uint8_t _messageSlots = 0;  // Client slots _message still has to reach, bit per slot
+    uint16_t _messageConnIds[TONE_MAX_CLIENTS] = {};  // Connection each slot of _messageSlots was taken for
+    size_t _messageOffsets[TONE_MAX_CLIENTS] = {};  // Bytes of _message each client got
+    std::atomic<unsigned long> _messagesDropped{0};  // Payloads lost to a full queue, written from the input task
+    StateMailbox<toneState> _outbox[NOTIFY_SLOTS];  // Latest state per channel mode, input task to notify task
+    std::atomic<bool> _statesFlushed{false};  // _outbox holds the states of a finished input tick
+    SpscQueue<toneCommand, TONE_COMMAND_QUEUE + 1> _commands{};  // Parsed writes, BLE task to main loop
+    std::atomic<unsigned long> _commandsDropped{0};  // Writes lost to a full queue, written from the BLE task
+
+    /**
+     * @brief Handles a write to the characteristic (format negotiation, other writes are parsed and queued for takeCommand()).
+     * @param value Written value.
+     * @param connId Connection the value was written on.
+     */
+    void onWrite(const std::string &value, uint16_t connId);
+
+    /**
+     * @brief Custom GATT server handler, queues the CCCD writes of every connection as client events.
+     * The BLE library keeps a single CCCD value for all connections, so the writes are tracked here. BLE task.
+     */
+    static void onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t *param);
+
+    /**
+     * @brief Applies queued connection changes and input task requests to the client table. Notify task only.
+     */
+    void applyClientEvents();
+
+    /**
+     * @brief Queues a payload for one or all subscribed clients, sent by the next update(). Input task only.
+     * @param data Payload, at most BLE_MESSAGE_MAX bytes.
+     * @param length Payload length in bytes.
+     * @param to Connection id of the client, TONE_ALL_CLIENTS for every client.
+     */
+    void notify(const uint8_t *data, size_t length, uint16_t to);
+
+    /**
+     * @brief Notifies one client, split into MTU sized parts; nothing for an empty payload. Notify task only.
+     * @param handle Attribute handle of the characteristic to notify.
+     * @param offset Bytes of the payload sent before, to continue a payload the stack refused.
+     * @return Bytes of the payload sent, less than length if the stack refused a part.
+     */
+    size_t notifyClient(uint16_t connId, uint16_t mtu, const uint8_t *data, size_t length, uint16_t handle,
+                        size_t offset = 0);
+
+    /**
+     * @brief Sends the queued messages in order. One the stack refuses, and the ones after it, are sent
+     * by the next update(), continuing where the refused one stopped. Notify task only.
+     */
+    void sendMessages();
 
     class MyServerCallbacks : public BLEServerCallbacks {  // Callback class for BLE connection events
     public:
         explicit MyServerCallbacks(BluetoothController* controller) : _controller(controller) {}
-        void onConnect(BLEServer* pServer) override;
-        void onDisconnect(BLEServer* pServer) override;
+        void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
+        void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
+        void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
 
     private:
         BluetoothController* _controller;
     };
+
+    class MyCharacteristicCallbacks : public BLECharacteristicCallbacks {  // Callback class for BLE writes
+    public:
+        explicit MyCharacteristicCallbacks(BluetoothController* controller) : _controller(controller) {}
+        void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) override;
+
+    private:
+        BluetoothController* _controller;
+    };
+
+#if TONE_METRICS
+    class MyMetricsCallbacks : public BLECharacteristicCallbacks {  // Refreshes the snapshot before every read
+    public:
+        void onRead(BLECharacteristic* pCharacteristic) override;
+    };
+#endif
 };
 
 #endif  // BluetoothController_h
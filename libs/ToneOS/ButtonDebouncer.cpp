@@ -0,0 +1,108 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "ButtonDebouncer.h"
+
+void ButtonDebouncer::emit(ButtonEvent event) {
+    if (eventCount < BUTTON_EVENT_QUEUE) {
+        events[(eventHead + eventCount) % BUTTON_EVENT_QUEUE] = event;
+        eventCount++;
+    }
+}
+
+void ButtonDebouncer::accept(bool pressed, unsigned long time) {
+    stable = pressed;
+    if (pressed) {
+        pressedAt = time;
+        longSent = false;
+        if (awaitingSecond) {
+            awaitingSecond = false;
+            if (time - releasedAt <= BUTTON_DOUBLE_MS) secondPress = true;
+            else emit(BUTTON_SHORT);
+        }
+        return;
+    }
+
+    if (longSent) {
+        secondPress = false;
+    } else if (secondPress) {
+        secondPress = false;
+        emit(BUTTON_DOUBLE);
+    } else {
+        awaitingSecond = true;
+        releasedAt = time;
+    }
+}
+
+void ButtonDebouncer::tick(unsigned long now) {
+    // The raw level has held long enough to be real
+    if (level != stable && now - levelAt >= BUTTON_DEBOUNCE_MS) {
+        accept(level, levelAt);
+    }
+
+    if (stable && !longSent && now - pressedAt >= BUTTON_LONG_MS) {
+        longSent = true;
+        if (secondPress) {
+            secondPress = false;
+            emit(BUTTON_SHORT);
+        }
+        emit(BUTTON_LONG);
+    }
+
+    // No second press in time; wait while a press that started within the gap is still bouncing
+    bool secondPending = level && levelAt - releasedAt <= BUTTON_DOUBLE_MS;
+    if (awaitingSecond && !secondPending && now - releasedAt > BUTTON_DOUBLE_MS) {
+        awaitingSecond = false;
+        emit(BUTTON_SHORT);
+    }
+}
+
+void ButtonDebouncer::addEdge(const buttonEdge &edge) {
+    tick(edge.time);
+    level = edge.pressed;
+    levelAt = edge.time;
+}
+
+ButtonEvent ButtonDebouncer::update(unsigned long now) {
+    // An edge may be timestamped after the caller read the clock
+    if ((long) (now - levelAt) < 0) now = levelAt;
+    tick(now);
+    if (eventCount == 0) return BUTTON_NONE;
+
+    ButtonEvent event = events[eventHead];
+    eventHead = (eventHead + 1) % BUTTON_EVENT_QUEUE;
+    eventCount--;
+    return event;
+}
+
+bool ButtonDebouncer::isPressed() const {
+    return stable;
+}
+
+void ButtonDebouncer::reset(bool pressed, unsigned long now) {
+    stable = level = pressed;
+    levelAt = pressedAt = now;
+    longSent = pressed; // A press held through the reset is not a gesture
+    awaitingSecond = secondPress = false;
+    eventHead = eventCount = 0;
+}
+
+buttonSnapshot ButtonDebouncer::snapshot() const {
+    buttonSnapshot state;
+    state.pressed = stable;
+    state.longSent = longSent;
+    state.awaitingSecond = awaitingSecond;
+    state.secondPress = secondPress;
+    state.since = stable ? pressedAt : releasedAt;
+    return state;
+}
+
+void ButtonDebouncer::restore(const buttonSnapshot &state) {
+    stable = level = state.pressed;
+    levelAt = pressedAt = releasedAt = state.since;
+    longSent = state.longSent;
+    awaitingSecond = state.awaitingSecond;
+    secondPress = state.secondPress;
+    eventHead = eventCount = 0;
+}
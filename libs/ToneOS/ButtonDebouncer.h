@@ -0,0 +1,118 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef BUTTONDEBOUNCER_H
+#define BUTTONDEBOUNCER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Time in milliseconds the button level must hold after an edge, measured between edge timestamps,
+ * before the edge is accepted. Not a lockout: a bounce restarts the wait from the new edge.
+ */
+#define BUTTON_DEBOUNCE_MS 30
+
+/**
+ * @brief Hold time that turns a press into a long press, in milliseconds.
+ */
+#define BUTTON_LONG_MS 600
+
+/**
+ * @brief Longest gap between the release of a short press and the next press of a double press, in milliseconds.
+ * A short press is reported once this gap has passed without a second press.
+ */
+#define BUTTON_DOUBLE_MS 250
+
+/**
+ * @brief Events ButtonDebouncer holds until update() returns them.
+ */
+#define BUTTON_EVENT_QUEUE 4
+
+/**
+ * @brief Gestures reported by ButtonDebouncer.
+ */
+enum ButtonEvent : uint8_t {
+    BUTTON_NONE,   ///< No event
+    BUTTON_SHORT,  ///< Pressed and released once, shorter than BUTTON_LONG_MS
+    BUTTON_LONG,   ///< Held for BUTTON_LONG_MS (reported while still held)
+    BUTTON_DOUBLE  ///< Two short presses within BUTTON_DOUBLE_MS
+};
+
+/**
+ * @brief A raw level change of the button, timestamped by the interrupt handler.
+ */
+struct buttonEdge {
+    unsigned long time; ///< millis() of the edge
+    bool pressed;       ///< Level after the edge
+};
+
+/**
+ * @brief Debounced state of a ButtonDebouncer, enough to continue a gesture from another point in time.
+ */
+struct buttonSnapshot {
+    bool pressed = false;        ///< Debounced level
+    bool longSent = false;       ///< The current press has been reported as long
+    bool awaitingSecond = false; ///< A short press was released, a second one would make it double
+    bool secondPress = false;    ///< The current press is the second one of a possible double press
+    unsigned long since = 0;     ///< millis() the current press was accepted, or the last short press released
+};
+
+/**
+ * @brief ButtonDebouncer turns timestamped, bouncing button edges into gestures.
+ * An edge is accepted once the level has been stable for BUTTON_DEBOUNCE_MS, measured between edge
+ * timestamps, so the result does not depend on how often update() runs. Never blocks.
+ */
+class ButtonDebouncer {
+private:
+    bool stable = false; ///< Debounced level
+    bool level = false; ///< Level after the last raw edge
+    unsigned long levelAt = 0; ///< Time of the last raw edge
+    unsigned long pressedAt = 0; ///< Time the current press was accepted
+    unsigned long releasedAt = 0; ///< Time the last short press was released
+    bool longSent = false; ///< The current press has been reported as long
+    bool awaitingSecond = false; ///< A short press was released, a second one would make it double
+    bool secondPress = false; ///< The current press is the second one of a possible double press
+    ButtonEvent events[BUTTON_EVENT_QUEUE] = {}; ///< Ring of events not yet returned by update()
+    uint8_t eventHead = 0, eventCount = 0;
+
+    void emit(ButtonEvent event);  // Queues an event, dropped if the ring is full
+    void accept(bool pressed, unsigned long time);  // Applies a debounced level change
+    void tick(unsigned long now);  // Runs debounce, long press and double press timers up to now
+
+public:
+    /**
+     * @brief Feeds a raw edge. Edges must be fed in time order.
+     * @param edge Level change and its timestamp.
+     */
+    void addEdge(const buttonEdge &edge);
+
+    /**
+     * @brief Advances the timers and returns the next gesture.
+     * @param now Current millis() timestamp.
+     * @return ButtonEvent Next event, BUTTON_NONE if there is none. Call until it returns BUTTON_NONE.
+     */
+    ButtonEvent update(unsigned long now);
+
+    /**
+     * @brief Returns the debounced level.
+     */
+    bool isPressed() const;
+
+    /**
+     * @brief Forgets the pending gesture and starts from the given level.
+     */
+    void reset(bool pressed, unsigned long now);
+
+    /**
+     * @brief Returns the debounced state. A bounce that has not settled yet is not part of it.
+     */
+    buttonSnapshot snapshot() const;
+
+    /**
+     * @brief Continues from a snapshot, e.g. a replay starting at an event log keyframe. Queued events are dropped.
+     */
+    void restore(const buttonSnapshot &state);
+};
+
+#endif //BUTTONDEBOUNCER_H
@@ -0,0 +1,223 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "EventRecorder.h"
+
+void EventRecorder::put(uint8_t byte) {
+    ring[head] = byte;
+    head = (head + 1) & (RECORDER_BYTES - 1);
+}
+
+uint8_t EventRecorder::peek(size_t offset) const {
+    return ring[(tail + offset) & (RECORDER_BYTES - 1)];
+}
+
+void EventRecorder::dropOldest() {
+    size_t length = 1 + RECORD_PAYLOAD[peek(0) & 0x0F];
+    if ((peek(0) & 0x0F) == REC_CHANNEL) tailChannel = peek(1);
+    tail = (tail + length) & (RECORDER_BYTES - 1);
+    used -= length;
+    dropped++;
+    if (used == 0) return;
+
+    // The new oldest record carries its own time: absolute, or a step from the dropped one
+    uint8_t header = peek(0);
+    if ((header & 0x0F) == REC_TIME) {
+        tailTime = peek(1) | (unsigned long) peek(2) << 8 | (unsigned long) peek(3) << 16 | (unsigned long) peek(4) << 24;
+    } else {
+        tailTime += header >> 4;
+    }
+}
+
+void EventRecorder::record(RecordType type, const uint8_t *payload, unsigned long now) {
+    if (!enabled) return;
+    if (started && (long) (now - lastTime) < 0) now = lastTime;
+
+    unsigned long delta = now - lastTime;
+    if (!started || delta > RECORDER_MAX_DELTA) {
+        started = true;
+        lastTime = now;
+        delta = 0;
+        const uint8_t time[4] = {(uint8_t) now, (uint8_t) (now >> 8), (uint8_t) (now >> 16), (uint8_t) (now >> 24)};
+        record(REC_TIME, time, now);
+    }
+
+    size_t length = 1 + RECORD_PAYLOAD[type];
+    while (RECORDER_BYTES - used < length) {
+        dropOldest();
+    }
+    if (used == 0) {
+        tailTime = now;
+        tailChannel = lastChannel;
+    }
+
+    put(type | delta << 4);
+    for (uint8_t i = 0; i < RECORD_PAYLOAD[type]; i++) {
+        put(payload[i]);
+    }
+    used += length;
+    lastTime = now;
+}
+
+void EventRecorder::record(uint8_t channel, RecordType type, const uint8_t *payload, unsigned long now) {
+    if (enabled && channel != lastChannel) {
+        const uint8_t selected[1] = {channel};
+        record(REC_CHANNEL, selected, now);
+        lastChannel = channel;
+    }
+    record(type, payload, now);
+}
+
+void EventRecorder::recordSample(unsigned long now, uint8_t channel, int x, int y) {
+    const uint8_t payload[3] = {(uint8_t) x, (uint8_t) ((x >> 8 & 0x0F) | (y & 0x0F) << 4), (uint8_t) (y >> 4)};
+    record(channel, REC_SAMPLE, payload, now);
+}
+
+void EventRecorder::recordButton(unsigned long now, uint8_t channel, bool pressed) {
+    const uint8_t payload[1] = {pressed};
+    record(channel, REC_BUTTON, payload, now);
+}
+
+void EventRecorder::recordMode(unsigned long now, uint8_t channel, int index) {
+    const uint8_t payload[1] = {(uint8_t) index};
+    record(channel, REC_MODE, payload, now);
+}
+
+void EventRecorder::recordValue(unsigned long now, uint8_t channel, int value) {
+    const uint8_t payload[2] = {(uint8_t) value, (uint8_t) (value >> 8)};
+    record(channel, REC_VALUE, payload, now);
+}
+
+void EventRecorder::recordCommand(unsigned long now, uint8_t channel, uint8_t type, int argument) {
+    const uint8_t payload[3] = {type, (uint8_t) argument, (uint8_t) (argument >> 8)};
+    record(channel, REC_COMMAND, payload, now);
+}
+
+void EventRecorder::recordNotify(unsigned long now, unsigned long count) {
+    const uint8_t payload[1] = {(uint8_t) min(count, 255UL)};
+    record(REC_NOTIFY, payload, now);
+}
+
+void EventRecorder::recordConnection(unsigned long now, bool connected) {
+    record(connected ? REC_CONNECT : REC_DISCONNECT, nullptr, now);
+}
+
+void EventRecorder::recordKeyframe(unsigned long now, uint8_t channel, int mode, int originX, int originY,
+                                   int deadZone, bool connected, int stickX, int stickY, const buttonSnapshot &button,
+                                   const int16_t *values) {
+    unsigned long age = min(now - button.since, 0xFFFFUL);
+    uint8_t payload[RECORD_PAYLOAD[REC_KEYFRAME]] = {
+        (uint8_t) ((mode & 0x7F) | connected << 7),
+        (uint8_t) originX, (uint8_t) (originX >> 8),
+        (uint8_t) originY, (uint8_t) (originY >> 8),
+        (uint8_t) deadZone, (uint8_t) (deadZone >> 8),
+        (uint8_t) stickX, (uint8_t) ((stickX >> 8 & 0x0F) | (stickY & 0x0F) << 4), (uint8_t) (stickY >> 4),
+        (uint8_t) ((button.pressed ? KEY_BUTTON_PRESSED : 0) | (button.longSent ? KEY_BUTTON_LONG : 0)
+                   | (button.awaitingSecond ? KEY_BUTTON_AWAIT : 0) | (button.secondPress ? KEY_BUTTON_SECOND : 0)),
+        (uint8_t) age, (uint8_t) (age >> 8)
+    };
+    for (int i = 0; i < MAX_MODES; i++) {
+        payload[13 + 2 * i] = (uint8_t) values[i];
+        payload[14 + 2 * i] = (uint8_t) (values[i] >> 8);
+    }
+    record(channel, REC_KEYFRAME, payload, now);
+}
+
+void EventRecorder::setEnabled(bool enable) {
+    this->enabled = enable;
+}
+
+void EventRecorder::clear() {
+    head = tail = used = 0;
+    lastChannel = tailChannel = 0;
+    started = false;
+}
+
+size_t EventRecorder::size() const {
+    return used;
+}
+
+unsigned long EventRecorder::startTime() const {
+    return tailTime;
+}
+
+uint8_t EventRecorder::startChannel() const {
+    return tailChannel;
+}
+
+unsigned long EventRecorder::getDropped() const {
+    return dropped;
+}
+
+size_t EventRecorder::read(size_t offset, uint8_t *out, size_t length) const {
+    size_t count = 0;
+    for (; count < length && offset + count < used; count++) {
+        out[count] = peek(offset + count);
+    }
+    return count;
+}
+
+bool EventRecorder::decode(const uint8_t *log, size_t length, size_t &offset, unsigned long &time, uint8_t &channel,
+                           recordEntry &out) {
+    if (offset >= length) return false;
+    uint8_t type = log[offset] & 0x0F;
+    if (type >= REC_TYPES || offset + 1 + RECORD_PAYLOAD[type] > length) return false;
+
+    // The first record's step points at a record that was dropped, startTime() already includes it
+    if (offset > 0) time += log[offset] >> 4;
+    const uint8_t *p = log + offset + 1;
+    offset += 1 + RECORD_PAYLOAD[type];
+
+    out = recordEntry();
+    out.type = (RecordType) type;
+    switch (out.type) {
+        case REC_TIME:
+            time = p[0] | (unsigned long) p[1] << 8 | (unsigned long) p[2] << 16 | (unsigned long) p[3] << 24;
+            out.args[0] = (int32_t) time;
+            break;
+        case REC_SAMPLE:
+            out.args[0] = p[0] | (p[1] & 0x0F) << 8;
+            out.args[1] = p[1] >> 4 | p[2] << 4;
+            break;
+        case REC_BUTTON:
+        case REC_MODE:
+        case REC_NOTIFY:
+            out.args[0] = p[0];
+            break;
+        case REC_CHANNEL:
+            channel = p[0];
+            out.args[0] = p[0];
+            break;
+        case REC_VALUE:
+            out.args[0] = (int16_t) (p[0] | p[1] << 8);
+            break;
+        case REC_COMMAND:
+            out.args[0] = p[0];
+            out.args[1] = (int16_t) (p[1] | p[2] << 8);
+            break;
+        case REC_KEYFRAME:
+            out.args[0] = p[0] & 0x7F;
+            for (int i = 0; i < 3; i++) {
+                out.args[i + 2] = (int16_t) (p[1 + 2 * i] | p[2 + 2 * i] << 8);
+            }
+            out.args[5] = p[0] >> 7;
+            out.args[6] = p[7] | (p[8] & 0x0F) << 8;
+            out.args[7] = p[8] >> 4 | p[9] << 4;
+            out.button.pressed = p[10] & KEY_BUTTON_PRESSED;
+            out.button.longSent = p[10] & KEY_BUTTON_LONG;
+            out.button.awaitingSecond = p[10] & KEY_BUTTON_AWAIT;
+            out.button.secondPress = p[10] & KEY_BUTTON_SECOND;
+            out.button.since = time - (p[11] | p[12] << 8);
+            for (int i = 0; i < MAX_MODES; i++) {
+                out.values[i] = (int16_t) (p[13 + 2 * i] | p[14 + 2 * i] << 8);
+            }
+            out.args[1] = out.args[0] < MAX_MODES ? out.values[out.args[0]] : 0;
+            break;
+        default:
+            break;
+    }
+    out.time = time;
+    out.channel = channel;
+    return true;
+}
@@ -0,0 +1,161 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef EVENTRECORDER_H
+#define EVENTRECORDER_H
+
+#include <Arduino.h>
+#include "ButtonDebouncer.h"
+#include "ModeRegistry.h"
+
+/**
+ * @brief Size of the event ring in bytes, a power of two. At one joystick sample per
+ * SAMPLE_INTERVAL_MS (4 bytes) it holds the last ~10 seconds.
+ */
+#ifndef RECORDER_BYTES
+#define RECORDER_BYTES 4096
+#endif
+
+static_assert((RECORDER_BYTES & (RECORDER_BYTES - 1)) == 0, "RECORDER_BYTES must be a power of two");
+
+/**
+ * @brief Largest time step stored in a record header, in milliseconds. Longer gaps get a REC_TIME record.
+ */
+#define RECORDER_MAX_DELTA 15
+
+/**
+ * @brief Event types of the log. The header byte holds the type in its low and the time step
+ * since the previous record in its high nibble, followed by a fixed size payload (little endian).
+ */
+enum RecordType : uint8_t {
+    REC_TIME,       ///< Absolute millis() (4 bytes), before the first record and after long gaps
+    REC_SAMPLE,     ///< Raw joystick sample, X and Y as two 12 bit values (3 bytes)
+    REC_BUTTON,     ///< Button edge, 1 if pressed (1 byte)
+    REC_MODE,       ///< Active mode changed, index (1 byte)
+    REC_VALUE,      ///< Value of the active mode changed (2 bytes)
+    REC_COMMAND,    ///< Host command applied, ToneCommandType and first argument (1 + 2 bytes)
+    REC_NOTIFY,     ///< Notifications sent since the previous REC_NOTIFY (1 byte)
+    REC_CONNECT,    ///< Client connected
+    REC_DISCONNECT, ///< Client disconnected
+    REC_KEYFRAME,   ///< Active mode (bit 7: client connected), the joystick calibration, the filtered stick
+                    ///< position like REC_SAMPLE, the debounced button (KEY_BUTTON_* bits and the age of its
+                    ///< timestamp in ms, saturated) and the value of every mode slot
+                    ///< (1 + 3 * 2 + 3 + 1 + 2 + MAX_MODES * 2 bytes), replay starts here
+    REC_CHANNEL,    ///< Channel of the sample, button, mode, value, command and keyframe records that follow
+                    ///< (1 byte), written when it changes; channel 0 until the first one
+    REC_TYPES
+};
+
+/**
+ * @brief Button bits of a REC_KEYFRAME, see buttonSnapshot.
+ */
+#define KEY_BUTTON_PRESSED 0x01
+#define KEY_BUTTON_LONG    0x02
+#define KEY_BUTTON_AWAIT   0x04
+#define KEY_BUTTON_SECOND  0x08
+
+/**
+ * @brief Payload size of each RecordType in bytes.
+ */
+static constexpr uint8_t RECORD_PAYLOAD[REC_TYPES] = {4, 3, 1, 1, 2, 3, 1, 0, 0, 13 + 2 * MAX_MODES, 1};
+
+/**
+ * @brief A decoded record.
+ */
+struct recordEntry {
+    unsigned long time = 0; ///< millis() of the record
+    RecordType type = REC_TIME;
+    uint8_t channel = 0;    ///< Channel in effect at the record, see REC_CHANNEL
+    int32_t args[8] = {}; ///< Payload fields in the order listed at RecordType, keyframes: mode, value, origin X,
+                          ///< origin Y, dead zone, connected, stick X, stick Y
+    buttonSnapshot button;          ///< Keyframes: debounced button
+    int16_t values[MAX_MODES] = {}; ///< Keyframes: value of every mode slot
+};
+
+/**
+ * @brief EventRecorder keeps a compact binary log of inputs and outputs in a fixed RAM ring.
+ * When the ring is full the oldest records are dropped. Written by the input task only;
+ * nothing allocates and a record is a few byte stores. Times never go backwards: a record
+ * stamped before the previous one (a button edge taken late) gets the previous time.
+ */
+class EventRecorder {
+private:
+    uint8_t ring[RECORDER_BYTES] = {}; ///< Records, oldest at tail
+    size_t head = 0; ///< Next byte to write
+    size_t tail = 0; ///< First byte of the oldest record
+    size_t used = 0; ///< Bytes in the ring
+    unsigned long lastTime = 0; ///< millis() of the newest record
+    unsigned long tailTime = 0; ///< millis() of the oldest record
+    uint8_t lastChannel = 0; ///< Channel of the newest channel record
+    uint8_t tailChannel = 0; ///< Channel in effect at the oldest record
+    bool started = false; ///< A REC_TIME record has been written
+    bool enabled = true; ///< Records are kept
+    unsigned long dropped = 0; ///< Records overwritten since the start
+
+    void put(uint8_t byte);  // Appends a byte at head
+    uint8_t peek(size_t offset) const;  // Byte at tail + offset
+    void dropOldest();  // Removes the record at tail
+    void record(RecordType type, const uint8_t *payload, unsigned long now);
+
+    /**
+     * @brief Same as record(), preceded by a REC_CHANNEL if the record is for another channel than the last one.
+     */
+    void record(uint8_t channel, RecordType type, const uint8_t *payload, unsigned long now);
+
+public:
+    void recordSample(unsigned long now, uint8_t channel, int x, int y);
+    void recordButton(unsigned long now, uint8_t channel, bool pressed);
+    void recordMode(unsigned long now, uint8_t channel, int index);
+    void recordValue(unsigned long now, uint8_t channel, int value);
+    void recordCommand(unsigned long now, uint8_t channel, uint8_t type, int argument);
+    void recordNotify(unsigned long now, unsigned long count);
+    void recordConnection(unsigned long now, bool connected);
+
+    /**
+     * @brief Records the state a replay starts from.
+     * @param values Value of every mode slot, MAX_MODES entries.
+     */
+    void recordKeyframe(unsigned long now, uint8_t channel, int mode, int originX, int originY, int deadZone,
+                        bool connected, int stickX, int stickY, const buttonSnapshot &button, const int16_t *values);
+
+
+    /**
+     * @brief Pauses or resumes recording, e.g. while the log is dumped.
+     */
+    void setEnabled(bool enable);
+
+    /**
+     * @brief Empties the log.
+     */
+    void clear();
+
+    size_t size() const;  // Bytes in the log
+    unsigned long startTime() const;  // millis() of the oldest record
+    uint8_t startChannel() const;  // Channel in effect at the oldest record
+    unsigned long getDropped() const;  // Records overwritten since the start
+
+    /**
+     * @brief Copies log bytes in order, oldest first.
+     * @param offset Offset from the oldest byte.
+     * @param out Destination.
+     * @param length Bytes to copy.
+     * @return size_t Bytes copied, less than length at the end of the log.
+     */
+    size_t read(size_t offset, uint8_t *out, size_t length) const;
+
+    /**
+     * @brief Decodes the record at offset of a log copied with read().
+     * @param log Log bytes.
+     * @param length Number of log bytes.
+     * @param offset Position of the record, advanced past it.
+     * @param time millis() of the previous record, startTime() before the first one. Advanced to this record.
+     * @param channel Channel in effect, startChannel() before the first record. Changed by REC_CHANNEL.
+     * @param out Decoded record.
+     * @return false at the end of the log or on a truncated or unknown record.
+     */
+    static bool decode(const uint8_t *log, size_t length, size_t &offset, unsigned long &time, uint8_t &channel,
+                       recordEntry &out);
+};
+
+#endif //EVENTRECORDER_H
@@ -5,6 +5,17 @@
 
 #include "JoyController.h"
 
+/**
+ * @brief atan(i / 64) in 1/JOY_ANGLE_SCALE degrees for i = 0..64 (first octant).
+ */
+static constexpr uint16_t ATAN_TABLE[65] = {
+        0, 57, 115, 172, 229, 286, 343, 399, 456, 512, 568, 624, 680,
+        735, 790, 844, 898, 952, 1005, 1058, 1111, 1163, 1214, 1265, 1316, 1366,
+        1415, 1464, 1512, 1560, 1607, 1654, 1700, 1746, 1791, 1835, 1879, 1922, 1965,
+        2007, 2048, 2089, 2130, 2169, 2209, 2247, 2285, 2323, 2360, 2396, 2432, 2467,
+        2502, 2536, 2570, 2603, 2636, 2668, 2700, 2731, 2762, 2792, 2822, 2851, 2880,
+};
+
 JoystickController::JoystickController(uint8_t vrxPin, uint8_t vryPin, uint8_t swPin)
     : _vrxPin(vrxPin), _vryPin(vryPin), _swPin(swPin) {
     pinMode(_vrxPin, INPUT);
@@ -12,26 +23,145 @@ JoystickController::JoystickController(uint8_t vrxPin, uint8_t vryPin, uint8_t s
     pinMode(_swPin, INPUT_PULLUP); // Use internal pull-up resistor for switch
 }
 
-void JoystickController::begin() {
-    delay(500); // Allow time for the joystick to stabilize)
-    this->deadZone = 450;
-    this->calibrate(); // Calibrate the joystick
+void JoystickController::begin(bool calibrate) {
+    attachInterruptArg(digitalPinToInterrupt(_swPin), onButtonEdge, this, CHANGE);
+    if (calibrate) {
+        this->calibrate(); // Calibrate the joystick
+    }
+}
+
+/**
+ * @brief Largest distance of a sample from the median.
+ */
+static int peakDeviation(const int *samples, int count, int median) {
+    int peak = 0;
+    for (int i = 0; i < count; i++) {
+        peak = max(peak, abs(samples[i] - median));
+    }
+    return peak;
+}
+
+bool JoystickController::calibrate() {
+    int xs[JOY_CALIBRATION_SAMPLES];
+    int ys[JOY_CALIBRATION_SAMPLES];
+    int x = -1, y = -1, noise = 0;
+    bool settled = false;
+    unsigned long start = millis();
+
+    // Compare the medians of consecutive windows until the stick (and the supply) has settled
+    do {
+        for (int i = 0; i < JOY_CALIBRATION_SAMPLES; i++) {
+            xs[i] = analogRead(_vrxPin);
+            ys[i] = analogRead(_vryPin);
+            delayMicroseconds(JOY_CALIBRATION_SPACING_US);
+        }
+        int medianX = AxisCalibration::median(xs, JOY_CALIBRATION_SAMPLES);
+        int medianY = AxisCalibration::median(ys, JOY_CALIBRATION_SAMPLES);
+        noise = max(peakDeviation(xs, JOY_CALIBRATION_SAMPLES, medianX),
+                    peakDeviation(ys, JOY_CALIBRATION_SAMPLES, medianY));
+        settled = x != -1 && abs(medianX - x) <= noise / 2 + 4 && abs(medianY - y) <= noise / 2 + 4;
+        x = medianX;
+        y = medianY;
+    } while (!settled && millis() - start < JOY_CALIBRATION_BUDGET_MS);
+
+    this->setCalibration(x, y, constrain(noise * JOY_NOISE_FACTOR, JOY_DEADZONE_MIN, JOY_DEADZONE_MAX));
+    return settled;
+}
+
+void JoystickController::setCalibration(int x, int y, int zone) {
+    calX.reset(x);
+    calY.reset(y);
+    deadZone = zone;
+    sampleX = x;
+    sampleY = y;
+    filterX.reset(x);
+    filterY.reset(y);
+}
+
+int JoystickController::getOriginX() const {
+    return calX.getOrigin();
+}
+
+int JoystickController::getOriginY() const {
+    return calY.getOrigin();
+}
+
+int JoystickController::getDeadZone() const {
+    return deadZone;
+}
+
+void JoystickController::sample() {
+    TONE_METRIC_SCOPE(METRIC_JOY_READ);
+    long sumX = 0;
+    long sumY = 0;
+    for (uint8_t i = 0; i < oversample; i++) {
+        sumX += analogRead(_vrxPin);
+        sumY += analogRead(_vryPin);
+    }
+    this->sample(sumX / oversample, sumY / oversample);
+}
+
+void JoystickController::sample(int x, int y) {
+    unsigned long now = millis();
+    rawX = x;
+    rawY = y;
+    sampleX = filterX.apply(rawX, now);
+    sampleY = filterY.apply(rawY, now);
+
+    if (!atDeadZone(originizeX(sampleX)) || !atDeadZone(originizeY(sampleY))) {
+        movedAt = now;
+        calX.learn(sampleX);
+        calY.learn(sampleY);
+    } else if (now - movedAt >= JOY_IDLE_MS) {
+        calX.recenter(sampleX);
+        calY.recenter(sampleY);
+    }
+}
+
+int JoystickController::getRawX() const {
+    return rawX;
+}
+
+int JoystickController::getRawY() const {
+    return rawY;
 }
 
-void JoystickController::calibrate() {
-    // Calibrate the joystick by setting the origin to the current position
-    originX = analogRead(_vrxPin);
-    originY = analogRead(_vryPin);
+int JoystickController::getFilteredX() const {
+    return sampleX;
+}
+
+int JoystickController::getFilteredY() const {
+    return sampleY;
+}
+
+void JoystickController::resetFilter(int x, int y) {
+    sampleX = x;
+    sampleY = y;
+    filterX.reset(x);
+    filterY.reset(y);
+}
+
+void JoystickController::setOversample(uint8_t count) {
+    oversample = max(count, (uint8_t) 1);
+}
+
+uint8_t JoystickController::getOversample() const {
+    return oversample;
+}
+
+void JoystickController::setFilter(JoyFilter filter) {
+    filterX.setType(filter, sampleX);
+    filterY.setType(filter, sampleY);
 }
 
 int JoystickController::originizeX(int x) {
     // reassing x within originX
-    return x - originX;
+    return x - calX.getOrigin();
 }
 
 int JoystickController::originizeY(int y) {
     // reassing y within originY
-    return y - originY;
+    return y - calY.getOrigin();
 }
 
 float JoystickController::normalize(int value) {
@@ -43,22 +173,44 @@ bool JoystickController::atDeadZone(int value) {
 }
 
 int JoystickController::readX() {
-    int read =  analogRead(_vrxPin);
-    int normalized =  originizeX(read);
+    int normalized =  originizeX(sampleX);
     if (atDeadZone(normalized)) return 0;
-    return normalized;
+    return calX.scale(sampleX);
 }
 
 int JoystickController::readY() {
-    int read =  analogRead(_vryPin);
-    int normalized =  originizeY(read);
+    int normalized =  originizeY(sampleY);
     if (atDeadZone(normalized)) return 0;
-    return normalized;
+    return calY.scale(sampleY);
 }
 
-int JoystickController::readAngle(int offset) {
-    float x = readX();
-    float y = readY();
+int JoystickController::fastAtan2(int y, int x) {
+    if (x == 0 && y == 0) return 0;
+    long ax = abs(x);
+    long ay = abs(y);
+
+    // Reduce to the first octant: ratio of the smaller to the larger component in Q12
+    bool swapped = ay > ax;
+    long ratio = swapped ? (ax << 12) / ay : (ay << 12) / ax;
+    int idx = ratio >> 6;
+    int frac = ratio & 63;
+    int angle = ATAN_TABLE[idx];
+    if (idx < 64) angle += ((ATAN_TABLE[idx + 1] - ATAN_TABLE[idx]) * frac) >> 6;
+
+    if (swapped) angle = 90 * JOY_ANGLE_SCALE - angle;
+    if (x < 0) angle = 180 * JOY_ANGLE_SCALE - angle;
+    if (y < 0) angle = 360 * JOY_ANGLE_SCALE - angle;
+    return angle;
+}
+
+int JoystickController::angleOf(int y, int x, int offset) {
+    int angle = fastAtan2(y, x) + offset * JOY_ANGLE_SCALE;
+    angle %= 360 * JOY_ANGLE_SCALE;
+    if (angle < 0) angle += 360 * JOY_ANGLE_SCALE;
+    return ((angle + JOY_ANGLE_SCALE / 2) / JOY_ANGLE_SCALE) % 360;
+}
+
+int JoystickController::angleOfFloat(float y, float x, int offset) {
     float radian = atan2(y, x); // atan2 returns angle in radians
     float angle = radian * (180.0 / PI); // Convert radians to degrees
     angle += offset;
@@ -66,6 +218,15 @@ int JoystickController::readAngle(int offset) {
     return (int) round(angle) % 360;
 }
 
+int JoystickController::readAngle(int offset) {
+    // Not readX()/readY(): zeroing one axis in its dead zone would snap the angle to the other axis
+#if JOY_FAST_ANGLE
+    return angleOf(calY.scale(sampleY), calX.scale(sampleX), offset);
+#else
+    return angleOfFloat(calY.scale(sampleY), calX.scale(sampleX), offset);
+#endif
+}
+
 bool JoystickController::atOrigin() {
     int x = readX();
     int y = readY();
@@ -75,3 +236,21 @@ bool JoystickController::atOrigin() {
 bool JoystickController::isPressed() {
     return digitalRead(_swPin) == LOW; // Button pressed when pin is LOW
 }
+
+void IRAM_ATTR JoystickController::onButtonEdge(void *joystick) {
+    JoystickController *self = static_cast<JoystickController *>(joystick);
+    if (!self->edges.push({millis(), self->isPressed()})) {
+        self->edgesLost = true;
+    }
+}
+
+bool JoystickController::takeEdge(buttonEdge &out) {
+    if (edges.pop(out)) {
+        return true;
+    }
+    if (edgesLost.exchange(false)) {
+        out = {millis(), isPressed()};
+        return true;
+    }
+    return false;
+}
@@ -6,6 +6,66 @@
 #define JOYCONTROLLER_H
 
 #include <Arduino.h>
+#include "AxisFilter.h"
+#include "AxisCalibration.h"
+#include "ButtonDebouncer.h"
+#include "SpscQueue.h"
+#include "ToneMetrics.h"
+
+/**
+ * @brief Selects the angle routine used by readAngle().
+ * 1 uses the integer octant/table routine, 0 uses the float atan2() path.
+ */
+#ifndef JOY_FAST_ANGLE
+#define JOY_FAST_ANGLE 1
+#endif
+
+/**
+ * @brief Default number of ADC reads averaged into one sample.
+ */
+#define JOY_OVERSAMPLE 4
+
+/**
+ * @brief Fixed point scale of the angles returned by fastAtan2() (1/64 degree).
+ */
+#define JOY_ANGLE_SCALE 64
+
+/**
+ * @brief Samples per axis in one calibration window; the origin is their median.
+ */
+#define JOY_CALIBRATION_SAMPLES 16
+
+/**
+ * @brief Time between two calibration samples in microseconds.
+ */
+#define JOY_CALIBRATION_SPACING_US 250
+
+/**
+ * @brief Longest time calibrate() waits for the stick to settle, in milliseconds.
+ */
+#define JOY_CALIBRATION_BUDGET_MS 100
+
+/**
+ * @brief Dead zone as a multiple of the noise floor measured by calibrate().
+ */
+#define JOY_NOISE_FACTOR 3
+
+/**
+ * @brief Bounds of the dead zone (raw ADC). The lower bound covers the spring not returning
+ * to exactly the same rest position, the upper one the former fixed dead zone.
+ */
+#define JOY_DEADZONE_MIN 160
+#define JOY_DEADZONE_MAX 450
+
+/**
+ * @brief Time the stick must rest in the dead zone before the origin follows it, in milliseconds.
+ */
+#define JOY_IDLE_MS 2000
+
+/**
+ * @brief Capacity of the button edge ring filled by the interrupt handler.
+ */
+#define JOY_EDGE_QUEUE 32
 
 /**
  * @brief JoystickController handles joystick input, including X and Y axis readings, button press detection
@@ -14,7 +74,15 @@
 class JoystickController {
 private:
     uint8_t _vrxPin, _vryPin, _swPin;
-    int originX, originY, deadZone;
+    AxisCalibration calX, calY; ///< Origin and travel per axis
+    int deadZone = JOY_DEADZONE_MAX; ///< Dead zone around the origin (raw ADC)
+    unsigned long movedAt = 0; ///< millis() of the last sample outside the dead zone
+    SpscQueue<buttonEdge, JOY_EDGE_QUEUE> edges; ///< Button edges, filled by onButtonEdge()
+    std::atomic<bool> edgesLost{false}; ///< The edge ring overflowed since the last takeEdge()
+    int sampleX = 0, sampleY = 0; ///< Filtered raw axis values of the last sample()
+    int rawX = 0, rawY = 0; ///< Averaged ADC values of the last sample(), before the filter
+    uint8_t oversample = JOY_OVERSAMPLE; ///< ADC reads averaged per sample
+    AxisFilter filterX, filterY; ///< Per axis noise filters
 
     /**
      * @brief Normalizes the X axis value based on the origin.
@@ -44,6 +112,12 @@ private:
      */
     bool atDeadZone(int value);
 
+    /**
+     * @brief Button interrupt handler: timestamps the new level into the edge ring.
+     * @param joystick The JoystickController that attached it.
+     */
+    static void onButtonEdge(void *joystick);
+
 public:
     /**
      * @brief Initializes joystick controller with given pins.
@@ -55,35 +129,113 @@ public:
     JoystickController(uint8_t vrxPin, uint8_t vryPin, uint8_t swPin);
 
     /**
-     * @brief Starts the joystick and calibrates the center position.
+     * @brief Starts the joystick, attaches the button interrupt and calibrates the center position.
+     * @param calibrate Capture the origin with calibrate(). Skip it when
+     * a stored calibration is applied with setCalibration().
      */
-    void begin();
+    void begin(bool calibrate = true);
 
     /**
-     * @brief Calibrates the joystick by setting the current position as origin.
+     * @brief Calibrates the joystick at its rest position.
+     * Reads windows of JOY_CALIBRATION_SAMPLES until the medians of two windows agree within their noise,
+     * for at most JOY_CALIBRATION_BUDGET_MS. The last median becomes the origin and its noise sizes the dead zone.
+     * @return true if the stick settled within the budget.
      */
-    void calibrate();
+    bool calibrate();
 
     /**
-     * @brief Reads and normalizes the X axis value.
-     * @return int The normalized X axis value, or 0 if within dead zone.
+     * @brief Applies a known calibration, e.g. one restored from flash.
+     * @param x Origin of the X axis (raw ADC).
+     * @param y Origin of the Y axis (raw ADC).
+     * @param zone Dead zone around the origin (raw ADC).
+     */
+    void setCalibration(int x, int y, int zone);
+
+    int getOriginX() const;  // Origin of the X axis (raw ADC)
+    int getOriginY() const;  // Origin of the Y axis (raw ADC)
+    int getDeadZone() const;  // Dead zone around the origin (raw ADC)
+
+    /**
+     * @brief Acquires a new snapshot of both axes.
+     * Each axis is read `oversample` times (interleaved), averaged and run through the selected filter.
+     * Outside the dead zone the travel of each axis is learned; after JOY_IDLE_MS at rest the origin
+     * follows the rest position to compensate drift.
+     * readX(), readY(), readAngle() and atOrigin() all work on this snapshot, so call it once per tick.
+     */
+    void sample();
+
+    /**
+     * @brief Same as sample(), from reads the caller made (ToneController scans all joysticks at once).
+     * @param x Average of getOversample() reads of the X axis.
+     * @param y Average of getOversample() reads of the Y axis.
+     */
+    void sample(int x, int y);
+
+    int getRawX() const;  // Averaged ADC value of the X axis in the last sample(), before the filter
+    int getRawY() const;  // Averaged ADC value of the Y axis in the last sample(), before the filter
+    int getFilteredX() const;  // X axis of the last sample() after the filter (raw ADC)
+    int getFilteredY() const;  // Y axis of the last sample() after the filter (raw ADC)
+
+    /**
+     * @brief Restarts both filters from a filtered position, e.g. the one of an event log keyframe.
+     */
+    void resetFilter(int x, int y);
+
+    /**
+     * @brief Sets how many ADC reads are averaged into one sample.
+     * @param count Number of reads per axis (at least 1).
+     */
+    void setOversample(uint8_t count);
+
+    uint8_t getOversample() const;  // ADC reads averaged per sample
+
+    /**
+     * @brief Selects the noise filter applied to both axes.
+     * @param filter Filter type.
+     */
+    void setFilter(JoyFilter filter);
+
+    /**
+     * @brief Returns the normalized X axis value of the last sample.
+     * @return int The X axis value scaled to the learned travel (-JOY_AXIS_SPAN..JOY_AXIS_SPAN), or 0 if within dead zone.
      */
     int readX();
 
     /**
-     * @brief Reads and normalizes the Y axis value.
-     * @return int The normalized Y axis value, or 0 if within dead zone.
+     * @brief Returns the normalized Y axis value of the last sample.
+     * @return int The Y axis value scaled to the learned travel (-JOY_AXIS_SPAN..JOY_AXIS_SPAN), or 0 if within dead zone.
      */
     int readY();
 
     /**
-     * @brief Calculates the angle (in degrees) based on X and Y axes.
+     * @brief Calculates the angle (in degrees) of the last sample based on X and Y axes.
+     * Uses the scaled axes without the dead zone; check atOrigin() first.
      * @return int Angle in degrees between 0 and 360.
      */
     int readAngle(int offset=0);
 
     /**
-     * @brief Checks if the joystick is centered (dead zone).
+     * @brief Integer atan2 using octant reduction and an interpolated lookup table.
+     * @param y Y component.
+     * @param x X component.
+     * @return int Angle in 1/JOY_ANGLE_SCALE degrees between 0 and 360 * JOY_ANGLE_SCALE.
+     */
+    static int fastAtan2(int y, int x);
+
+    /**
+     * @brief Angle of a vector rounded to whole degrees, the way readAngle() computes it with JOY_FAST_ANGLE 1.
+     * @param offset Degrees added before wrapping.
+     * @return int Angle in degrees between 0 and 360.
+     */
+    static int angleOf(int y, int x, int offset=0);
+
+    /**
+     * @brief Same as angleOf() through the float atan2() path, used with JOY_FAST_ANGLE 0.
+     */
+    static int angleOfFloat(float y, float x, int offset=0);
+
+    /**
+     * @brief Checks if the last sample is centered (dead zone).
      * @return true if both X and Y are approximately zero
      */
     bool atOrigin();
@@ -93,6 +245,14 @@ public:
      * @return true if button is pressed
      */
     bool isPressed();
+
+    /**
+     * @brief Takes the oldest button edge recorded by the interrupt handler.
+     * After an overflow of the edge ring, a final edge with the current level is returned.
+     * @param out Receives the edge.
+     * @return true if an edge was taken.
+     */
+    bool takeEdge(buttonEdge &out);
 };
 
 #endif //JOYCONTROLLER_H
@@ -0,0 +1,64 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "MessageWriter.h"
+
+MessageWriter::MessageWriter(char *buffer, size_t capacity) : buffer(buffer), capacity(capacity) {
+    buffer[0] = '\0';
+}
+
+MessageWriter &MessageWriter::append(const char *text, size_t maxLength) {
+    while (*text && maxLength-- > 0 && length + 1 < capacity) {
+        buffer[length++] = *text++;
+    }
+    buffer[length] = '\0';
+    return *this;
+}
+
+MessageWriter &MessageWriter::append(int32_t value) {
+    char digits[12];
+    int count = 0;
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t) value : (uint32_t) value;
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) digits[count++] = '-';
+
+    while (count > 0 && length + 1 < capacity) {
+        buffer[length++] = digits[--count];
+    }
+    buffer[length] = '\0';
+    return *this;
+}
+
+MessageWriter &MessageWriter::appendJson(const KVP *kvp, int numKVP) {
+    append("{");
+    for (int i = 0; i < numKVP; i++) {
+        append("\"").append(kvp[i].key, KVP_KEY_MAX).append("\": \"");
+        if (kvp[i].text) {
+            append(kvp[i].text, KVP_VALUE_MAX);
+        } else {
+            append(kvp[i].number);
+        }
+        append("\"");
+        if (i < numKVP - 1) {
+            append(", ");
+        }
+    }
+    return append("}");
+}
+
+const char *MessageWriter::c_str() const {
+    return buffer;
+}
+
+size_t MessageWriter::size() const {
+    return length;
+}
+
+void MessageWriter::clear() {
+    length = 0;
+    buffer[0] = '\0';
+}
@@ -0,0 +1,107 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef MESSAGEWRITER_H
+#define MESSAGEWRITER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Longest key written for a key-value pair, longer keys are truncated.
+ */
+#define KVP_KEY_MAX 12
+
+/**
+ * @brief Longest value written for a key-value pair, longer values are truncated.
+ */
+#define KVP_VALUE_MAX 16
+
+/**
+ * @brief Largest number of key-value pairs accepted by the non-templated writers.
+ */
+#define KVP_MAX_FIELDS 8
+
+/**
+ * @brief Buffer size of a JSON object with N key-value pairs: {"key": "value", ...} plus terminator.
+ */
+#define JSON_MESSAGE_SIZE(N) (2 + (N) * (KVP_KEY_MAX + KVP_VALUE_MAX + 8) + 1)
+
+/**
+ * @brief Key-Value Pair structure for logging data.
+ * Keys and text values are borrowed pointers (usually string literals), numbers are stored inline,
+ * so building a KVP never allocates.
+ */
+struct KVP {
+    const char *key = "";
+    const char *text = nullptr; ///< Text value, nullptr if the value is a number
+    int32_t number = 0;         ///< Numeric value, used when text is nullptr
+
+    KVP() = default;
+    KVP(const char *key, const char *text) : key(key), text(text ? text : "") {}
+    KVP(const char *key, int32_t number) : key(key), number(number) {}
+};
+
+/**
+ * @brief MessageWriter formats text into a caller provided buffer without heap allocations.
+ * Output that does not fit is truncated; the buffer is always null terminated.
+ */
+class MessageWriter {
+private:
+    char *buffer;
+    size_t capacity;
+    size_t length = 0;
+
+public:
+    /**
+     * @brief Construct a writer over a buffer.
+     * @param buffer Output buffer.
+     * @param capacity Size of the buffer in bytes (including the terminator).
+     */
+    MessageWriter(char *buffer, size_t capacity);
+
+    /**
+     * @brief Appends at most maxLength characters of a string.
+     */
+    MessageWriter &append(const char *text, size_t maxLength = SIZE_MAX);
+
+    /**
+     * @brief Appends a signed integer in decimal.
+     */
+    MessageWriter &append(int32_t value);
+
+    /**
+     * @brief Appends a JSON object of key-value pairs: {"key": "value", ...}
+     * @param kvp Array of key-value pairs.
+     * @param numKVP Number of key-value pairs.
+     */
+    MessageWriter &appendJson(const KVP *kvp, int numKVP);
+
+    const char *c_str() const;  // Null terminated message
+    size_t size() const;  // Message length without the terminator
+    void clear();  // Empties the message
+};
+
+/**
+ * @brief Storage of a JsonMessage. A base class listed before MessageWriter, so the buffer exists before the
+ * writer is constructed over it.
+ */
+template<size_t N>
+struct JsonMessageStorage {
+    char storage[JSON_MESSAGE_SIZE(N)];
+};
+
+/**
+ * @brief MessageWriter with its own storage sized for a JSON object of N key-value pairs.
+ */
+template<size_t N>
+class JsonMessage : private JsonMessageStorage<N>, public MessageWriter {
+public:
+    JsonMessage() : JsonMessageStorage<N>(), MessageWriter(this->storage, sizeof(this->storage)) {}
+
+    explicit JsonMessage(const KVP (&kvp)[N]) : JsonMessage() {
+        appendJson(kvp, N);
+    }
+};
+
+#endif //MESSAGEWRITER_H
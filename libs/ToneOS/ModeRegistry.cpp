@@ -0,0 +1,102 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "ModeRegistry.h"
+
+bool ModeRegistry::set(int slot, const modeSpec *spec) {
+    if (slot < 0 || slot >= MAX_MODES || spec == nullptr) return false;
+    if (spec->maxValue < spec->minValue) return false;  // The lookup tables map angles onto min..max
+
+    if (specs[slot] == nullptr) {
+        position[slot] = configured;
+        order[configured++] = slot;
+    }
+    specs[slot] = spec;
+    values[slot] = spec->minValue; // Initialize current value to min
+    return true;
+}
+
+bool ModeRegistry::set(int slot, const char *name, int16_t minValue, int16_t maxValue, uint8_t r, uint8_t g,
+                       uint8_t b, uint8_t brightness, ModeInput input) {
+    if (slot < 0 || slot >= MAX_MODES || maxValue < minValue) return false;  // Before the copy is overwritten
+
+    strncpy(names[slot], name, TONE_NAME_MAX);
+    names[slot][TONE_NAME_MAX] = '\0';
+    modeSpec &spec = ramSpecs[slot];
+    spec.name = names[slot];
+    spec.minValue = minValue;
+    spec.maxValue = maxValue;
+    spec.color[0] = r;
+    spec.color[1] = g;
+    spec.color[2] = b;
+    spec.brightness = brightness;
+    spec.input = input;
+    return set(slot, &spec);
+}
+
+int ModeRegistry::add(const modeSpec *spec) {
+    int slot = freeSlot();
+    return set(slot, spec) ? slot : -1;
+}
+
+int ModeRegistry::add(const char *name, int16_t minValue, int16_t maxValue, uint8_t r, uint8_t g, uint8_t b,
+                      uint8_t brightness, ModeInput input) {
+    int slot = freeSlot();
+    return set(slot, name, minValue, maxValue, r, g, b, brightness, input) ? slot : -1;
+}
+
+bool ModeRegistry::remove(int slot) {
+    if (!isConfigured(slot)) return false;
+
+    for (int i = position[slot]; i < configured - 1; i++) {
+        order[i] = order[i + 1];
+        position[order[i]] = i;
+    }
+    configured--;
+    specs[slot] = nullptr;
+    return true;
+}
+
+bool ModeRegistry::isConfigured(int slot) const {
+    return slot >= 0 && slot < MAX_MODES && specs[slot] != nullptr;
+}
+
+int ModeRegistry::next(int slot) const {
+    if (configured == 0) return -1;
+    if (!isConfigured(slot)) return order[0];
+    return order[(position[slot] + 1) % configured];
+}
+
+int ModeRegistry::previous(int slot) const {
+    if (configured == 0) return -1;
+    if (!isConfigured(slot)) return order[0];
+    return order[(position[slot] + configured - 1) % configured];
+}
+
+int ModeRegistry::first() const {
+    return configured > 0 ? order[0] : -1;
+}
+
+int ModeRegistry::count() const {
+    return configured;
+}
+
+const modeSpec &ModeRegistry::spec(int slot) const {
+    return *specs[slot];
+}
+
+int16_t ModeRegistry::getValue(int slot) const {
+    return values[slot];
+}
+
+void ModeRegistry::setValue(int slot, int16_t value) {
+    values[slot] = value;
+}
+
+int ModeRegistry::freeSlot() const {
+    for (int i = 0; i < MAX_MODES; i++) {
+        if (specs[i] == nullptr) return i;
+    }
+    return -1;
+}
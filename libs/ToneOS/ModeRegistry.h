@@ -0,0 +1,133 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef MODEREGISTRY_H
+#define MODEREGISTRY_H
+
+#include <Arduino.h>
+#include "ToneProtocol.h"
+
+/**
+ * @brief Number of mode slots available in the registry.
+ */
+#define MAX_MODES 12
+
+/**
+ * @brief How the joystick changes the value of a mode.
+ */
+enum ModeInput : uint8_t {
+    MODE_INPUT_ABSOLUTE, ///< The stick angle (0..MAX_MAPPED_ANGLE) selects the value directly
+    MODE_INPUT_RELATIVE  ///< Turning the stick steps the value like a jog dial, faster turns take larger steps
+};
+
+/**
+ * @brief Configuration of a mode: name, value range, color, brightness and input style.
+ * Declare built-in modes as `const modeSpec` so name and colors stay in flash.
+ */
+struct modeSpec {
+    const char *name;
+    int16_t minValue;
+    int16_t maxValue;
+    uint8_t color[3];
+    uint8_t brightness;
+    ModeInput input; ///< Absolute if omitted from the initializer (MODE_INPUT_ABSOLUTE is 0)
+};
+
+/**
+ * @brief ModeRegistry is a fixed capacity table of modes.
+ *
+ * Each slot points at its configuration, which is either a flash resident modeSpec or a copy
+ * held in the registry for modes configured at runtime. The current values are kept in a packed
+ * array. Configured slots are linked in cycling order, so next() is O(1), and nothing allocates.
+ */
+class ModeRegistry {
+private:
+    const modeSpec *specs[MAX_MODES] = {};       ///< Configuration per slot, nullptr if free
+    int16_t values[MAX_MODES] = {};              ///< Current value per slot
+    modeSpec ramSpecs[MAX_MODES] = {};           ///< Storage for modes configured at runtime
+    char names[MAX_MODES][TONE_NAME_MAX + 1] = {}; ///< Name storage for modes configured at runtime
+    uint8_t order[MAX_MODES] = {};               ///< Configured slots in cycling order
+    uint8_t position[MAX_MODES] = {};            ///< Position of each configured slot in order
+    uint8_t configured = 0;                      ///< Number of configured slots
+
+    /**
+     * @brief Returns the first free slot, or -1 if the registry is full.
+     */
+    int freeSlot() const;
+
+public:
+    /**
+     * @brief Configures a slot with a spec that outlives the registry (usually in flash).
+     * @param slot Slot index (0 to MAX_MODES-1).
+     * @param spec Mode configuration.
+     * @return true if the slot was configured, false (slot left as it is) if maxValue < minValue.
+     */
+    bool set(int slot, const modeSpec *spec);
+
+    /**
+     * @brief Configures a slot with a copy of the given values.
+     * @return true if the slot was configured, false (slot left as it is) if maxValue < minValue.
+     */
+    bool set(int slot, const char *name, int16_t minValue, int16_t maxValue, uint8_t r, uint8_t g, uint8_t b,
+             uint8_t brightness, ModeInput input = MODE_INPUT_ABSOLUTE);
+
+    /**
+     * @brief Configures the first free slot with a spec that outlives the registry.
+     * @return int Slot index, or -1 if the registry is full or maxValue < minValue.
+     */
+    int add(const modeSpec *spec);
+
+    /**
+     * @brief Configures the first free slot with a copy of the given values.
+     * @return int Slot index, or -1 if the registry is full or maxValue < minValue.
+     */
+    int add(const char *name, int16_t minValue, int16_t maxValue, uint8_t r, uint8_t g, uint8_t b,
+            uint8_t brightness, ModeInput input = MODE_INPUT_ABSOLUTE);
+
+    /**
+     * @brief Frees a slot.
+     * @param slot Slot index.
+     * @return true if the slot was configured.
+     */
+    bool remove(int slot);
+
+    /**
+     * @brief Checks if a slot holds a mode.
+     */
+    bool isConfigured(int slot) const;
+
+    /**
+     * @brief Returns the slot that follows the given one in cycling order.
+     * @param slot Configured slot index.
+     * @return int Next slot, or the first configured slot if `slot` is not configured (-1 if none).
+     */
+    int next(int slot) const;
+
+    /**
+     * @brief Returns the slot that precedes the given one in cycling order.
+     * @param slot Configured slot index.
+     * @return int Previous slot, or the first configured slot if `slot` is not configured (-1 if none).
+     */
+    int previous(int slot) const;
+
+    /**
+     * @brief Returns the first configured slot, or -1 if there is none.
+     */
+    int first() const;
+
+    /**
+     * @brief Returns the number of configured slots.
+     */
+    int count() const;
+
+    /**
+     * @brief Returns the configuration of a configured slot.
+     */
+    const modeSpec &spec(int slot) const;
+
+    int16_t getValue(int slot) const;  // Current value of a slot
+    void setValue(int slot, int16_t value);  // Sets the current value of a slot
+};
+
+#endif //MODEREGISTRY_H
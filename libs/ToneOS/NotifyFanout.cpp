@@ -0,0 +1,314 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "NotifyFanout.h"
+
+bool NotifyFanout::addClient(uint16_t connId, unsigned long intervalMs) {
+    fanoutClient *client = this->find(connId);
+    if (client == nullptr) {
+        for (fanoutClient &slot : clients) {
+            if (slot.active) continue;
+            slot = fanoutClient();
+            slot.active = true;
+            slot.connId = connId;
+            client = &slot;
+            break;
+        }
+    }
+    if (client == nullptr) return false;
+
+    client->interval = max(intervalMs, (unsigned long) NOTIFY_MIN_INTERVAL_MS);
+    return true;
+}
+
+void NotifyFanout::removeClient(uint16_t connId) {
+    fanoutClient *client = this->find(connId);
+    if (client == nullptr) return;
+
+    for (uint8_t i = 0; i < client->depth; i++) {
+        this->release(client->queue[(client->head + i) % FANOUT_QUEUE]);
+    }
+    client->depth = 0;
+    client->active = false;
+}
+
+void NotifyFanout::setMtu(uint16_t connId, uint16_t mtu) {
+    fanoutClient *client = this->find(connId);
+    if (client != nullptr) client->mtu = mtu;
+}
+
+void NotifyFanout::setFormat(uint16_t connId, ToneFormat format) {
+    fanoutClient *client = this->find(connId);
+    if (client == nullptr) return;
+    client->format = format;
+    client->synced = false;
+    client->resync = true;
+}
+
+void NotifyFanout::setSubscribed(uint16_t connId, bool subscribed) {
+    fanoutClient *client = this->find(connId);
+    if (client == nullptr || client->subscribed == subscribed) return;
+    for (uint8_t i = 0; i < client->depth; i++) {
+        this->release(client->queue[(client->head + i) % FANOUT_QUEUE]);
+    }
+    client->depth = 0;
+    client->subscribed = subscribed;
+    client->synced = false;
+    client->resync = true;
+}
+
+void NotifyFanout::requestFullFrame() {
+    for (fanoutClient &client : clients) {
+        client.synced = false;
+    }
+}
+
+void NotifyFanout::lost(uint16_t connId) {
+    fanoutClient *client = this->find(connId);
+    if (client == nullptr) return;
+    client->synced = false;
+    client->resync = true;
+    client->lost++;
+}
+
+void NotifyFanout::publish(const toneState *states, uint8_t count) {
+    bool json = false, binary = false;
+    for (const fanoutClient &client : clients) {
+        if (!client.active || !client.subscribed) continue;
+        json |= client.format == FORMAT_JSON;
+        binary |= client.format == FORMAT_BINARY;
+    }
+    count = min(count, (uint8_t) TONE_MAX_CHANNELS);
+    if ((!json && !binary) || count == 0) return;
+
+    // Every client holds at most FANOUT_QUEUE frames, so one is always free
+    uint8_t index = 0;
+    while (frames[index].refs != 0) index++;
+    sharedFrame &frame = frames[index];
+    frame.sequence = ++sequence;
+    frame.count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        frame.keys[i] = states[i].channel * NOTIFY_MAX_MODES + states[i].modeIndex;
+        uint8_t channel = states[i].channel % TONE_MAX_CHANNELS;
+        current[channel] = states[i];
+        known[channel] = true;
+    }
+    frame.deltaLength = frame.fullLength = frame.jsonLength = 0;
+    published++;
+
+    if (binary) {
+        frame.deltaLength = encoder.encode(states, count, frame.delta);
+        frame.fullLength = encoder.encodeFull(states, count, frame.full);
+        binaryEncoded += 2;
+    }
+    if (json) {
+        frame.jsonLength = encodeJson(states, count, frame.json, sizeof(frame.json));
+        jsonEncoded++;
+    }
+
+    for (fanoutClient &client : clients) {
+        if (client.active && client.subscribed) this->enqueue(client, index);
+    }
+}
+
+bool NotifyFanout::next(unsigned long now, fanoutSend &out) {
+    for (uint8_t i = 0; i < TONE_MAX_CLIENTS; i++) {
+        uint8_t slot = (nextClient + i) % TONE_MAX_CLIENTS;
+        fanoutClient &client = clients[slot];
+        if (!client.active || client.depth == 0) continue;
+        if (client.sentOnce && now - client.lastSentAt < client.interval) continue;
+
+        out.connId = client.connId;
+        out.mtu = client.mtu;
+        if (client.resync) {
+            // The queue may miss channels the lost frame carried, the current state of all of them replaces it
+            for (uint8_t queued = 0; queued < client.depth; queued++) {
+                this->release(client.queue[(client.head + queued) % FANOUT_QUEUE]);
+            }
+            client.coalesced += client.depth - 1;
+            client.depth = 0;
+            out.length = this->encodeSnapshot(client.format);
+            out.data = client.format == FORMAT_BINARY ? snapshotFull : (const uint8_t *) snapshotJson;
+            client.resync = false;
+            client.synced = true;
+            client.lastSequence = sequence;
+            client.lastSentAt = now;
+            client.sentOnce = true;
+            client.sent++;
+            client.bytes += out.length;
+            nextClient = (slot + 1) % TONE_MAX_CLIENTS;
+            return true;
+        }
+
+        uint8_t index = client.queue[client.head];
+        client.head = (client.head + 1) % FANOUT_QUEUE;
+        client.depth--;
+        const sharedFrame &frame = frames[index];
+
+        if (client.format == FORMAT_BINARY) {
+            bool delta = client.synced && frame.sequence == client.lastSequence + 1;
+            out.data = delta ? frame.delta : frame.full;
+            out.length = delta ? frame.deltaLength : frame.fullLength;
+            client.synced = true;
+        } else {
+            out.data = (const uint8_t *) frame.json;
+            out.length = frame.jsonLength;
+        }
+
+        client.lastSequence = frame.sequence;
+        client.lastSentAt = now;
+        client.sentOnce = true;
+        client.sent++;
+        client.bytes += out.length;
+        nextClient = (slot + 1) % TONE_MAX_CLIENTS;
+        // The frame is only reused by the next publish(), after the caller sent it
+        this->release(index);
+        return true;
+    }
+    return false;
+}
+
+unsigned long NotifyFanout::getMinInterval() const {
+    unsigned long interval = 0;
+    for (const fanoutClient &client : clients) {
+        if (client.active && (interval == 0 || client.interval < interval)) interval = client.interval;
+    }
+    return interval ? interval : NOTIFY_DEFAULT_INTERVAL_MS;
+}
+
+#if TONE_METRICS
+bool NotifyFanout::setMetricsInterval(uint16_t connId, unsigned long intervalMs, unsigned long now) {
+    fanoutClient *client = this->find(connId);
+    if (client == nullptr) return false;
+    client->metricsInterval = intervalMs ? max(intervalMs, (unsigned long) FANOUT_METRICS_MIN_MS) : 0;
+    // The first notification goes out with the next update
+    client->metricsAt = now - client->metricsInterval;
+    return true;
+}
+
+void NotifyFanout::setMetricsSubscribed(uint16_t connId, bool subscribed) {
+    fanoutClient *client = this->find(connId);
+    if (client != nullptr) client->metricsSubscribed = subscribed;
+}
+
+bool NotifyFanout::nextMetrics(unsigned long now, fanoutSend &out) {
+    for (fanoutClient &client : clients) {
+        if (!client.active || !client.metricsSubscribed || client.metricsInterval == 0) continue;
+        if (now - client.metricsAt < client.metricsInterval) continue;
+        client.metricsAt = now;
+        out.connId = client.connId;
+        out.mtu = client.mtu;
+        return true;
+    }
+    return false;
+}
+#endif
+
+const fanoutClient &NotifyFanout::getSlot(uint8_t slot) const {
+    return clients[slot];
+}
+
+uint8_t NotifyFanout::getClientCount() const {
+    uint8_t count = 0;
+    for (const fanoutClient &client : clients) {
+        if (client.active) count++;
+    }
+    return count;
+}
+
+unsigned long NotifyFanout::getPublished() const {
+    return published;
+}
+
+unsigned long NotifyFanout::getJsonEncoded() const {
+    return jsonEncoded;
+}
+
+unsigned long NotifyFanout::getBinaryEncoded() const {
+    return binaryEncoded;
+}
+
+fanoutClient *NotifyFanout::find(uint16_t connId) {
+    for (fanoutClient &client : clients) {
+        if (client.active && client.connId == connId) return &client;
+    }
+    return nullptr;
+}
+
+void NotifyFanout::release(uint8_t frame) {
+    if (frames[frame].refs > 0) frames[frame].refs--;
+}
+
+bool NotifyFanout::covers(const sharedFrame &frame, const sharedFrame &older) const {
+    for (uint8_t i = 0; i < older.count; i++) {
+        bool found = false;
+        for (uint8_t j = 0; j < frame.count && !found; j++) {
+            found = frame.keys[j] == older.keys[i];
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+uint16_t NotifyFanout::encodeJson(const toneState *states, uint8_t count, char *out, size_t size) {
+    // Single channel devices keep sending a plain object without the channel key
+    bool batch = count > 1 || states[0].channel != 0;
+    MessageWriter writer(out, size);
+    if (batch) writer.append("[");
+    for (uint8_t i = 0; i < count; i++) {
+        const toneState &state = states[i];
+        const KVP data[6] = {
+            {"ch", state.channel},
+            {"mode", state.name},
+            {"value", state.value},
+            {"r", state.color[0]},
+            {"g", state.color[1]},
+            {"b", state.color[2]}
+        };
+        if (i > 0) writer.append(", ");
+        writer.appendJson(batch ? data : data + 1, batch ? 6 : 5);
+    }
+    if (batch) writer.append("]");
+    return writer.size();
+}
+
+size_t NotifyFanout::encodeSnapshot(ToneFormat format) {
+    toneState states[TONE_MAX_CHANNELS];
+    uint8_t count = 0;
+    for (uint8_t channel = 0; channel < TONE_MAX_CHANNELS; channel++) {
+        if (known[channel]) states[count++] = current[channel];
+    }
+    if (format == FORMAT_BINARY) {
+        binaryEncoded++;
+        return encoder.encodeFull(states, count, snapshotFull);
+    }
+    jsonEncoded++;
+    return encodeJson(states, count, snapshotJson, sizeof(snapshotJson));
+}
+
+void NotifyFanout::enqueue(fanoutClient &client, uint8_t frame) {
+    // Covered frames leave the queue and the new one goes last, so queued frames keep their publish order
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < client.depth; i++) {
+        uint8_t queued = client.queue[(client.head + i) % FANOUT_QUEUE];
+        if (this->covers(frames[frame], frames[queued])) {
+            this->release(queued);
+            client.coalesced++;
+            continue;
+        }
+        client.queue[(client.head + kept++) % FANOUT_QUEUE] = queued;
+    }
+    client.depth = kept;
+
+    if (client.depth == FANOUT_QUEUE) {
+        this->release(client.queue[client.head]);
+        client.head = (client.head + 1) % FANOUT_QUEUE;
+        client.depth--;
+        client.coalesced++;
+        client.resync = true;
+    }
+    client.queue[(client.head + client.depth) % FANOUT_QUEUE] = frame;
+    client.depth++;
+    frames[frame].refs++;
+}
@@ -0,0 +1,233 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef NOTIFYFANOUT_H
+#define NOTIFYFANOUT_H
+
+#include <Arduino.h>
+#include "ToneProtocol.h"
+#include "MessageWriter.h"
+#include "NotifyScheduler.h"
+#include "ToneMetrics.h"
+
+/**
+ * @brief Number of BLE clients served at once (Bluedroid allows 4 connections on the C3 by default).
+ */
+#define TONE_MAX_CLIENTS 3
+
+/**
+ * @brief Frames a client can have waiting; older frames are dropped when a slow client falls behind.
+ */
+#define FANOUT_QUEUE 4
+
+/**
+ * @brief Shared frames: every client queue full, plus the one being published.
+ */
+#define FANOUT_FRAMES (TONE_MAX_CLIENTS * FANOUT_QUEUE + 1)
+
+/**
+ * @brief Default ATT MTU of a connection until the client negotiates a larger one.
+ */
+#define FANOUT_DEFAULT_MTU 23
+
+/**
+ * @brief Largest JSON payload: an array with the object of every channel, each with its channel key.
+ */
+#define FANOUT_JSON_MAX (2 + TONE_MAX_CHANNELS * (JSON_MESSAGE_SIZE(6) + 1))
+
+/**
+ * @brief Shortest interval between two live metrics notifications to a client, in milliseconds.
+ */
+#define FANOUT_METRICS_MIN_MS 250
+
+static_assert(TONE_BATCH_MAX <= 255, "binary frame lengths are stored in a byte");
+
+/**
+ * @brief States published together, encoded once per format in use and shared by all client queues.
+ */
+struct sharedFrame {
+    uint32_t sequence = 0;                ///< Publish sequence number
+    uint8_t count = 0;                    ///< Number of states, at most one per channel
+    uint8_t keys[TONE_MAX_CHANNELS] = {}; ///< Channel * NOTIFY_MAX_MODES + mode of every state, for coalescing
+    uint8_t refs = 0;                     ///< Client queues holding the frame
+    uint8_t deltaLength = 0;              ///< Binary frame relative to the previous publish, 0 if not encoded
+    uint8_t fullLength = 0;               ///< Binary frame with name and color, 0 if not encoded
+    uint16_t jsonLength = 0;              ///< JSON object (array for several channels), 0 if not encoded
+    uint8_t delta[TONE_BATCH_MAX] = {};
+    uint8_t full[TONE_BATCH_MAX] = {};
+    char json[FANOUT_JSON_MAX] = {};
+};
+
+/**
+ * @brief State of a connected client.
+ */
+struct fanoutClient {
+    bool active = false;                  ///< Slot holds a connection
+    uint16_t connId = 0;                  ///< Connection id given by the stack
+    uint16_t mtu = FANOUT_DEFAULT_MTU;    ///< Negotiated ATT MTU
+    ToneFormat format = FORMAT_JSON;      ///< Format selected by the client
+    bool subscribed = false;              ///< Enabled notifications of the state characteristic
+    unsigned long interval = NOTIFY_DEFAULT_INTERVAL_MS; ///< Minimum time between two frames
+    uint32_t lastSequence = 0;            ///< Sequence number of the last frame delivered
+    bool synced = false;                  ///< Received a full binary frame since connecting or switching format
+    bool resync = false;                  ///< A frame was dropped or lost, the next one is a snapshot of every channel
+    bool sentOnce = false;                ///< A frame was delivered at lastSentAt
+    unsigned long lastSentAt = 0;         ///< millis() of the last frame delivered
+    uint8_t queue[FANOUT_QUEUE] = {};     ///< Shared frame indices, oldest first from head
+    uint8_t head = 0;                     ///< Index of the oldest queued frame
+    uint8_t depth = 0;                    ///< Number of queued frames
+    unsigned long sent = 0;               ///< Frames delivered
+    unsigned long coalesced = 0;          ///< Frames replaced or dropped before delivery
+    unsigned long bytes = 0;              ///< Payload bytes delivered
+    unsigned long lost = 0;               ///< Frames the stack refused to send
+#if TONE_METRICS
+    unsigned long metricsInterval = 0;    ///< Time between two live metrics notifications, 0 if not subscribed
+    bool metricsSubscribed = false;       ///< Enabled notifications of the metrics characteristic
+    unsigned long metricsAt = 0;          ///< millis() of the last live metrics notification
+#endif
+};
+
+/**
+ * @brief A frame to notify one client with. data stays valid until the next publish() or next().
+ */
+struct fanoutSend {
+    uint16_t connId;     ///< Connection to notify
+    uint16_t mtu;        ///< ATT MTU of the connection
+    const uint8_t *data; ///< Payload in the client's format
+    size_t length;       ///< Payload length in bytes
+};
+
+/**
+ * @brief NotifyFanout delivers every published state to several clients.
+ *
+ * The states of a publish (one per channel at most) are encoded once into a shared frame, in each format
+ * some client selected, and the clients queue references to it. Every client is paced by its own
+ * connection interval and keeps at most FANOUT_QUEUE frames in publish order, dropping every older frame
+ * whose channel modes the new one all carries, so a slow client loses intermediate states instead of
+ * holding buffers the fast ones need. Binary clients get the delta frame when they received the previous
+ * publish, and the full frame otherwise. A client that lost a frame on overflow, in the stack or by
+ * switching format gets a snapshot of the current state of every channel instead of its queue, so no
+ * channel is left behind. Only clients that enabled notifications (their CCCD) get frames.
+ * Notify task only.
+ */
+class NotifyFanout {
+private:
+    fanoutClient clients[TONE_MAX_CLIENTS]; ///< Client slots
+    sharedFrame frames[FANOUT_FRAMES]; ///< Frame pool
+    ToneFrameEncoder encoder{}; ///< Delta encoder shared by all binary clients
+    toneState current[TONE_MAX_CHANNELS]; ///< Last published state of every channel
+    bool known[TONE_MAX_CHANNELS] = {}; ///< A state of the channel was published
+    uint8_t snapshotFull[TONE_BATCH_MAX] = {}; ///< Binary snapshot of the last resync
+    char snapshotJson[FANOUT_JSON_MAX] = {}; ///< JSON snapshot of the last resync
+    uint32_t sequence = 0; ///< Sequence number of the last publish
+    uint8_t nextClient = 0; ///< Client next() looks at first, for round robin
+    unsigned long published = 0; ///< Frames published
+    unsigned long jsonEncoded = 0; ///< JSON encodings
+    unsigned long binaryEncoded = 0; ///< Binary encodings (delta and full frame)
+
+    fanoutClient *find(uint16_t connId);  // Active client with the connection id, nullptr if none
+    void release(uint8_t frame);  // Drops one reference to a shared frame
+    void enqueue(fanoutClient &client, uint8_t frame);  // Queues a frame, coalescing by channel mode
+    bool covers(const sharedFrame &frame, const sharedFrame &older) const;  // frame carries every channel mode of older
+
+    /**
+     * @brief Encodes states as a JSON object, or as an array of objects with their channel for several
+     * channels or a channel other than 0.
+     * @return Length written.
+     */
+    static uint16_t encodeJson(const toneState *states, uint8_t count, char *out, size_t size);
+
+    /**
+     * @brief Encodes the current state of every channel in a format, with name and color.
+     * @return Length written into snapshotFull or snapshotJson.
+     */
+    size_t encodeSnapshot(ToneFormat format);
+
+public:
+    /**
+     * @brief Adds a client, or updates its interval if it is already known.
+     * @param connId Connection id.
+     * @param intervalMs Minimum time between two frames, clamped to NOTIFY_MIN_INTERVAL_MS.
+     * @return false if all TONE_MAX_CLIENTS slots are taken.
+     */
+    bool addClient(uint16_t connId, unsigned long intervalMs);
+
+    /**
+     * @brief Removes a client and drops its queued frames.
+     */
+    void removeClient(uint16_t connId);
+
+    void setMtu(uint16_t connId, uint16_t mtu);  // Sets the negotiated MTU of a client
+    void setFormat(uint16_t connId, ToneFormat format);  // Sets the format of a client, its next frame is a snapshot
+
+    /**
+     * @brief Enables or disables the state notifications of a client, as its CCCD was written.
+     * Disabling drops the queued frames, the first frame after enabling them again is a snapshot.
+     */
+    void setSubscribed(uint16_t connId, bool subscribed);
+
+    /**
+     * @brief Makes the next binary frame of every client carry name and color.
+     */
+    void requestFullFrame();
+
+    /**
+     * @brief Counts a frame taken with next() that did not reach the client; its next frame is a snapshot.
+     */
+    void lost(uint16_t connId);
+
+    /**
+     * @brief Encodes states in every format in use, as one frame, and queues it for every subscribed client.
+     * Does nothing without subscribed clients.
+     * @param states States to send, at most one per channel.
+     * @param count Number of states (1 to TONE_MAX_CHANNELS).
+     */
+    void publish(const toneState *states, uint8_t count);
+
+    /**
+     * @brief Takes the next frame due for a client, round robin over the clients.
+     * @param now Current millis() timestamp.
+     * @param out Receives the frame and its destination.
+     * @return true if a frame was taken.
+     */
+    bool next(unsigned long now, fanoutSend &out);
+
+    /**
+     * @brief Returns the shortest interval of all clients, the rate states need to be published at.
+     * @return Interval in milliseconds, NOTIFY_DEFAULT_INTERVAL_MS without clients.
+     */
+    unsigned long getMinInterval() const;
+
+#if TONE_METRICS
+    /**
+     * @brief Subscribes a client to live metrics, see nextMetrics().
+     * @param intervalMs Time between two notifications, clamped to FANOUT_METRICS_MIN_MS; 0 unsubscribes.
+     * @return false if the client is not connected.
+     */
+    bool setMetricsInterval(uint16_t connId, unsigned long intervalMs, unsigned long now);
+
+    void setMetricsSubscribed(uint16_t connId, bool subscribed);  // Sets the metrics CCCD of a client
+
+    /**
+     * @brief Takes the next subscribed client whose live metrics are due, in slot order.
+     * @param now Current millis() timestamp.
+     * @param out Receives connId and mtu, data and length are left to the caller.
+     * @return true if a client was taken.
+     */
+    bool nextMetrics(unsigned long now, fanoutSend &out);
+#endif
+
+    /**
+     * @brief Returns a client slot, for sending to all or one client.
+     * @param slot 0..TONE_MAX_CLIENTS-1, check fanoutClient::active.
+     */
+    const fanoutClient &getSlot(uint8_t slot) const;
+
+    uint8_t getClientCount() const;  // Number of connected clients
+    unsigned long getPublished() const;  // Frames published
+    unsigned long getJsonEncoded() const;  // JSON encodings, at most one per publish
+    unsigned long getBinaryEncoded() const;  // Binary encodings, at most two per publish
+};
+
+#endif //NOTIFYFANOUT_H
@@ -0,0 +1,86 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "NotifyScheduler.h"
+
+void NotifyScheduler::submit(const toneState &state) {
+    if (state.modeIndex >= NOTIFY_MAX_MODES || state.channel >= TONE_MAX_CHANNELS) return;
+    uint8_t index = state.channel * NOTIFY_MAX_MODES + state.modeIndex;
+
+    if (isPending[index]) {
+        // The newest state goes last, so the mode the host ends on is the one the device is on
+        coalesced++;
+        uint8_t i = 0;
+        while (order[(head + i) % NOTIFY_SLOTS] != index) i++;
+        for (; i + 1 < depth; i++) {
+            order[(head + i) % NOTIFY_SLOTS] = order[(head + i + 1) % NOTIFY_SLOTS];
+        }
+        order[(head + depth - 1) % NOTIFY_SLOTS] = index;
+    } else {
+        isPending[index] = true;
+        order[(head + depth) % NOTIFY_SLOTS] = index;
+        depth++;
+        if (depth > maxDepth) maxDepth = depth;
+    }
+    pending[index] = state;
+}
+
+uint8_t NotifyScheduler::next(unsigned long now, toneState *out) {
+    if (depth == 0) return 0;
+    if (flushed && now - lastFlush < interval) return 0;
+
+    // Take the oldest slot of every channel, the others move up in their order
+    bool taken[TONE_MAX_CHANNELS] = {};
+    uint8_t count = 0;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < depth; i++) {
+        uint8_t index = order[(head + i) % NOTIFY_SLOTS];
+        uint8_t channel = index / NOTIFY_MAX_MODES;
+        if (taken[channel]) {
+            order[(head + kept++) % NOTIFY_SLOTS] = index;
+            continue;
+        }
+        taken[channel] = true;
+        isPending[index] = false;
+        out[count++] = pending[index];
+    }
+    depth = kept;
+
+    lastFlush = now;
+    flushed = true;
+    sent += count;
+    return count;
+}
+
+void NotifyScheduler::setInterval(unsigned long intervalMs) {
+    interval = max(intervalMs, (unsigned long) NOTIFY_MIN_INTERVAL_MS);
+}
+
+void NotifyScheduler::clear() {
+    for (int i = 0; i < NOTIFY_SLOTS; i++) {
+        isPending[i] = false;
+    }
+    head = 0;
+    depth = 0;
+}
+
+unsigned long NotifyScheduler::getInterval() const {
+    return interval;
+}
+
+unsigned long NotifyScheduler::getCoalesced() const {
+    return coalesced;
+}
+
+unsigned long NotifyScheduler::getSent() const {
+    return sent;
+}
+
+uint8_t NotifyScheduler::getQueueDepth() const {
+    return depth;
+}
+
+uint8_t NotifyScheduler::getMaxQueueDepth() const {
+    return maxDepth;
+}
@@ -0,0 +1,85 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef NOTIFYSCHEDULER_H
+#define NOTIFYSCHEDULER_H
+
+#include <Arduino.h>
+#include "ToneProtocol.h"
+
+/**
+ * @brief Number of modes per channel the scheduler can hold a pending state for.
+ */
+#define NOTIFY_MAX_MODES 16
+
+/**
+ * @brief Pending state slots, one per mode of every channel.
+ */
+#define NOTIFY_SLOTS (TONE_MAX_CHANNELS * NOTIFY_MAX_MODES)
+
+/**
+ * @brief Lower bound of the interval between two notifications in milliseconds.
+ */
+#define NOTIFY_MIN_INTERVAL_MS 15
+
+/**
+ * @brief Interval used until a connection interval has been negotiated, in milliseconds.
+ */
+#define NOTIFY_DEFAULT_INTERVAL_MS 30
+
+/**
+ * @brief NotifyScheduler rate-limits notifications and coalesces intermediate states.
+ * Only the latest state of every mode of every channel is kept; pending modes are flushed in the
+ * order they were last submitted, at most one per channel every interval. The states released
+ * together go out in one notification.
+ */
+class NotifyScheduler {
+private:
+    toneState pending[NOTIFY_SLOTS]; ///< Latest unsent state per channel and mode
+    bool isPending[NOTIFY_SLOTS] = {}; ///< Slot has an unsent state
+    uint8_t order[NOTIFY_SLOTS] = {}; ///< FIFO of pending slots (channel * NOTIFY_MAX_MODES + mode)
+    uint8_t head = 0; ///< Index of the oldest entry in order
+    uint8_t depth = 0; ///< Number of pending modes
+    unsigned long interval = NOTIFY_DEFAULT_INTERVAL_MS; ///< Minimum time between notifications
+    unsigned long lastFlush = 0; ///< millis() of the last released state
+    bool flushed = false; ///< A state was released at lastFlush
+    unsigned long coalesced = 0; ///< States overwritten before they were sent
+    unsigned long sent = 0; ///< States released by next()
+    uint8_t maxDepth = 0; ///< Highest queue depth seen
+
+public:
+    /**
+     * @brief Queues a state, replacing an unsent state of the same channel and mode and moving it behind
+     * the other pending modes.
+     * @param state State to send.
+     */
+    void submit(const toneState &state);
+
+    /**
+     * @brief Releases the oldest pending state of every channel if the rate limit allows it.
+     * @param now Current millis() timestamp.
+     * @param out Receives the states to send, room for TONE_MAX_CHANNELS.
+     * @return Number of states released, 0 if none.
+     */
+    uint8_t next(unsigned long now, toneState *out);
+
+    /**
+     * @brief Sets the minimum interval between notifications.
+     * @param intervalMs Interval in milliseconds, clamped to NOTIFY_MIN_INTERVAL_MS.
+     */
+    void setInterval(unsigned long intervalMs);
+
+    /**
+     * @brief Drops all pending states.
+     */
+    void clear();
+
+    unsigned long getInterval() const;  // Minimum interval between notifications
+    unsigned long getCoalesced() const;  // States overwritten before they were sent
+    unsigned long getSent() const;  // States released for sending
+    uint8_t getQueueDepth() const;  // Channel modes with an unsent state
+    uint8_t getMaxQueueDepth() const;  // Highest queue depth seen
+};
+
+#endif //NOTIFYSCHEDULER_H
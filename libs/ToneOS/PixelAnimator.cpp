@@ -0,0 +1,208 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "PixelAnimator.h"
+
+static void fill(uint32_t *frame, int count, uint32_t color) {
+    for (int i = 0; i < count; i++) {
+        frame[i] = color;
+    }
+}
+
+void PixelEffect::start(unsigned long now) {
+    startTime = now;
+}
+
+void BlinkEffect::set(uint32_t color, unsigned long onMs, unsigned long offMs, int count) {
+    this->color = color;
+    this->onMs = max(onMs, 1UL);
+    this->offMs = offMs;
+    this->count = count;
+}
+
+bool BlinkEffect::render(unsigned long now, uint32_t *frame, int count) {
+    unsigned long elapsed = now - startTime;
+    unsigned long period = onMs + offMs;
+    if (this->count > 0 && elapsed >= period * this->count) return false;
+
+    fill(frame, count, elapsed % period < onMs ? color : 0);
+    return true;
+}
+
+void WipeEffect::set(uint32_t color, unsigned long durationMs) {
+    this->color = color;
+    this->durationMs = max(durationMs, 1UL);
+}
+
+bool WipeEffect::render(unsigned long now, uint32_t *frame, int count) {
+    unsigned long elapsed = now - startTime;
+    int lit = elapsed >= durationMs ? count : (int) (elapsed * count / durationMs) + 1;
+    fill(frame, lit, color);
+    return elapsed < durationMs;
+}
+
+void PulseEffect::set(uint32_t color, unsigned long periodMs, int cycles) {
+    this->color = color;
+    this->periodMs = max(periodMs, 2UL);
+    this->cycles = cycles;
+}
+
+bool PulseEffect::render(unsigned long now, uint32_t *frame, int count) {
+    unsigned long elapsed = now - startTime;
+    if (cycles > 0 && elapsed >= periodMs * cycles) return false;
+
+    // Triangle wave: floor -> full -> floor over one period
+    unsigned long phase = elapsed % periodMs;
+    unsigned long half = periodMs / 2;
+    unsigned long rise = phase < half ? phase : periodMs - phase;
+    uint8_t level = PULSE_FLOOR + rise * (255 - PULSE_FLOOR) / half;
+    fill(frame, count, PixelAnimator::scaleColor(color, level));
+    return true;
+}
+
+void LevelEffect::setColor(uint32_t color) {
+    this->color = color;
+}
+
+void LevelEffect::setTarget(int32_t level, bool jump) {
+    target = level;
+    if (jump) {
+        current = level;
+        jumped = true;
+    }
+}
+
+int32_t LevelEffect::getLevel() const {
+    return current;
+}
+
+bool LevelEffect::render(unsigned long now, uint32_t *frame, int count) {
+    unsigned long elapsed = jumped ? 0 : min(now - lastStep, (unsigned long) LEVEL_EASE_MS);
+    lastStep = now;
+    jumped = false;
+
+    int32_t distance = target - current;
+    int32_t step = distance * (int32_t) elapsed / LEVEL_EASE_MS;
+    if (step == 0 && distance != 0 && elapsed > 0) step = distance > 0 ? 1 : -1;
+    current += step;
+
+    PixelController::renderLevel(frame, count, current, color);
+    return true;
+}
+
+void CrossfadeEffect::begin(const uint32_t *from, PixelEffect *to, unsigned long durationMs, unsigned long now) {
+    this->from = from;
+    this->to = to;
+    this->durationMs = durationMs;
+    start(now);
+}
+
+PixelEffect *CrossfadeEffect::getTarget() const {
+    return to;
+}
+
+bool CrossfadeEffect::render(unsigned long now, uint32_t *frame, int count) {
+    to->render(now, frame, count);
+    unsigned long elapsed = now - startTime;
+    if (elapsed >= durationMs) return false;
+
+    uint8_t amount = elapsed * 255 / durationMs;
+    for (int i = 0; i < count; i++) {
+        frame[i] = PixelAnimator::blendColor(from[i], frame[i], amount);
+    }
+    return true;
+}
+
+PixelAnimator::PixelAnimator(PixelController *pixel) : pixel(pixel) {
+    this->count = pixel->getNumPixels();
+    this->frame = new uint32_t[count];
+    this->snapshot = new uint32_t[count];
+    fill(frame, count, 0);
+    fill(snapshot, count, 0);
+}
+
+void PixelAnimator::setBackground(PixelEffect *effect) {
+    background = effect;
+    forceFrame = true;
+}
+
+void PixelAnimator::play(PixelEffect *effect, unsigned long now, unsigned long fadeInMs, unsigned long fadeOutMs) {
+    effect->start(now);
+    this->fadeOutMs = fadeOutMs;
+    transition(effect, fadeInMs, now);
+}
+
+void PixelAnimator::stop(unsigned long now, unsigned long fadeMs) {
+    if (foreground == nullptr) return;
+    transition(background, fadeMs, now);
+}
+
+void PixelAnimator::transition(PixelEffect *effect, unsigned long fadeMs, unsigned long now) {
+    if (fadeMs > 0 && effect != nullptr) {
+        memcpy(snapshot, frame, count * sizeof(uint32_t));
+        crossfade.begin(snapshot, effect, fadeMs, now);
+        foreground = &crossfade;
+    } else {
+        foreground = effect == background ? nullptr : effect;
+    }
+    forceFrame = true;
+}
+
+bool PixelAnimator::update(unsigned long now) {
+    if (!forceFrame && now - lastFrame < frameInterval) {
+        return false;
+    }
+    lastFrame = now;
+    forceFrame = false;
+
+    if (foreground != nullptr && !foreground->render(now, frame, count)) {
+        if (foreground == &crossfade) {
+            // The fade is over, its target keeps running on its own
+            PixelEffect *target = crossfade.getTarget();
+            foreground = target == background ? nullptr : target;
+        } else {
+            transition(background, fadeOutMs, now);
+            forceFrame = false;
+            if (foreground != nullptr) foreground->render(now, frame, count);
+            else if (background != nullptr) background->render(now, frame, count);
+        }
+    } else if (foreground == nullptr && background != nullptr) {
+        background->render(now, frame, count);
+    }
+
+    for (int i = 0; i < count; i++) {
+        pixel->setPixelColor(i, frame[i]);
+    }
+    pixel->show();
+    return true;
+}
+
+bool PixelAnimator::isPlaying() const {
+    return foreground != nullptr;
+}
+
+void PixelAnimator::setFrameInterval(unsigned long intervalMs) {
+    frameInterval = intervalMs;
+}
+
+const uint32_t *PixelAnimator::getFrame() const {
+    return frame;
+}
+
+uint32_t PixelAnimator::scaleColor(uint32_t color, uint8_t level) {
+    uint32_t r = ((color >> 16) & 0xFF) * level / 255;
+    uint32_t g = ((color >> 8) & 0xFF) * level / 255;
+    uint32_t b = (color & 0xFF) * level / 255;
+    return (r << 16) | (g << 8) | b;
+}
+
+uint32_t PixelAnimator::blendColor(uint32_t from, uint32_t to, uint8_t amount) {
+    uint32_t result = 0;
+    for (int shift = 0; shift <= 16; shift += 8) {
+        int a = (from >> shift) & 0xFF;
+        int b = (to >> shift) & 0xFF;
+        result |= (uint32_t) (a + (b - a) * amount / 255) << shift;
+    }
+    return result;
+}
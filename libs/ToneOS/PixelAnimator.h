@@ -0,0 +1,211 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef PIXELANIMATOR_H
+#define PIXELANIMATOR_H
+
+#include <Arduino.h>
+#include "PixelController.h"
+
+/**
+ * @brief Minimum time between two rendered frames in milliseconds (50 fps cap).
+ */
+#define PIXEL_FRAME_MS 20
+
+/**
+ * @brief Time constant of the level fill in milliseconds, the level covers the remaining distance
+ * to its target at 1/LEVEL_EASE_MS per millisecond.
+ */
+#define LEVEL_EASE_MS 60
+
+/**
+ * @brief Lowest brightness (0–255) of a PulseEffect.
+ */
+#define PULSE_FLOOR 24
+
+/**
+ * @brief Base class of the LED effects. An effect is a function of time: render() draws the frame at
+ * `now` into a buffer in logical pixel order and must never block or allocate.
+ */
+class PixelEffect {
+protected:
+    unsigned long startTime = 0; ///< millis() timestamp the effect was started at
+
+public:
+    virtual ~PixelEffect() = default;
+
+    /**
+     * @brief Restarts the effect.
+     * @param now Current millis() timestamp.
+     */
+    virtual void start(unsigned long now);
+
+    /**
+     * @brief Draws the frame at `now`. The buffer holds the previous frame on entry.
+     * @param now Current millis() timestamp.
+     * @param frame Packed RGB colors in logical pixel order.
+     * @param count Number of pixels.
+     * @return false once the effect has finished.
+     */
+    virtual bool render(unsigned long now, uint32_t *frame, int count) = 0;
+};
+
+/**
+ * @brief Flashes all pixels `count` times (0 = forever). With offMs = 0 and count = 1 it holds a color for onMs.
+ */
+class BlinkEffect : public PixelEffect {
+private:
+    uint32_t color = 0;
+    unsigned long onMs = 100;
+    unsigned long offMs = 100;
+    int count = 1;
+
+public:
+    void set(uint32_t color, unsigned long onMs, unsigned long offMs, int count);
+    bool render(unsigned long now, uint32_t *frame, int count) override;
+};
+
+/**
+ * @brief Lights the pixels one after the other over durationMs, on top of the previous frame.
+ */
+class WipeEffect : public PixelEffect {
+private:
+    uint32_t color = 0;
+    unsigned long durationMs = 200;
+
+public:
+    void set(uint32_t color, unsigned long durationMs);
+    bool render(unsigned long now, uint32_t *frame, int count) override;
+};
+
+/**
+ * @brief Breathes all pixels between PULSE_FLOOR and full brightness, `cycles` times (0 = forever).
+ */
+class PulseEffect : public PixelEffect {
+private:
+    uint32_t color = 0;
+    unsigned long periodMs = 1000;
+    int cycles = 0;
+
+public:
+    void set(uint32_t color, unsigned long periodMs, int cycles);
+    bool render(unsigned long now, uint32_t *frame, int count) override;
+};
+
+/**
+ * @brief Fills the ring up to a fractional level that moves smoothly towards its target. Never finishes.
+ */
+class LevelEffect : public PixelEffect {
+private:
+    uint32_t color = 0;
+    int32_t target = 0;          ///< Target level in 1/LEVEL_ONE pixels
+    int32_t current = 0;         ///< Displayed level in 1/LEVEL_ONE pixels
+    unsigned long lastStep = 0;  ///< millis() timestamp of the last easing step
+    bool jumped = true;          ///< Next render starts easing from now
+
+public:
+    void setColor(uint32_t color);
+
+    /**
+     * @brief Sets the level to fill to.
+     * @param level Level in 1/LEVEL_ONE pixels.
+     * @param jump Show the level immediately instead of easing towards it.
+     */
+    void setTarget(int32_t level, bool jump = false);
+
+    int32_t getLevel() const;  // Displayed level in 1/LEVEL_ONE pixels
+    bool render(unsigned long now, uint32_t *frame, int count) override;
+};
+
+/**
+ * @brief Blends from a captured frame into another effect over durationMs.
+ */
+class CrossfadeEffect : public PixelEffect {
+private:
+    const uint32_t *from = nullptr; ///< Frame the fade starts from
+    PixelEffect *to = nullptr;      ///< Effect the fade ends in
+    unsigned long durationMs = 0;
+
+public:
+    /**
+     * @brief Starts a fade. `to` is not restarted.
+     * @param from Frame to fade from, must stay valid during the fade.
+     * @param to Effect to fade into.
+     * @param durationMs Fade duration.
+     * @param now Current millis() timestamp.
+     */
+    void begin(const uint32_t *from, PixelEffect *to, unsigned long durationMs, unsigned long now);
+
+    PixelEffect *getTarget() const;  // Effect the fade ends in
+    bool render(unsigned long now, uint32_t *frame, int count) override;
+};
+
+/**
+ * @brief PixelAnimator steps effects by timestamp and flushes their frames to a PixelController.
+ *
+ * A background effect (usually a LevelEffect) is shown whenever no foreground effect runs. Finished
+ * foreground effects fade back into the background. Frames are rendered at most every PIXEL_FRAME_MS.
+ */
+class PixelAnimator {
+private:
+    PixelController *pixel;      ///< Output
+    int count;                   ///< Number of pixels
+    uint32_t *frame;             ///< Last rendered frame, logical pixel order
+    uint32_t *snapshot;          ///< Frame the running crossfade starts from
+    CrossfadeEffect crossfade;   ///< Transition between effects
+    PixelEffect *background = nullptr; ///< Effect shown when nothing else runs
+    PixelEffect *foreground = nullptr; ///< Running effect, nullptr if none
+    unsigned long fadeOutMs = 0; ///< Fade into the background when the foreground finishes
+    unsigned long frameInterval = PIXEL_FRAME_MS;
+    unsigned long lastFrame = 0; ///< millis() timestamp of the last rendered frame
+    bool forceFrame = true;      ///< Render on the next update regardless of the frame cap
+
+    /**
+     * @brief Makes `effect` the foreground, through a crossfade from the current frame if fadeMs > 0.
+     */
+    void transition(PixelEffect *effect, unsigned long fadeMs, unsigned long now);
+
+public:
+    explicit PixelAnimator(PixelController *pixel);
+
+    /**
+     * @brief Sets the effect shown when no foreground effect runs.
+     * @param effect Background effect, must outlive the animator.
+     */
+    void setBackground(PixelEffect *effect);
+
+    /**
+     * @brief Starts a foreground effect.
+     * @param effect Effect to play, must stay valid until it finished.
+     * @param now Current millis() timestamp.
+     * @param fadeInMs Crossfade from the current frame into the effect.
+     * @param fadeOutMs Crossfade back into the background when the effect finished.
+     */
+    void play(PixelEffect *effect, unsigned long now, unsigned long fadeInMs = 0, unsigned long fadeOutMs = 0);
+
+    /**
+     * @brief Ends the foreground effect and fades into the background.
+     */
+    void stop(unsigned long now, unsigned long fadeMs = 0);
+
+    /**
+     * @brief Renders and flushes a frame if the frame interval has passed. Never blocks.
+     * @param now Current millis() timestamp.
+     * @return true if a frame was rendered.
+     */
+    bool update(unsigned long now);
+
+    /**
+     * @brief Checks if a foreground effect (or its fade out) is running.
+     */
+    bool isPlaying() const;
+
+    void setFrameInterval(unsigned long intervalMs);  // Frame cap, PIXEL_FRAME_MS by default
+    const uint32_t *getFrame() const;  // Last rendered frame, logical pixel order
+
+    static uint32_t scaleColor(uint32_t color, uint8_t level);  // Scales every channel by level/255
+    static uint32_t blendColor(uint32_t from, uint32_t to, uint8_t amount);  // Mixes amount/255 of `to` into `from`
+};
+
+#endif //PIXELANIMATOR_H
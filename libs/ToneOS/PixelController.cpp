@@ -5,37 +5,87 @@
 
 #include "PixelController.h"
 
-PixelController::PixelController(int pin, int numPixels, int offset, bool isReverse) : numPixels(numPixels), offset(offset), isReverse(isReverse) {
+/**
+ * @brief Channel value raised to PIXEL_GAMMA, scaled back to 0..255.
+ */
+static const uint8_t GAMMA_TABLE[256] = {
+          0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+          1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+          3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+          6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+         12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+         20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+         30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+         42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+         56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+         73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+         91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+        113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+        137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+        163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+        192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+        223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+/**
+ * @brief Inverse of GAMMA_TABLE: channel scale for a fraction of a pixel's light (fraction/255).
+ */
+static const uint8_t LEVEL_RAMP[256] = {
+          0,  21,  28,  34,  39,  43,  46,  50,  53,  56,  59,  61,  64,  66,  68,  70,
+         72,  74,  76,  78,  80,  82,  84,  85,  87,  89,  90,  92,  93,  95,  96,  98,
+         99, 101, 102, 103, 105, 106, 107, 109, 110, 111, 112, 114, 115, 116, 117, 118,
+        119, 120, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135,
+        136, 137, 138, 139, 140, 141, 142, 143, 144, 144, 145, 146, 147, 148, 149, 150,
+        151, 151, 152, 153, 154, 155, 156, 156, 157, 158, 159, 160, 160, 161, 162, 163,
+        164, 164, 165, 166, 167, 167, 168, 169, 170, 170, 171, 172, 173, 173, 174, 175,
+        175, 176, 177, 178, 178, 179, 180, 180, 181, 182, 182, 183, 184, 184, 185, 186,
+        186, 187, 188, 188, 189, 190, 190, 191, 192, 192, 193, 194, 194, 195, 195, 196,
+        197, 197, 198, 199, 199, 200, 200, 201, 202, 202, 203, 203, 204, 205, 205, 206,
+        206, 207, 207, 208, 209, 209, 210, 210, 211, 212, 212, 213, 213, 214, 214, 215,
+        215, 216, 217, 217, 218, 218, 219, 219, 220, 220, 221, 221, 222, 223, 223, 224,
+        224, 225, 225, 226, 226, 227, 227, 228, 228, 229, 229, 230, 230, 231, 231, 232,
+        232, 233, 233, 234, 234, 235, 235, 236, 236, 237, 237, 238, 238, 239, 239, 240,
+        240, 241, 241, 242, 242, 243, 243, 244, 244, 245, 245, 246, 246, 247, 247, 248,
+        248, 249, 249, 249, 250, 250, 251, 251, 252, 252, 253, 253, 254, 254, 255, 255,
+};
+
+PixelController::PixelController(int pin, int numPixels, int offset, bool isReverse)
+        : PixelController(new NeoPixelOutput(pin, numPixels), numPixels, offset, isReverse) {
+}
+
+PixelController::PixelController(PixelOutput *output, int numPixels, int offset, bool isReverse) : output(output),
+        numPixels(numPixels), offset(offset), isReverse(isReverse) {
     this->pixelStatus = new bool[numPixels];
-    this->offset = offset;
-    this->isReverse = isReverse;
-    this->numPixels = numPixels;
-    this->pixels = new Adafruit_NeoPixel(numPixels, pin, NEO_GRB + NEO_KHZ800);
+    this->frame = new uint32_t[numPixels];
+    this->outputFrame = new uint32_t[numPixels];
+    this->dirtyFrom = numPixels;
+    this->dirtyTo = -1;
     this->currentPixel = -1;
-    this->pixels->setBrightness(255); // Set default brightness to maximum
+    buildLevels();
 
     for (int i = 0; i < numPixels; i++) {
         pixelStatus[i] = false;
+        frame[i] = 0;
+        outputFrame[i] = 0;
     }
 }
 
-void PixelController::begin() {
-    pixels->begin();
-    pixels->show();
+PixelController::~PixelController() {
+    delete output;
+    delete[] pixelStatus;
+    delete[] frame;
+    delete[] outputFrame;
 }
 
-void PixelController::blink(int r, int g, int b, int delayTime) {
-    this->setAllPixelsColor(r, g, b);
-    this->show();
-    delay(delayTime);
-    this->setAllPixelsColor(0, 0, 0);
-    this->show();
+void PixelController::begin() {
+    output->begin();
+    output->write(outputFrame, numPixels);
 }
 
 void PixelController::setPixelColor(int pixel, int r, int g, int b) {
     pixel = getPixelIndex(pixel);
     if (pixel >= 0 && pixel < numPixels) {
-        pixels->setPixelColor(pixel, pixels->Color(r, g, b));
+        writePixel(pixel, Adafruit_NeoPixel::Color(r, g, b));
         pixelStatus[pixel] = true;
     }
 }
@@ -43,15 +93,26 @@ void PixelController::setPixelColor(int pixel, int r, int g, int b) {
 void PixelController::setPixelColor(int pixel, uint32_t color) {
     pixel = getPixelIndex(pixel);
     if (pixel >= 0 && pixel < numPixels) {
-        pixels->setPixelColor(pixel, color);
+        writePixel(pixel, color);
         pixelStatus[pixel] = true;
     }
 }
 
+void PixelController::writePixel(int index, uint32_t color) {
+    if (frame[index] == color) return;
+    frame[index] = color;
+    markDirty(index, index);
+}
+
+void PixelController::markDirty(int from, int to) {
+    if (from < dirtyFrom) dirtyFrom = from;
+    if (to > dirtyTo) dirtyTo = to;
+}
+
 int PixelController::getPixelIndex(int pixel) {
     pixel = pixel + offset;
     if (pixel < 0) pixel = numPixels + pixel;
-    if (pixel > numPixels) pixel = pixel % numPixels;
+    if (pixel >= numPixels) pixel = pixel % numPixels;
     if (this->isReverse) pixel = (numPixels - pixel) - 1;
     return pixel;
 }
@@ -63,21 +124,64 @@ void PixelController::setFirstnPixelColor(int n, int r, int g, int b) {
     this->currentPixel = n;
 }
 
+void PixelController::setLevel(int32_t level, uint32_t color) {
+    for (int i = 0; i < numPixels; i++) {
+        uint32_t pixelColor;
+        renderLevel(&pixelColor, 1, level - (int32_t) i * LEVEL_ONE, color);
+        setPixelColor(i, pixelColor);
+    }
+}
+
+void PixelController::renderLevel(uint32_t *frame, int count, int32_t level, uint32_t color) {
+    int lit = level <= 0 ? 0 : min(level / LEVEL_ONE, (int32_t) count);
+    for (int i = 0; i < lit; i++) {
+        frame[i] = color;
+    }
+    if (lit < count && level > 0) {
+        uint32_t scale = LEVEL_RAMP[level % LEVEL_ONE];
+        uint32_t r = ((color >> 16) & 0xFF) * scale / 255;
+        uint32_t g = ((color >> 8) & 0xFF) * scale / 255;
+        uint32_t b = (color & 0xFF) * scale / 255;
+        frame[lit++] = (r << 16) | (g << 8) | b;
+    }
+    for (int i = lit; i < count; i++) {
+        frame[i] = 0;
+    }
+}
+
 void PixelController::setBrightness(int brightness) {
-    pixels->setBrightness(brightness);
+    brightness = constrain(brightness, 0, 255);
+    if (this->brightness == brightness) return;
+    this->brightness = brightness;
+    buildLevels();
 }
 
-void PixelController::setAllPixelsColor(int r, int g, int b) {
-    for (int i = 0; i < numPixels; i++) {
-        setPixelColor(i, r, g, b);
+int PixelController::getBrightness() const {
+    return brightness;
+}
+
+void PixelController::setGamma(bool enabled) {
+    if (gamma == enabled) return;
+    gamma = enabled;
+    buildLevels();
+}
+
+void PixelController::buildLevels() {
+    buildLevelTable(levels, brightness, gamma);
+    // Every pixel changes its output level, so all of them have to be retransmitted
+    markDirty(0, numPixels - 1);
+}
+
+void PixelController::buildLevelTable(uint8_t *levels, uint8_t brightness, bool gamma) {
+    for (int i = 0; i < 256; i++) {
+        int level = gamma ? GAMMA_TABLE[i] : i;
+        levels[i] = (level * brightness + 127) / 255;
     }
 }
 
-void PixelController::setAllPixelsColorOrdered(int r, int g, int b, int delayTime) {
+void PixelController::setAllPixelsColor(int r, int g, int b) {
     for (int i = 0; i < numPixels; i++) {
         setPixelColor(i, r, g, b);
-        this->show();
-        delay(delayTime);
     }
 }
 
@@ -88,24 +192,69 @@ void PixelController::setCurrentPixelColor(int r, int g, int b) {
 }
 
 void PixelController::show() {
-    pixels->show();
+    output->poll();
+    if (!isDirty()) {
+        framesSkipped++;
+        return;
+    }
+    TONE_METRIC_SCOPE(METRIC_SHOW);
+    for (int i = dirtyFrom; i <= dirtyTo; i++) {
+        uint32_t color = frame[i];
+        outputFrame[i] = ((uint32_t) levels[(color >> 16) & 0xFF] << 16) | ((uint32_t) levels[(color >> 8) & 0xFF] << 8)
+                         | levels[color & 0xFF];
+    }
+    output->write(outputFrame, numPixels);
+    framesFlushed++;
+    dirtyFrom = numPixels;
+    dirtyTo = -1;
+}
+
+void PixelController::poll() {
+    output->poll();
+}
+
+bool PixelController::isSending() const {
+    return output->isBusy();
+}
+
+void PixelController::waitSent() {
+    output->wait();
+}
+
+PixelOutput *PixelController::getOutput() {
+    return output;
 }
 
 void PixelController::clear() {
     for (int i = 0; i < numPixels; i++) {
-        pixels->setPixelColor(i, pixels->Color(0, 0, 0));
+        writePixel(i, 0);
         pixelStatus[i] = false;
     }
-    pixels->show();
+}
+
+bool PixelController::isDirty() const {
+    return dirtyTo >= dirtyFrom;
+}
+
+unsigned long PixelController::getFramesFlushed() const {
+    return framesFlushed;
+}
+
+unsigned long PixelController::getFramesSkipped() const {
+    return framesSkipped;
 }
 
 uint32_t PixelController::getPixelColor(int pixel) {
     if (pixel >= 0 && pixel < numPixels) {
-        return pixels->getPixelColor(pixel);
+        return frame[pixel];
     }
     return 0;
 }
 
+bool PixelController::isPixelOn(int pixel) const {
+    return pixel >= 0 && pixel < numPixels && pixelStatus[pixel];
+}
+
 int PixelController::getNumPixels() {
     return numPixels;
 }
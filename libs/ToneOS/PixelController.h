@@ -7,16 +7,41 @@
 
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
+#include "PixelOutput.h"
+#include "ToneMetrics.h"
+
+/**
+ * @brief Gamma applied to every channel when a frame is flushed.
+ */
+#define PIXEL_GAMMA 2.2
+
+/**
+ * @brief Fixed point scale of fractional levels: one pixel is LEVEL_ONE units.
+ */
+#define LEVEL_ONE 256
 
 /**
  * @brief A controller class for managing Adafruit NeoPixel LED strips or rings.
- * Provides easy manipulation of individual or grouped pixels, brightness, and effects.
+ * Provides easy manipulation of individual or grouped pixels and brightness. Timed effects live in PixelAnimator.
+ *
+ * Colors are kept unscaled in a frame buffer. Brightness and gamma correction are applied through one
+ * 256 entry lookup table when the frame is flushed, so changing brightness never loses color precision.
+ * Flushed frames go to a PixelOutput, which sends them with Adafruit_NeoPixel or in the background through RMT.
  */
 class PixelController {
 private:
-    Adafruit_NeoPixel *pixels;
+    PixelOutput *output;   ///< Sends flushed frames to the strip
     int currentPixel = -1; ///< Index of the currently selected pixel
     bool *pixelStatus;     ///< Stores pixel on/off status
+    uint32_t *frame;       ///< Shadow frame buffer, unscaled colors by hardware index
+    uint32_t *outputFrame; ///< Frame as sent, brightness and gamma applied
+    uint8_t levels[256];   ///< Output level of every channel value (gamma and brightness)
+    uint8_t brightness = 255; ///< Brightness baked into levels
+    bool gamma = true;     ///< Gamma correction baked into levels
+    int dirtyFrom;         ///< First hardware index changed since the last flush
+    int dirtyTo;           ///< Last hardware index changed since the last flush (-1 if clean)
+    unsigned long framesFlushed = 0; ///< Number of show() calls that were transmitted
+    unsigned long framesSkipped = 0; ///< Number of show() calls skipped because nothing changed
     int numPixels;         ///< Total number of pixels
     int offset;            ///< Rotation offset for pixel layout
     bool isReverse;        ///< Is led index reversed
@@ -28,6 +53,25 @@ private:
      */
     int getPixelIndex(int pixel);
 
+    /**
+     * @brief Writes a color into the frame buffer and marks the pixel dirty if it changed.
+     * @param index Hardware pixel index.
+     * @param color Packed RGB color.
+     */
+    void writePixel(int index, uint32_t color);
+
+    /**
+     * @brief Marks a range of hardware pixels as changed since the last flush.
+     * @param from First hardware index.
+     * @param to Last hardware index.
+     */
+    void markDirty(int from, int to);
+
+    /**
+     * @brief Rebuilds the output level table from brightness and gamma.
+     */
+    void buildLevels();
+
 public:
 /**
      * @brief Construct a new Pixel Controller object.
@@ -39,18 +83,26 @@ public:
     PixelController(int pin, int numPixels, int offset = 0, bool isReverse=false);
 
     /**
-     * @brief Initializes the NeoPixel strip.
+     * @brief Construct a new Pixel Controller object sending through the given output.
+     * @param output Output of the strip, owned by the controller from now on.
+     * @param numPixels Number of pixels in the strip or ring.
+     * @param offset Optional rotation offset (default is 0).
+     * @param isReversed Optional reversed indexing (default is false).
      */
-    void begin();
+    PixelController(PixelOutput *output, int numPixels, int offset = 0, bool isReverse=false);
 
     /**
-     * @brief Blinks all pixels with the specified color.
-     * @param r Red component (0–255).
-     * @param g Green component (0–255).
-     * @param b Blue component (0–255).
-     * @param delayTime Time in milliseconds for blink duration (default: 100ms).
+     * @brief Frees the frame buffers and the output.
      */
-    void blink(int r, int g, int b, int delayTime = 100);
+    ~PixelController();
+
+    PixelController(const PixelController &) = delete;
+    PixelController &operator=(const PixelController &) = delete;
+
+    /**
+     * @brief Initializes the NeoPixel strip.
+     */
+    void begin();
 
     /**
      * @brief Sets a specific pixel to a color using RGB values.
@@ -78,27 +130,56 @@ public:
     void setFirstnPixelColor(int n, int r, int g, int b);
 
     /**
-     * @brief Sets the brightness of the entire pixel strip.
+     * @brief Lights the ring up to a fractional level. Whole pixels get `color`, the next one is dimmed
+     * by the remainder and the rest is turned off. Call show() to apply.
+     * @param level Level in 1/LEVEL_ONE pixels.
+     * @param color Packed RGB color.
+     */
+    void setLevel(int32_t level, uint32_t color);
+
+    /**
+     * @brief Renders a fractional level into a frame in logical pixel order, see setLevel().
+     * The remainder goes through LEVEL_RAMP, so after gamma correction the light of the last pixel
+     * grows linearly with the level and every level step changes the output. Integer math only.
+     * @param frame Packed RGB colors in logical pixel order.
+     * @param count Number of pixels.
+     * @param level Level in 1/LEVEL_ONE pixels.
+     * @param color Packed RGB color.
+     */
+    static void renderLevel(uint32_t *frame, int count, int32_t level, uint32_t color);
+
+    /**
+     * @brief Fills the output level of every channel value: gamma (PIXEL_GAMMA) if enabled, then brightness.
+     * @param levels Receives 256 levels.
+     * @param brightness Brightness (0–255).
+     * @param gamma true to correct.
+     */
+    static void buildLevelTable(uint8_t *levels, uint8_t brightness, bool gamma);
+
+    /**
+     * @brief Sets the brightness of the entire pixel strip, applied when the next frame is flushed.
      * @param brightness Brightness value (0–255).
      */
     void setBrightness(int brightness);
 
     /**
-     * @brief Sets all pixels to the same color instantly.
-     * @param r Red (0–255).
-     * @param g Green (0–255).
-     * @param b Blue (0–255).
+     * @brief Returns the brightness applied at flush time.
      */
-    void setAllPixelsColor(int r, int g, int b);
+    int getBrightness() const;
 
     /**
-     * @brief Sets all pixels one by one with a delay for a wave-like effect.
+     * @brief Enables or disables gamma correction (PIXEL_GAMMA) at flush time.
+     * @param enabled true to correct (default).
+     */
+    void setGamma(bool enabled);
+
+    /**
+     * @brief Sets all pixels to the same color instantly.
      * @param r Red (0–255).
      * @param g Green (0–255).
      * @param b Blue (0–255).
-     * @param delayTime Delay between each pixel update (ms, default: 10).
      */
-    void setAllPixelsColorOrdered(int r, int g, int b, int delayTime = 10);
+    void setAllPixelsColor(int r, int g, int b);
 
     /**
      * @brief Sets the currently active pixel (based on internal index) to a specific color.
@@ -110,21 +191,66 @@ public:
 
     /**
      * @brief Applies all pending pixel changes to the strip (must be called to reflect changes).
+     * Changed pixels go through the brightness and gamma table, the transmission is skipped if
+     * no pixel changed since the last flush.
      */
     void show();
 
     /**
-     * @brief Clears all pixels (turns them off).
+     * @brief Sends a frame that show() left waiting for the previous transmission. Call regularly.
+     */
+    void poll();
+
+    /**
+     * @brief Returns true while a flushed frame is being sent or waits to be.
+     */
+    bool isSending() const;
+
+    /**
+     * @brief Blocks until every flushed frame has been sent.
+     */
+    void waitSent();
+
+    /**
+     * @brief Returns the output frames are sent through.
+     */
+    PixelOutput *getOutput();
+
+    /**
+     * @brief Clears all pixels (turns them off). Call show() to apply.
      */
     void clear();
 
+    /**
+     * @brief Checks if any pixel changed since the last flush.
+     * @return true if the next show() will transmit a frame.
+     */
+    bool isDirty() const;
+
+    /**
+     * @brief Returns the number of frames transmitted to the strip.
+     * @return Number of flushed frames.
+     */
+    unsigned long getFramesFlushed() const;
+
+    /**
+     * @brief Returns the number of show() calls skipped because nothing changed.
+     * @return Number of skipped frames.
+     */
+    unsigned long getFramesSkipped() const;
+
     /**
      * @brief Returns the color of a specific pixel.
      * @param pixel Index of the pixel.
-     * @return 32-bit packed RGB color.
+     * @return 32-bit packed RGB color, before brightness and gamma.
      */
     uint32_t getPixelColor(int pixel);
 
+    /**
+     * @brief Returns true if a pixel (hardware index) was set since the last clear().
+     */
+    bool isPixelOn(int pixel) const;
+
     /**
      * @brief Returns the number of pixels controlled by this instance.
      * @return Total number of pixels.
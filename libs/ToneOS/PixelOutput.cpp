@@ -0,0 +1,151 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "PixelOutput.h"
+
+#define S0 PIXEL_SYMBOL(PIXEL_T0H, PIXEL_T0L)
+#define S1 PIXEL_SYMBOL(PIXEL_T1H, PIXEL_T1L)
+
+/**
+ * @brief Symbols of every nibble, most significant bit first.
+ */
+static const uint32_t NIBBLE_SYMBOLS[16][4] = {
+        {S0, S0, S0, S0}, {S0, S0, S0, S1}, {S0, S0, S1, S0}, {S0, S0, S1, S1},
+        {S0, S1, S0, S0}, {S0, S1, S0, S1}, {S0, S1, S1, S0}, {S0, S1, S1, S1},
+        {S1, S0, S0, S0}, {S1, S0, S0, S1}, {S1, S0, S1, S0}, {S1, S0, S1, S1},
+        {S1, S1, S0, S0}, {S1, S1, S0, S1}, {S1, S1, S1, S0}, {S1, S1, S1, S1},
+};
+
+#undef S0
+#undef S1
+
+void PixelEncoder::encode(const uint32_t *colors, uint16_t count, uint32_t *symbols) {
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t color = colors[i];
+        uint32_t grb = ((color & 0xFF00) << 8) | ((color >> 8) & 0xFF00) | (color & 0xFF);
+        for (int shift = 20; shift >= 0; shift -= 4) {
+            memcpy(symbols, NIBBLE_SYMBOLS[(grb >> shift) & 0xF], sizeof(NIBBLE_SYMBOLS[0]));
+            symbols += 4;
+        }
+    }
+    if (count > 0) {
+        symbols[-1] = (symbols[-1] & 0xFFFF) | ((uint32_t) PIXEL_LATCH << 16);
+    }
+}
+
+PixelOutput *PixelOutput::create(int pin, uint16_t count, int rmtChannel) {
+#if TONE_PIXEL_RMT
+    if (rmtChannel >= 0 && rmtChannel < PIXEL_RMT_CHANNELS) {
+        return new RmtPixelOutput(pin, count, (rmt_channel_t) rmtChannel);
+    }
+#endif
+    return new NeoPixelOutput(pin, count);
+}
+
+void PixelOutput::setShownCallback(pixelShownCallback callback, void *arg) {
+    onShown = callback;
+    onShownArg = arg;
+}
+
+void IRAM_ATTR PixelOutput::shown() {
+    if (onShown != nullptr) onShown(onShownArg);
+}
+
+unsigned long PixelOutput::getFramesReplaced() const {
+    return framesReplaced;
+}
+
+NeoPixelOutput::NeoPixelOutput(int pin, uint16_t count) : pixels(count, pin, NEO_GRB + NEO_KHZ800) {
+    // Brightness is applied by PixelController, keep NeoPixel's scaling out of the way
+    pixels.setBrightness(255);
+}
+
+void NeoPixelOutput::begin() {
+    pixels.begin();
+}
+
+void NeoPixelOutput::write(const uint32_t *colors, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+        pixels.setPixelColor(i, colors[i]);
+    }
+    pixels.show();
+    this->shown();
+}
+
+#if TONE_PIXEL_RMT
+RmtPixelOutput *RmtPixelOutput::outputs[RMT_CHANNEL_MAX] = {};
+
+RmtPixelOutput::RmtPixelOutput(int pin, uint16_t count, rmt_channel_t channel) : channel(channel), pin(pin),
+                                                                                 count(count) {
+    buffers[0] = new uint32_t[PIXEL_SYMBOLS(count)];
+    buffers[1] = new uint32_t[PIXEL_SYMBOLS(count)];
+}
+
+RmtPixelOutput::~RmtPixelOutput() {
+    if (outputs[channel] == this) {
+        this->wait();
+        rmt_driver_uninstall(channel);
+        outputs[channel] = nullptr;
+    }
+    delete[] buffers[0];
+    delete[] buffers[1];
+}
+
+void RmtPixelOutput::begin() {
+    rmt_config_t config = {};
+    config.rmt_mode = RMT_MODE_TX;
+    config.channel = channel;
+    config.gpio_num = (gpio_num_t) pin;
+    config.clk_div = PIXEL_RMT_CLK_DIV;
+    config.mem_block_num = 1;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    config.tx_config.idle_output_en = true;
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(channel, 0, 0) != ESP_OK) return;
+
+    // The end callback is one for all channels
+    outputs[channel] = this;
+    rmt_register_tx_end_callback(transmitted, nullptr);
+}
+
+void RmtPixelOutput::write(const uint32_t *colors, uint16_t count) {
+    if (outputs[channel] != this) return;
+
+    if (pending) framesReplaced++;
+    lengths[back] = min(count, this->count);
+    PixelEncoder::encode(colors, lengths[back], buffers[back]);
+    pending = true;
+    this->poll();
+}
+
+void RmtPixelOutput::poll() {
+    if (pending && !sending) this->start();
+}
+
+bool RmtPixelOutput::isBusy() const {
+    return pending || sending;
+}
+
+void RmtPixelOutput::wait() {
+    while (this->isBusy()) {
+        rmt_wait_tx_done(channel, portMAX_DELAY);
+        sending = false;
+        this->poll();
+    }
+}
+
+void RmtPixelOutput::start() {
+    sending = true;
+    pending = false;
+    // The channel is idle, so this only copies the first block and returns
+    rmt_write_items(channel, (const rmt_item32_t *) buffers[back], PIXEL_SYMBOLS(lengths[back]), false);
+    back ^= 1;
+}
+
+void IRAM_ATTR RmtPixelOutput::transmitted(rmt_channel_t channel, void *arg) {
+    RmtPixelOutput *self = channel < RMT_CHANNEL_MAX ? outputs[channel] : nullptr;
+    if (self == nullptr) return;
+    self->sending = false;
+    self->shown();
+}
+#endif
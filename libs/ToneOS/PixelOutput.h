@@ -0,0 +1,192 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef PIXELOUTPUT_H
+#define PIXELOUTPUT_H
+
+#include <Arduino.h>
+#include <Adafruit_NeoPixel.h>
+#include <atomic>
+
+/**
+ * @brief Send ring frames through the RMT peripheral in the background instead of Adafruit_NeoPixel's
+ * blocking show(). Build with -DTONE_PIXEL_RMT=0 to use Adafruit_NeoPixel for every ring.
+ */
+#ifndef TONE_PIXEL_RMT
+#define TONE_PIXEL_RMT 1
+#endif
+
+#if TONE_PIXEL_RMT
+#include <driver/rmt.h>
+#endif
+
+/**
+ * @brief RMT transmit channels rings can use (the ESP32-C3 has two).
+ */
+#define PIXEL_RMT_CHANNELS 2
+
+/**
+ * @brief RMT clock divider: 80 MHz APB clock / 2, one tick is 25 ns.
+ */
+#define PIXEL_RMT_CLK_DIV 2
+
+/**
+ * @brief WS2812 bit timings in RMT ticks: high and low time of a 0 bit (400/850 ns) and a 1 bit (800/450 ns).
+ */
+#define PIXEL_T0H 16
+#define PIXEL_T0L 34
+#define PIXEL_T1H 32
+#define PIXEL_T1L 18
+
+/**
+ * @brief Low time that latches a frame, in RMT ticks (300 us, newer WS2812B need 280 us).
+ */
+#define PIXEL_LATCH 12000
+
+/**
+ * @brief RMT symbols of a frame: one per bit, 24 per pixel.
+ */
+#define PIXEL_SYMBOLS(count) ((size_t) (count) * 24)
+
+/**
+ * @brief A WS2812 bit in the rmt_item32_t layout: high for `high` ticks, then low for `low` ticks.
+ */
+#define PIXEL_SYMBOL(high, low) ((uint32_t) (high) | (1UL << 15) | ((uint32_t) (low) << 16))
+
+/**
+ * @brief Called when a frame has been sent and latched. Runs in interrupt context with the RMT output, so it
+ * must be IRAM_ATTR and only touch IRAM code and DRAM data (no Serial, no flash, FreeRTOS *FromISR calls only).
+ */
+typedef void (*pixelShownCallback)(void *arg);
+
+/**
+ * @brief PixelEncoder turns output colors into the RMT symbols of a WS2812 transmission.
+ * It does not touch the hardware, so the simulator can check and time it.
+ */
+class PixelEncoder {
+public:
+    /**
+     * @brief Encodes colors in GRB wire order, most significant bit first, one nibble table lookup per 4 bits.
+     * The low time of the last bit is stretched to PIXEL_LATCH, so the transmission ends once the strip latched.
+     * @param colors Packed RGB output colors.
+     * @param count Number of pixels.
+     * @param symbols Receives PIXEL_SYMBOLS(count) symbols.
+     */
+    static void encode(const uint32_t *colors, uint16_t count, uint32_t *symbols);
+};
+
+/**
+ * @brief PixelOutput sends frames of output colors to a ring. PixelController renders and corrects the
+ * colors and hands every changed frame to its output, which decides how it reaches the strip.
+ */
+class PixelOutput {
+private:
+    pixelShownCallback onShown = nullptr; ///< Called after every frame
+    void *onShownArg = nullptr;           ///< Argument of onShown
+
+protected:
+    unsigned long framesReplaced = 0; ///< Frames overwritten by a newer one before they were sent
+
+    void shown();  // Runs the completion callback, IRAM_ATTR as the RMT end interrupt calls it
+
+public:
+    virtual ~PixelOutput() = default;
+
+    /**
+     * @brief Creates the output of a ring.
+     * @param pin Data pin of the ring.
+     * @param count Number of pixels.
+     * @param rmtChannel RMT channel to send through, -1 (or TONE_PIXEL_RMT 0) for Adafruit_NeoPixel.
+     */
+    static PixelOutput *create(int pin, uint16_t count, int rmtChannel);
+
+    /**
+     * @brief Sets up the data pin.
+     */
+    virtual void begin() = 0;
+
+    /**
+     * @brief Sends a frame. Returns right away when the output transmits in the background; a frame
+     * written while the previous one is still being sent waits for it (see poll()).
+     * @param colors Packed RGB output colors by hardware index, read during the call only.
+     * @param count Number of pixels, at most the count the output was created with.
+     */
+    virtual void write(const uint32_t *colors, uint16_t count) = 0;
+
+    /**
+     * @brief Starts a frame that was written during the previous transmission once that one ended.
+     */
+    virtual void poll() {}
+
+    /**
+     * @brief Returns true while a frame is being sent or waits to be.
+     */
+    virtual bool isBusy() const { return false; }
+
+    /**
+     * @brief Blocks until every written frame has been sent.
+     */
+    virtual void wait() {}
+
+    /**
+     * @brief Sets the function called after every frame sent, nullptr for none.
+     */
+    void setShownCallback(pixelShownCallback callback, void *arg);
+
+    unsigned long getFramesReplaced() const;  // Frames overwritten before they were sent
+};
+
+/**
+ * @brief Output through Adafruit_NeoPixel. show() blocks for the whole transmission.
+ */
+class NeoPixelOutput : public PixelOutput {
+private:
+    Adafruit_NeoPixel pixels;
+
+public:
+    NeoPixelOutput(int pin, uint16_t count);
+
+    void begin() override;
+    void write(const uint32_t *colors, uint16_t count) override;
+};
+
+#if TONE_PIXEL_RMT
+/**
+ * @brief Output through an RMT transmit channel, double buffered.
+ *
+ * write() encodes the frame into the buffer the hardware is not reading and starts it, so the CPU
+ * renders and encodes the next frame while the previous one is on the wire, and rings on different
+ * channels transmit in parallel. The driver feeds the channel memory from its interrupt. A frame
+ * written during a transmission waits in the free buffer, replaced by newer ones, until poll() sees
+ * the channel idle.
+ */
+class RmtPixelOutput : public PixelOutput {
+private:
+    rmt_channel_t channel; ///< Transmit channel
+    int pin;               ///< Data pin
+    uint16_t count;        ///< Number of pixels
+    uint32_t *buffers[2];  ///< Symbol buffers, PIXEL_SYMBOLS(count) each
+    uint16_t lengths[2] = {}; ///< Pixels encoded into each buffer by the last write()
+    uint8_t back = 0;      ///< Buffer the next frame is encoded into
+    bool pending = false;  ///< buffers[back] holds a frame waiting for the channel
+    std::atomic<bool> sending{false}; ///< The channel is sending the other buffer, cleared by the end interrupt
+
+    static RmtPixelOutput *outputs[RMT_CHANNEL_MAX]; ///< Output of every installed channel, for the end interrupt
+
+    static void transmitted(rmt_channel_t channel, void *arg);  // RMT end interrupt, shared by all channels
+    void start();  // Hands buffers[back] to the channel and flips the buffers
+
+public:
+    RmtPixelOutput(int pin, uint16_t count, rmt_channel_t channel);
+    ~RmtPixelOutput() override;
+
+    void begin() override;
+    void write(const uint32_t *colors, uint16_t count) override;
+    void poll() override;
+    bool isBusy() const override;
+    void wait() override;
+};
+#endif
+
+#endif //PIXELOUTPUT_H
@@ -0,0 +1,113 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "PowerManager.h"
+
+#ifndef ARDUINO_ARCH_ESP32
+#include <chrono>
+#endif
+
+void PowerManager::begin(unsigned long now) {
+    state = reported = POWER_ACTIVE;
+    activeAt = updatedAt = startedAt = now;
+    for (unsigned long &ms : stateMs) ms = 0;
+    busyUs = sleepUs = wakes = 0;
+}
+
+void PowerManager::activity(unsigned long now) {
+    activeAt = now;
+    if (state != POWER_ACTIVE) {
+        stateMs[state] += now - updatedAt;
+        updatedAt = now;
+        state = POWER_ACTIVE;
+    }
+}
+
+bool PowerManager::update(unsigned long now, bool isConnected) {
+    if (isConnected != connected) {
+        connected = isConnected;
+        this->activity(now);
+    }
+
+    stateMs[state] += now - updatedAt;
+    updatedAt = now;
+
+    unsigned long idle = now - activeAt;
+    state = idle >= POWER_SLEEP_MS ? POWER_SLEEP
+            : idle >= POWER_DIM_MS ? POWER_DIM
+            : idle >= POWER_IDLE_MS ? POWER_IDLE
+            : POWER_ACTIVE;
+    if (state == reported) return false;
+    reported = state;
+    return true;
+}
+
+PowerState PowerManager::getState() const {
+    return state;
+}
+
+unsigned long PowerManager::getSampleInterval(unsigned long activeInterval) const {
+    if (state == POWER_ACTIVE) return activeInterval;
+    unsigned long idle = updatedAt - activeAt;
+    unsigned long shift = min((idle - POWER_IDLE_MS) / POWER_BACKOFF_MS + 1, (unsigned long) POWER_MAX_BACKOFF);
+    return activeInterval << shift;
+}
+
+uint8_t PowerManager::scaleBrightness(uint8_t brightness) const {
+    switch (state) {
+        case POWER_DIM:
+            return max(brightness >> POWER_DIM_SHIFT, 1);
+        case POWER_SLEEP:
+            return 0;
+        default:
+            return brightness;
+    }
+}
+
+bool PowerManager::canSleep() const {
+    return state == POWER_SLEEP && !connected;
+}
+
+bool PowerManager::isBlank() const {
+    return state == POWER_SLEEP;
+}
+
+unsigned long PowerManager::busyClock() {
+#ifdef ARDUINO_ARCH_ESP32
+    return micros();
+#else
+    return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void PowerManager::addBusy(unsigned long us) {
+    busyUs += us;
+}
+
+void PowerManager::addSleep(unsigned long us) {
+    sleepUs += us;
+    wakes++;
+}
+
+powerReport PowerManager::getReport(unsigned long now) const {
+    powerReport report = {};
+    for (int i = 0; i < POWER_STATES; i++) {
+        report.stateMs[i] = stateMs[i];
+    }
+    report.stateMs[state] += now - updatedAt;
+    report.totalMs = now - startedAt;
+    report.busyUs = busyUs;
+    report.sleepUs = sleepUs;
+    report.wakes = wakes;
+    if (report.totalMs == 0) return report;
+
+    // Busy time runs, sleep time sleeps, the rest waits in the idle task
+    double totalUs = report.totalMs * 1000.0;
+    double waitUs = max(totalUs - busyUs - sleepUs, 0.0);
+    report.dutyCycle = (float) (busyUs / totalUs);
+    report.averageUa = (float) ((busyUs * (double) POWER_RUN_UA + waitUs * POWER_WAIT_UA + sleepUs * (double) POWER_SLEEP_UA)
+                                / totalUs);
+    return report;
+}
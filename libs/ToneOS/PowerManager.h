@@ -0,0 +1,151 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Time without input before the joystick sampling backs off, in milliseconds.
+ */
+#define POWER_IDLE_MS 2000
+
+/**
+ * @brief Idle time after which the sampling interval doubles again, in milliseconds.
+ */
+#define POWER_BACKOFF_MS 1000
+
+/**
+ * @brief Longest sampling interval is the active one shifted left by this (10 ms << 4 = 160 ms).
+ */
+#define POWER_MAX_BACKOFF 4
+
+/**
+ * @brief Time without input before the LED ring is dimmed, in milliseconds.
+ */
+#define POWER_DIM_MS 30000
+
+/**
+ * @brief Brightness of a dimmed ring is the mode's brightness shifted right by this.
+ */
+#define POWER_DIM_SHIFT 2
+
+/**
+ * @brief Time without input before the LED ring is blanked and, without a client, the chip sleeps between samples.
+ */
+#define POWER_SLEEP_MS 120000
+
+/**
+ * @brief Estimated supply current of the ESP32-C3 (160 MHz, radio off) in microamperes:
+ * running, waiting in the idle task, and in light sleep. LEDs and radio are not included.
+ */
+#define POWER_RUN_UA 23000
+#define POWER_WAIT_UA 13000
+#define POWER_SLEEP_UA 130
+
+/**
+ * @brief States of the power state machine, ordered by time without input.
+ */
+enum PowerState : uint8_t {
+    POWER_ACTIVE, ///< Input within POWER_IDLE_MS, full sampling rate
+    POWER_IDLE,   ///< Sampling interval doubles every POWER_BACKOFF_MS
+    POWER_DIM,    ///< LED ring dimmed
+    POWER_SLEEP,  ///< LED ring off, light sleep between samples unless a client is connected
+    POWER_STATES
+};
+
+/**
+ * @brief Time spent in each state and an estimate of the CPU duty cycle and supply current.
+ */
+struct powerReport {
+    unsigned long stateMs[POWER_STATES]; ///< Time spent in each state
+    unsigned long totalMs;               ///< Time since begin()
+    unsigned long busyUs;                ///< Time spent in updates
+    unsigned long sleepUs;               ///< Time spent in light sleep
+    unsigned long wakes;                 ///< Light sleep wake ups
+    float dutyCycle;                     ///< busyUs / totalMs, 0..1
+    float averageUa;                     ///< Estimated average current (POWER_*_UA)
+};
+
+/**
+ * @brief PowerManager decides how much of the chip the firmware needs from the time since the last input.
+ * It only keeps time and state; ToneController applies the sampling interval, ring brightness and sleep.
+ * Input task only.
+ */
+class PowerManager {
+private:
+    PowerState state = POWER_ACTIVE; ///< Current state
+    PowerState reported = POWER_ACTIVE; ///< State returned as changed by the last update()
+    unsigned long activeAt = 0; ///< millis() of the last input
+    unsigned long updatedAt = 0; ///< millis() of the last update()
+    bool connected = false; ///< A client is connected
+    unsigned long stateMs[POWER_STATES] = {}; ///< Time spent in each state
+    unsigned long startedAt = 0; ///< millis() of begin()
+    unsigned long busyUs = 0; ///< Time spent in updates
+    unsigned long sleepUs = 0; ///< Time spent in light sleep
+    unsigned long wakes = 0; ///< Light sleep wake ups
+
+public:
+    /**
+     * @brief Starts in POWER_ACTIVE and clears the statistics.
+     * @param now Current millis() timestamp.
+     */
+    void begin(unsigned long now);
+
+    /**
+     * @brief Records an input (stick deflected, button edge, host command). Switches to POWER_ACTIVE.
+     * @param now Current millis() timestamp.
+     */
+    void activity(unsigned long now);
+
+    /**
+     * @brief Advances the state machine. A client connecting or leaving counts as input.
+     * @param now Current millis() timestamp.
+     * @param isConnected A client is connected.
+     * @return true if the state changed since the last update(), including changes by activity().
+     */
+    bool update(unsigned long now, bool isConnected);
+
+    PowerState getState() const;  // Current state
+
+    /**
+     * @brief Returns the joystick sampling interval for the time without input.
+     * @param activeInterval Interval while active, in milliseconds.
+     * @return Interval in milliseconds, doubled every POWER_BACKOFF_MS once idle (up to POWER_MAX_BACKOFF times).
+     */
+    unsigned long getSampleInterval(unsigned long activeInterval) const;
+
+    /**
+     * @brief Scales a mode brightness to the state: full, dimmed, or 0 in POWER_SLEEP.
+     */
+    uint8_t scaleBrightness(uint8_t brightness) const;
+
+    /**
+     * @brief Returns true if the chip may light sleep between samples (POWER_SLEEP without a client).
+     */
+    bool canSleep() const;
+
+    /**
+     * @brief Returns true if the LED ring is off.
+     */
+    bool isBlank() const;
+
+    /**
+     * @brief Returns a timestamp for busy time in microseconds, wrapping: micros() on the ESP32, host time in
+     * the simulator, whose clock stands still while an update runs.
+     */
+    static unsigned long busyClock();
+
+    void addBusy(unsigned long us);  // Adds the duration of an update, two busyClock() timestamps apart
+    void addSleep(unsigned long us);  // Adds the duration of a light sleep and counts the wake up
+
+    /**
+     * @brief Returns the statistics since begin().
+     * @param now Current millis() timestamp.
+     */
+    powerReport getReport(unsigned long now) const;
+};
+
+#endif //POWERMANAGER_H
@@ -0,0 +1,59 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+
+/**
+ * @brief Lock-free queue for exactly one producer task and one consumer task.
+ *
+ * Holds up to N - 1 elements. The producer only writes `tail`, the consumer only writes `head`,
+ * so push() and pop() never block each other and can be called from different FreeRTOS tasks.
+ * T should be a plain struct, it is copied in and out.
+ */
+template<typename T, size_t N>
+class SpscQueue {
+private:
+    T items[N];                    ///< Ring storage, one slot is kept free
+    std::atomic<size_t> head{0};   ///< Next element to pop, written by the consumer
+    std::atomic<size_t> tail{0};   ///< Next free slot, written by the producer
+
+public:
+    /**
+     * @brief Appends an element. Producer only.
+     * @return false if the queue is full.
+     */
+    bool push(const T &item) {
+        size_t current = tail.load(std::memory_order_relaxed);
+        size_t next = (current + 1) % N;
+        if (next == head.load(std::memory_order_acquire)) return false;
+        items[current] = item;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element. Consumer only.
+     * @return false if the queue is empty.
+     */
+    bool pop(T &item) {
+        size_t current = head.load(std::memory_order_relaxed);
+        if (current == tail.load(std::memory_order_acquire)) return false;
+        item = items[current];
+        head.store((current + 1) % N, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Checks if there is nothing to pop. Exact only on the consumer side.
+     */
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif //SPSCQUEUE_H
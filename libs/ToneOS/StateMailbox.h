@@ -0,0 +1,51 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef STATEMAILBOX_H
+#define STATEMAILBOX_H
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * @brief Lock-free mailbox that hands the latest value from one producer task to one consumer task.
+ *
+ * Triple buffered: the producer fills its own buffer and swaps it with the shared one, the consumer
+ * swaps the shared one with its own when it is fresh. Neither side ever waits or sees a half
+ * written value; values posted between two take() calls are overwritten by the newest one.
+ * T should be a plain struct, it is copied in and out.
+ */
+template<typename T>
+class StateMailbox {
+private:
+    static constexpr uint8_t FRESH = 0x04; ///< Set in `shared` when it holds a value not taken yet
+    static constexpr uint8_t INDEX = 0x03; ///< Buffer index bits of `shared`
+
+    T buffers[3] = {};
+    std::atomic<uint8_t> shared{1}; ///< Buffer exchanged between both sides, plus FRESH
+    uint8_t back = 0;  ///< Buffer owned by the producer
+    uint8_t front = 2; ///< Buffer owned by the consumer
+
+public:
+    /**
+     * @brief Publishes a value, replacing one that was not taken yet. Producer only.
+     */
+    void post(const T &value) {
+        buffers[back] = value;
+        back = shared.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    /**
+     * @brief Takes the latest value if one was posted since the last take(). Consumer only.
+     * @return false if there is no new value.
+     */
+    bool take(T &value) {
+        if (!(shared.load(std::memory_order_acquire) & FRESH)) return false;
+        front = shared.exchange(front, std::memory_order_acq_rel) & INDEX;
+        value = buffers[front];
+        return true;
+    }
+};
+
+#endif //STATEMAILBOX_H
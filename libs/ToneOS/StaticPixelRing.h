@@ -0,0 +1,282 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef STATICPIXELRING_H
+#define STATICPIXELRING_H
+
+#include <Arduino.h>
+#include <bitset>
+#include "PixelController.h"
+
+/**
+ * @brief Hardware index of every logical pixel of a ring, built by the compiler.
+ * Same mapping as PixelController: rotate by OFFSET, then mirror if REVERSE.
+ */
+template<int N, int OFFSET, bool REVERSE>
+struct PixelIndexTable {
+    uint16_t index[N];
+
+    static constexpr int map(int pixel) {
+        return REVERSE ? N - 1 - (pixel + OFFSET + N) % N : (pixel + OFFSET + N) % N;
+    }
+
+    constexpr PixelIndexTable() : index() {
+        for (int i = 0; i < N; i++) {
+            index[i] = map(i);
+        }
+    }
+};
+
+/**
+ * @brief PixelController for a ring whose size, rotation and direction are fixed at compile time.
+ *
+ * The logical to hardware index map is a constexpr table, frame buffers and the packed on/off status
+ * live in the object, and bulk writes fill the at most two hardware runs a rotated range covers
+ * instead of mapping pixel by pixel. Brightness, gamma, dirty tracking and the output behave like
+ * PixelController's, which stays the class for units that read their ring geometry at runtime.
+ * Logical indices outside 0..N-1 are ignored.
+ */
+template<int N, int OFFSET = 0, bool REVERSE = false>
+class StaticPixelRing {
+    static_assert(N > 0 && N <= 0xFFFF, "ring size out of range");
+    static_assert(OFFSET > -N && OFFSET < N, "offset must be less than one turn");
+
+private:
+    static constexpr PixelIndexTable<N, OFFSET, REVERSE> INDEX{}; ///< Hardware index of every logical pixel
+
+    PixelOutput *output;         ///< Sends flushed frames to the strip
+    int currentPixel = -1;       ///< Index of the currently selected pixel
+    std::bitset<N> status;       ///< Pixel on/off status by hardware index
+    uint32_t frame[N] = {};      ///< Shadow frame buffer, unscaled colors by hardware index
+    uint32_t outputFrame[N] = {}; ///< Frame as sent, brightness and gamma applied
+    uint8_t levels[256];         ///< Output level of every channel value (gamma and brightness)
+    uint8_t brightness = 255;    ///< Brightness baked into levels
+    bool gamma = true;           ///< Gamma correction baked into levels
+    int dirtyFrom = 0;           ///< First hardware index changed since the last flush
+    int dirtyTo = N - 1;         ///< Last hardware index changed since the last flush (-1 if clean)
+    unsigned long framesFlushed = 0; ///< Number of show() calls that were transmitted
+    unsigned long framesSkipped = 0; ///< Number of show() calls skipped because nothing changed
+
+    // Writes a color into the frame buffer and marks the pixel dirty if it changed
+    void writePixel(int index, uint32_t color) {
+        status.set(index);
+        if (frame[index] == color) return;
+        frame[index] = color;
+        markDirty(index, index);
+    }
+
+    // Marks a range of hardware pixels as changed since the last flush
+    void markDirty(int from, int to) {
+        if (from < dirtyFrom) dirtyFrom = from;
+        if (to > dirtyTo) dirtyTo = to;
+    }
+
+    // Fills hardware pixels from..to with one color
+    void fillHardware(int from, int to, uint32_t color) {
+        bool changed = false;
+        for (int i = from; i <= to; i++) {
+            changed |= frame[i] != color;
+            status.set(i);
+        }
+        if (!changed) return;
+        std::fill(frame + from, frame + to + 1, color);
+        markDirty(from, to);
+    }
+
+    // Fills `count` logical pixels from `from` on: one hardware run, two if the range crosses the ring's seam
+    void fillLogical(int from, int count, uint32_t color) {
+        if (count <= 0) return;
+        int first = INDEX.index[from];
+        if (REVERSE) {
+            int run = min(count, first + 1);
+            fillHardware(first - run + 1, first, color);
+            if (count > run) fillHardware(N - (count - run), N - 1, color);
+        } else {
+            int run = min(count, N - first);
+            fillHardware(first, first + run - 1, color);
+            if (count > run) fillHardware(0, count - run - 1, color);
+        }
+    }
+
+    void buildLevels() {
+        PixelController::buildLevelTable(levels, brightness, gamma);
+        // Every pixel changes its output level, so all of them have to be retransmitted
+        markDirty(0, N - 1);
+    }
+
+public:
+    /**
+     * @brief Construct a ring on a pin, sent through Adafruit_NeoPixel.
+     * @param pin Digital pin connected to NeoPixel data input.
+     */
+    explicit StaticPixelRing(int pin) : StaticPixelRing(new NeoPixelOutput(pin, N)) {
+    }
+
+    /**
+     * @brief Construct a ring sending through the given output.
+     * @param output Output of the strip, owned by the ring from now on.
+     */
+    explicit StaticPixelRing(PixelOutput *output) : output(output) {
+        PixelController::buildLevelTable(levels, brightness, gamma);
+    }
+
+    ~StaticPixelRing() {
+        delete output;
+    }
+
+    StaticPixelRing(const StaticPixelRing &) = delete;
+    StaticPixelRing &operator=(const StaticPixelRing &) = delete;
+
+    /**
+     * @brief Initializes the output and sends a dark frame.
+     */
+    void begin() {
+        output->begin();
+        output->write(outputFrame, N);
+    }
+
+    /**
+     * @brief Returns the hardware index of a logical pixel, evaluated at compile time for constant pixels.
+     */
+    static constexpr int hardwareIndex(int pixel) {
+        return PixelIndexTable<N, OFFSET, REVERSE>::map(pixel);
+    }
+
+    void setPixelColor(int pixel, int r, int g, int b) {
+        setPixelColor(pixel, Adafruit_NeoPixel::Color(r, g, b));
+    }
+
+    void setPixelColor(int pixel, uint32_t color) {
+        if ((unsigned) pixel >= (unsigned) N) return;
+        writePixel(INDEX.index[pixel], color);
+    }
+
+    /**
+     * @brief Sets the first N pixels to the given RGB color, see PixelController::setFirstnPixelColor().
+     */
+    void setFirstnPixelColor(int n, int r, int g, int b) {
+        fillLogical(0, constrain(n, 0, N), Adafruit_NeoPixel::Color(r, g, b));
+        currentPixel = n;
+    }
+
+    /**
+     * @brief Lights the ring up to a fractional level, see PixelController::setLevel().
+     * Whole pixels and the dark rest are filled as runs, only the partial pixel is computed.
+     */
+    void setLevel(int32_t level, uint32_t color) {
+        int lit = level <= 0 ? 0 : min(level / LEVEL_ONE, (int32_t) N);
+        fillLogical(0, lit, color);
+        if (lit < N) {
+            uint32_t partial;
+            PixelController::renderLevel(&partial, 1, level - (int32_t) lit * LEVEL_ONE, color);
+            writePixel(INDEX.index[lit], partial);
+            fillLogical(lit + 1, N - lit - 1, 0);
+        }
+    }
+
+    void setAllPixelsColor(int r, int g, int b) {
+        fillHardware(0, N - 1, Adafruit_NeoPixel::Color(r, g, b));
+    }
+
+    void setCurrentPixelColor(int r, int g, int b) {
+        setPixelColor(currentPixel, r, g, b);
+    }
+
+    void setBrightness(int brightness) {
+        brightness = constrain(brightness, 0, 255);
+        if (this->brightness == brightness) return;
+        this->brightness = brightness;
+        buildLevels();
+    }
+
+    int getBrightness() const {
+        return brightness;
+    }
+
+    void setGamma(bool enabled) {
+        if (gamma == enabled) return;
+        gamma = enabled;
+        buildLevels();
+    }
+
+    /**
+     * @brief Applies all pending pixel changes to the strip, see PixelController::show().
+     */
+    void show() {
+        output->poll();
+        if (!isDirty()) {
+            framesSkipped++;
+            return;
+        }
+        TONE_METRIC_SCOPE(METRIC_SHOW);
+        for (int i = dirtyFrom; i <= dirtyTo; i++) {
+            uint32_t color = frame[i];
+            outputFrame[i] = ((uint32_t) levels[(color >> 16) & 0xFF] << 16)
+                             | ((uint32_t) levels[(color >> 8) & 0xFF] << 8) | levels[color & 0xFF];
+        }
+        output->write(outputFrame, N);
+        framesFlushed++;
+        dirtyFrom = N;
+        dirtyTo = -1;
+    }
+
+    void poll() {
+        output->poll();
+    }
+
+    bool isSending() const {
+        return output->isBusy();
+    }
+
+    void waitSent() {
+        output->wait();
+    }
+
+    /**
+     * @brief Clears all pixels (turns them off). Call show() to apply.
+     */
+    void clear() {
+        fillHardware(0, N - 1, 0);
+        status.reset();
+    }
+
+    bool isDirty() const {
+        return dirtyTo >= dirtyFrom;
+    }
+
+    unsigned long getFramesFlushed() const {
+        return framesFlushed;
+    }
+
+    unsigned long getFramesSkipped() const {
+        return framesSkipped;
+    }
+
+    /**
+     * @brief Returns the color of a pixel by hardware index, before brightness and gamma.
+     */
+    uint32_t getPixelColor(int pixel) const {
+        return (unsigned) pixel < (unsigned) N ? frame[pixel] : 0;
+    }
+
+    /**
+     * @brief Returns true if a pixel (hardware index) was set since the last clear().
+     */
+    bool isPixelOn(int pixel) const {
+        return (unsigned) pixel < (unsigned) N && status.test(pixel);
+    }
+
+    static constexpr int getNumPixels() {
+        return N;
+    }
+
+    PixelOutput *getOutput() {
+        return output;
+    }
+};
+
+template<int N, int OFFSET, bool REVERSE>
+constexpr PixelIndexTable<N, OFFSET, REVERSE> StaticPixelRing<N, OFFSET, REVERSE>::INDEX;
+
+#endif //STATICPIXELRING_H
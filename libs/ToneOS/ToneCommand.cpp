@@ -0,0 +1,135 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "ToneCommand.h"
+#include "ModeRegistry.h"
+
+/**
+ * @brief Parses a decimal integer followed by a ',' or the end of the string.
+ * @param text Parse position, advanced past the separator.
+ * @param value Parsed value.
+ * @return true if a number was parsed.
+ */
+static bool parseField(const char *&text, int32_t &value) {
+    char *end;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || (*end != ',' && *end != '\0')) return false;
+    value = (int32_t) parsed;
+    text = *end == ',' ? end + 1 : end;
+    return true;
+}
+
+/**
+ * @brief Copies a name up to the next ',' (truncated to TONE_NAME_MAX) and advances past the separator.
+ */
+static bool parseName(const char *&text, char *name) {
+    const char *comma = strchr(text, ',');
+    if (comma == nullptr || comma == text) return false;
+
+    size_t length = min((size_t) (comma - text), (size_t) TONE_NAME_MAX);
+    memcpy(name, text, length);
+    name[length] = '\0';
+    text = comma + 1;
+    return true;
+}
+
+/**
+ * @brief Returns true and advances text if it starts with prefix.
+ */
+static bool consume(const char *&text, const char *prefix) {
+    size_t length = strlen(prefix);
+    if (strncmp(text, prefix, length) != 0) return false;
+    text += length;
+    return true;
+}
+
+/**
+ * @brief Parses the min, max, r, g, b and brightness fields of a mode configuration into args[1..6]
+ * and the optional input into args[7] (-1 if omitted).
+ * @return false unless min and max fit int16_t with min <= max and the color and brightness fit uint8_t.
+ */
+static bool parseModeFields(const char *&text, toneCommand &out) {
+    for (int i = 1; i < 7; i++) {
+        if (!parseField(text, out.args[i])) return false;
+    }
+    out.args[7] = -1;
+    if (*text != '\0') {
+        if (!parseField(text, out.args[7]) || *text != '\0') return false;
+        if (out.args[7] != MODE_INPUT_ABSOLUTE && out.args[7] != MODE_INPUT_RELATIVE) return false;
+    }
+    for (int i = 3; i < 7; i++) {
+        if (out.args[i] < 0 || out.args[i] > UINT8_MAX) return false;
+    }
+    return out.args[1] >= INT16_MIN && out.args[2] <= INT16_MAX && out.args[1] <= out.args[2];
+}
+
+bool parseToneCommand(const char *text, size_t length, toneCommand &out) {
+    out = toneCommand();
+    if (length > TONE_COMMAND_MAX) return false;
+
+    char buffer[TONE_COMMAND_MAX + 1];
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    const char *p = buffer;
+
+    const char *separator = strchr(p, CMD_SEQ_SEPARATOR);
+    if (separator != nullptr) {
+        char *end;
+        long seq = strtol(p, &end, 10);
+        if (end != separator || end == p) return false;
+        out.seq = (int32_t) seq;
+        p = separator + 1;
+    }
+
+    // Commands start with a letter, so digits here are a channel
+    if (*p >= '0' && *p <= '9') {
+        char *end;
+        long channel = strtol(p, &end, 10);
+        if (*end != CMD_CHANNEL_SEPARATOR || channel >= TONE_MAX_CHANNELS) return false;
+        out.channel = (uint8_t) channel;
+        p = end + 1;
+    }
+
+    ToneCommandType type = CMD_INVALID;
+    bool valid = false;
+    if (consume(p, CMD_SET_VALUE) || consume(p, CMD_SET_VALUE_LEGACY)) {
+        type = CMD_VALUE;
+        valid = parseField(p, out.args[0]) && *p == '\0';
+    } else if (consume(p, CMD_ADD_MODE)) {
+        type = CMD_ADD;
+        valid = parseName(p, out.name) && parseModeFields(p, out);
+    } else if (consume(p, CMD_REMOVE_MODE)) {
+        type = CMD_REMOVE;
+        valid = parseField(p, out.args[0]) && *p == '\0';
+    } else if (consume(p, CMD_SET_MODE)) {
+        type = CMD_MODE;
+        valid = parseField(p, out.args[0]) && *p == '\0';
+    } else if (consume(p, CMD_CONFIGURE_MODE)) {
+        type = CMD_CONFIGURE;
+        valid = parseField(p, out.args[0]) && parseName(p, out.name) && parseModeFields(p, out);
+    } else if (strcmp(p, CMD_SNAPSHOT) == 0) {
+        type = CMD_GET;
+        valid = true;
+    } else if (strcmp(p, CMD_DUMP_LOG) == 0) {
+        type = CMD_LOG;
+        valid = true;
+    } else if (consume(p, CMD_LIVE_METRICS)) {
+        type = CMD_METRICS;
+        valid = parseField(p, out.args[0]) && *p == '\0' && out.args[0] >= 0;
+    } else if (strcmp(p, CMD_RESET_METRICS) == 0) {
+        type = CMD_METRICS_RESET;
+        valid = true;
+    } else if (strcmp(p, FORMAT_CMD_BINARY) == 0 || strcmp(p, FORMAT_CMD_JSON) == 0) {
+        type = CMD_FORMAT;
+        out.args[0] = strcmp(p, FORMAT_CMD_BINARY) == 0 ? FORMAT_BINARY : FORMAT_JSON;
+        valid = true;
+    } else if (strcmp(p, CMD_DUMP_METRICS) == 0) {
+        type = CMD_METRICS;
+        out.args[0] = -1;
+        valid = true;
+    }
+
+    out.type = valid ? type : CMD_INVALID;
+    return valid;
+}
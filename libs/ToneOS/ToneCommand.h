@@ -0,0 +1,93 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef TONECOMMAND_H
+#define TONECOMMAND_H
+
+#include <Arduino.h>
+#include "ToneProtocol.h"
+
+/**
+ * @brief Control writes understood by the firmware. Each may be prefixed with `<seq>@`,
+ * the sequence number is echoed in the acknowledgement, and then with `<channel>/` to address
+ * a channel other than 0 (all but `log`, `metrics` and `fmt`, which cover the whole device or the client).
+ *
+ *   val:<value>                                                    set the value of the active mode
+ *   mode:<index>                                                   activate a mode
+ *   get                                                            send a full snapshot of all modes
+ *   cfg:<index>,<name>,<min>,<max>,<r>,<g>,<b>,<bright>[,<input>]  configure a mode slot
+ *   mode+:<name>,<min>,<max>,<r>,<g>,<b>,<bright>[,<input>]        add a mode to the first free slot
+ *   mode-:<index>                                                  remove a mode
+ *   log                                                            dump the event log, as `#` text lines
+ *   metrics                                                        dump the hot path timings, as `#` text lines
+ *   metrics:<ms>                                                   notify the metrics characteristic every <ms>, 0 off
+ *   metrics-                                                       clear the hot path timings
+ *   fmt:bin / fmt:json                                             select the notification format of the client
+ *
+ * <input> is the ModeInput (0 absolute, 1 relative). Without it `cfg` keeps the input of a configured
+ * slot and `mode+` adds an absolute mode.
+ */
+#define CMD_SET_VALUE        "val:"
+#define CMD_SET_VALUE_LEGACY "vol:"  ///< Sent by older ToneTerminal versions
+#define CMD_SET_MODE         "mode:"
+#define CMD_SNAPSHOT         "get"
+#define CMD_CONFIGURE_MODE   "cfg:"
+#define CMD_ADD_MODE         "mode+:"
+#define CMD_REMOVE_MODE      "mode-:"
+#define CMD_DUMP_LOG         "log"
+#define CMD_DUMP_METRICS     "metrics"
+#define CMD_LIVE_METRICS     "metrics:"
+#define CMD_RESET_METRICS    "metrics-"
+#define CMD_SEQ_SEPARATOR    '@'
+#define CMD_CHANNEL_SEPARATOR '/'
+
+/**
+ * @brief Longest control write that is parsed, longer writes are rejected.
+ */
+#define TONE_COMMAND_MAX 64
+
+/**
+ * @brief Number of parsed commands that can wait for the main loop.
+ */
+#define TONE_COMMAND_QUEUE 8
+
+/**
+ * @brief Kinds of parsed commands.
+ */
+enum ToneCommandType : uint8_t {
+    CMD_INVALID,   ///< Write could not be parsed, only acknowledged
+    CMD_VALUE,     ///< args[0] = value
+    CMD_MODE,      ///< args[0] = mode index
+    CMD_GET,       ///< No arguments
+    CMD_CONFIGURE, ///< args = index, min, max, r, g, b, brightness, input (-1 if omitted); name
+    CMD_ADD,       ///< args = -, min, max, r, g, b, brightness, input (-1 if omitted); name
+    CMD_REMOVE,    ///< args[0] = mode index
+    CMD_LOG,       ///< No arguments
+    CMD_METRICS,   ///< args[0] = live interval in ms (`metrics:`), -1 for a dump
+    CMD_METRICS_RESET, ///< No arguments
+    CMD_FORMAT     ///< args[0] = ToneFormat
+};
+
+/**
+ * @brief A parsed control write, copied through the command queue.
+ */
+struct toneCommand {
+    ToneCommandType type = CMD_INVALID;
+    int32_t seq = -1;                   ///< Sequence number given by the host, -1 if none
+    uint16_t client = TONE_ALL_CLIENTS; ///< Connection the command was written on
+    uint8_t channel = 0;                ///< Channel the command addresses
+    int32_t args[8] = {};
+    char name[TONE_NAME_MAX + 1] = {};
+};
+
+/**
+ * @brief Parses a control write. Never allocates, so it can run in the BLE callback.
+ * @param text Written bytes, not NUL terminated.
+ * @param length Number of bytes.
+ * @param out Parsed command, type is CMD_INVALID if the write is malformed.
+ * @return true if the write was a valid command.
+ */
+bool parseToneCommand(const char *text, size_t length, toneCommand &out);
+
+#endif //TONECOMMAND_H
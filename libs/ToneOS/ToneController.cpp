@@ -4,146 +4,867 @@
 
 #include "ToneController.h"
 
+#if TONE_TASKS && TONE_LIGHT_SLEEP
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#endif
+
 ToneController::ToneController(int xPin, int yPin, int swPin, int pixelPin, int pixelCount) {
-    _xPin = xPin;
-    _yPin = yPin;
-    _swPin = swPin;
-    _pixelPin = pixelPin;
-    _pixelCount = pixelCount;
+    this->addChannel(xPin, yPin, swPin, pixelPin, pixelCount);
+}
+
+int ToneController::addChannel(int xPin, int yPin, int swPin, int pixelPin, int pixelCount) {
+    if (channelCount >= TONE_MAX_CHANNELS) {
+        return -1;
+    }
+
+    toneChannel *channel = new toneChannel();
+    channel->index = channelCount;
+    channel->xPin = xPin;
+    channel->yPin = yPin;
+    channel->swPin = swPin;
+    channel->pixelPin = pixelPin;
+    channel->pixelCount = pixelCount;
+    channels[channelCount] = channel;
+    return channelCount++;
+}
+
+int ToneController::getChannelCount() const {
+    return channelCount;
 }
 
 void ToneController::begin() {
-    pinMode(_xPin, INPUT);
-    pinMode(_yPin, INPUT);
-    pinMode(_swPin, INPUT_PULLUP);
-    pinMode(_pixelPin, OUTPUT);
+#if TONE_METRICS
+    ToneMetrics::begin();
+#endif
+    // Rings take the RMT channels from the last one down. With more rings than channels one is left to
+    // Adafruit_NeoPixel, which sends through an RMT channel of its own on the ESP32
+    int rmtRings = channelCount > PIXEL_RMT_CHANNELS ? PIXEL_RMT_CHANNELS - 1 : PIXEL_RMT_CHANNELS;
+    for (uint8_t i = 0; i < channelCount; i++) {
+        toneChannel &channel = *channels[i];
+        pinMode(channel.xPin, INPUT);
+        pinMode(channel.yPin, INPUT);
+        pinMode(channel.swPin, INPUT_PULLUP);
+        pinMode(channel.pixelPin, OUTPUT);
 
-    // Initialize pixel controller
-    this->pixel = new PixelController(_pixelPin, _pixelCount, 0, true);
-    pixel->begin();
+        // Initialize pixel controller
+        int rmtChannel = i < rmtRings ? PIXEL_RMT_CHANNELS - 1 - i : -1;
+        channel.pixel = new PixelController(PixelOutput::create(channel.pixelPin, channel.pixelCount, rmtChannel),
+                                            channel.pixelCount, 0, true);
+        channel.pixel->begin();
+        channel.animator = new PixelAnimator(channel.pixel);
+        channel.animator->setBackground(&channel.level);
 
-    // Initialize joystick
-    this->joystick = new JoystickController(_xPin, _yPin, _swPin);
-    this->joystick->begin();
+        // Initialize joystick, with the stored calibration if there is one
+        toneRecord record;
+        bool restored = channel.store.begin(channel.index) && channel.store.load(record);
+        channel.joystick = new JoystickController(channel.xPin, channel.yPin, channel.swPin);
+        channel.joystick->begin(!restored);
+        if (restored) {
+            channel.joystick->setCalibration(record.originX, record.originY, record.deadZone);
+        } else {
+            channel.store.markChanged(millis());
+        }
+        channel.button.reset(channel.joystick->isPressed(), millis());
+
+        // Set initial mode
+        channel.currentModeIndex = channel.modes.first();
+    }
+    this->power.begin(millis());
 
     // Initialize Bluetooth controller
     this->bluetooth = new BluetoothController("Tone Equalizer");
     this->bluetooth->begin();
+}
 
-    // Set initial mode
-    this->currentModeIndex = 0;
+bool ToneController::restoreState() {
+    bool restoredAll = true;
+    for (uint8_t i = 0; i < channelCount; i++) {
+        toneChannel &channel = *channels[i];
+        toneRecord record;
+        if (!channel.store.load(record)) {
+            restoredAll = false;
+            continue;
+        }
+
+        for (int index = 0; index < MAX_MODES; index++) {
+            if (!(record.modeMask & (1 << index)) || !channel.modes.isConfigured(index)) continue;
+            const modeSpec &m = channel.modes.spec(index);
+            if (record.values[index] >= m.minValue && record.values[index] <= m.maxValue) {
+                channel.modes.setValue(index, record.values[index]);
+            }
+        }
+        this->setCurrentMode(channel, record.currentMode);
+    }
+    return restoredAll;
 }
 
 void ToneController::update() {
-    if (joystick->isPressed()) {
-        this->nextMode();
-        while (joystick->isPressed()) {
-        } // waiting
+    unsigned long now = millis();
+    this->updateControl(now);
+    bluetooth->update(now);
+}
+
+bool ToneController::startTasks() {
+#if TONE_TASKS
+    if (inputTask != nullptr) return true;
+
+    xTaskCreatePinnedToCore(notifyTaskLoop, "tone-notify", TONE_TASK_STACK, this, TONE_NOTIFY_PRIORITY,
+                            &notifyTask, TONE_NOTIFY_CORE);
+    xTaskCreatePinnedToCore(inputTaskLoop, "tone-input", TONE_TASK_STACK, this, TONE_INPUT_PRIORITY,
+                            &inputTask, TONE_INPUT_CORE);
+    if (inputTask == nullptr || notifyTask == nullptr) {
+        // The caller falls back to update() in loop(), which must not race the task that did start
+        if (inputTask != nullptr) vTaskDelete(inputTask);
+        if (notifyTask != nullptr) vTaskDelete(notifyTask);
+        inputTask = nullptr;
+        notifyTask = nullptr;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if TONE_TASKS
+void ToneController::inputTaskLoop(void *controller) {
+    ToneController *self = static_cast<ToneController *>(controller);
+    for (;;) {
+        unsigned long now = millis();
+        self->updateControl(now);
+        unsigned long wait = self->getIdleTime(now);
+#if TONE_LIGHT_SLEEP
+        if (wait > 0 && self->power.canSleep()) {
+            // Timer wake for the next sample, GPIO wake for the button (active low)
+            esp_sleep_enable_timer_wakeup(wait * 1000ULL);
+            for (uint8_t i = 0; i < self->channelCount; i++) {
+                gpio_wakeup_enable((gpio_num_t) self->channels[i]->swPin, GPIO_INTR_LOW_LEVEL);
+            }
+            esp_sleep_enable_gpio_wakeup();
+            unsigned long start = micros();
+            esp_light_sleep_start();
+            self->sleptFor(micros() - start, esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO);
+            continue;
+        }
+#endif
+        vTaskDelay(max(pdMS_TO_TICKS(wait), (TickType_t) 1));
+    }
+}
+
+void ToneController::notifyTaskLoop(void *controller) {
+    ToneController *self = static_cast<ToneController *>(controller);
+    for (;;) {
+        // Woken by flushStates(), or after TONE_NOTIFY_IDLE_MS for rate-limited states
+        bool connected = self->bluetooth->isConnected();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(connected ? TONE_NOTIFY_IDLE_MS : TONE_NOTIFY_ADVERTISE_MS));
+        self->bluetooth->update(millis());
+    }
+}
+#endif
+
+void ToneController::updateControl(unsigned long now) {
+    TONE_METRIC_SCOPE(METRIC_CONTROL);
+    unsigned long start = PowerManager::busyClock();
+    this->updateRecorder(now);
+    this->updateButton(now);
+
+    toneCommand command;
+    while (bluetooth->takeCommand(command)) {
+        power.activity(now);
+        this->handleCommand(command);
+    }
+    this->updateSerial();
+
+    if (now - lastSampleTime >= power.getSampleInterval(SAMPLE_INTERVAL_MS)) {
+        lastSampleTime = now;
+        this->updateInput();
+    }
+
+    this->updatePower(now);
+    for (uint8_t i = 0; i < channelCount; i++) {
+        channels[i]->pixel->poll();
+        channels[i]->animator->update(now);
+    }
+    this->updateStore(now);
+    this->updateDump(now);
+    this->flushStates();
+    power.addBusy(PowerManager::busyClock() - start);
+}
+
+void ToneController::updatePower(unsigned long now) {
+    if (!power.update(now, bluetooth->isConnected())) {
         return;
-    } else if (joystick->atOrigin()) {
+    }
+
+    for (uint8_t i = 0; i < channelCount; i++) {
+        toneChannel &channel = *channels[i];
+        if (channel.modes.isConfigured(channel.currentModeIndex)) {
+            channel.pixel->setBrightness(power.scaleBrightness(channel.modes.spec(channel.currentModeIndex).brightness));
+        }
+    }
+    bluetooth->setSlowAdvertising(power.getState() >= POWER_DIM);
+}
+
+unsigned long ToneController::getIdleTime(unsigned long now) const {
+    if (power.getState() == POWER_ACTIVE || dumpTarget != LOG_NONE) return 0;
+    // A frame on the wire has to end before light sleep, a waiting one needs poll()
+    for (uint8_t i = 0; i < channelCount; i++) {
+        if (channels[i]->pixel->isSending()) return 0;
+    }
+    unsigned long due = lastSampleTime + power.getSampleInterval(SAMPLE_INTERVAL_MS);
+    return (long) (due - now) > 0 ? due - now : 0;
+}
+
+void ToneController::sleptFor(unsigned long us, bool byButton) {
+    power.addSleep(us);
+    if (byButton) {
+        for (uint8_t i = 0; i < channelCount; i++) {
+            if (channels[i]->joystick->isPressed()) channels[i]->wakePress = true;
+        }
+        power.activity(millis());
+    }
+}
+
+void ToneController::updateButton(unsigned long now) {
+    for (uint8_t i = 0; i < channelCount; i++) {
+        toneChannel &channel = *channels[i];
+        buttonEdge edge;
+        while (channel.joystick->takeEdge(edge)) {
+            recorder.recordButton(edge.time, channel.index, edge.pressed);
+            if (power.isBlank()) channel.wakePress = true;
+            power.activity(now);
+            channel.button.addEdge(edge);
+        }
+
+        ButtonDebouncer &button = channel.button;
+        for (ButtonEvent event = button.update(now); event != BUTTON_NONE; event = button.update(now)) {
+            // The press that lit the ring again only wakes it
+            if (channel.wakePress) {
+                channel.wakePress = false;
+                continue;
+            }
+            switch (event) {
+                case BUTTON_SHORT:
+                    this->setCurrentMode(channel, channel.modes.next(channel.currentModeIndex));
+                    break;
+                case BUTTON_LONG:
+                    this->setCurrentMode(channel, channel.modes.previous(channel.currentModeIndex));
+                    break;
+                case BUTTON_DOUBLE:
+                    if (doublePressHandler != nullptr) doublePressHandler();
+                    else this->recalibrate(channel.index);
+                    break;
+                case BUTTON_NONE:
+                    break;
+            }
+        }
+    }
+}
+
+void ToneController::updateInput() {
+    this->scanJoysticks();
+    for (uint8_t i = 0; i < channelCount; i++) {
+        this->updateChannel(*channels[i]);
+    }
+}
+
+void ToneController::scanJoysticks() {
+    TONE_METRIC_SCOPE(METRIC_JOY_READ);
+    long sumX[TONE_MAX_CHANNELS] = {};
+    long sumY[TONE_MAX_CHANNELS] = {};
+    uint8_t rounds = 0;
+    for (uint8_t i = 0; i < channelCount; i++) {
+        rounds = max(rounds, channels[i]->joystick->getOversample());
+    }
+
+    // Round robin over all pins, so every joystick is sampled over the same window
+    for (uint8_t round = 0; round < rounds; round++) {
+        for (uint8_t i = 0; i < channelCount; i++) {
+            const toneChannel &channel = *channels[i];
+            if (round >= channel.joystick->getOversample()) continue;
+            sumX[i] += analogRead(channel.xPin);
+            sumY[i] += analogRead(channel.yPin);
+        }
+    }
+
+    for (uint8_t i = 0; i < channelCount; i++) {
+        JoystickController *joystick = channels[i]->joystick;
+        joystick->sample(sumX[i] / joystick->getOversample(), sumY[i] / joystick->getOversample());
+    }
+}
+
+void ToneController::updateChannel(toneChannel &channel) {
+    JoystickController *joystick = channel.joystick;
+    recorder.recordSample(lastSampleTime, channel.index, joystick->getRawX(), joystick->getRawY());
+    if (!joystick->atOrigin()) power.activity(lastSampleTime);
+    if (channel.button.isPressed() || joystick->atOrigin() || !channel.modes.isConfigured(channel.currentModeIndex)) {
+        channel.jogActive = false;
         return;
     }
 
-    int angle = joystick->readAngle(90);
-    int mappedValue = this->getMappedValue(angle, 330);
-    if (mappedValue == -1 || mappedValue == modes[currentModeIndex].currentValue) {
+    int mappedValue;
+    {
+        TONE_METRIC_SCOPE(METRIC_MAPPING);
+        int angle = joystick->readAngle(90);
+        mappedValue = channel.modes.spec(channel.currentModeIndex).input == MODE_INPUT_RELATIVE
+                      ? this->getJogValue(channel, angle)
+                      : this->getStableMappedValue(channel, angle);
+    }
+    if (mappedValue == -1 || mappedValue == channel.modes.getValue(channel.currentModeIndex)) {
         return;
-    } 
+    }
 
-    this->setCurrentValue(mappedValue);
-    this->sendDataChange();
+    this->setCurrentValue(channel, mappedValue);
+    this->postState(channel);
 }
 
-void ToneController::setMode(int index, String name, int minValue, int maxValue, uint8_t r, uint8_t g, uint8_t b,
-                             uint8_t brightness) {
-    if (index >= 0 && index < MODE_COUNT) {
-        modes[index].name = name;
-        modes[index].minValue = minValue;
-        modes[index].maxValue = maxValue;
-        modes[index].currentValue = minValue; // Initialize current value to min
-        modes[index].color[0] = r;
-        modes[index].color[1] = g;
-        modes[index].color[2] = b;
-        modes[index].brightness = brightness;
+void ToneController::updateSerial() {
+    while (Serial.available() > 0) {
+        char c = (char) Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (serialLength <= TONE_COMMAND_MAX) serialLine[serialLength++] = c;
+            continue;
+        }
+        if (serialLength == 0) continue;
+
+        toneCommand command;
+        parseToneCommand(serialLine, serialLength, command);
+        serialLength = 0;
+        this->handleCommand(command, LOG_SERIAL);
     }
 }
 
-void ToneController::nextMode() {
-    this->setCurrentMode(this->currentModeIndex + 1);
+void ToneController::updateRecorder(unsigned long now) {
+    bool connected = bluetooth->isConnected();
+    if (connected != recordedConnected) {
+        recorder.recordConnection(now, connected);
+        recordedConnected = connected;
+    }
+
+    unsigned long notifies = bluetooth->getNotifyCount();
+    if (notifies != recordedNotifies) {
+        recorder.recordNotify(now, notifies - recordedNotifies);
+        recordedNotifies = notifies;
+    }
+
+    if (!keyframed || now - keyframeAt >= RECORDER_KEYFRAME_MS) {
+        keyframed = true;
+        keyframeAt = now;
+        for (uint8_t i = 0; i < channelCount; i++) {
+            const toneChannel &channel = *channels[i];
+            int16_t values[MAX_MODES];
+            for (int mode = 0; mode < MAX_MODES; mode++) values[mode] = channel.modes.getValue(mode);
+            const JoystickController &joystick = *channel.joystick;
+            recorder.recordKeyframe(now, channel.index, channel.currentModeIndex, joystick.getOriginX(),
+                                    joystick.getOriginY(), joystick.getDeadZone(), connected, joystick.getFilteredX(),
+                                    joystick.getFilteredY(), channel.button.snapshot(), values);
+        }
+    }
+}
+
+void ToneController::applyKeyframe(const recordEntry &keyframe) {
+    toneChannel *target = this->channelAt(keyframe.channel);
+    if (target == nullptr) return;
+    toneChannel &channel = *target;
+    channel.joystick->setCalibration(keyframe.args[2], keyframe.args[3], keyframe.args[4]);
+    channel.joystick->resetFilter(keyframe.args[6], keyframe.args[7]);
+    for (int i = 0; i < MAX_MODES; i++) {
+        if (channel.modes.isConfigured(i)) channel.modes.setValue(i, keyframe.values[i]);
+    }
+    this->setCurrentMode(channel, keyframe.args[0]);
+    channel.button.restore(keyframe.button);
+}
+
+void ToneController::updateDump(unsigned long now) {
+    if (dumpTarget == LOG_NONE || now - dumpAt < LOG_DUMP_INTERVAL_MS) {
+        return;
+    }
+    dumpAt = now;
+
+    char line[8 + 2 * LOG_DUMP_BYTES];
+    uint8_t bytes[LOG_DUMP_BYTES];
+    size_t count = recorder.read(dumpOffset, bytes, LOG_DUMP_BYTES);
+    if (count == 0) {
+        this->writeDumpLine("#end");
+        dumpTarget = LOG_NONE;
+        recorder.setEnabled(true);
+        keyframed = false;
+        return;
+    }
+
+    int length = snprintf(line, sizeof(line), "#%04x ", (unsigned) dumpOffset);
+    for (size_t i = 0; i < count; i++) {
+        length += snprintf(line + length, sizeof(line) - length, "%02x", bytes[i]);
+    }
+    dumpOffset += count;
+    this->writeDumpLine(line);
+}
+
+void ToneController::writeDumpLine(const char *line) {
+    this->writeDumpLine(line, dumpTarget, dumpClient);
+}
+
+void ToneController::writeDumpLine(const char *line, LogTarget target, uint16_t client) {
+    if (target == LOG_SERIAL) Serial.println(line);
+    else bluetooth->sendText(line, client);
+}
+
+#if TONE_METRICS
+void ToneController::dumpMetrics(LogTarget target, uint16_t client) {
+    char line[96];
+    snprintf(line, sizeof(line), "#metrics %u", (unsigned) METRIC_COUNT);
+    this->writeDumpLine(line, target, client);
+    for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+        ToneMetrics::format((ToneMetric) metric, line, sizeof(line));
+        this->writeDumpLine(line, target, client);
+    }
+}
+#endif
+
+void ToneController::updateStore(unsigned long now) {
+    for (uint8_t i = 0; i < channelCount; i++) {
+        toneChannel &channel = *channels[i];
+        if (!channel.store.isDue(now)) continue;
+
+        toneRecord record = {};
+        record.currentMode = channel.currentModeIndex;
+        for (int index = 0; index < MAX_MODES; index++) {
+            if (!channel.modes.isConfigured(index)) continue;
+            record.modeMask |= 1 << index;
+            record.values[index] = channel.modes.getValue(index);
+        }
+        record.originX = channel.joystick->getOriginX();
+        record.originY = channel.joystick->getOriginY();
+        record.deadZone = channel.joystick->getDeadZone();
+        channel.store.save(record, now);
+    }
+}
+
+void ToneController::handleCommand(const toneCommand &command, LogTarget source) {
+    const int32_t *args = command.args;
+    int32_t result = -1;
+    bool ok = false;
+
+    // The parser only accepts channel numbers below TONE_MAX_CHANNELS, this one may still not exist
+    toneChannel *channel = this->channelAt(command.channel);
+    recorder.recordCommand(millis(), command.channel, command.type, args[0]);
+    switch (channel != nullptr ? command.type : CMD_INVALID) {
+        case CMD_VALUE:
+            ok = channel->modes.isConfigured(channel->currentModeIndex);
+            if (ok) {
+                this->setCurrentValue(*channel, args[0]);
+                this->postState(*channel);
+                result = channel->modes.getValue(channel->currentModeIndex);
+            }
+            break;
+        case CMD_MODE:
+            ok = channel->modes.isConfigured(args[0]);
+            if (ok) {
+                this->setCurrentMode(*channel, args[0]);
+                this->postState(*channel);
+                result = args[0];
+            }
+            break;
+        case CMD_GET:
+            this->sendSnapshot(*channel, command.client);
+            ok = true;
+            result = channel->modes.count();
+            break;
+        case CMD_CONFIGURE:
+            ok = args[0] >= 0 && args[0] < MAX_MODES;
+            if (ok) {
+                // Reconfiguring a slot without an input keeps its input
+                ModeInput input = args[7] >= 0 ? (ModeInput) args[7]
+                                  : channel->modes.isConfigured(args[0]) ? channel->modes.spec(args[0]).input
+                                  : MODE_INPUT_ABSOLUTE;
+                this->setMode(*channel, args[0], command.name, args[1], args[2], args[3], args[4], args[5], args[6],
+                              input);
+                if (args[0] == channel->currentModeIndex) bluetooth->requestFullFrame();
+                result = args[0];
+            }
+            break;
+        case CMD_ADD:
+            result = this->addMode(*channel, command.name, args[1], args[2], args[3], args[4], args[5], args[6],
+                                   args[7] >= 0 ? (ModeInput) args[7] : MODE_INPUT_ABSOLUTE);
+            ok = result != -1;
+            break;
+        case CMD_REMOVE:
+            ok = this->removeMode(*channel, args[0]);
+            result = args[0];
+            break;
+        case CMD_LOG:
+            ok = dumpTarget == LOG_NONE;
+            if (ok) {
+                result = recorder.size();
+                recorder.setEnabled(false);
+                dumpTarget = source;
+                dumpClient = command.client;
+                dumpOffset = 0;
+                dumpAt = millis();
+                char header[64];
+                snprintf(header, sizeof(header), "#log %lu %u %lu %u", recorder.startTime(),
+                         (unsigned) recorder.size(), recorder.getDropped(), recorder.startChannel());
+                this->writeDumpLine(header);
+            }
+            break;
+#if TONE_METRICS
+        case CMD_METRICS:
+            if (args[0] < 0) {
+                this->dumpMetrics(source, command.client);
+                ok = true;
+                result = METRIC_COUNT;
+            } else {
+                // Live metrics go to the metrics characteristic, which Serial has none of
+                ok = source == LOG_BLE && bluetooth->setLiveMetrics(command.client, args[0]);
+                result = args[0];
+            }
+            break;
+        case CMD_METRICS_RESET:
+            ToneMetrics::reset();
+            ok = true;
+            result = 0;
+            break;
+#else
+        case CMD_METRICS:
+        case CMD_METRICS_RESET:
+            break;
+#endif
+        case CMD_FORMAT:
+            // Applied by the BLE write callback, Serial has no format
+            ok = command.client != TONE_ALL_CLIENTS;
+            result = args[0];
+            break;
+        case CMD_INVALID:
+            break;
+    }
+
+    const KVP ack[3] = {
+        {"ack", command.seq},
+        {"ok", ok ? 1 : 0},
+        {"result", result}
+    };
+    if (source == LOG_SERIAL) bluetooth->log(ack);
+    else bluetooth->sendData(ack, command.client);
+}
+
+void ToneController::sendSnapshot(toneChannel &channel, uint16_t client) {
+    const ModeRegistry &modes = channel.modes;
+    for (int index = modes.first(), i = 0; i < modes.count(); index = modes.next(index), i++) {
+        const modeSpec &m = modes.spec(index);
+        const KVP data[9] = {
+            {"ch", channel.index},
+            {"index", index},
+            {"mode", m.name},
+            {"value", modes.getValue(index)},
+            {"min", m.minValue},
+            {"max", m.maxValue},
+            {"r", m.color[0]},
+            {"g", m.color[1]},
+            {"b", m.color[2]}
+        };
+        bluetooth->sendData(data, client);
+    }
+
+    bluetooth->requestFullFrame();
+    this->postState(channel);
+}
+
+toneChannel *ToneController::channelAt(int channel) const {
+    return channel >= 0 && channel < channelCount ? channels[channel] : nullptr;
+}
+
+void ToneController::updateLevel(toneChannel &channel, bool jump) {
+    if (!channel.modes.isConfigured(channel.currentModeIndex)) {
+        channel.level.setTarget(0, jump);
+        return;
+    }
+
+    const modeSpec &m = channel.modes.spec(channel.currentModeIndex);
+    channel.level.setColor(Adafruit_NeoPixel::Color(m.color[0], m.color[1], m.color[2]));
+    channel.level.setTarget(this->getMappedLevel(channel, channel.modes.getValue(channel.currentModeIndex)), jump);
+}
+
+void ToneController::setMode(int index, const char *name, int minValue, int maxValue, uint8_t r, uint8_t g,
+                             uint8_t b, uint8_t brightness, ModeInput input) {
+    this->setMode(*channels[0], index, name, minValue, maxValue, r, g, b, brightness, input);
+}
+
+void ToneController::setMode(toneChannel &channel, int index, const char *name, int minValue, int maxValue,
+                             uint8_t r, uint8_t g, uint8_t b, uint8_t brightness, ModeInput input) {
+    if (minValue < INT16_MIN || maxValue > INT16_MAX) return;  // The registry refuses min > max
+    if (channel.modes.set(index, name, minValue, maxValue, r, g, b, brightness, input)) {
+        buildLookupTables(channel, index);
+        if (index == channel.currentModeIndex) this->updateLevel(channel, true);
+    }
+}
+
+void ToneController::setMode(int index, const modeSpec *spec) {
+    this->setMode(0, index, spec);
+}
+
+void ToneController::setMode(int channel, int index, const modeSpec *spec) {
+    toneChannel *target = this->channelAt(channel);
+    if (target != nullptr && target->modes.set(index, spec)) {
+        buildLookupTables(*target, index);
+        if (index == target->currentModeIndex) this->updateLevel(*target, true);
+    }
+}
+
+int ToneController::addMode(const char *name, int minValue, int maxValue, uint8_t r, uint8_t g, uint8_t b,
+                            uint8_t brightness, ModeInput input) {
+    return this->addMode(*channels[0], name, minValue, maxValue, r, g, b, brightness, input);
+}
+
+int ToneController::addMode(toneChannel &channel, const char *name, int minValue, int maxValue, uint8_t r,
+                            uint8_t g, uint8_t b, uint8_t brightness, ModeInput input) {
+    if (minValue < INT16_MIN || maxValue > INT16_MAX) return -1;
+    int index = channel.modes.add(name, minValue, maxValue, r, g, b, brightness, input);
+    if (index != -1) {
+        buildLookupTables(channel, index);
+    }
+    return index;
+}
+
+bool ToneController::removeMode(int index) {
+    return this->removeMode(*channels[0], index);
+}
+
+bool ToneController::removeMode(toneChannel &channel, int index) {
+    if (!channel.modes.isConfigured(index) || channel.modes.count() <= 1) {
+        return false;
+    }
+
+    if (index == channel.currentModeIndex) {
+        this->setCurrentMode(channel, channel.modes.next(index));
+    }
+    return channel.modes.remove(index);
+}
+
+int ToneController::getModeCount(int channel) const {
+    const toneChannel *target = this->channelAt(channel);
+    return target != nullptr ? target->modes.count() : 0;
+}
+
+void ToneController::nextMode(int channel) {
+    toneChannel *target = this->channelAt(channel);
+    if (target != nullptr) this->setCurrentMode(*target, target->modes.next(target->currentModeIndex));
+}
+
+void ToneController::previousMode(int channel) {
+    toneChannel *target = this->channelAt(channel);
+    if (target != nullptr) this->setCurrentMode(*target, target->modes.previous(target->currentModeIndex));
+}
+
+void ToneController::recalibrate(int channel) {
+    toneChannel *target = this->channelAt(channel);
+    if (target == nullptr) return;
+
+    target->joystick->calibrate();
+    target->store.markChanged(millis());
+    keyframed = false;
+}
+
+void ToneController::setDoublePressHandler(void (*handler)()) {
+    this->doublePressHandler = handler;
 }
 
 void ToneController::setCurrentMode(int index) {
-    index = index % MODE_COUNT;
-    pixel->blink(modes[index].color[0],
-                 modes[index].color[1],
-                 modes[index].color[2],
-                 1000);
-    this->currentModeIndex = index;
-    int current = modes[index].currentValue;
-    int led_index = this->getMappedPixelIndex(current);
-    pixel->setFirstnPixelColor(
-        led_index,
-        modes[index].color[0],
-        modes[index].color[1],
-        modes[index].color[2]
-    );
-    pixel->show();
-}
-
-int ToneController::getCurrentValue() const {
-    return modes[this->currentModeIndex].currentValue;
-}
-
-String ToneController::getCurrentModeName() {
-    return modes[this->currentModeIndex].name;
-}
-
-void ToneController::setCurrentValue(int value) {
-    value = max(value, modes[this->currentModeIndex].minValue);
-    value = min(value, modes[this->currentModeIndex].maxValue);
-    int led_index = this->getMappedPixelIndex(value);
-    modes[this->currentModeIndex].currentValue = value;
-
-    pixel->clear();
-    pixel->setFirstnPixelColor(
-        led_index,
-        modes[this->currentModeIndex].color[0],
-        modes[this->currentModeIndex].color[1],
-        modes[this->currentModeIndex].color[2]
-    );
-    pixel->show();
-}
-
-int ToneController::getMappedValue(int angle, int maxAngle) {
-    int in_min = 0; // Minimum angle
-    int in_max = maxAngle; // Maximum angle
-    int out_min = modes[this->currentModeIndex].minValue;
-    int out_max = modes[this->currentModeIndex].maxValue;
-    if (angle < in_min) angle = in_min;
-    else if (angle > in_max) return -1;
-    return ceil(mapf(angle, in_min, in_max, out_min, out_max));
-}
-
-int ToneController::getMappedPixelIndex(int value) {
-    float result = mapf(
-        value,
-        modes[this->currentModeIndex].minValue,
-        modes[this->currentModeIndex].maxValue,
-        0,
-        this->_pixelCount + 1
-    );
-    return ceil(result);
+    this->setCurrentMode(*channels[0], index);
+}
+
+void ToneController::setCurrentMode(int channel, int index) {
+    toneChannel *target = this->channelAt(channel);
+    if (target != nullptr) this->setCurrentMode(*target, index);
+}
+
+void ToneController::setCurrentMode(toneChannel &channel, int index) {
+    const ModeRegistry &modes = channel.modes;
+    if (!modes.isConfigured(index)) {
+        index = modes.first();
+        if (index == -1) return;
+    }
+
+    channel.currentModeIndex = index;
+    channel.jogActive = false;
+    recorder.recordMode(millis(), channel.index, index);
+    const modeSpec &m = modes.spec(index);
+    channel.pixel->setBrightness(power.scaleBrightness(m.brightness));
+    this->updateLevel(channel, true);
+    channel.flash.set(Adafruit_NeoPixel::Color(m.color[0], m.color[1], m.color[2]), MODE_FLASH_MS, 0, 1);
+    channel.animator->play(&channel.flash, millis(), MODE_FADE_MS, MODE_FADE_MS);
+    channel.store.markChanged(millis());
+}
+
+int ToneController::getCurrentValue(int channel) const {
+    const toneChannel *target = this->channelAt(channel);
+    if (target == nullptr || !target->modes.isConfigured(target->currentModeIndex)) return 0;
+    return target->modes.getValue(target->currentModeIndex);
+}
+
+const modeSpec *ToneController::getModeSpec(int index, int channel) const {
+    const toneChannel *target = this->channelAt(channel);
+    if (target == nullptr || !target->modes.isConfigured(index)) return nullptr;
+    return &target->modes.spec(index);
+}
+
+const char *ToneController::getCurrentModeName(int channel) const {
+    const toneChannel *target = this->channelAt(channel);
+    if (target == nullptr || !target->modes.isConfigured(target->currentModeIndex)) return "";
+    return target->modes.spec(target->currentModeIndex).name;
+}
+
+int ToneController::getCurrentModeIndex(int channel) const {
+    const toneChannel *target = this->channelAt(channel);
+    return target != nullptr ? target->currentModeIndex : 0;
+}
+
+PixelController *ToneController::getPixel(int channel) {
+    toneChannel *target = this->channelAt(channel);
+    return target != nullptr ? target->pixel : nullptr;
+}
+
+JoystickController *ToneController::getJoystick(int channel) {
+    toneChannel *target = this->channelAt(channel);
+    return target != nullptr ? target->joystick : nullptr;
+}
+
+BluetoothController *ToneController::getBluetooth() {
+    return bluetooth;
+}
+
+const PowerManager &ToneController::getPower() const {
+    return power;
+}
+
+EventRecorder &ToneController::getRecorder() {
+    return recorder;
+}
+
+void ToneController::setCurrentValue(toneChannel &channel, int value) {
+    const modeSpec &m = channel.modes.spec(channel.currentModeIndex);
+    value = max(value, (int) m.minValue);
+    value = min(value, (int) m.maxValue);
+    channel.modes.setValue(channel.currentModeIndex, value);
+    recorder.recordValue(millis(), channel.index, value);
+    this->updateLevel(channel, false);
+    channel.store.markChanged(millis());
+}
+
+int ToneController::getMappedValue(const toneChannel &channel, int angle) const {
+    if (angle < 0) angle = 0;
+    else if (angle > MAX_MAPPED_ANGLE) return -1;
+    return channel.luts[channel.currentModeIndex].angleToValue[angle];
+}
+
+int ToneController::getStableMappedValue(const toneChannel &channel, int angle) const {
+    int value = getMappedValue(channel, angle);
+    int current = channel.modes.getValue(channel.currentModeIndex);
+    if (value == -1 || value == current) return value;
+
+    // Only accept the new value if it still holds ANGLE_HYSTERESIS degrees back towards the current one
+    if (value > current) {
+        int back = getMappedValue(channel, max(angle - ANGLE_HYSTERESIS, 0));
+        return back > current ? value : current;
+    }
+    int back = getMappedValue(channel, min(angle + ANGLE_HYSTERESIS, MAX_MAPPED_ANGLE));
+    return back < current ? value : current;
+}
+
+int ToneController::getJogValue(toneChannel &channel, int angle) {
+    int current = channel.modes.getValue(channel.currentModeIndex);
+    if (!channel.jogActive) {
+        channel.jogActive = true;
+        channel.jogAngle = angle;
+        channel.jogRemainder = 0;
+        return current;
+    }
+
+    int delta = angleDelta(channel.jogAngle, angle);
+    channel.jogAngle = angle;
+    return current + jogSteps(delta, channel.jogRemainder);
+}
+
+int ToneController::angleDelta(int from, int to) {
+    int delta = (to - from) % 360;
+    if (delta > 180) delta -= 360;
+    else if (delta <= -180) delta += 360;
+    return delta;
+}
+
+int ToneController::jogSteps(int delta, int32_t &remainder) {
+    if (delta == 0) return 0;
+    // Jitter back and forth cancels out instead of adding up to a step
+    if ((delta > 0) != (remainder > 0)) remainder = 0;
+
+    int32_t speed = min(abs(delta), JOG_MAX_SPEED);
+    int32_t gain = JOG_ACCEL_SPEED * JOG_ACCEL_SPEED + speed * speed;
+    remainder += (int32_t) delta * JOG_ONE * gain / (JOG_STEP_DEGREES * JOG_ACCEL_SPEED * JOG_ACCEL_SPEED);
+    int steps = remainder / JOG_ONE;
+    remainder -= (int32_t) steps * JOG_ONE;
+    return steps;
+}
+
+int32_t ToneController::getMappedLevel(const toneChannel &channel, int value) const {
+    const modeSpec &m = channel.modes.spec(channel.currentModeIndex);
+    int offset = value - m.minValue;
+    if (offset >= 0 && offset < VALUE_LUT_SIZE && value <= m.maxValue) {
+        return channel.luts[channel.currentModeIndex].valueToLevel[offset];
+    }
+    return computeLevel(channel, channel.currentModeIndex, value);
+}
+
+int32_t ToneController::computeLevel(const toneChannel &channel, int index, int value) {
+    const modeSpec &m = channel.modes.spec(index);
+    return levelOf(value - m.minValue, m.maxValue - m.minValue, channel.pixelCount);
+}
+
+int32_t ToneController::levelOf(long offset, long range, int pixelCount) {
+    if (range <= 0) return 0;
+    return (int64_t) offset * pixelCount * LEVEL_ONE / range;
+}
+
+void ToneController::buildLookupTables(toneChannel &channel, int index) {
+    const modeSpec &m = channel.modes.spec(index);
+    modeLut &lut = channel.luts[index];
+    long range = m.maxValue - m.minValue;
+    for (int angle = 0; angle <= MAX_MAPPED_ANGLE; angle++) {
+        lut.angleToValue[angle] = m.minValue + ceilDiv(angle * range, MAX_MAPPED_ANGLE);
+    }
+    for (int offset = 0; offset < VALUE_LUT_SIZE && offset <= range; offset++) {
+        lut.valueToLevel[offset] = computeLevel(channel, index, m.minValue + offset);
+    }
+}
+
+void ToneController::postState(toneChannel &channel) {
+    const ModeRegistry &modes = channel.modes;
+    if (!modes.isConfigured(channel.currentModeIndex)) return;
+
+    const modeSpec &m = modes.spec(channel.currentModeIndex);
+    toneState state;
+    state.channel = channel.index;
+    state.modeIndex = channel.currentModeIndex;
+    strncpy(state.name, m.name, TONE_NAME_MAX);
+    state.value = modes.getValue(channel.currentModeIndex);
+    memcpy(state.color, m.color, 3);
+    bluetooth->sendState(state);
+    statesPosted = true;
+}
+
+void ToneController::flushStates() {
+    if (!statesPosted) return;
+    statesPosted = false;
+    bluetooth->flushStates();
+#if TONE_TASKS
+    if (notifyTask != nullptr) xTaskNotifyGive(notifyTask);
+#endif
 }
 
 void ToneController::sendDataChange() {
-    const KVP data[5] = {
-        {"mode", getCurrentModeName()},
-        {"value", String(modes[this->currentModeIndex].currentValue)},
-        {"r", String(modes[this->currentModeIndex].color[0])},
-        {"g", String(modes[this->currentModeIndex].color[1])},
-        {"b", String(modes[this->currentModeIndex].color[2])}
-    };
-    bluetooth->sendData(data, 5);
+    for (uint8_t i = 0; i < channelCount; i++) {
+        this->postState(*channels[i]);
+    }
+    this->flushStates();
 }
 
 float ToneController::mapf(const float x, const float in_min, const float in_max, const float out_min, const float out_max) {
@@ -7,67 +7,390 @@
 
 #include <Arduino.h>
 #include "PixelController.h"
+#include "PixelAnimator.h"
 #include "JoyController.h"
 #include "BluetoothController.h"
+#include "ModeRegistry.h"
+#include "ToneStore.h"
+#include "EventRecorder.h"
+#include "PowerManager.h"
 
 /**
- * @brief Number of modes supported by the ToneController.
- * This constant defines how many different interaction modes can be configured.
+ * @brief Run input/LED handling and BLE notification in their own FreeRTOS tasks (see startTasks()).
+ * Off on the host simulator, where update() drives both from loop().
  */
-#define MODE_COUNT 3
+#ifndef TONE_TASKS
+#ifdef ARDUINO_ARCH_ESP32
+#define TONE_TASKS 1
+#else
+#define TONE_TASKS 0
+#endif
+#endif
 
+#if TONE_TASKS
 /**
- * @brief Structure representing a mode, with a name, value range, current value, color and brightness.
+ * @brief Cores of the two tasks. BLE notification stays on the core of the Bluedroid host (0),
+ * input and LEDs get the other one. Single core chips (ESP32-C3) run both on core 0, where the
+ * input task preempts the notify task by priority.
  */
-struct mode {
-    String name;
-    int minValue = 0;
-    int maxValue = 100;
-    int currentValue = 0;
-    uint8_t color[3] = {255, 255, 255};
-    uint8_t brightness = 150;
+#if portNUM_PROCESSORS > 1
+#define TONE_INPUT_CORE 1
+#else
+#define TONE_INPUT_CORE 0
+#endif
+#define TONE_NOTIFY_CORE 0
+#define TONE_INPUT_PRIORITY 3
+#define TONE_NOTIFY_PRIORITY 2
+#define TONE_TASK_STACK 4096
+
+/**
+ * @brief Longest time the notify task sleeps without a new state, in milliseconds.
+ * Bounds the delay of rate-limited states and of the advertising restart.
+ */
+#define TONE_NOTIFY_IDLE_MS 5
+
+/**
+ * @brief Same, while no client is connected (only the advertising restart is left to do).
+ */
+#define TONE_NOTIFY_ADVERTISE_MS 100
+
+/**
+ * @brief Light sleep between samples in POWER_SLEEP, woken by the sample timer or the button.
+ */
+#ifndef TONE_LIGHT_SLEEP
+#define TONE_LIGHT_SLEEP 1
+#endif
+#endif
+
+/**
+ * @brief Joystick angle that maps to the maximum value of a mode.
+ * Angles above it (the gap at the end of the ring) are ignored.
+ */
+#define MAX_MAPPED_ANGLE 330
+
+/**
+ * @brief Largest mode range (maxValue - minValue) covered by the value to level lookup table.
+ * Wider ranges fall back to integer arithmetic.
+ */
+#define VALUE_LUT_SIZE 256
+
+/**
+ * @brief Angle in degrees the joystick has to move past a value boundary before the value changes.
+ */
+#define ANGLE_HYSTERESIS 2
+
+/**
+ * @brief Relative modes: degrees of slow rotation per value step.
+ */
+#define JOG_STEP_DEGREES 6
+
+/**
+ * @brief Relative modes: rotation speed (degrees per sample) at which the step size doubles.
+ * The gain grows with the square of the speed, 1 + (speed / JOG_ACCEL_SPEED)^2.
+ */
+#define JOG_ACCEL_SPEED 2
+
+/**
+ * @brief Relative modes: speeds above this many degrees per sample count as this speed.
+ */
+#define JOG_MAX_SPEED 30
+
+/**
+ * @brief Fixed point scale of the relative step accumulator (1/JOG_ONE steps).
+ */
+#define JOG_ONE 256
+
+/**
+ * @brief Interval between two joystick samples in milliseconds.
+ */
+#define SAMPLE_INTERVAL_MS 10
+
+/**
+ * @brief Duration of the mode switch flash in milliseconds.
+ */
+#define MODE_FLASH_MS 1000
+
+/**
+ * @brief Crossfade into and out of the mode switch flash in milliseconds.
+ */
+#define MODE_FADE_MS 150
+
+/**
+ * @brief Interval between two REC_KEYFRAME records of the event log in milliseconds.
+ * A replay of a log whose start was overwritten begins at its first keyframe.
+ */
+#define RECORDER_KEYFRAME_MS 2000
+
+/**
+ * @brief Log bytes per line of a log dump.
+ */
+#define LOG_DUMP_BYTES 16
+
+/**
+ * @brief Interval between two lines of a log dump in milliseconds.
+ */
+#define LOG_DUMP_INTERVAL_MS 10
+
+/**
+ * @brief Where a requested log dump is written.
+ */
+enum LogTarget : uint8_t {
+    LOG_NONE,   ///< No dump in progress
+    LOG_BLE,    ///< Notifications, requested with a BLE write
+    LOG_SERIAL  ///< Serial lines, requested on Serial
+};
+
+/**
+ * @brief Precomputed lookup tables of a mode, rebuilt by setMode().
+ */
+struct modeLut {
+    int16_t angleToValue[MAX_MAPPED_ANGLE + 1]; ///< Mode value for every angle 0..MAX_MAPPED_ANGLE
+    uint16_t valueToLevel[VALUE_LUT_SIZE];      ///< Ring level (1/LEVEL_ONE pixels) for every value offset from minValue
+};
+
+/**
+ * @brief A joystick, its LED ring and the set of modes it drives.
+ */
+struct toneChannel {
+    uint8_t index = 0; ///< Channel number, carried in states and commands
+    int xPin = 0; ///< Analog pin for joystick X axis
+    int yPin = 0; ///< Analog pin for joystick Y axis
+    int swPin = 0; ///< Digital pin for joystick switch
+    int pixelPin = 0; ///< Digital pin for LED ring
+    int pixelCount = 0; ///< Number of pixels in the LED ring
+    PixelController *pixel = nullptr; ///< LED ring, created by begin()
+    PixelAnimator *animator = nullptr; ///< Effects rendered on the LED ring
+    LevelEffect level; ///< Level of the active mode, the animator's background
+    BlinkEffect flash; ///< Mode switch flash
+    JoystickController *joystick = nullptr; ///< Joystick, created by begin()
+    ModeRegistry modes; ///< Configured modes and their values
+    ToneStore store; ///< Values, active mode and calibration kept on flash
+    modeLut luts[MAX_MODES]; ///< Lookup tables of each mode slot
+    int currentModeIndex = 0; ///< Index of the currently active mode
+    bool jogActive = false; ///< Relative modes: jogAngle holds the angle of the previous sample
+    int jogAngle = 0; ///< Relative modes: angle of the previous deflected sample
+    int32_t jogRemainder = 0; ///< Relative modes: fraction of a step carried to the next sample (1/JOG_ONE)
+    ButtonDebouncer button; ///< Turns button edges into short, long and double presses
+    bool wakePress = false; ///< This button woke the blank ring, its next gesture is not acted on
 };
 
 /**
  * @brief ToneController handles multiple interaction modes using a joystick and pixel LED ring.
  * It maps joystick input to angles and values, and provides vibration feedback and LED visualization.
+ *
+ * A controller drives up to TONE_MAX_CHANNELS channels, each a joystick, a ring and its own modes.
+ * All joysticks are read in one ADC scan per sample and processed in one pass, and the states the
+ * channels change in that pass go out together in one notification. Methods without a channel
+ * argument work on channel 0, so single channel sketches stay as they are. The event log records channel 0.
  */
 class ToneController {
 private:
-    int _xPin; ///< Analog pin for joystick X axis
-    int _yPin; ///< Analog pin for joystick Y axis
-    int _swPin; ///< Digital pin for joystick switch
-    int _pixelPin; ///< Digital pin for LED ring
-    int _pixelCount; ///< Number of pixels in the LED ring
-    PixelController *pixel; ///< Pointer to PixelController instance
-    JoystickController *joystick; ///< Pointer to JoystickController instance
+    toneChannel *channels[TONE_MAX_CHANNELS] = {}; ///< Channels, channel 0 created by the constructor
+    uint8_t channelCount = 0; ///< Number of channels
     BluetoothController *bluetooth; ///< Pointer to BluetoothController instance
-    mode modes[MODE_COUNT]; ///< Array of modes
-    int currentModeIndex; ///< Index of the currently active mode
+    unsigned long lastSampleTime = 0; ///< millis() timestamp of the last joystick sample
+    bool statesPosted = false; ///< States were posted in this input tick, see flushStates()
+    void (*doublePressHandler)() = nullptr; ///< Action of a double press, recalibrate() if not set
+    EventRecorder recorder; ///< Log of inputs and outputs for replay
+    bool keyframed = false; ///< A keyframe has been recorded since the last calibration or dump
+    unsigned long keyframeAt = 0; ///< millis() of the last keyframe
+    unsigned long recordedNotifies = 0; ///< Notification count at the last REC_NOTIFY
+    bool recordedConnected = false; ///< Connection state at the last REC_CONNECT / REC_DISCONNECT
+    LogTarget dumpTarget = LOG_NONE; ///< Destination of the log dump in progress
+    uint16_t dumpClient = TONE_ALL_CLIENTS; ///< BLE client that asked for the dump
+    size_t dumpOffset = 0; ///< Next log byte to dump
+    unsigned long dumpAt = 0; ///< millis() of the last dump line
+    PowerManager power; ///< Sampling rate, ring brightness and sleep from the time since the last input
+    char serialLine[TONE_COMMAND_MAX + 2] = {}; ///< Command line being received on Serial
+    uint8_t serialLength = 0; ///< Characters in serialLine, TONE_COMMAND_MAX + 1 once it is too long
+#if TONE_TASKS
+    TaskHandle_t inputTask = nullptr; ///< Task running updateControl()
+    TaskHandle_t notifyTask = nullptr; ///< Task running BluetoothController::update()
+#endif
+
+    /**
+     * @brief Button, host commands, joystick sampling and LED ring. Input task only.
+     * @param now Current millis() timestamp.
+     */
+    void updateControl(unsigned long now);
+
+    /**
+     * @brief Debounces the button edges recorded by the interrupt handlers and acts on the gestures:
+     * short press next mode, long press previous mode, double press the double press handler.
+     * @param now Current millis() timestamp.
+     */
+    void updateButton(unsigned long now);
+
+    /**
+     * @brief Samples all joysticks and updates the value of the active mode of every channel.
+     */
+    void updateInput();
+
+    /**
+     * @brief Reads both axes of every joystick in one pass, interleaved and oversampled, and hands
+     * the averages to the joysticks.
+     */
+    void scanJoysticks();
+
+    /**
+     * @brief Updates the value of the active mode of a channel from its last joystick sample.
+     */
+    void updateChannel(toneChannel &channel);
+
+    /**
+     * @brief Advances the power state machine and applies a new state to the ring and advertising.
+     * @param now Current millis() timestamp.
+     */
+    void updatePower(unsigned long now);
+
+    /**
+     * @brief Reads command lines from Serial, they are handled like BLE writes and acknowledged on Serial.
+     */
+    void updateSerial();
+
+    /**
+     * @brief Records keyframes, notifications and connection changes in the event log.
+     * @param now Current millis() timestamp.
+     */
+    void updateRecorder(unsigned long now);
+
+    /**
+     * @brief Writes the next line of a requested log dump. Recording is paused until the dump is done.
+     * @param now Current millis() timestamp.
+     */
+    void updateDump(unsigned long now);
+
+    /**
+     * @brief Writes a line of a log dump to its target.
+     */
+    void writeDumpLine(const char *line);
+    void writeDumpLine(const char *line, LogTarget target, uint16_t client);  // Same, to the given target
+
+#if TONE_METRICS
+    /**
+     * @brief Writes the hot path timings as `#metrics <count>` followed by a `#metric` line per metric.
+     * @param target LOG_SERIAL or LOG_BLE.
+     * @param client BLE client that asked.
+     */
+    void dumpMetrics(LogTarget target, uint16_t client);
+#endif
+
+    /**
+     * @brief Writes values, active mode and calibration of every channel to flash once a change has settled.
+     * @param now Current millis() timestamp.
+     */
+    void updateStore(unsigned long now);
+
+    /**
+     * @brief Applies a command written by the host and acknowledges it with its sequence number.
+     * @param command Parsed command.
+     * @param source LOG_BLE for BLE writes (acknowledged to the writing client), LOG_SERIAL for Serial lines
+     * (acknowledged on Serial).
+     */
+    void handleCommand(const toneCommand &command, LogTarget source = LOG_BLE);
+
+    /**
+     * @brief Sends the configuration and value of every mode of a channel, then the full state of its active mode.
+     * @param channel Channel to describe.
+     * @param client Connection id of the client that asked, TONE_ALL_CLIENTS for every client.
+     */
+    void sendSnapshot(toneChannel &channel, uint16_t client);
 
     /**
-     * @brief Sets the current value of the active mode.
+     * @brief Returns a channel, nullptr if there is no channel with that number.
+     */
+    toneChannel *channelAt(int channel) const;
+
+    /**
+     * @brief Posts the state of the active mode of a channel. It is sent with the other states of
+     * the input tick by flushStates().
+     */
+    void postState(toneChannel &channel);
+
+    /**
+     * @brief Hands the states posted in this input tick to the notify task in one go.
+     */
+    void flushStates();
+
+    // Per channel versions of the public mode methods
+    void setMode(toneChannel &channel, int index, const char *name, int minValue, int maxValue, uint8_t r, uint8_t g,
+                 uint8_t b, uint8_t brightness, ModeInput input);
+    int addMode(toneChannel &channel, const char *name, int minValue, int maxValue, uint8_t r, uint8_t g, uint8_t b,
+                uint8_t brightness, ModeInput input);
+    bool removeMode(toneChannel &channel, int index);
+    void setCurrentMode(toneChannel &channel, int index);
+
+    /**
+     * @brief Points the level effect of a channel at the value and color of its active mode.
+     * @param jump Show the new level immediately instead of filling up to it.
+     */
+    void updateLevel(toneChannel &channel, bool jump);
+
+    /**
+     * @brief Sets the current value of the active mode of a channel.
      * @param value The value to be set within the mode's range.
      */
-    void setCurrentValue(int value);
+    void setCurrentValue(toneChannel &channel, int value);
+
+    /**
+     * @brief Maps a given joystick angle to the value range of the channel's current mode.
+     * @param angle Angle in degrees (0–360).
+     * @return Mapped value within mode's min and max, or -1 if the angle is above MAX_MAPPED_ANGLE.
+     */
+    int getMappedValue(const toneChannel &channel, int angle) const;
 
     /**
-     * @brief Maps a given joystick angle to the current mode's value range.
+     * @brief Maps an angle to a value, keeping the current value until the angle
+     * is ANGLE_HYSTERESIS degrees past the boundary of a neighbouring value.
      * @param angle Angle in degrees (0–360).
-     * @param maxAngle Maximum angle
-     * @return Mapped value within mode's min and max.
+     * @return Mapped value, or -1 if the angle is above MAX_MAPPED_ANGLE.
      */
-    int getMappedValue(int angle, int maxAngle=360);
+    int getStableMappedValue(const toneChannel &channel, int angle) const;
 
     /**
-     * @brief Calculates the number of LEDs to turn on
+     * @brief Relative modes: steps the current value by the rotation since the previous sample.
+     * The first sample after the stick leaves the dead zone only sets the reference angle.
+     * @param angle Angle in degrees (0–360).
+     * @return New value, not yet clamped to the mode's range.
+     */
+    int getJogValue(toneChannel &channel, int angle);
+
+    /**
+     * @brief Calculates how far the ring of a channel is lit for a value of its active mode.
      * @param value The value to be set within the mode's range.
+     * @return Level in 1/LEVEL_ONE pixels.
+     */
+    int32_t getMappedLevel(const toneChannel &channel, int value) const;
+
+    /**
+     * @brief Calculates the ring level for a value of a mode without the lookup table.
+     * @param index Index of the mode.
+     * @param value The value within the mode's range.
+     * @return Level in 1/LEVEL_ONE pixels.
+     */
+    static int32_t computeLevel(const toneChannel &channel, int index, int value);
+
+    /**
+     * @brief Fills the angle to value and value to pixel tables of a mode.
+     * @param index Index of the mode.
      */
-    int getMappedPixelIndex(int value);
+    static void buildLookupTables(toneChannel &channel, int index);
+
+#if TONE_TASKS
+    static void inputTaskLoop(void *controller);  // Body of the input task
+    static void notifyTaskLoop(void *controller);  // Body of the notify task
+#endif
+
+    /**
+     * @brief Integer division rounding towards positive infinity.
+     */
+    static constexpr long ceilDiv(long num, long den) {
+        return (num % den == 0) ? num / den : num / den + ((num < 0) == (den < 0) ? 1 : 0);
+    }
 
 public:
     /**
-         * @brief Construct a new ToneController object with all necessary pins.
+         * @brief Construct a new ToneController object with all necessary pins of channel 0.
          * @param xPin Analog pin for joystick X axis.
          * @param yPin Analog pin for joystick Y axis.
          * @param swPin Digital pin for joystick switch.
@@ -77,59 +400,220 @@ public:
     ToneController(int xPin, int yPin, int swPin, int pixelPin, int pixelCount);
 
     /**
-     * @brief Initializes joystick, pixel controller and other hardware.
+     * @brief Adds a channel: another joystick and ring with modes of its own. Call before begin().
+     * @param xPin Analog pin for joystick X axis.
+     * @param yPin Analog pin for joystick Y axis.
+     * @param swPin Digital pin for joystick switch.
+     * @param pixelPin Digital pin connected to the LED ring.
+     * @param pixelCount Number of pixels in the LED ring.
+     * @return Number of the new channel, or -1 if all TONE_MAX_CHANNELS are in use.
+     */
+    int addChannel(int xPin, int yPin, int swPin, int pixelPin, int pixelCount);
+
+    /**
+     * @brief Returns the number of channels.
+     */
+    int getChannelCount() const;
+
+    /**
+     * @brief Initializes the joysticks, pixel controllers and other hardware of every channel.
+     * Reads the stored states; a channel with a stored joystick calibration is not recalibrated.
      */
     void begin();
 
+    /**
+     * @brief Restores the stored mode values and activates the stored mode of every channel.
+     * Call after the modes are configured. Values of unconfigured slots or outside the range are skipped.
+     * @return true if a stored state was applied to every channel, false if one has none (the caller picks its mode).
+     */
+    bool restoreState();
+
     /**
      * @brief Updates the system – reads joystick, updates mode value, vibration and LEDs.
-     * Should be called regularly in loop().
+     * Never blocks: every step is driven by millis() and advances a little on each call,
+     * so it should be called as often as possible in loop(). Not needed after startTasks().
      */
     void update();
 
+    /**
+     * @brief Returns how long the input loop can wait before update() has work again:
+     * 0 while active (animations and button timers) or a ring frame is being sent, else until the next
+     * joystick sample is due.
+     * Button edges are timestamped by the interrupt handler, so waiting does not change the gestures.
+     * @param now Current millis() timestamp.
+     * @return Milliseconds to wait.
+     */
+    unsigned long getIdleTime(unsigned long now) const;
+
+    /**
+     * @brief Adds time the input loop spent in light sleep to the power statistics and wakes
+     * the power state machine if a button ended it.
+     * @param us Time asleep in microseconds.
+     * @param byButton A button woke the chip; the channels whose button is held only wake.
+     */
+    void sleptFor(unsigned long us, bool byButton);
+
+    /**
+     * @brief Moves input/LED handling and BLE notification into two pinned FreeRTOS tasks
+     * (TONE_INPUT_CORE and TONE_NOTIFY_CORE). They exchange states through lock-free mailboxes.
+     * @return true if both tasks were started. false if they are not available (TONE_TASKS 0) or could not be
+     * created, then neither runs and update() has to be called from loop().
+     */
+    bool startTasks();
+
     /**
      * @brief Sets the configuration for a specific mode.
-     * @param index Index of the mode (0 to MODE_COUNT-1).
-     * @param name Mode display name.
+     * @param index Index of the mode (0 to MAX_MODES-1).
+     * @param name Mode display name, copied (up to TONE_NAME_MAX characters).
      * @param minValue Minimum value of the mode.
-     * @param maxValue Maximum value of the mode.
+     * @param maxValue Maximum value of the mode. The slot is left as it is unless both fit int16_t and min <= max.
      * @param r Red color component (0–255).
      * @param g Green color component (0–255).
      * @param b Blue color component (0–255).
      * @param brightness LED brightness (0–255).
+     * @param input Absolute angle mapping or relative jog dial.
+     */
+    void setMode(int index, const char *name, int minValue, int maxValue, uint8_t r, uint8_t g, uint8_t b,
+                 uint8_t brightness, ModeInput input = MODE_INPUT_ABSOLUTE);
+
+    /**
+     * @brief Sets the configuration for a specific mode without copying it.
+     * @param index Index of the mode (0 to MAX_MODES-1).
+     * @param spec Mode configuration, must outlive the controller (usually a `static const` table).
+     */
+    void setMode(int index, const modeSpec *spec);
+
+    /**
+     * @brief Sets the configuration for a specific mode of a channel without copying it.
+     * @param channel Channel number.
+     * @param index Index of the mode (0 to MAX_MODES-1).
+     * @param spec Mode configuration, must outlive the controller (usually a `static const` table). The slot is
+     * left as it is if maxValue < minValue.
+     */
+    void setMode(int channel, int index, const modeSpec *spec);
+
+    /**
+     * @brief Configures the first free mode slot.
+     * @return int Index of the new mode, or -1 if all MAX_MODES slots are in use or the range is invalid
+     * (see setMode()).
+     */
+    int addMode(const char *name, int minValue, int maxValue, uint8_t r, uint8_t g, uint8_t b, uint8_t brightness,
+                ModeInput input = MODE_INPUT_ABSOLUTE);
+
+    /**
+     * @brief Removes a mode. If it is active, the next mode is activated first.
+     * The last remaining mode cannot be removed.
+     * @param index Mode index to remove.
+     * @return true if the mode was removed.
      */
-    void setMode(int index, String name, int minValue, int maxValue, uint8_t r, uint8_t g, uint8_t b,
-                 uint8_t brightness);
+    bool removeMode(int index);
+
+    /**
+     * @brief Returns the number of configured modes of a channel.
+     */
+    int getModeCount(int channel = 0) const;
+
+    /**
+     * @brief Returns the configuration of a mode of a channel.
+     * @return const modeSpec* Mode configuration, nullptr if the slot is not configured.
+     */
+    const modeSpec *getModeSpec(int index, int channel = 0) const;
 
     /**
      * @brief Activates the specified mode by index.
-     * @param index Mode index to activate.
+     * The ring fades into the mode color for MODE_FLASH_MS, then fades back to the mode level.
+     * @param index Mode index to activate, the first configured mode is used if it is not configured.
      */
     void setCurrentMode(int index);
 
     /**
-     * @brief Switches to the next mode in the list (looping).
+     * @brief Activates the specified mode of a channel, see setCurrentMode(int).
+     * @param channel Channel number.
+     * @param index Mode index to activate.
+     */
+    void setCurrentMode(int channel, int index);
+
+    /**
+     * @brief Switches a channel to its next configured mode (looping).
      */
-    void nextMode();
+    void nextMode(int channel = 0);
 
     /**
-     * @brief Returns the current value of the active mode.
+     * @brief Switches a channel to its previous configured mode (looping).
+     */
+    void previousMode(int channel = 0);
+
+    /**
+     * @brief Recalibrates the joystick of a channel at its current (rest) position and stores the result.
+     */
+    void recalibrate(int channel = 0);
+
+    /**
+     * @brief Sets the action of a double press on any channel.
+     * @param handler Called from the input loop, nullptr restores the default (recalibrate() of the channel).
+     */
+    void setDoublePressHandler(void (*handler)());
+
+    /**
+     * @brief Returns the current value of the active mode of a channel.
      * @return int Current value.
      */
-    int getCurrentValue() const;
+    int getCurrentValue(int channel = 0) const;
+
+    /**
+     * @brief Gets the name of the currently active mode of a channel.
+     * @return const char* Mode name, empty if no mode is configured.
+     */
+    const char *getCurrentModeName(int channel = 0) const;
+
+    /**
+     * @brief Returns the index of the currently active mode of a channel.
+     * @return int Mode index.
+     */
+    int getCurrentModeIndex(int channel = 0) const;
+
+    PixelController *getPixel(int channel = 0);  // LED ring of a channel, valid after begin()
+    JoystickController *getJoystick(int channel = 0);  // Joystick of a channel, valid after begin()
+    BluetoothController *getBluetooth();  // BLE link, valid after begin()
+    const PowerManager &getPower() const;  // Power state and duty cycle statistics
+    EventRecorder &getRecorder();  // Event log of inputs and outputs
 
     /**
-     * @brief Gets the name of the currently active mode.
-     * @return String Mode name.
+     * @brief Puts the keyframe's channel into the state of a REC_KEYFRAME: calibration, filtered stick position,
+     * the value of every mode, the active mode and the debounced button. A replay of the event log starts here.
+     * @param keyframe Decoded keyframe, its button timestamp already moved to the current millis() base.
      */
-    String getCurrentModeName();
+    void applyKeyframe(const recordEntry &keyframe);
 
     /**
-     * @brief Sends the current mode data over Bluetooth.
+     * @brief Sends the current mode data of every channel over Bluetooth, in one notification.
      * This includes mode name, current value, and color.
      */
     void sendDataChange();
 
+    /**
+     * @brief Ring level of a value: the full range lights all pixels, every value step a fraction of one.
+     * @param offset Value minus the mode's minimum.
+     * @param range Mode range (maxValue - minValue).
+     * @param pixelCount Number of pixels in the ring.
+     * @return Level in 1/LEVEL_ONE pixels.
+     */
+    static int32_t levelOf(long offset, long range, int pixelCount);
+
+    /**
+     * @brief Shortest signed rotation between two angles, across the 360/0 boundary.
+     * @return Degrees between -179 and 180, positive for increasing angles.
+     */
+    static int angleDelta(int from, int to);
+
+    /**
+     * @brief Converts a rotation into value steps with the jog acceleration curve. Integer only.
+     * @param delta Rotation in degrees since the previous sample.
+     * @param remainder Fraction of a step carried between calls (1/JOG_ONE), reset on a direction change.
+     * @return Whole steps, signed like delta.
+     */
+    static int jogSteps(int delta, int32_t &remainder);
+
     static float mapf(float x, float in_min, float in_max, float out_min, float out_max);
 };
 
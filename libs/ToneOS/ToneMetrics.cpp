@@ -0,0 +1,103 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "ToneMetrics.h"
+
+#if TONE_METRICS
+static metricHistogram histograms[METRIC_COUNT];
+
+/**
+ * @brief Nanoseconds per tick in 16.16 fixed point: 6.25 ns per cycle at 160 MHz, 1 on the host.
+ */
+#ifdef ARDUINO_ARCH_ESP32
+static uint32_t nsPerTick = (1000UL << 16) / 160;
+#else
+static uint32_t nsPerTick = 1UL << 16;
+#endif
+
+static const char *const METRIC_NAMES[METRIC_COUNT] = {"joy_read", "mapping", "show", "notify", "control"};
+
+static void putLe32(uint8_t *out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+void ToneMetrics::begin() {
+#ifdef ARDUINO_ARCH_ESP32
+    nsPerTick = (1000UL << 16) / getCpuFrequencyMhz();
+#endif
+}
+
+void ToneMetrics::record(ToneMetric metric, uint32_t ticks) {
+    uint32_t ns = ((uint64_t) ticks * nsPerTick) >> 16;
+    uint32_t scaled = ns >> METRIC_BUCKET_SHIFT;
+    uint8_t bucket = scaled == 0 ? 0 : min(32 - __builtin_clz(scaled), METRIC_BUCKETS - 1);
+
+    metricHistogram &histogram = histograms[metric];
+    histogram.count++;
+    histogram.totalNs += ns;
+    if (ns > histogram.maxNs) histogram.maxNs = ns;
+    histogram.buckets[bucket]++;
+}
+
+const metricHistogram &ToneMetrics::get(ToneMetric metric) {
+    return histograms[metric];
+}
+
+const char *ToneMetrics::name(ToneMetric metric) {
+    return metric < METRIC_COUNT ? METRIC_NAMES[metric] : "";
+}
+
+uint32_t ToneMetrics::percentile(ToneMetric metric, uint8_t percent) {
+    const metricHistogram &histogram = histograms[metric];
+    if (histogram.count == 0) return 0;
+
+    // Rank of the percentile, rounded up, so p100 is the last duration
+    uint32_t rank = ((uint64_t) histogram.count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t bucket = 0; bucket < METRIC_BUCKETS - 1; bucket++) {
+        seen += histogram.buckets[bucket];
+        if (seen >= rank) return min(1UL << (bucket + METRIC_BUCKET_SHIFT), (unsigned long) histogram.maxNs);
+    }
+    return histogram.maxNs;
+}
+
+size_t ToneMetrics::encode(uint8_t *out, size_t size) {
+    if (size < METRIC_SNAPSHOT_SIZE) return 0;
+
+    out[0] = METRIC_SNAPSHOT_VERSION;
+    out[1] = METRIC_COUNT;
+    uint8_t *record = out + 2;
+    for (const metricHistogram &histogram : histograms) {
+        putLe32(record, histogram.count);
+        putLe32(record + 4, histogram.count ? histogram.totalNs / histogram.count : 0);
+        putLe32(record + 8, histogram.maxNs);
+        for (uint8_t bucket = 0; bucket < METRIC_BUCKETS; bucket++) {
+            uint16_t count = min(histogram.buckets[bucket], (uint32_t) 0xFFFF);
+            record[12 + 2 * bucket] = count;
+            record[13 + 2 * bucket] = count >> 8;
+        }
+        record += METRIC_RECORD_SIZE;
+    }
+    return METRIC_SNAPSHOT_SIZE;
+}
+
+size_t ToneMetrics::format(ToneMetric metric, char *line, size_t size) {
+    const metricHistogram &histogram = histograms[metric];
+    int length = snprintf(line, size, "#metric %s n=%lu mean=%lu p50=%lu p99=%lu max=%lu", name(metric),
+                          (unsigned long) histogram.count,
+                          (unsigned long) (histogram.count ? histogram.totalNs / histogram.count : 0),
+                          (unsigned long) percentile(metric, 50), (unsigned long) percentile(metric, 99),
+                          (unsigned long) histogram.maxNs);
+    return length < 0 ? 0 : min((size_t) length, size - 1);
+}
+
+void ToneMetrics::reset() {
+    for (metricHistogram &histogram : histograms) {
+        histogram = metricHistogram();
+    }
+}
+#endif
@@ -0,0 +1,151 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef TONEMETRICS_H
+#define TONEMETRICS_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Time the hot paths (joystick scan, mapping, ring show, BLE notify, control tick) into histograms,
+ * readable over Serial, the `metrics` command and the metrics characteristic. Build with -DTONE_METRICS=0
+ * to compile the timers, the characteristic and the command out.
+ */
+#ifndef TONE_METRICS
+#define TONE_METRICS 1
+#endif
+
+#if TONE_METRICS
+#ifndef ARDUINO_ARCH_ESP32
+#include <chrono>
+#endif
+
+/**
+ * @brief Histogram buckets of a metric. Bucket 0 holds durations below 2^METRIC_BUCKET_SHIFT ns,
+ * every further bucket twice the range of the previous one, the last (from 4.2 ms on) is open ended.
+ */
+#define METRIC_BUCKETS 16
+#define METRIC_BUCKET_SHIFT 8
+
+/**
+ * @brief Version byte of the binary snapshot sent on the metrics characteristic.
+ */
+#define METRIC_SNAPSHOT_VERSION 1
+
+/**
+ * @brief Bytes of a metric in the snapshot: count, mean and max in ns (uint32 LE each),
+ * then the bucket counts (uint16 LE each, saturated).
+ */
+#define METRIC_RECORD_SIZE (12 + 2 * METRIC_BUCKETS)
+
+/**
+ * @brief Timed code paths.
+ */
+enum ToneMetric : uint8_t {
+    METRIC_JOY_READ, ///< ADC reads and filtering of all joysticks
+    METRIC_MAPPING,  ///< Angle to mode value of a channel
+    METRIC_SHOW,     ///< Ring show(): level correction and handing the frame to the output
+    METRIC_NOTIFY,   ///< One BLE payload to one client, all of its parts
+    METRIC_CONTROL,  ///< Whole input tick (updateControl())
+    METRIC_COUNT
+};
+
+/**
+ * @brief Snapshot size: version, metric count, then METRIC_RECORD_SIZE bytes per metric.
+ */
+#define METRIC_SNAPSHOT_SIZE (2 + METRIC_COUNT * METRIC_RECORD_SIZE)
+
+/**
+ * @brief Durations of one metric.
+ */
+struct metricHistogram {
+    uint32_t count = 0;                    ///< Durations recorded
+    uint64_t totalNs = 0;                  ///< Sum of all durations
+    uint32_t maxNs = 0;                    ///< Longest duration
+    uint32_t buckets[METRIC_BUCKETS] = {}; ///< Durations per power of two range
+};
+
+/**
+ * @brief ToneMetrics keeps a fixed histogram per ToneMetric, filled by MetricTimer.
+ *
+ * Timestamps are the CPU cycle counter on the ESP32 and steady_clock on the host, recording never
+ * allocates or locks. Every metric is written by one task at a time (METRIC_NOTIFY under the notify
+ * lock), readers in other tasks may see a duration half recorded, which the statistics tolerate.
+ */
+class ToneMetrics {
+public:
+    /**
+     * @brief Reads the CPU frequency the cycle counter runs at. Durations assume 160 MHz until then.
+     */
+    static void begin();
+
+    /**
+     * @brief Returns a timestamp in ticks (CPU cycles on the ESP32, ns on the host), wrapping.
+     */
+    static inline uint32_t now() {
+#ifdef ARDUINO_ARCH_ESP32
+        return ESP.getCycleCount();
+#else
+        return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /**
+     * @brief Adds a duration to a metric.
+     * @param ticks Difference of two now() timestamps.
+     */
+    static void record(ToneMetric metric, uint32_t ticks);
+
+    static const metricHistogram &get(ToneMetric metric);  // Histogram of a metric
+    static const char *name(ToneMetric metric);  // Short name, as in the dump
+
+    /**
+     * @brief Estimates a percentile from the histogram.
+     * @param percent 1..100.
+     * @return Upper bound of the bucket holding the percentile in ns, capped at the maximum; 0 without durations.
+     */
+    static uint32_t percentile(ToneMetric metric, uint8_t percent);
+
+    /**
+     * @brief Writes the binary snapshot of all metrics, see METRIC_RECORD_SIZE.
+     * @param out Receives METRIC_SNAPSHOT_SIZE bytes.
+     * @return Bytes written, 0 if size is too small.
+     */
+    static size_t encode(uint8_t *out, size_t size);
+
+    /**
+     * @brief Formats a metric as a dump line: `#metric <name> n=<count> mean=<ns> p50=<ns> p99=<ns> max=<ns>`.
+     * @return Length of the line.
+     */
+    static size_t format(ToneMetric metric, char *line, size_t size);
+
+    static void reset();  // Clears all histograms
+};
+
+/**
+ * @brief Records the time until the end of its scope into a metric.
+ */
+class MetricTimer {
+private:
+    ToneMetric metric;
+    uint32_t start;
+
+public:
+    explicit MetricTimer(ToneMetric metric) : metric(metric), start(ToneMetrics::now()) {}
+
+    ~MetricTimer() {
+        ToneMetrics::record(metric, ToneMetrics::now() - start);
+    }
+
+    MetricTimer(const MetricTimer &) = delete;
+    MetricTimer &operator=(const MetricTimer &) = delete;
+};
+
+#define TONE_METRIC_SCOPE(metric) MetricTimer toneMetricTimer(metric)
+#else
+#define TONE_METRIC_SCOPE(metric) do {} while (0)
+#endif
+
+#endif //TONEMETRICS_H
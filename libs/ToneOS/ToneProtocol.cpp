@@ -0,0 +1,89 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "ToneProtocol.h"
+
+size_t ToneFrameEncoder::encode(const toneState &state, uint8_t *out) {
+    return this->encode(&state, 1, out);
+}
+
+size_t ToneFrameEncoder::encode(const toneState *states, uint8_t count, uint8_t *out) {
+    uint8_t flags[TONE_MAX_CHANNELS];
+    count = min(count, (uint8_t) TONE_MAX_CHANNELS);
+    for (uint8_t i = 0; i < count; i++) {
+        const toneState &state = states[i];
+        uint8_t channel = state.channel % TONE_MAX_CHANNELS;
+        bool nameChanged = !hasLast[channel] || strncmp(lastName[channel], state.name, TONE_NAME_MAX) != 0;
+        bool colorChanged = !hasLast[channel] || memcmp(lastColor[channel], state.color, 3) != 0;
+        flags[i] = (nameChanged ? FRAME_HAS_NAME : 0) | (colorChanged ? FRAME_HAS_COLOR : 0);
+
+        if (nameChanged) {
+            size_t nameLen = strnlen(state.name, TONE_NAME_MAX);
+            memcpy(lastName[channel], state.name, nameLen);
+            lastName[channel][nameLen] = '\0';
+        }
+        if (colorChanged) {
+            memcpy(lastColor[channel], state.color, 3);
+        }
+        hasLast[channel] = true;
+    }
+    return writeFrame(states, count, sequence++, flags, out);
+}
+
+size_t ToneFrameEncoder::encodeFull(const toneState *states, uint8_t count, uint8_t *out) const {
+    uint8_t flags[TONE_MAX_CHANNELS];
+    count = min(count, (uint8_t) TONE_MAX_CHANNELS);
+    for (uint8_t i = 0; i < count; i++) {
+        flags[i] = FRAME_HAS_NAME | FRAME_HAS_COLOR;
+    }
+    return writeFrame(states, count, sequence - 1, flags, out);
+}
+
+size_t ToneFrameEncoder::writeState(const toneState &state, uint8_t flags, uint8_t *out) {
+    size_t len = 0;
+    out[len++] = state.modeIndex;
+    out[len++] = (uint16_t) state.value & 0xFF;
+    out[len++] = (uint16_t) state.value >> 8;
+
+    if (flags & FRAME_HAS_NAME) {
+        size_t nameLen = strnlen(state.name, TONE_NAME_MAX);
+        out[len++] = nameLen;
+        memcpy(out + len, state.name, nameLen);
+        len += nameLen;
+    }
+    if (flags & FRAME_HAS_COLOR) {
+        memcpy(out + len, state.color, 3);
+        len += 3;
+    }
+    return len;
+}
+
+size_t ToneFrameEncoder::writeFrame(const toneState *states, uint8_t count, uint8_t frameSequence,
+                                    const uint8_t *flags, uint8_t *out) {
+    size_t len = 0;
+    out[len++] = TONE_PROTOCOL_VERSION;
+
+    // A single state of channel 0 keeps the frame layout of single channel devices
+    if (count == 1 && states[0].channel == 0) {
+        out[len++] = flags[0];
+        out[len++] = frameSequence;
+        return len + writeState(states[0], flags[0], out + len);
+    }
+
+    out[len++] = FRAME_BATCH;
+    out[len++] = frameSequence;
+    out[len++] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        out[len++] = states[i].channel;
+        out[len++] = flags[i];
+        len += writeState(states[i], flags[i], out + len);
+    }
+    return len;
+}
+
+void ToneFrameEncoder::reset() {
+    for (bool &channel : hasLast) {
+        channel = false;
+    }
+}
@@ -0,0 +1,136 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef TONEPROTOCOL_H
+#define TONEPROTOCOL_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Version byte at the start of every binary frame.
+ */
+#define TONE_PROTOCOL_VERSION 1
+
+/**
+ * @brief Longest mode name carried in a binary frame.
+ */
+#define TONE_NAME_MAX 16
+
+/**
+ * @brief Joystick and ring channels one controller drives, see ToneController::addChannel().
+ */
+#ifndef TONE_MAX_CHANNELS
+#define TONE_MAX_CHANNELS 4
+#endif
+
+/**
+ * @brief Largest binary frame: header, value, name and color.
+ */
+#define TONE_FRAME_MAX (6 + 1 + TONE_NAME_MAX + 3)
+
+/**
+ * @brief Largest batch frame: header and count, then channel, flags, mode, value, name and color of every channel.
+ */
+#define TONE_BATCH_MAX (4 + TONE_MAX_CHANNELS * (5 + 1 + TONE_NAME_MAX + 3))
+
+/**
+ * @brief Flags of a binary frame.
+ */
+#define FRAME_HAS_NAME  0x01 ///< Frame carries the mode name
+#define FRAME_HAS_COLOR 0x02 ///< Frame carries the mode color
+#define FRAME_BATCH     0x80 ///< Frame carries a count and the states of several channels
+
+/**
+ * @brief Connection id that addresses every connected client.
+ */
+#define TONE_ALL_CLIENTS 0xFFFF
+
+/**
+ * @brief Control writes used by the host to select the notification format.
+ */
+#define FORMAT_CMD_JSON   "fmt:json"
+#define FORMAT_CMD_BINARY "fmt:bin"
+
+/**
+ * @brief Notification formats supported by the firmware.
+ */
+enum ToneFormat {
+    FORMAT_JSON,  ///< JSON object of key-value pairs (default)
+    FORMAT_BINARY ///< Compact binary frame, see ToneFrameEncoder
+};
+
+/**
+ * @brief State of the active mode of a channel as sent to the host.
+ */
+struct toneState {
+    uint8_t channel = 0;
+    uint8_t modeIndex = 0;
+    char name[TONE_NAME_MAX + 1] = ""; ///< Copy of the mode name, the registry can rename it while the state is queued
+    int16_t value = 0;
+    uint8_t color[3] = {0, 0, 0};
+};
+
+/**
+ * @brief ToneFrameEncoder builds delta encoded binary frames.
+ *
+ * Frame layout (little endian):
+ *   [version][flags][sequence][mode][value lo][value hi]
+ *   [name length][name bytes...]   if flags & FRAME_HAS_NAME
+ *   [r][g][b]                      if flags & FRAME_HAS_COLOR
+ *
+ * States of several channels, or of a channel other than 0, go out in one batch frame:
+ *   [version][FRAME_BATCH][sequence][count]
+ *   count times: [channel][flags][mode][value lo][value hi], then name and color as above
+ *
+ * Name and color are only included when they differ from the last frame of the same channel.
+ */
+class ToneFrameEncoder {
+private:
+    uint8_t sequence = 0;            ///< Sequence number of the next frame
+    char lastName[TONE_MAX_CHANNELS][TONE_NAME_MAX + 1] = {}; ///< Name carried by the last frame, per channel
+    uint8_t lastColor[TONE_MAX_CHANNELS][3] = {}; ///< Color carried by the last frame, per channel
+    bool hasLast[TONE_MAX_CHANNELS] = {}; ///< False until a full frame of the channel was encoded
+
+    // Writes mode, value and the name and color selected by FRAME_HAS_* flags
+    static size_t writeState(const toneState &state, uint8_t flags, uint8_t *out);
+
+    // Writes a frame with the given sequence number; flags[i] are the FRAME_HAS_* flags of states[i]
+    static size_t writeFrame(const toneState *states, uint8_t count, uint8_t frameSequence, const uint8_t *flags,
+                             uint8_t *out);
+
+public:
+    /**
+     * @brief Encodes a state into a frame.
+     * @param state State to encode.
+     * @param out Output buffer, at least TONE_FRAME_MAX bytes (TONE_BATCH_MAX for a channel other than 0).
+     * @return size_t Number of bytes written.
+     */
+    size_t encode(const toneState &state, uint8_t *out);
+
+    /**
+     * @brief Encodes the states of several channels into one frame, a plain frame for a single state of channel 0.
+     * @param states States to encode, at most one per channel.
+     * @param count Number of states (1 to TONE_MAX_CHANNELS).
+     * @param out Output buffer, at least TONE_BATCH_MAX bytes.
+     * @return size_t Number of bytes written.
+     */
+    size_t encode(const toneState *states, uint8_t count, uint8_t *out);
+
+    /**
+     * @brief Encodes the states of the last encode() again with name and color, under the same sequence number.
+     * Leaves the delta state alone, so a receiver that missed frames can be sent this frame instead.
+     * @param states States passed to the last encode().
+     * @param count Number of states.
+     * @param out Output buffer, at least TONE_BATCH_MAX bytes.
+     * @return size_t Number of bytes written.
+     */
+    size_t encodeFull(const toneState *states, uint8_t count, uint8_t *out) const;
+
+    /**
+     * @brief Forgets the last frame so that the next one carries name and color.
+     */
+    void reset();
+};
+
+#endif //TONEPROTOCOL_H
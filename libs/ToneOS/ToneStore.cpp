@@ -0,0 +1,70 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "ToneStore.h"
+
+static const char *STORE_NAMESPACE = "tone";
+static const char *STORE_KEY = "state";
+
+uint16_t ToneStore::checksum(const toneRecord &record) {
+    const uint8_t *bytes = (const uint8_t *) &record;
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < offsetof(toneRecord, crc); i++) {
+        crc ^= (uint16_t) bytes[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+bool ToneStore::begin(uint8_t channel) {
+    if (channel == 0) snprintf(key, sizeof(key), "%s", STORE_KEY);
+    else snprintf(key, sizeof(key), "%s%u", STORE_KEY, (unsigned) channel);
+
+    prefs.begin(STORE_NAMESPACE, false);
+    hasSaved = prefs.getBytesLength(key) == sizeof(toneRecord)
+               && prefs.getBytes(key, &saved, sizeof(toneRecord)) == sizeof(toneRecord)
+               && saved.version == STORE_VERSION
+               && saved.crc == checksum(saved);
+    return hasSaved;
+}
+
+bool ToneStore::load(toneRecord &out) const {
+    if (!hasSaved) return false;
+    out = saved;
+    return true;
+}
+
+void ToneStore::markChanged(unsigned long now) {
+    dirty = true;
+    changedAt = now;
+}
+
+bool ToneStore::isDue(unsigned long now) const {
+    return dirty && now - changedAt >= STORE_SETTLE_MS
+           && (writes == 0 || now - savedAt >= STORE_MIN_INTERVAL_MS);
+}
+
+bool ToneStore::save(toneRecord &record, unsigned long now) {
+    dirty = false;
+    record.version = STORE_VERSION;
+    record.crc = checksum(record);
+    if (hasSaved && memcmp(&record, &saved, sizeof(toneRecord)) == 0) {
+        return false;
+    }
+
+    if (prefs.putBytes(key, &record, sizeof(toneRecord)) != sizeof(toneRecord)) {
+        return false;
+    }
+    saved = record;
+    hasSaved = true;
+    savedAt = now;
+    writes++;
+    return true;
+}
+
+unsigned long ToneStore::getWrites() const {
+    return writes;
+}
@@ -0,0 +1,106 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef TONESTORE_H
+#define TONESTORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "ModeRegistry.h"
+
+/**
+ * @brief Layout version of toneRecord. Records of another version are ignored.
+ */
+#define STORE_VERSION 1
+
+/**
+ * @brief Time the state must stay unchanged before it is written, in milliseconds.
+ * A joystick sweep keeps postponing the write and costs one write after it settles.
+ */
+#define STORE_SETTLE_MS 1500
+
+/**
+ * @brief Shortest time between two flash writes in milliseconds.
+ */
+#define STORE_MIN_INTERVAL_MS 5000
+
+/**
+ * @brief Persistent state: mode values, active mode and joystick calibration.
+ */
+struct toneRecord {
+    uint8_t version; ///< STORE_VERSION
+    uint8_t currentMode; ///< Index of the active mode
+    uint16_t modeMask; ///< Bit per mode slot that has a stored value
+    int16_t values[MAX_MODES]; ///< Value of every mode slot
+    int16_t originX, originY; ///< Joystick origin (raw ADC)
+    int16_t deadZone; ///< Joystick dead zone (raw ADC)
+    uint16_t crc; ///< CRC-16/CCITT of all fields above
+};
+
+static_assert(MAX_MODES <= 16, "modeMask holds one bit per mode slot");
+
+/**
+ * @brief ToneStore keeps the toneRecord of a channel in NVS (Preferences) and limits flash wear.
+ * Changes are only marked; the record is written once the state has settled for STORE_SETTLE_MS,
+ * at most every STORE_MIN_INTERVAL_MS, and not at all if it equals the record already on flash.
+ */
+class ToneStore {
+private:
+    Preferences prefs; ///< NVS namespace of the store
+    char key[8] = {}; ///< NVS key of the record, one per channel
+    toneRecord saved = {}; ///< Record currently on flash
+    bool hasSaved = false; ///< saved holds a valid record
+    bool dirty = false; ///< State changed since the last save()
+    unsigned long changedAt = 0; ///< millis() of the last markChanged()
+    unsigned long savedAt = 0; ///< millis() of the last flash write
+    unsigned long writes = 0; ///< Flash writes since begin()
+
+    /**
+     * @brief CRC-16/CCITT (poly 0x1021, init 0xFFFF) of a record without its crc field.
+     */
+    static uint16_t checksum(const toneRecord &record);
+
+public:
+    /**
+     * @brief Opens the NVS namespace and reads the stored record.
+     * @param channel Channel whose record is kept; channel 0 uses the key of single channel devices.
+     * @return true if a valid record was found.
+     */
+    bool begin(uint8_t channel = 0);
+
+    /**
+     * @brief Returns the record read by begin() or written by save().
+     * @param out Receives the record.
+     * @return true if the record is valid (version and CRC match).
+     */
+    bool load(toneRecord &out) const;
+
+    /**
+     * @brief Marks the state as changed, restarting the settle time.
+     * @param now Current millis() timestamp.
+     */
+    void markChanged(unsigned long now);
+
+    /**
+     * @brief Checks if a marked change has settled and the write interval has passed.
+     * @param now Current millis() timestamp.
+     */
+    bool isDue(unsigned long now) const;
+
+    /**
+     * @brief Writes a record unless it equals the one on flash, and clears the change mark.
+     * Sets version and crc. Blocks for the duration of the NVS write.
+     * @param record Record to write.
+     * @param now Current millis() timestamp.
+     * @return true if the record was written.
+     */
+    bool save(toneRecord &record, unsigned long now);
+
+    /**
+     * @brief Returns the number of flash writes since begin().
+     */
+    unsigned long getWrites() const;
+};
+
+#endif //TONESTORE_H
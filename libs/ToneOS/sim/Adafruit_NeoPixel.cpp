@@ -0,0 +1,60 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "Adafruit_NeoPixel.h"
+#include "SimHal.h"
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t pin, neoPixelType type) : pixels(n, 0), pin(pin) {
+}
+
+void Adafruit_NeoPixel::begin() {
+}
+
+void Adafruit_NeoPixel::show() {
+    SimHal &hal = SimHal::instance();
+    hal.recordFrame(pin, brightness, pixels.data(), pixels.size());
+    // The real driver blocks with interrupts disabled for the whole transfer
+    hal.advance(pixels.size() * SIM_PIXEL_US + SIM_PIXEL_LATCH_US);
+}
+
+void Adafruit_NeoPixel::setPin(int16_t p) {
+    pin = p;
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+    setPixelColor(n, Color(r, g, b));
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
+    if (n < pixels.size()) pixels[n] = c & 0xFFFFFF;
+}
+
+void Adafruit_NeoPixel::fill(uint32_t c, uint16_t first, uint16_t count) {
+    uint16_t end = count ? min<size_t>(first + count, pixels.size()) : pixels.size();
+    for (uint16_t i = first; i < end; i++) pixels[i] = c & 0xFFFFFF;
+}
+
+void Adafruit_NeoPixel::setBrightness(uint8_t b) {
+    brightness = b;
+}
+
+void Adafruit_NeoPixel::clear() {
+    std::fill(pixels.begin(), pixels.end(), 0);
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
+    return n < pixels.size() ? pixels[n] : 0;
+}
+
+uint8_t Adafruit_NeoPixel::getBrightness() const {
+    return brightness;
+}
+
+uint16_t Adafruit_NeoPixel::numPixels() const {
+    return pixels.size();
+}
+
+int16_t Adafruit_NeoPixel::getPin() const {
+    return pin;
+}
@@ -0,0 +1,45 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Host replacement for Adafruit_NeoPixel, frames are recorded by SimHal.
+//
+
+#ifndef ADAFRUIT_NEOPIXEL_H
+#define ADAFRUIT_NEOPIXEL_H
+
+#include "Arduino.h"
+#include <vector>
+
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+
+typedef uint16_t neoPixelType;
+
+class Adafruit_NeoPixel {
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+
+    void begin();
+    void show();
+    void setPin(int16_t p);
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setPixelColor(uint16_t n, uint32_t c);
+    void fill(uint32_t c = 0, uint16_t first = 0, uint16_t count = 0);
+    void setBrightness(uint8_t b);
+    void clear();
+    uint32_t getPixelColor(uint16_t n) const;
+    uint8_t getBrightness() const;
+    uint16_t numPixels() const;
+    int16_t getPin() const;
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+        return ((uint32_t) r << 16) | ((uint32_t) g << 8) | b;
+    }
+
+private:
+    std::vector<uint32_t> pixels;
+    int16_t pin;
+    uint8_t brightness = 255;
+};
+
+#endif // ADAFRUIT_NEOPIXEL_H
@@ -0,0 +1,110 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "Arduino.h"
+#include "SimHal.h"
+#include <cstdarg>
+
+HardwareSerial Serial;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+int digitalRead(uint8_t pin) {
+    return SimHal::instance().digitalRead(pin);
+}
+
+uint16_t analogRead(uint8_t pin) {
+    return SimHal::instance().analogRead(pin);
+}
+
+unsigned long millis() {
+    return SimHal::instance().millis();
+}
+
+unsigned long micros() {
+    return SimHal::instance().micros();
+}
+
+void delay(uint32_t ms) {
+    SimHal::instance().advance(ms * 1000UL);
+}
+
+void delayMicroseconds(uint32_t us) {
+    SimHal::instance().advance(us);
+}
+
+int digitalPinToInterrupt(uint8_t pin) {
+    return pin;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    SimHal::instance().attachInterrupt(pin, isr, mode);
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode) {
+    SimHal::instance().attachInterruptArg(pin, isr, arg, mode);
+}
+
+void detachInterrupt(uint8_t pin) {
+    SimHal::instance().detachInterrupt(pin);
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t length) {
+    SimHal::instance().recordSerial((const char *) data, length);
+    return length;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::print(const char *text) {
+    return write((const uint8_t *) text, strlen(text));
+}
+
+size_t HardwareSerial::print(const String &text) {
+    return print(text.c_str());
+}
+
+size_t HardwareSerial::print(long value) {
+    return printf("%ld", value);
+}
+
+size_t HardwareSerial::println(const char *text) {
+    return print(text) + println();
+}
+
+size_t HardwareSerial::println(const String &text) {
+    return println(text.c_str());
+}
+
+size_t HardwareSerial::println(long value) {
+    return print(value) + println();
+}
+
+size_t HardwareSerial::println() {
+    return print("\r\n");
+}
+
+size_t HardwareSerial::printf(const char *format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write((const uint8_t *) buffer, min((size_t) length, sizeof(buffer) - 1));
+}
+
+int HardwareSerial::available() {
+    return SimHal::instance().serialAvailable();
+}
+
+int HardwareSerial::read() {
+    return SimHal::instance().serialRead();
+}
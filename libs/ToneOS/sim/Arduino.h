@@ -0,0 +1,114 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Host replacement for the ESP32 Arduino core header, backed by SimHal.
+//
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using std::abs;
+using std::max;
+using std::min;
+using ::round;
+
+#define LOW     0x0
+#define HIGH    0x1
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+#define CHANGE  0x03
+
+#define PI 3.1415926535897932384626433832795
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define IRAM_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef int esp_err_t;
+typedef uint32_t TickType_t;
+
+#define ESP_OK   0
+#define ESP_FAIL -1
+
+#define portMAX_DELAY 0xFFFFFFFF
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+/**
+ * @brief Minimal Arduino String on top of std::string.
+ */
+class String : public std::string {
+public:
+    String() = default;
+    String(const char *text) : std::string(text ? text : "") {}
+    String(const std::string &text) : std::string(text) {}
+    explicit String(char c) : std::string(1, c) {}
+    String(int value) : std::string(std::to_string(value)) {}
+    String(unsigned int value) : std::string(std::to_string(value)) {}
+    String(long value) : std::string(std::to_string(value)) {}
+    String(unsigned long value) : std::string(std::to_string(value)) {}
+    String(unsigned char value) : std::string(std::to_string(value)) {}
+
+    int toInt() const { return atoi(c_str()); }
+};
+
+inline String operator+(const String &a, const String &b) {
+    return String(static_cast<const std::string &>(a) + static_cast<const std::string &>(b));
+}
+
+inline String operator+(const String &a, const char *b) {
+    return String(static_cast<const std::string &>(a) + b);
+}
+
+inline String operator+(const char *a, const String &b) {
+    return String(a + static_cast<const std::string &>(b));
+}
+
+/**
+ * @brief Serial port, output is recorded by SimHal.
+ */
+class HardwareSerial {
+public:
+    void begin(unsigned long baud);
+    size_t write(const uint8_t *data, size_t length);
+    size_t write(uint8_t c);
+    size_t print(const char *text);
+    size_t print(const String &text);
+    size_t print(long value);
+    size_t println(const char *text);
+    size_t println(const String &text);
+    size_t println(long value);
+    size_t println();
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    int available();
+    int read();
+};
+
+extern HardwareSerial Serial;
+
+#endif // Arduino_h
@@ -0,0 +1,10 @@
+// Host replacement for the Client Characteristic Configuration descriptor
+#ifndef BLE2902_H_
+#define BLE2902_H_
+
+#include "BLEDevice.h"
+
+class BLE2902 : public BLEDescriptor {
+};
+
+#endif // BLE2902_H_
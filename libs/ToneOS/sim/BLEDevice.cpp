@@ -0,0 +1,244 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "BLEDevice.h"
+#include "SimHal.h"
+
+BLECharacteristic::BLECharacteristic(const char *uuid, uint32_t properties) : uuid(uuid), properties(properties) {
+    handle = SimHal::instance().registerCharacteristic(this);
+}
+
+void BLECharacteristic::setValue(uint8_t *data, size_t size) {
+    value.assign((const char *) data, size);
+}
+
+void BLECharacteristic::setValue(const std::string &value) {
+    this->value = value;
+}
+
+std::string BLECharacteristic::getValue() {
+    return value;
+}
+
+uint8_t *BLECharacteristic::getData() {
+    return (uint8_t *) value.data();
+}
+
+size_t BLECharacteristic::getLength() {
+    return value.size();
+}
+
+void BLECharacteristic::notify(bool is_notification) {
+    // Like the ESP32 library: every connection, truncated to its MTU
+    SimHal::instance().recordNotify((const uint8_t *) value.data(), value.size(), handle);
+}
+
+void BLECharacteristic::indicate() {
+    notify(false);
+}
+
+void BLECharacteristic::addDescriptor(BLEDescriptor *descriptor) {
+    descriptors.push_back(descriptor);
+}
+
+void BLECharacteristic::setCallbacks(BLECharacteristicCallbacks *callbacks) {
+    this->callbacks = callbacks;
+}
+
+BLECharacteristicCallbacks *BLECharacteristic::getCallbacks() const {
+    return callbacks;
+}
+
+const std::string &BLECharacteristic::getUUID() const {
+    return uuid;
+}
+
+uint32_t BLECharacteristic::getProperties() const {
+    return properties;
+}
+
+uint16_t BLECharacteristic::getHandle() {
+    return handle;
+}
+
+const std::vector<BLEDescriptor *> &BLECharacteristic::getDescriptors() const {
+    return descriptors;
+}
+
+BLEDescriptor::BLEDescriptor() {
+    handle = SimHal::instance().registerDescriptor();
+}
+
+uint16_t BLEDescriptor::getHandle() {
+    return handle;
+}
+
+BLEService::BLEService(const char *uuid) : uuid(uuid) {
+}
+
+BLECharacteristic *BLEService::createCharacteristic(const char *uuid, uint32_t properties) {
+    return new BLECharacteristic(uuid, properties);
+}
+
+void BLEService::start() {
+}
+
+void BLEAdvertising::addServiceUUID(const char *uuid) {
+}
+
+void BLEAdvertising::setScanResponse(bool scanResponse) {
+}
+
+void BLEAdvertising::setMinPreferred(uint16_t interval) {
+}
+
+void BLEAdvertising::setMinInterval(uint16_t interval) {
+    minInterval = interval;
+}
+
+void BLEAdvertising::setMaxInterval(uint16_t interval) {
+    maxInterval = interval;
+}
+
+void BLEAdvertising::start() {
+    SimHal::instance().setAdvertising(true);
+}
+
+void BLEAdvertising::stop() {
+    SimHal::instance().setAdvertising(false);
+}
+
+uint16_t BLEAdvertising::getMinInterval() const {
+    return minInterval;
+}
+
+uint16_t BLEAdvertising::getMaxInterval() const {
+    return maxInterval;
+}
+
+BLEServer::BLEServer() {
+    SimHal::instance().registerServer(this);
+}
+
+void BLEServer::setCallbacks(BLEServerCallbacks *callbacks) {
+    this->callbacks = callbacks;
+}
+
+BLEServerCallbacks *BLEServer::getCallbacks() const {
+    return callbacks;
+}
+
+BLEService *BLEServer::createService(const char *uuid) {
+    return new BLEService(uuid);
+}
+
+BLEAdvertising *BLEServer::getAdvertising() {
+    return BLEDevice::getAdvertising();
+}
+
+void BLEServer::startAdvertising() {
+    BLEDevice::startAdvertising();
+}
+
+uint16_t BLEServer::getConnId() {
+    return connId;
+}
+
+uint32_t BLEServer::getConnectedCount() {
+    return peers.size();
+}
+
+uint16_t BLEServer::getPeerMTU(uint16_t connId) {
+    auto peer = peers.find(connId);
+    return peer == peers.end() ? 23 : peer->second;
+}
+
+uint16_t BLEServer::getGattsIf() {
+    return 3;
+}
+
+void BLEServer::disconnect(uint16_t connId) {
+    simDisconnect(connId);
+}
+
+void BLEServer::simConnect(uint16_t connId, uint16_t interval) {
+    if (isPeer(connId)) return;
+    this->connId = connId;
+    peers[connId] = 23;
+    // The stack stops advertising when a client connects
+    SimHal::instance().setAdvertising(false);
+    if (callbacks == nullptr) return;
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.connect.conn_id = connId;
+    param.connect.conn_params.interval = interval;
+    callbacks->onConnect(this);
+    callbacks->onConnect(this, &param);
+}
+
+void BLEServer::simDisconnect(uint16_t connId) {
+    if (!isPeer(connId)) return;
+    peers.erase(connId);
+    if (callbacks == nullptr) return;
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.disconnect.conn_id = connId;
+    callbacks->onDisconnect(this);
+    callbacks->onDisconnect(this, &param);
+}
+
+void BLEServer::simMtuChanged(uint16_t connId, uint16_t mtu) {
+    if (!isPeer(connId)) return;
+    peers[connId] = mtu;
+    if (callbacks == nullptr) return;
+
+    esp_ble_gatts_cb_param_t param = {};
+    param.mtu.conn_id = connId;
+    param.mtu.mtu = mtu;
+    callbacks->onMtuChanged(this, &param);
+}
+
+bool BLEServer::isPeer(uint16_t connId) const {
+    return peers.count(connId) > 0;
+}
+
+uint16_t BLEDevice::localMtu = 23;
+gatts_event_handler BLEDevice::m_customGattsHandler = nullptr;
+
+void BLEDevice::init(const std::string &deviceName) {
+}
+
+BLEServer *BLEDevice::createServer() {
+    return new BLEServer();
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() {
+    static BLEAdvertising advertising;
+    return &advertising;
+}
+
+void BLEDevice::startAdvertising() {
+    getAdvertising()->start();
+}
+
+void BLEDevice::stopAdvertising() {
+    getAdvertising()->stop();
+}
+
+void BLEDevice::setMTU(uint16_t mtu) {
+    localMtu = mtu;
+}
+
+uint16_t BLEDevice::getMTU() {
+    return localMtu;
+}
+
+void BLEDevice::setCustomGattsHandler(gatts_event_handler handler) {
+    m_customGattsHandler = handler;
+}
+
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm) {
+    return SimHal::instance().sendNotify(conn_id, value, value_len, attr_handle) ? ESP_OK : ESP_FAIL;
+}
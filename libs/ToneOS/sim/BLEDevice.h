@@ -0,0 +1,212 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Host replacement for the ESP32 BLE library, traffic is recorded by SimHal.
+//
+
+#ifndef BLEDEVICE_H_
+#define BLEDEVICE_H_
+
+#include "Arduino.h"
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Subset of the GATT server event parameters passed to the server callbacks.
+ */
+typedef uint8_t esp_gatt_if_t;
+
+typedef union {
+    struct {
+        uint16_t conn_id;
+        uint8_t link_role;
+        uint8_t remote_bda[6];
+        struct {
+            uint16_t interval;
+            uint16_t latency;
+            uint16_t timeout;
+        } conn_params;
+    } connect;
+    struct {
+        uint16_t conn_id;
+        uint8_t remote_bda[6];
+        int reason;
+    } disconnect;
+    struct {
+        uint16_t conn_id;
+        uint16_t mtu;
+    } mtu;
+    struct {
+        uint16_t conn_id;
+        uint32_t trans_id;
+        uint16_t handle;
+        uint16_t offset;
+        bool need_rsp;
+        bool is_prep;
+        uint16_t len;
+        uint8_t *value;
+    } write;
+} esp_ble_gatts_cb_param_t;
+
+/**
+ * @brief GATT server events, the subset a custom handler sees in the simulator.
+ */
+typedef enum {
+    ESP_GATTS_READ_EVT = 1,
+    ESP_GATTS_WRITE_EVT = 2,
+    ESP_GATTS_CONNECT_EVT = 14,
+    ESP_GATTS_DISCONNECT_EVT = 15
+} esp_gatts_cb_event_t;
+
+typedef void (*gatts_event_handler)(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                                    esp_ble_gatts_cb_param_t *param);
+
+/**
+ * @brief Notifies (or indicates) one connection, as the GATT server API does. Recorded by SimHal,
+ * which refuses values longer than the connection's MTU allows and packets beyond its link capacity.
+ */
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm);
+
+class BLECharacteristic;
+class BLEServer;
+
+class BLEDescriptor {
+public:
+    BLEDescriptor();
+    virtual ~BLEDescriptor() = default;
+    uint16_t getHandle();
+
+private:
+    uint16_t handle;
+};
+
+class BLECharacteristicCallbacks {
+public:
+    virtual ~BLECharacteristicCallbacks() = default;
+    virtual void onRead(BLECharacteristic *pCharacteristic) {}
+    virtual void onWrite(BLECharacteristic *pCharacteristic, esp_ble_gatts_cb_param_t *param) { onWrite(pCharacteristic); }
+    virtual void onWrite(BLECharacteristic *pCharacteristic) {}
+};
+
+class BLECharacteristic {
+public:
+    static const uint32_t PROPERTY_READ = 1 << 0;
+    static const uint32_t PROPERTY_WRITE = 1 << 1;
+    static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+    static const uint32_t PROPERTY_BROADCAST = 1 << 3;
+    static const uint32_t PROPERTY_INDICATE = 1 << 4;
+    static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+    BLECharacteristic(const char *uuid, uint32_t properties);
+
+    void setValue(uint8_t *data, size_t size);
+    void setValue(const std::string &value);
+    std::string getValue();
+    uint8_t *getData();
+    size_t getLength();
+    void notify(bool is_notification = true);
+    void indicate();
+    void addDescriptor(BLEDescriptor *descriptor);
+    void setCallbacks(BLECharacteristicCallbacks *callbacks);
+    BLECharacteristicCallbacks *getCallbacks() const;
+    const std::string &getUUID() const;
+    uint32_t getProperties() const;
+    uint16_t getHandle();
+
+    // Simulator side, for client writes to the descriptors
+    const std::vector<BLEDescriptor *> &getDescriptors() const;
+
+private:
+    std::string uuid;
+    uint16_t handle;
+    uint32_t properties;
+    std::string value;
+    std::vector<BLEDescriptor *> descriptors;
+    BLECharacteristicCallbacks *callbacks = nullptr;
+};
+
+class BLEService {
+public:
+    explicit BLEService(const char *uuid);
+    BLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties);
+    void start();
+
+private:
+    std::string uuid;
+};
+
+class BLEAdvertising {
+public:
+    void addServiceUUID(const char *uuid);
+    void setScanResponse(bool scanResponse);
+    void setMinPreferred(uint16_t interval);
+    void setMinInterval(uint16_t interval);
+    void setMaxInterval(uint16_t interval);
+    void start();
+    void stop();
+
+    uint16_t getMinInterval() const;
+    uint16_t getMaxInterval() const;
+
+private:
+    uint16_t minInterval = 0x20;
+    uint16_t maxInterval = 0x40;
+};
+
+class BLEServerCallbacks {
+public:
+    virtual ~BLEServerCallbacks() = default;
+    virtual void onConnect(BLEServer *pServer) {}
+    virtual void onConnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {}
+    virtual void onDisconnect(BLEServer *pServer) {}
+    virtual void onDisconnect(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {}
+    virtual void onMtuChanged(BLEServer *pServer, esp_ble_gatts_cb_param_t *param) {}
+};
+
+class BLEServer {
+public:
+    BLEServer();
+
+    void setCallbacks(BLEServerCallbacks *callbacks);
+    BLEServerCallbacks *getCallbacks() const;
+    BLEService *createService(const char *uuid);
+    BLEAdvertising *getAdvertising();
+    void startAdvertising();
+    uint16_t getConnId();
+    uint32_t getConnectedCount();
+    uint16_t getPeerMTU(uint16_t connId);
+    uint16_t getGattsIf();
+    void disconnect(uint16_t connId);
+
+    // Simulator side of the connection handling
+    void simConnect(uint16_t connId, uint16_t interval);
+    void simDisconnect(uint16_t connId);
+    void simMtuChanged(uint16_t connId, uint16_t mtu);
+    bool isPeer(uint16_t connId) const;
+
+private:
+    BLEServerCallbacks *callbacks = nullptr;
+    std::map<uint16_t, uint16_t> peers;  // Connection id to MTU
+    uint16_t connId = 0;
+};
+
+class BLEDevice {
+public:
+    static void init(const std::string &deviceName);
+    static BLEServer *createServer();
+    static BLEAdvertising *getAdvertising();
+    static void startAdvertising();
+    static void stopAdvertising();
+    static void setMTU(uint16_t mtu);
+    static uint16_t getMTU();
+    static void setCustomGattsHandler(gatts_event_handler handler);  // Sees every GATT server event first
+
+    static gatts_event_handler m_customGattsHandler;
+
+private:
+    static uint16_t localMtu;
+};
+
+#endif // BLEDEVICE_H_
@@ -0,0 +1,2 @@
+// Host replacement, all BLE classes are declared in BLEDevice.h
+#include "BLEDevice.h"
@@ -0,0 +1,208 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "EventReplay.h"
+#include "SimHal.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+bool parseLogDump(const std::string &text, eventLog &out) {
+    out = eventLog();
+    std::istringstream lines(text);
+    std::string line;
+    bool header = false;
+    unsigned long size = 0;
+
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.compare(0, 5, "#log ") == 0) {
+            // Dumps from before channel tagging end after the dropped count and start on channel 0
+            unsigned channel = 0;
+            int fields = sscanf(line.c_str(), "#log %lu %lu %lu %u", &out.start, &size, &out.dropped, &channel);
+            header = fields >= 3;
+            out.channel = channel;
+            out.bytes.clear();
+            continue;
+        }
+        if (!header || line.size() < 2 || line[0] != '#') continue;
+        if (line == "#end") break;
+
+        char *end;
+        unsigned long offset = strtoul(line.c_str() + 1, &end, 16);
+        if (*end != ' ' || offset != out.bytes.size()) return false;
+        for (const char *p = end + 1; p[0] != '\0' && p[1] != '\0'; p += 2) {
+            char hex[3] = {p[0], p[1], '\0'};
+            out.bytes.push_back((uint8_t) strtoul(hex, nullptr, 16));
+        }
+    }
+    return header && out.bytes.size() == size;
+}
+
+bool decodeEventLog(const eventLog &log, std::vector<recordEntry> &out) {
+    out.clear();
+    size_t offset = 0;
+    unsigned long time = log.start;
+    uint8_t channel = log.channel;
+    recordEntry entry;
+    while (EventRecorder::decode(log.bytes.data(), log.bytes.size(), offset, time, channel, entry)) {
+        out.push_back(entry);
+    }
+    return offset == log.bytes.size();
+}
+
+/**
+ * @brief Mode and value changes of channel 0 in a decoded log, from the given record on.
+ */
+static std::vector<recordEntry> changesOf(const std::vector<recordEntry> &events, size_t from) {
+    std::vector<recordEntry> changes;
+    for (size_t i = from; i < events.size(); i++) {
+        if (events[i].channel != 0) continue;
+        if (events[i].type == REC_MODE || events[i].type == REC_VALUE) changes.push_back(events[i]);
+    }
+    return changes;
+}
+
+/**
+ * @brief Sum of the REC_NOTIFY counts of a decoded log, from the given record on.
+ */
+static unsigned long notifiesOf(const std::vector<recordEntry> &events, size_t from) {
+    unsigned long count = 0;
+    for (size_t i = from; i < events.size(); i++) {
+        if (events[i].type == REC_NOTIFY) count += events[i].args[0];
+    }
+    return count;
+}
+
+/**
+ * @brief Same kind and value.
+ */
+static bool sameChange(const recordEntry &a, const recordEntry &b) {
+    return a.type == b.type && a.args[0] == b.args[0];
+}
+
+/**
+ * @brief Aligns two change sequences by their longest common subsequence, so one missing change
+ * counts once instead of shifting everything after it.
+ * @return Changes that are not in both sequences. maxSkewMs is raised to the largest time difference of an aligned pair.
+ */
+static size_t diffChanges(const std::vector<recordEntry> &expected, const std::vector<recordEntry> &actual,
+                          unsigned long shift, long &maxSkewMs) {
+    size_t n = expected.size(), m = actual.size();
+    std::vector<uint16_t> common((n + 1) * (m + 1), 0);
+    for (size_t i = n; i-- > 0;) {
+        for (size_t j = m; j-- > 0;) {
+            common[i * (m + 1) + j] = sameChange(expected[i], actual[j])
+                                      ? common[(i + 1) * (m + 1) + j + 1] + 1
+                                      : max(common[(i + 1) * (m + 1) + j], common[i * (m + 1) + j + 1]);
+        }
+    }
+
+    size_t i = 0, j = 0;
+    while (i < n && j < m) {
+        if (sameChange(expected[i], actual[j])) {
+            maxSkewMs = max(maxSkewMs, labs((long) (actual[j].time - shift - expected[i].time)));
+            i++;
+            j++;
+        } else if (common[(i + 1) * (m + 1) + j] >= common[i * (m + 1) + j + 1]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    return n + m - 2 * common[0];
+}
+
+replayResult replayEventLog(const std::vector<recordEntry> &events, ToneController &tone, uint8_t xPin, uint8_t yPin,
+                            uint8_t swPin, unsigned long tickUs) {
+    SimHal &hal = SimHal::instance();
+    replayResult result;
+
+    size_t first = 0;
+    while (first < events.size() && (events[first].type != REC_KEYFRAME || events[first].channel != 0)) first++;
+    if (first == events.size()) return result;
+    result.keyframe = true;
+
+    // Start from the keyframe: stick where the filter had it, button at its debounced level
+    const recordEntry &key = events[first];
+    hal.setAdcNoise(0);
+    hal.setAnalog(xPin, key.args[6]);
+    hal.setAnalog(yPin, key.args[7]);
+    hal.setDigital(swPin, key.button.pressed ? LOW : HIGH);
+    if (key.args[5] && !hal.isConnected()) hal.connect();
+    tone.update();
+
+    // Replay time = recorded time + shift
+    unsigned long shift = hal.millis() - key.time;
+    recordEntry start = key;
+    start.button.since += shift;
+    tone.applyKeyframe(start);
+    tone.update();
+    hal.advance(tickUs);
+    tone.getRecorder().clear();
+    unsigned long notifiesBefore = tone.getBluetooth()->getNotifyCount();
+
+    for (size_t i = first + 1; i < events.size(); i++) {
+        const recordEntry &event = events[i];
+        if (event.channel != 0) continue;
+        while ((long) (hal.millis() - (event.time + shift)) < 0) {
+            tone.update();
+            hal.advance(tickUs);
+        }
+
+        result.events++;
+        switch (event.type) {
+            case REC_SAMPLE:
+                hal.setAnalog(xPin, event.args[0]);
+                hal.setAnalog(yPin, event.args[1]);
+                break;
+            case REC_BUTTON:
+                hal.setDigital(swPin, event.args[0] ? LOW : HIGH);
+                break;
+            case REC_CONNECT:
+                hal.connect();
+                break;
+            case REC_DISCONNECT:
+                hal.disconnect();
+                break;
+            case REC_COMMAND:
+                if (event.args[0] == CMD_VALUE) {
+                    hal.serialInput(CMD_SET_VALUE + std::to_string(event.args[1]) + "\n");
+                } else if (event.args[0] == CMD_MODE) {
+                    hal.serialInput(CMD_SET_MODE + std::to_string(event.args[1]) + "\n");
+                } else if (event.args[0] != CMD_GET && event.args[0] != CMD_LOG && event.args[0] != CMD_INVALID
+                           && event.args[0] != CMD_METRICS && event.args[0] != CMD_METRICS_RESET
+                           && event.args[0] != CMD_FORMAT) {
+                    result.skippedCommands++;
+                }
+                break;
+            default:
+                result.events--;
+                break;
+        }
+    }
+    for (unsigned long end = hal.millis() + 2 * SAMPLE_INTERVAL_MS; hal.millis() < end;) {
+        tone.update();
+        hal.advance(tickUs);
+    }
+
+    // Compare with what the replayed controller recorded itself
+    const EventRecorder &recorder = tone.getRecorder();
+    eventLog replayed;
+    replayed.start = recorder.startTime();
+    replayed.bytes.resize(recorder.size());
+    recorder.read(0, replayed.bytes.data(), replayed.bytes.size());
+    std::vector<recordEntry> replayedEvents;
+    decodeEventLog(replayed, replayedEvents);
+
+    std::vector<recordEntry> expected = changesOf(events, first + 1);
+    std::vector<recordEntry> actual = changesOf(replayedEvents, 0);
+    result.expected = expected.size();
+    result.replayed = actual.size();
+    result.mismatches = diffChanges(expected, actual, shift, result.maxSkewMs);
+    result.notifies = notifiesOf(events, first + 1);
+    result.replayedNotifies = tone.getBluetooth()->getNotifyCount() - notifiesBefore;
+    return result;
+}
@@ -0,0 +1,64 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef EVENTREPLAY_H
+#define EVENTREPLAY_H
+
+#include "ToneController.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief An event log copied from a dump.
+ */
+struct eventLog {
+    unsigned long start = 0;    ///< millis() of the oldest record
+    unsigned long dropped = 0;  ///< Records the device had overwritten before the dump
+    uint8_t channel = 0;        ///< Channel in effect at the oldest record
+    std::vector<uint8_t> bytes; ///< Log bytes, oldest first
+};
+
+/**
+ * @brief Outcome of replaying a log into a controller.
+ */
+struct replayResult {
+    bool keyframe = false;         ///< The log has a keyframe to start from
+    size_t events = 0;             ///< Records fed into the controller
+    size_t expected = 0;           ///< Mode and value changes in the log after the keyframe
+    size_t replayed = 0;           ///< Mode and value changes made by the replayed controller
+    size_t mismatches = 0;         ///< Changes missing from either side once both are aligned
+    long maxSkewMs = 0;            ///< Largest time difference of aligned changes
+    size_t skippedCommands = 0;    ///< Commands whose arguments are not in the log (cfg, mode+, mode-)
+    unsigned long notifies = 0;    ///< Notifications in the log after the keyframe
+    unsigned long replayedNotifies = 0; ///< Notifications sent by the replayed controller
+};
+
+/**
+ * @brief Parses the text of a log dump (`#log <start> <size> <dropped> <channel>`, `#<offset> <hex>` lines, `#end`).
+ * Other lines, such as acknowledgements, are skipped.
+ * @return false if the header is missing, a line is out of order or the size does not match.
+ */
+bool parseLogDump(const std::string &text, eventLog &out);
+
+/**
+ * @brief Decodes all records of a log.
+ * @return false if the log ends with a truncated or unknown record, out holds the records before it.
+ */
+bool decodeEventLog(const eventLog &log, std::vector<recordEntry> &out);
+
+/**
+ * @brief Feeds the channel 0 records of a log into a booted controller through SimHal, starting at its
+ * first keyframe: joystick samples become ADC values, button records pin levels, connection records client
+ * connects, and value and mode commands Serial lines. Then compares the mode and value changes
+ * the controller records on channel 0 with the ones in the log.
+ * @param events Decoded log.
+ * @param tone Controller configured with the modes of the recording device, update() is called every tick.
+ * @param xPin, yPin, swPin Joystick pins of the controller.
+ * @param tickUs Simulated time between two update() calls.
+ */
+replayResult replayEventLog(const std::vector<recordEntry> &events, ToneController &tone, uint8_t xPin, uint8_t yPin,
+                            uint8_t swPin, unsigned long tickUs = 1000);
+
+#endif //EVENTREPLAY_H
@@ -0,0 +1,2 @@
+// Host replacement, Serial is declared in Arduino.h
+#include "Arduino.h"
@@ -0,0 +1,57 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "Preferences.h"
+#include "SimHal.h"
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel) {
+    SimHal::Recording shim;  // The namespace, key and value strings are the simulator's, not the firmware's
+    ns = name;
+    started = true;
+    this->readOnly = readOnly;
+    return true;
+}
+
+void Preferences::end() {
+    started = false;
+}
+
+std::string Preferences::flashKey(const char *key) const {
+    return ns + "/" + key;
+}
+
+bool Preferences::remove(const char *key) {
+    SimHal::Recording shim;
+    if (!started || readOnly) return false;
+    SimHal::instance().flashErase(flashKey(key));
+    return true;
+}
+
+bool Preferences::isKey(const char *key) {
+    SimHal::Recording shim;
+    std::string value;
+    return started && SimHal::instance().flashRead(flashKey(key), value);
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    SimHal::Recording shim;
+    if (!started || readOnly || value == nullptr) return 0;
+    SimHal::instance().flashWrite(flashKey(key), std::string((const char *) value, len));
+    return len;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    SimHal::Recording shim;
+    std::string value;
+    if (!started || !SimHal::instance().flashRead(flashKey(key), value)) return 0;
+    return value.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    SimHal::Recording shim;
+    std::string value;
+    if (!started || !SimHal::instance().flashRead(flashKey(key), value) || value.size() > maxLen) return 0;
+    memcpy(buf, value.data(), value.size());
+    return value.size();
+}
@@ -0,0 +1,32 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Host replacement for the ESP32 Preferences (NVS) library, backed by the SimHal flash.
+//
+
+#ifndef Preferences_h
+#define Preferences_h
+
+#include "Arduino.h"
+
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+    void end();
+
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putBytes(const char *key, const void *value, size_t len);
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+    std::string flashKey(const char *key) const;
+
+    std::string ns;
+    bool started = false;
+    bool readOnly = false;
+};
+
+#endif // Preferences_h
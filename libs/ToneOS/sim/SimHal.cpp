@@ -0,0 +1,463 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "SimHal.h"
+#include "Arduino.h"
+#include "BLEDevice.h"
+#include <fstream>
+#include <sstream>
+
+SimHal &SimHal::instance() {
+    static SimHal hal;
+    return hal;
+}
+
+void SimHal::reset() {
+    timeUs = 0;
+    for (int i = 0; i < 64; i++) {
+        analogSet[i] = false;
+        digitalSet[i] = false;
+        isrs[i] = nullptr;
+        argIsrs[i] = nullptr;
+    }
+    analogReadCount = 0;
+    noise = 0;
+    noiseState = 1;
+    trace.clear();
+    traceIndex = 0;
+    serialPending.clear();
+    serialPendingIndex = 0;
+    clearRecordings();
+    servers.clear();
+    characteristics.clear();
+    attributeCount = 0;
+    BLEDevice::setCustomGattsHandler(nullptr);
+    links.clear();
+    advertising = false;
+    for (SimRmtChannel &channel : rmt) {
+        channel = SimRmtChannel();
+    }
+    rmtEnd = nullptr;
+    rmtEndArg = nullptr;
+    rmtBadSymbolCount = 0;
+}
+
+unsigned long SimHal::micros() const {
+    return timeUs;
+}
+
+unsigned long SimHal::millis() const {
+    return timeUs / 1000;
+}
+
+void SimHal::advance(unsigned long us) {
+    unsigned long target = timeUs + us;
+    // Apply due events at their own time, so interrupt handlers see the time of the edge
+    for (;;) {
+        unsigned long rmtAt;
+        int channel = nextRmtEnd(rmtAt);
+        bool traceDue = traceIndex < trace.size() && trace[traceIndex].time * 1000UL <= target;
+        bool rmtDue = channel >= 0 && rmtAt <= target;
+        if (rmtDue && (!traceDue || rmtAt <= trace[traceIndex].time * 1000UL)) {
+            timeUs = max(timeUs, rmtAt);
+            rmt[channel].sending = false;
+            if (rmtEnd != nullptr) rmtEnd(channel, rmtEndArg);
+        } else if (traceDue) {
+            timeUs = max(timeUs, trace[traceIndex].time * 1000UL);
+            applyTrace();
+        } else {
+            break;
+        }
+    }
+    timeUs = target;
+}
+
+void SimHal::setAnalog(uint8_t pin, int value) {
+    analogPins[pin & 63] = value;
+    analogSet[pin & 63] = true;
+}
+
+void SimHal::setDigital(uint8_t pin, int level) {
+    pin &= 63;
+    int previous = digitalRead(pin);
+    digitalPins[pin] = level;
+    digitalSet[pin] = true;
+    if (previous != level && isrs[pin] != nullptr) {
+        isrs[pin]();
+    }
+    if (previous != level && argIsrs[pin] != nullptr) {
+        argIsrs[pin](isrArgs[pin]);
+    }
+}
+
+int SimHal::analogRead(uint8_t pin) {
+    analogReadCount++;
+    int value = analogSet[pin & 63] ? analogPins[pin & 63] : 2048;
+    if (noise > 0) {
+        // xorshift32, deterministic for a given seed
+        noiseState ^= noiseState << 13;
+        noiseState ^= noiseState >> 17;
+        noiseState ^= noiseState << 5;
+        value += (int) (noiseState % (2 * noise + 1)) - noise;
+    }
+    return max(0, min(4095, value));
+}
+
+unsigned long SimHal::analogReads() const {
+    return analogReadCount;
+}
+
+int SimHal::digitalRead(uint8_t pin) {
+    return digitalSet[pin & 63] ? digitalPins[pin & 63] : HIGH;
+}
+
+void SimHal::setAdcNoise(int amplitude, uint32_t seed) {
+    noise = amplitude;
+    noiseState = seed ? seed : 1;
+}
+
+void SimHal::addTraceEvent(const SimTraceEvent &event) {
+    auto position = trace.end();
+    while (position != trace.begin() + traceIndex && (position - 1)->time > event.time) --position;
+    trace.insert(position, event);
+    applyTrace();
+}
+
+bool SimHal::loadTrace(const char *path) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        SimTraceEvent event{};
+        char kind;
+        int pin;
+        if (fields >> event.time >> kind >> pin >> event.value) {
+            event.analog = kind == 'a' || kind == 'A';
+            event.pin = pin;
+            addTraceEvent(event);
+        }
+    }
+    return true;
+}
+
+void SimHal::applyTrace() {
+    while (traceIndex < trace.size() && trace[traceIndex].time * 1000UL <= timeUs) {
+        const SimTraceEvent &event = trace[traceIndex++];
+        if (event.analog) {
+            setAnalog(event.pin, event.value);
+        } else {
+            setDigital(event.pin, event.value);
+        }
+    }
+}
+
+void SimHal::attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+    isrs[pin & 63] = isr;
+}
+
+void SimHal::attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode) {
+    argIsrs[pin & 63] = isr;
+    isrArgs[pin & 63] = arg;
+}
+
+void SimHal::detachInterrupt(uint8_t pin) {
+    isrs[pin & 63] = nullptr;
+    argIsrs[pin & 63] = nullptr;
+}
+
+void SimHal::recordFrame(int16_t pin, uint8_t brightness, const uint32_t *pixels, uint16_t count) {
+    recording = true;
+    frameLog.push_back({timeUs, pin, brightness, std::vector<uint32_t>(pixels, pixels + count)});
+    recording = false;
+}
+
+bool SimHal::rmtInstall(uint8_t channel, int16_t pin, uint8_t clkDiv) {
+    if (channel >= SIM_RMT_CHANNELS || rmt[channel].installed) return false;
+    rmt[channel] = SimRmtChannel();
+    rmt[channel].installed = true;
+    rmt[channel].pin = pin;
+    rmt[channel].clkDiv = max(clkDiv, (uint8_t) 1);
+    return true;
+}
+
+void SimHal::rmtUninstall(uint8_t channel) {
+    if (channel >= SIM_RMT_CHANNELS) return;
+    rmtWait(channel);
+    rmt[channel].installed = false;
+}
+
+bool SimHal::rmtWrite(uint8_t channel, const uint32_t *symbols, size_t count) {
+    if (channel >= SIM_RMT_CHANNELS || !rmt[channel].installed || rmt[channel].sending) return false;
+
+    // Read the bits like a WS2812: the high time tells 0 from 1, a long enough low time at the end latches
+    SimRmtChannel &output = rmt[channel];
+    recording = true;
+    unsigned long totalNs = 0;
+    std::vector<uint32_t> pixels;
+    uint32_t bits = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned long highNs = (symbols[i] & 0x7FFF) * output.clkDiv * 25 / 2;
+        unsigned long lowNs = ((symbols[i] >> 16) & 0x7FFF) * output.clkDiv * 25 / 2;
+        totalNs += highNs + lowNs;
+        bool last = i + 1 == count;
+        bool levels = (symbols[i] & 0x80008000) == 0x8000;
+        bool one = highNs >= 650 && highNs <= 950;
+        bool zero = highNs >= 250 && highNs <= 550;
+        bool low = last ? lowNs >= SIM_LATCH_NS : lowNs >= 300 && lowNs <= 5000;
+        if (!levels || !(one || zero) || !low) rmtBadSymbolCount++;
+
+        bits = (bits << 1) | (one ? 1 : 0);
+        if (i % 24 == 23) {
+            // GRB on the wire
+            pixels.push_back(((bits & 0xFF00) << 8) | ((bits >> 8) & 0xFF00) | (bits & 0xFF));
+            bits = 0;
+        }
+    }
+    recordFrame(output.pin, 255, pixels.data(), pixels.size());
+    recording = false;
+    output.sending = true;
+    output.endsAt = timeUs + (totalNs + 999) / 1000;
+    return true;
+}
+
+bool SimHal::rmtBusy(uint8_t channel) const {
+    return channel < SIM_RMT_CHANNELS && rmt[channel].sending;
+}
+
+void SimHal::rmtWait(uint8_t channel) {
+    if (rmtBusy(channel)) advance(rmt[channel].endsAt - timeUs);
+}
+
+void SimHal::rmtSetEndCallback(void (*callback)(uint8_t, void *), void *arg) {
+    rmtEnd = callback;
+    rmtEndArg = arg;
+}
+
+unsigned long SimHal::rmtBadSymbols() const {
+    return rmtBadSymbolCount;
+}
+
+int SimHal::nextRmtEnd(unsigned long &at) const {
+    int next = -1;
+    for (int i = 0; i < SIM_RMT_CHANNELS; i++) {
+        if (rmt[i].sending && (next < 0 || rmt[i].endsAt < at)) {
+            next = i;
+            at = rmt[i].endsAt;
+        }
+    }
+    return next;
+}
+
+void SimHal::recordNotify(const uint8_t *data, size_t length, uint16_t handle) {
+    BLEServer *server = activeServer();
+    for (auto &link : links) {
+        if (server == nullptr || !server->isPeer(link.first)) continue;
+        sendNotify(link.first, data, std::min(length, (size_t) server->getPeerMTU(link.first) - 3), handle);
+    }
+}
+
+bool SimHal::sendNotify(uint16_t connId, const uint8_t *data, size_t length, uint16_t handle) {
+    BLEServer *server = activeServer();
+    if (server == nullptr || !server->isPeer(connId)) return false;
+
+    // Connection events since the last drain each carry SIM_LINK_PACKETS queued notifications
+    SimLink &link = links[connId];
+    unsigned long events = (timeUs - link.drainedAt) / link.eventUs;
+    link.queued -= std::min(link.queued, events * SIM_LINK_PACKETS);
+    link.drainedAt += events * link.eventUs;
+    if (length > (size_t) server->getPeerMTU(connId) - 3 || link.queued >= SIM_LINK_BUFFERS) {
+        link.rejected++;
+        return false;
+    }
+    link.queued++;
+
+    recording = true;
+    notifyLog.push_back({timeUs, std::string((const char *) data, length), connId, handle});
+    recording = false;
+    return true;
+}
+
+unsigned long SimHal::notifiesRejected(uint16_t connId) const {
+    auto link = links.find(connId);
+    return link == links.end() ? 0 : link->second.rejected;
+}
+
+void SimHal::recordSerial(const char *text, size_t length) {
+    recording = true;
+    serialLog.append(text, length);
+    recording = false;
+    if (serialEcho) fwrite(text, 1, length, stdout);
+}
+
+void SimHal::serialInput(const std::string &text) {
+    serialPending.append(text);
+}
+
+int SimHal::serialRead() {
+    if (serialPendingIndex >= serialPending.size()) return -1;
+    return (unsigned char) serialPending[serialPendingIndex++];
+}
+
+int SimHal::serialAvailable() const {
+    return (int) (serialPending.size() - serialPendingIndex);
+}
+
+void SimHal::setSerialEcho(bool echo) {
+    serialEcho = echo;
+}
+
+bool SimHal::isRecording() const {
+    return recording;
+}
+
+const std::vector<SimFrame> &SimHal::frames() const {
+    return frameLog;
+}
+
+const std::vector<SimNotify> &SimHal::notifies() const {
+    return notifyLog;
+}
+
+const std::string &SimHal::serialOutput() const {
+    return serialLog;
+}
+
+void SimHal::clearRecordings() {
+    frameLog.clear();
+    notifyLog.clear();
+    serialLog.clear();
+}
+
+void SimHal::registerServer(BLEServer *server) {
+    servers.push_back(server);
+}
+
+uint16_t SimHal::registerCharacteristic(BLECharacteristic *characteristic) {
+    characteristics.push_back(characteristic);
+    return ++attributeCount;
+}
+
+uint16_t SimHal::registerDescriptor() {
+    return ++attributeCount;
+}
+
+BLEServer *SimHal::activeServer() const {
+    // The newest server with callbacks is the one the firmware listens on
+    for (auto it = servers.rbegin(); it != servers.rend(); ++it) {
+        if ((*it)->getCallbacks() != nullptr) return *it;
+    }
+    return servers.empty() ? nullptr : servers.back();
+}
+
+void SimHal::connect(uint16_t interval, uint16_t connId, uint16_t mtu, bool subscribe) {
+    BLEServer *server = activeServer();
+    if (server == nullptr || server->isPeer(connId)) return;
+
+    SimLink &link = links[connId];
+    link = SimLink();
+    link.eventUs = std::max((unsigned long) interval, 6UL) * 1250;
+    link.drainedAt = timeUs;
+    server->simConnect(connId, interval);
+    if (mtu > 23) server->simMtuChanged(connId, std::min(mtu, BLEDevice::getMTU()));
+    if (subscribe) this->subscribe(connId);
+}
+
+void SimHal::subscribe(uint16_t connId, const char *uuid, bool enable) {
+    BLEServer *server = activeServer();
+    if (server == nullptr || !server->isPeer(connId) || BLEDevice::m_customGattsHandler == nullptr) return;
+
+    uint8_t value[2] = {(uint8_t) (enable ? 1 : 0), 0};
+    for (BLECharacteristic *characteristic : characteristics) {
+        if (!(characteristic->getProperties() & BLECharacteristic::PROPERTY_NOTIFY)) continue;
+        if (uuid != nullptr && characteristic->getUUID() != uuid) continue;
+        for (BLEDescriptor *descriptor : characteristic->getDescriptors()) {
+            esp_ble_gatts_cb_param_t param = {};
+            param.write.conn_id = connId;
+            param.write.handle = descriptor->getHandle();
+            param.write.len = sizeof(value);
+            param.write.value = value;
+            BLEDevice::m_customGattsHandler(ESP_GATTS_WRITE_EVT, server->getGattsIf(), &param);
+        }
+    }
+}
+
+void SimHal::disconnect(uint16_t connId) {
+    BLEServer *server = activeServer();
+    if (server != nullptr) server->simDisconnect(connId);
+}
+
+void SimHal::write(const std::string &value, const char *uuid, uint16_t connId) {
+    for (auto it = characteristics.rbegin(); it != characteristics.rend(); ++it) {
+        BLECharacteristic *characteristic = *it;
+        if (characteristic->getCallbacks() == nullptr) continue;
+        if (!(characteristic->getProperties() & BLECharacteristic::PROPERTY_WRITE)) continue;
+        if (uuid != nullptr && characteristic->getUUID() != uuid) continue;
+        characteristic->setValue(value);
+        esp_ble_gatts_cb_param_t param = {};
+        param.write.conn_id = connId;
+        param.write.handle = characteristic->getHandle();
+        param.write.len = value.size();
+        characteristic->getCallbacks()->onWrite(characteristic, &param);
+        return;
+    }
+}
+
+std::string SimHal::read(const char *uuid) {
+    for (auto it = characteristics.rbegin(); it != characteristics.rend(); ++it) {
+        BLECharacteristic *characteristic = *it;
+        if (characteristic->getUUID() != uuid) continue;
+        if (characteristic->getCallbacks() != nullptr) characteristic->getCallbacks()->onRead(characteristic);
+        return characteristic->getValue();
+    }
+    return "";
+}
+
+bool SimHal::isConnected() const {
+    BLEServer *server = activeServer();
+    return server != nullptr && server->getConnectedCount() > 0;
+}
+
+bool SimHal::isAdvertising() const {
+    return advertising;
+}
+
+void SimHal::setAdvertising(bool advertising) {
+    this->advertising = advertising;
+}
+
+bool SimHal::flashRead(const std::string &key, std::string &value) const {
+    auto entry = flash.find(key);
+    if (entry == flash.end()) return false;
+    value = entry->second;
+    return true;
+}
+
+void SimHal::flashWrite(const std::string &key, const std::string &value) {
+    Recording shim;
+    flash[key] = value;
+    flashWriteCount++;
+    flashByteCount += value.size();
+}
+
+void SimHal::flashErase(const std::string &key) {
+    Recording shim;
+    if (flash.erase(key) > 0) flashWriteCount++;
+}
+
+unsigned long SimHal::flashWrites() const {
+    return flashWriteCount;
+}
+
+size_t SimHal::flashBytesWritten() const {
+    return flashByteCount;
+}
+
+void SimHal::clearFlash() {
+    flash.clear();
+    flashWriteCount = 0;
+    flashByteCount = 0;
+}
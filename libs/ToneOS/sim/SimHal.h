@@ -0,0 +1,304 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#ifndef SIMHAL_H
+#define SIMHAL_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+class BLEServer;
+class BLECharacteristic;
+
+/**
+ * @brief Cost of a NeoPixel transmission per pixel in microseconds (24 bits at 800 kHz).
+ */
+#define SIM_PIXEL_US 30
+
+/**
+ * @brief Latch time after a NeoPixel transmission in microseconds.
+ */
+#define SIM_PIXEL_LATCH_US 50
+
+/**
+ * @brief RMT transmit channels of the simulated chip (ESP32-C3).
+ */
+#define SIM_RMT_CHANNELS 2
+
+/**
+ * @brief Shortest low time after the last bit of an RMT transmission that latches a WS2812 frame, in nanoseconds.
+ */
+#define SIM_LATCH_NS 50000
+
+/**
+ * @brief ATT MTU a simulated client asks for when connecting (macOS, iOS and Android ask for 185 or more).
+ */
+#define SIM_CLIENT_MTU 185
+
+/**
+ * @brief Notifications a connection carries per connection event.
+ */
+#define SIM_LINK_PACKETS 4
+
+/**
+ * @brief Notifications a connection queues before the stack refuses more (congested link).
+ */
+#define SIM_LINK_BUFFERS 10
+
+/**
+ * @brief A scripted input change, applied when the simulated clock reaches `time`.
+ */
+struct SimTraceEvent {
+    unsigned long time; ///< Time in milliseconds
+    bool analog;        ///< true for analog pins, false for digital pins
+    uint8_t pin;        ///< Pin number
+    int value;          ///< ADC value or digital level
+};
+
+/**
+ * @brief A frame transmitted to a NeoPixel strip.
+ */
+struct SimFrame {
+    unsigned long time;            ///< Time in microseconds
+    int16_t pin;                   ///< Data pin of the strip
+    uint8_t brightness;            ///< Strip brightness at transmission
+    std::vector<uint32_t> pixels;  ///< Packed RGB colors by hardware index
+};
+
+/**
+ * @brief A notification sent on a BLE characteristic.
+ */
+struct SimNotify {
+    unsigned long time;  ///< Time in microseconds
+    std::string payload; ///< Characteristic value at notify()
+    uint16_t connId;     ///< Connection it was sent on
+    uint16_t handle = 0; ///< Attribute handle of the notified characteristic
+};
+
+/**
+ * @brief Capacity of a simulated connection: SIM_LINK_PACKETS per connection event, SIM_LINK_BUFFERS queued.
+ */
+struct SimLink {
+    unsigned long eventUs = 1250;   ///< Connection interval in microseconds
+    unsigned long drainedAt = 0;    ///< Time of the last connection event that drained the queue
+    unsigned long queued = 0;       ///< Notifications waiting for a connection event
+    unsigned long rejected = 0;     ///< Notifications refused, too long for the MTU or the link congested
+};
+
+/**
+ * @brief An installed RMT transmit channel.
+ */
+struct SimRmtChannel {
+    bool installed = false;      ///< rmtInstall() was called
+    int16_t pin = -1;            ///< Output pin
+    uint8_t clkDiv = 1;          ///< Divider of the 80 MHz clock
+    bool sending = false;        ///< A transmission is in progress
+    unsigned long endsAt = 0;    ///< End of the transmission in microseconds
+};
+
+/**
+ * @brief SimHal is the host implementation of the hardware ToneOS talks to.
+ *
+ * The firmware is compiled unchanged against the headers in this directory. They provide
+ * the Arduino API subset the controllers use (analogRead, digitalRead, pinMode, millis,
+ * micros, delay, attachInterrupt, Serial), Adafruit_NeoPixel, the RMT driver and the ESP32 BLE classes.
+ * All of them are backed by this class: inputs come from scripted traces, outputs are
+ * recorded with timestamps, and time only moves when the simulation advances it, so every
+ * run is deterministic.
+ */
+class SimHal {
+public:
+    /**
+     * @brief Returns the simulator instance used by the Arduino shims.
+     */
+    static SimHal &instance();
+
+    /**
+     * @brief Resets clock, inputs, traces, recordings and BLE objects. Flash survives, like on a reboot.
+     */
+    void reset();
+
+    // --- Clock ---
+    unsigned long micros() const;  // Simulated time in microseconds
+    unsigned long millis() const;  // Simulated time in milliseconds
+    void advance(unsigned long us);  // Moves the clock forward and applies due trace events
+
+    // --- Inputs ---
+    void setAnalog(uint8_t pin, int value);  // Sets an ADC value immediately
+    void setDigital(uint8_t pin, int level);  // Sets a digital level immediately
+    int analogRead(uint8_t pin);  // Value of an analog pin (mid scale if never set)
+    unsigned long analogReads() const;  // analogRead() calls since reset()
+    int digitalRead(uint8_t pin);  // Level of a digital pin (HIGH if never set)
+    void setAdcNoise(int amplitude, uint32_t seed = 1);  // Adds uniform noise of +-amplitude to analog reads
+    void serialInput(const std::string &text);  // Queues characters for Serial.read()
+    int serialRead();  // Next queued Serial character, -1 if there is none
+    int serialAvailable() const;  // Number of queued Serial characters
+
+    /**
+     * @brief Adds a scripted input change.
+     */
+    void addTraceEvent(const SimTraceEvent &event);
+
+    /**
+     * @brief Loads a trace file. Each line is `<ms> <a|d> <pin> <value>`, `#` starts a comment.
+     * @return false if the file could not be read.
+     */
+    bool loadTrace(const char *path);
+
+    // --- Interrupts ---
+    void attachInterrupt(uint8_t pin, void (*isr)(), int mode);  // Registers a pin change handler
+    void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);  // Same, with an argument
+    void detachInterrupt(uint8_t pin);  // Removes a pin change handler
+
+    // --- Outputs ---
+    void recordFrame(int16_t pin, uint8_t brightness, const uint32_t *pixels, uint16_t count);
+    void recordNotify(const uint8_t *data, size_t length, uint16_t handle);  // Notifies every connection, truncated to its MTU
+
+    /**
+     * @brief Notifies one connection, like esp_ble_gatts_send_indicate().
+     * @return false if the connection does not exist, the value is longer than its MTU allows or the link is congested.
+     */
+    bool sendNotify(uint16_t connId, const uint8_t *data, size_t length, uint16_t handle = 0);
+    unsigned long notifiesRejected(uint16_t connId) const;  // Notifications sendNotify() refused on a connection
+    void recordSerial(const char *text, size_t length);
+    void setSerialEcho(bool echo);  // Prints Serial output to stdout when true
+    bool isRecording() const;  // True while a record*() call or a Recording scope runs (its allocations are the simulator's)
+
+    /**
+     * @brief Marks the simulator's own bookkeeping inside a shim (key strings, the flash map), so its allocations
+     * are not counted against the firmware. Scopes nest.
+     */
+    class Recording {
+    private:
+        bool previous;
+
+    public:
+        Recording() : previous(instance().recording) { instance().recording = true; }
+        ~Recording() { instance().recording = previous; }
+
+        Recording(const Recording &) = delete;
+        Recording &operator=(const Recording &) = delete;
+    };
+
+    const std::vector<SimFrame> &frames() const;
+    const std::vector<SimNotify> &notifies() const;
+    const std::string &serialOutput() const;
+    void clearRecordings();
+
+    // --- RMT ---
+    /**
+     * @brief Installs a transmit channel on a pin.
+     * @param clkDiv Divider of the 80 MHz clock, one tick is clkDiv * 12.5 ns.
+     * @return false if the channel is not a transmit channel (SIM_RMT_CHANNELS) or already installed.
+     */
+    bool rmtInstall(uint8_t channel, int16_t pin, uint8_t clkDiv);
+    void rmtUninstall(uint8_t channel);  // Waits for the transmission of a channel and frees it
+
+    /**
+     * @brief Starts a transmission on an idle channel. The symbols are decoded as WS2812 bits the way a
+     * strip reads them and recorded as a frame; the channel stays busy for their total duration.
+     * @return false if the channel is not installed or still busy.
+     */
+    bool rmtWrite(uint8_t channel, const uint32_t *symbols, size_t count);
+    bool rmtBusy(uint8_t channel) const;  // A transmission is in progress
+    void rmtWait(uint8_t channel);  // Advances the clock to the end of the channel's transmission
+    void rmtSetEndCallback(void (*callback)(uint8_t channel, void *arg), void *arg);  // Called when a transmission ends
+    unsigned long rmtBadSymbols() const;  // Symbols outside the WS2812 timing since reset()
+
+    // --- Flash (Preferences) ---
+    bool flashRead(const std::string &key, std::string &value) const;  // False if the key was never written
+    void flashWrite(const std::string &key, const std::string &value);  // Stores a value and counts the write cycle
+    void flashErase(const std::string &key);  // Removes a key, counted as a write cycle
+    unsigned long flashWrites() const;  // Write cycles since the last clearFlash()
+    size_t flashBytesWritten() const;  // Payload bytes written since the last clearFlash()
+    void clearFlash();  // Erases all keys and the counters
+
+    // --- BLE ---
+    void registerServer(BLEServer *server);
+    uint16_t registerCharacteristic(BLECharacteristic *characteristic);  // Returns the attribute handle
+    uint16_t registerDescriptor();  // Returns the attribute handle
+
+    /**
+     * @brief Simulates a client connecting with the given connection interval (1.25 ms units),
+     * followed by an MTU exchange when it asks for more than the default 23 bytes.
+     * @param mtu MTU the client asks for, the connection gets the smaller of it and the server's.
+     * @param subscribe Enables the notifications of every characteristic, as subscribe() does.
+     */
+    void connect(uint16_t interval = 24, uint16_t connId = 0, uint16_t mtu = SIM_CLIENT_MTU, bool subscribe = true);
+
+    /**
+     * @brief Simulates the client writing the CCCD of a characteristic, to the custom GATT server handler.
+     * @param uuid Characteristic UUID, nullptr for every characteristic that notifies.
+     * @param enable Notifications on (0x0001) or off (0x0000).
+     */
+    void subscribe(uint16_t connId, const char *uuid = nullptr, bool enable = true);
+
+    /**
+     * @brief Simulates the client disconnecting.
+     */
+    void disconnect(uint16_t connId = 0);
+
+    /**
+     * @brief Simulates the client writing a value to a characteristic.
+     * @param value Written value.
+     * @param uuid Characteristic UUID, nullptr for the newest writable characteristic with callbacks.
+     * @param connId Connection the client writes on.
+     */
+    void write(const std::string &value, const char *uuid = nullptr, uint16_t connId = 0);
+
+    /**
+     * @brief Simulates the client reading a characteristic, its read callback runs first.
+     * @return Value of the characteristic, empty if there is none with that UUID.
+     */
+    std::string read(const char *uuid);
+
+    bool isConnected() const;  // A client is connected to the active server
+
+    bool isAdvertising() const;
+    void setAdvertising(bool advertising);
+
+private:
+    SimHal() = default;
+
+    void applyTrace();
+    int nextRmtEnd(unsigned long &at) const;  // Channel whose transmission ends first, -1 if none is sending
+    BLEServer *activeServer() const;
+
+    unsigned long timeUs = 0;
+    int analogPins[64] = {};
+    bool analogSet[64] = {};
+    int digitalPins[64] = {};
+    bool digitalSet[64] = {};
+    unsigned long analogReadCount = 0;
+    int noise = 0;
+    uint32_t noiseState = 1;
+    std::vector<SimTraceEvent> trace;
+    size_t traceIndex = 0;
+    void (*isrs[64])() = {};
+    void (*argIsrs[64])(void *) = {};
+    void *isrArgs[64] = {};
+    std::vector<SimFrame> frameLog;
+    std::vector<SimNotify> notifyLog;
+    std::string serialLog;
+    std::string serialPending;
+    size_t serialPendingIndex = 0;
+    bool serialEcho = false;
+    bool recording = false;
+    std::vector<BLEServer *> servers;
+    std::vector<BLECharacteristic *> characteristics;
+    uint16_t attributeCount = 0;  // Handles given to characteristics and descriptors
+    std::map<uint16_t, SimLink> links;
+    bool advertising = false;
+    SimRmtChannel rmt[SIM_RMT_CHANNELS];
+    void (*rmtEnd)(uint8_t, void *) = nullptr;
+    void *rmtEndArg = nullptr;
+    unsigned long rmtBadSymbolCount = 0;
+    std::map<std::string, std::string> flash;
+    unsigned long flashWriteCount = 0;
+    size_t flashByteCount = 0;
+};
+
+#endif //SIMHAL_H
@@ -0,0 +1,1353 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "SimScenario.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+unsigned long allocationCount = 0;
+bool countAllocations = false;
+
+void *operator new(size_t size) {
+    if (countAllocations && !SimHal::instance().isRecording()) allocationCount++;
+    void *memory = malloc(size ? size : 1);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    free(memory);
+}
+
+std::vector<ScenarioInput> inputs;
+unsigned long scenarioStartMs = 0;
+
+int expectedValue(int angle) {
+    return (angle * 100 + MAX_MAPPED_ANGLE - 1) / MAX_MAPPED_ANGLE;
+}
+
+void stickAt(unsigned long timeMs, int angle, int radius) {
+    double radians = (angle - 90) * PI / 180.0;
+    SimHal &hal = SimHal::instance();
+    timeMs += scenarioStartMs;
+    hal.addTraceEvent({timeMs, true, SCENARIO_X_PIN, (int) lround(2048 + radius * cos(radians))});
+    hal.addTraceEvent({timeMs, true, SCENARIO_Y_PIN, (int) lround(2048 + radius * sin(radians))});
+    inputs.push_back({timeMs, angle <= MAX_MAPPED_ANGLE ? expectedValue(angle) : INPUT_NO_VALUE});
+}
+
+void stickCentered(unsigned long timeMs) {
+    SimHal &hal = SimHal::instance();
+    timeMs += scenarioStartMs;
+    inputs.push_back({timeMs, INPUT_NO_VALUE});
+    hal.addTraceEvent({timeMs, true, SCENARIO_X_PIN, 2048});
+    hal.addTraceEvent({timeMs, true, SCENARIO_Y_PIN, 2048});
+}
+
+void button(unsigned long timeMs, bool pressed) {
+    timeMs += scenarioStartMs;
+    SimHal::instance().addTraceEvent({timeMs, false, SCENARIO_SW_PIN, pressed ? LOW : HIGH});
+    inputs.push_back({timeMs, pressed ? INPUT_PRESS : INPUT_RELEASE});
+}
+
+void bouncyButton(unsigned long timeMs, bool pressed, int bounces) {
+    for (int i = 0; i < bounces; i++) {
+        button(timeMs + i / 2, i % 2 ? !pressed : pressed);
+    }
+    button(timeMs + bounces / 2, pressed);
+}
+
+void sweep(unsigned long startMs, unsigned long durationMs, int fromAngle, int toAngle) {
+    int steps = abs(toAngle - fromAngle);
+    for (int i = 0; i <= steps; i++) {
+        int angle = fromAngle + (toAngle > fromAngle ? i : -i);
+        stickAt(startMs + durationMs * i / max(steps, 1), angle);
+    }
+}
+
+static void scriptIdle() {
+    stickCentered(0);
+    SimHal::instance().setAdcNoise(8);
+}
+
+static void scriptSlowSweep() {
+    stickCentered(0);
+    sweep(200, 4000, 0, 330);
+    stickCentered(4500);
+}
+
+void scriptFastSweep() {
+    stickCentered(0);
+    for (int i = 0; i < 5; i++) {
+        sweep(200 + i * 700, 300, i % 2 ? 330 : 0, i % 2 ? 0 : 330);
+    }
+    stickCentered(3800);
+}
+
+static void scriptModeCycling() {
+    stickCentered(0);
+    // Presses further apart than BUTTON_DOUBLE_MS, so each one is a short press
+    for (unsigned long t = 200; t < 3000; t += 400) {
+        button(t, true);
+        button(t + 50, false);
+    }
+}
+
+static void scriptButtonHeld() {
+    stickCentered(0);
+    stickAt(100, 120);
+    button(200, true);
+    sweep(300, 2000, 120, 300);
+    button(2500, false);
+}
+
+static void scriptNoisyHold() {
+    stickCentered(0);
+    // 33 degrees is the boundary between value 10 and 11
+    stickAt(200, 33);
+    SimHal::instance().setAdcNoise(200);
+}
+
+const Scenario SCENARIOS[9] = {
+        {"idle_origin",       5000, scriptIdle,        JOY_FILTER_EXPONENTIAL},
+        {"slow_sweep",        5000, scriptSlowSweep,   JOY_FILTER_EXPONENTIAL},
+        {"fast_sweep",        4000, scriptFastSweep,   JOY_FILTER_EXPONENTIAL},
+        {"mode_cycling",      3500, scriptModeCycling, JOY_FILTER_EXPONENTIAL},
+        {"button_held",       3000, scriptButtonHeld,  JOY_FILTER_EXPONENTIAL},
+        {"noisy_hold_none",   3000, scriptNoisyHold,   JOY_FILTER_NONE},
+        {"noisy_hold_ma",     3000, scriptNoisyHold,   JOY_FILTER_MOVING_AVERAGE},
+        {"noisy_hold_ema",    3000, scriptNoisyHold,   JOY_FILTER_EXPONENTIAL},
+        {"noisy_hold_euro",   3000, scriptNoisyHold,   JOY_FILTER_ONE_EURO},
+};
+
+Percentiles percentiles(std::vector<double> values) {
+    Percentiles result;
+    if (values.empty()) return result;
+    std::sort(values.begin(), values.end());
+    result.p50 = values[values.size() / 2];
+    result.p99 = values[std::min(values.size() - 1, values.size() * 99 / 100)];
+    result.max = values.back();
+    return result;
+}
+
+int notifiedValue(const std::string &payload) {
+    if (!payload.empty() && payload[0] == TONE_PROTOCOL_VERSION && payload.size() >= 6) {
+        return (int16_t) ((uint8_t) payload[4] | ((uint8_t) payload[5] << 8));
+    }
+    size_t position = payload.find("\"value\": \"");
+    if (position == std::string::npos) return -1;
+    return atoi(payload.c_str() + position + 10);
+}
+
+std::vector<double> notifyLatencies(const std::vector<SimNotify> &notifies) {
+    std::vector<ScenarioInput> sorted(inputs);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const ScenarioInput &a, const ScenarioInput &b) {
+        return a.timeMs < b.timeMs;
+    });
+
+    // The values the controller is asked for, in time order; INPUT_NO_VALUE ends the attribution
+    std::vector<ScenarioInput> requests;
+    bool held = false;
+    int stickValue = INPUT_NO_VALUE;
+    for (const ScenarioInput &input : sorted) {
+        if (input.value == INPUT_PRESS) {
+            held = true;
+            requests.push_back({input.timeMs, INPUT_NO_VALUE});
+        } else if (input.value == INPUT_RELEASE) {
+            held = false;
+            requests.push_back({input.timeMs, stickValue});
+        } else {
+            stickValue = input.value;
+            if (!held) requests.push_back(input);
+        }
+    }
+
+    std::vector<bool> answered(requests.size(), false);
+    std::vector<double> latencies;
+    for (const SimNotify &notify : notifies) {
+        int value = notifiedValue(notify.payload);
+        for (size_t i = requests.size(); i-- > 0;) {
+            if (requests[i].timeMs * 1000UL > notify.time) continue;
+            if (requests[i].value == INPUT_NO_VALUE) break;
+            if (requests[i].value != value) continue;
+
+            while (i > 0 && requests[i - 1].value == value) i--;
+            if (!answered[i]) {
+                answered[i] = true;
+                latencies.push_back((notify.time - requests[i].timeMs * 1000UL) / 1000.0);
+            }
+            break;
+        }
+    }
+    return latencies;
+}
+
+/**
+ * @brief Tells whether the parts received so far hold a whole payload, the way a client finds the end of
+ * one that fills its last part: a binary frame by its layout, a text line by its newline and JSON by its
+ * closing bracket.
+ */
+static bool payloadComplete(const std::string &payload) {
+    const uint8_t *bytes = (const uint8_t *) payload.data();
+    if (payload.empty()) return false;
+    if (bytes[0] == '#') return payload.back() == '\n';
+    if (bytes[0] == TONE_PROTOCOL_VERSION) {
+        if (payload.size() < 6) return false;
+        bool batch = bytes[1] & FRAME_BATCH;
+        uint8_t count = batch ? bytes[3] : 1;
+        size_t offset = batch ? 4 : 1;
+        for (uint8_t i = 0; i < count; i++) {
+            if (offset + 5 > payload.size()) return false;
+            uint8_t flags = bytes[offset + (batch ? 1 : 0)];
+            offset += 5;
+            if (flags & FRAME_HAS_NAME) {
+                if (offset >= payload.size()) return false;
+                offset += 1 + bytes[offset];
+            }
+            if (flags & FRAME_HAS_COLOR) offset += 3;
+        }
+        return offset <= payload.size();
+    }
+    int depth = 0;
+    bool quoted = false;
+    for (size_t i = 0; i < payload.size(); i++) {
+        char c = payload[i];
+        if (quoted) {
+            if (c == '\\') i++;
+            else if (c == '"') quoted = false;
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<SimNotify> payloadsOf(uint16_t connId, uint16_t mtu) {
+    std::vector<SimNotify> payloads;
+    std::string partial;
+    for (const SimNotify &notify : SimHal::instance().notifies()) {
+        if (notify.connId != connId) continue;
+        partial += notify.payload;
+        if (notify.payload.size() == (size_t) mtu - 3 && !payloadComplete(partial)) continue;
+        payloads.push_back({notify.time, partial, connId});
+        partial.clear();
+    }
+    return payloads;
+}
+
+ToneController *bootController(bool &restored) {
+    ToneController *tone = new ToneController(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN,
+                                              SCENARIO_PIXELS);
+    tone->begin();
+    tone->setMode(0, "Volume", 0, 100, 255, 255, 155, 150);
+    tone->setMode(1, "Bass", 0, 100, 122, 50, 245, 150);
+    tone->setMode(2, "Treble", 0, 100, 90, 240, 255, 150);
+    restored = tone->restoreState();
+    if (!restored) tone->setCurrentMode(0);
+    return tone;
+}
+
+const modeSpec LEVEL_MODES[5] = {
+        {"Volume", 0, 100, {255, 255, 155}, 150},
+        {"Bass", 0, 100, {122, 50, 245}, 150},
+        {"Treble", 0, 100, {90, 240, 255}, 150},
+        {"Balance", -20, 20, {255, 80, 0}, 60},
+        {"Fine", 0, 1000, {255, 255, 255}, 255},
+};
+
+ScenarioRun runScenario(const Scenario &scenario, unsigned long tickUs) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    tone.begin();
+    tone.setMode(0, "Volume", 0, 100, 255, 255, 155, 150);
+    tone.setMode(1, "Bass", 0, 100, 122, 50, 245, 150);
+    tone.setMode(2, "Treble", 0, 100, 90, 240, 255, 150);
+    tone.setCurrentMode(0);
+    tone.getJoystick()->setFilter(scenario.filter);
+    hal.connect();
+
+    scenarioStartMs = hal.millis();
+    scenario.script();
+    hal.clearRecordings();
+    unsigned long skippedBefore = tone.getPixel()->getFramesSkipped();
+
+    ScenarioRun run;
+    run.hostNs.reserve(scenario.durationMs * 1000UL / tickUs + 1);
+    allocationCount = 0;
+    countAllocations = true;
+    while (hal.millis() < scenarioStartMs + scenario.durationMs) {
+        auto hostStart = std::chrono::steady_clock::now();
+        tone.update();
+        auto hostEnd = std::chrono::steady_clock::now();
+        run.hostNs.push_back(std::chrono::duration<double, std::nano>(hostEnd - hostStart).count());
+        hal.advance(tickUs);
+    }
+    countAllocations = false;
+    run.allocations = allocationCount;
+
+    for (const SimNotify &notify : hal.notifies()) run.notifyBytes += notify.payload.size();
+    const NotifyScheduler &scheduler = tone.getBluetooth()->getScheduler();
+    run.shows = hal.frames().size();
+    run.showsSkipped = tone.getPixel()->getFramesSkipped() - skippedBefore;
+    run.valueChanges = scheduler.getSent() + scheduler.getCoalesced();
+    run.notifies = hal.notifies();
+    run.latencies = notifyLatencies(hal.notifies());
+    return run;
+}
+
+/**
+ * @brief State whose fields all derive from i, so a torn copy is detectable.
+ */
+static toneState handoffState(uint32_t i) {
+    toneState state;
+    state.modeIndex = i & 0x0F;
+    state.value = (int16_t) (i & 0x7FFF);
+    state.color[0] = i & 0xFF;
+    state.color[1] = (i >> 8) & 0xFF;
+    state.color[2] = (i >> 16) & 0xFF;
+    for (int digit = 0; digit < 4; digit++) state.name[digit] = 'a' + ((i >> (4 * digit)) & 0x0F);
+    return state;
+}
+
+static uint32_t handoffIndex(const toneState &state) {
+    return state.color[0] | (state.color[1] << 8) | (state.color[2] << 16);
+}
+
+HandoffRun runMailboxHandoff() {
+    StateMailbox<toneState> mailbox;
+    std::atomic<bool> done{false};
+    HandoffRun run;
+    uint32_t last = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t i = 1; i <= HANDOFF_COUNT; i++) mailbox.post(handoffState(i));
+        done = true;
+    });
+    std::thread consumer([&] {
+        toneState state;
+        for (;;) {
+            bool finished = done;
+            while (mailbox.take(state)) {
+                uint32_t i = handoffIndex(state);
+                run.takes++;
+                if (state.value != (int16_t) (i & 0x7FFF) || state.modeIndex != (i & 0x0F)
+                    || strcmp(state.name, handoffState(i).name) != 0) {
+                    run.torn++;
+                }
+                if (i <= last) run.reordered++;
+                last = i;
+                run.latestDelivered |= i == HANDOFF_COUNT;
+            }
+            if (finished) break;
+            std::this_thread::yield();
+        }
+    });
+    producer.join();
+    consumer.join();
+    run.hostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+MessageRun runMessages() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    while (tone->addMode("Extra", 0, 100, 10, 20, 30, 150) >= 0) {
+    }
+    hal.connect(24, 0);
+    tone->update();
+
+    MessageRun run;
+    run.modes = tone->getModeCount();
+    hal.clearRecordings();
+    hal.write("5@" CMD_SNAPSHOT);
+    for (int i = 0; i < 10; i++) {
+        tone->update();
+        hal.advance(100000);
+    }
+    for (const SimNotify &payload : payloadsOf(0, SIM_CLIENT_MTU)) {
+        run.configs += payload.payload.find("\"min\"") != std::string::npos;
+        run.acks += payload.payload.find("\"ack\": \"5\"") != std::string::npos;
+    }
+
+    hal.clearRecordings();
+    tone->getBluetooth()->sendText("#input", 0);
+    run.sentByInput = hal.notifies().size();
+    tone->getBluetooth()->update(hal.millis());
+    run.sentByNotify = hal.notifies().size();
+    run.dropped = tone->getBluetooth()->getMessagesDropped();
+    delete tone;
+    return run;
+}
+
+HandoffRun runCommandQueueHandoff() {
+    SpscQueue<toneCommand, TONE_COMMAND_QUEUE + 1> queue;
+    HandoffRun run;
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        toneCommand command;
+        for (int32_t i = 0; i < HANDOFF_COUNT; i++) {
+            command.seq = i;
+            command.args[0] = i;
+            command.args[6] = -i;
+            while (!queue.push(command)) {
+                run.full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::thread consumer([&] {
+        toneCommand command;
+        for (int32_t expected = 0; expected < HANDOFF_COUNT;) {
+            if (!queue.pop(command)) {
+                std::this_thread::yield();
+                continue;
+            }
+            run.takes++;
+            if (command.args[0] != command.seq || command.args[6] != -command.seq) run.torn++;
+            if (command.seq != expected) run.lost++;
+            expected = command.seq + 1;
+            run.latestDelivered = command.seq == HANDOFF_COUNT - 1;
+        }
+    });
+    producer.join();
+    consumer.join();
+    run.hostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return run;
+}
+
+/**
+ * @brief Renders EFFECT_FRAMES frames of an effect PIXEL_FRAME_MS apart, calling `step` before each of them.
+ */
+static EffectRun runEffect(PixelEffect &effect, void (*step)(PixelEffect &, uint32_t) = nullptr) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    uint32_t frame[SCENARIO_PIXELS] = {};
+    EffectRun run;
+    run.hostNs.reserve(EFFECT_FRAMES);
+
+    effect.start(hal.millis());
+    for (uint32_t i = 0; i < EFFECT_FRAMES; i++) {
+        if (step != nullptr) step(effect, i);
+        unsigned long simStart = hal.micros();
+        auto hostStart = std::chrono::steady_clock::now();
+        if (!effect.render(hal.millis(), frame, SCENARIO_PIXELS)) effect.start(hal.millis());
+        auto hostEnd = std::chrono::steady_clock::now();
+        run.blockedUs += hal.micros() - simStart;
+        run.hostNs.push_back(std::chrono::duration<double, std::nano>(hostEnd - hostStart).count());
+        hal.advance(PIXEL_FRAME_MS * 1000UL);
+    }
+    return run;
+}
+
+static EffectRun runEffectBlink() {
+    BlinkEffect blink;
+    blink.set(0xFF8000, 100, 100, 3);
+    return runEffect(blink);
+}
+
+static EffectRun runEffectWipe() {
+    WipeEffect wipe;
+    wipe.set(0x00FF00, 300);
+    return runEffect(wipe);
+}
+
+static EffectRun runEffectPulse() {
+    PulseEffect pulse;
+    pulse.set(0x0000FF, 1200, 0);
+    return runEffect(pulse);
+}
+
+static EffectRun runEffectLevel() {
+    LevelEffect level;
+    level.setColor(0xFFFFFF);
+    return runEffect(level, [](PixelEffect &effect, uint32_t i) {
+        // A new target every 10 frames, sweeping the ring up and down
+        if (i % 10 == 0) static_cast<LevelEffect &>(effect).setTarget((i / 10 % 24) * LEVEL_ONE / 2);
+    });
+}
+
+static EffectRun runEffectCrossfade() {
+    static uint32_t from[SCENARIO_PIXELS];
+    static PulseEffect pulse;
+    for (uint32_t &color : from) color = 0x804020;
+    pulse.set(0x20A0FF, 800, 0);
+    CrossfadeEffect crossfade;
+    crossfade.begin(from, &pulse, 400, 0);
+    return runEffect(crossfade);
+}
+
+const EffectCase EFFECT_CASES[5] = {
+        {"effect_blink",     runEffectBlink},
+        {"effect_wipe",      runEffectWipe},
+        {"effect_pulse",     runEffectPulse},
+        {"effect_level",     runEffectLevel},
+        {"effect_crossfade", runEffectCrossfade},
+};
+
+PersistenceRun runPersistence() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    PersistenceRun run;
+    bool restored;
+    ToneController *tone = bootController(restored);
+    run.firstBootRestored = restored;
+    run.firstBootMs = hal.millis();
+    scenarioStartMs = hal.millis();
+    stickCentered(0);
+    for (int i = 0; i < PERSIST_SWEEPS; i++) {
+        unsigned long start = 500 + i * PERSIST_SWEEP_GAP_MS;
+        if (i == PERSIST_SWEEPS / 2) {
+            button(start - 300, true);
+            button(start - 200, false);
+        }
+        sweep(start, 2000, i % 2 ? 300 : 0, i % 2 ? 40 + i : 260 + i);
+        stickCentered(start + 2100);
+    }
+
+    int lastValue = tone->getCurrentValue();
+    while (hal.millis() < scenarioStartMs + PERSIST_SWEEPS * PERSIST_SWEEP_GAP_MS + 1000) {
+        tone->update();
+        if (tone->getCurrentValue() != lastValue) {
+            lastValue = tone->getCurrentValue();
+            run.valueChanges++;
+        }
+        hal.advance(1000);
+    }
+    run.flashWrites = hal.flashWrites();
+    run.flashBytes = hal.flashBytesWritten();
+    int expectedMode = tone->getCurrentModeIndex();
+    int expectedValue = tone->getCurrentValue();
+    delete tone;
+
+    // Reboot: flash survives hal.reset()
+    hal.reset();
+    auto hostStart = std::chrono::steady_clock::now();
+    tone = bootController(restored);
+    auto hostEnd = std::chrono::steady_clock::now();
+    run.restoredBootMs = hal.millis();
+    run.restoreHostUs = std::chrono::duration<double, std::micro>(hostEnd - hostStart).count();
+    run.restored = restored && tone->getCurrentModeIndex() == expectedMode && tone->getCurrentValue() == expectedValue;
+    delete tone;
+
+    // A corrupted record must be ignored
+    std::string record;
+    hal.flashRead("tone/state", record);
+    record[2] ^= 0x01;
+    hal.flashWrite("tone/state", record);
+    hal.reset();
+    tone = bootController(restored);
+    run.corruptRejected = !restored && tone->getCurrentValue() == 0;
+    delete tone;
+    return run;
+}
+
+#define CAL_REST_X 1990
+#define CAL_REST_Y 2110
+#define CAL_NOISE 30
+#define CAL_DRIFT_X 250
+#define CAL_DRIFT_Y -200
+#define CAL_DRIFT_MS 60000
+#define CAL_RADIUS 1900
+
+CalibrationRun runCalibration() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    hal.setAdcNoise(CAL_NOISE);
+
+    // Supply ramp: both axes rise from 0 to the rest position over 40 ms
+    for (unsigned long t = 0; t <= 40; t++) {
+        hal.addTraceEvent({t, true, SCENARIO_X_PIN, (int) (CAL_REST_X * t / 40)});
+        hal.addTraceEvent({t, true, SCENARIO_Y_PIN, (int) (CAL_REST_Y * t / 40)});
+    }
+    hal.advance(0);
+
+    CalibrationRun run;
+    JoystickController joystick(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN);
+    unsigned long startUs = hal.micros();
+    run.settled = joystick.calibrate();
+    run.startupUs = hal.micros() - startUs;
+    run.originError = max(abs(joystick.getOriginX() - CAL_REST_X), abs(joystick.getOriginY() - CAL_REST_Y));
+    run.deadZone = joystick.getDeadZone();
+
+    // Slow drift of the rest position while the stick is not touched
+    for (unsigned long t = 0; t <= CAL_DRIFT_MS; t += SAMPLE_INTERVAL_MS) {
+        hal.setAnalog(SCENARIO_X_PIN, CAL_REST_X + CAL_DRIFT_X * (long) t / CAL_DRIFT_MS);
+        hal.setAnalog(SCENARIO_Y_PIN, CAL_REST_Y + CAL_DRIFT_Y * (long) t / CAL_DRIFT_MS);
+        joystick.sample();
+        if (!joystick.atOrigin()) run.phantom++;
+        run.samples++;
+        hal.advance(SAMPLE_INTERVAL_MS * 1000UL);
+    }
+    int restX = CAL_REST_X + CAL_DRIFT_X;
+    int restY = CAL_REST_Y + CAL_DRIFT_Y;
+    run.driftError = max(abs(joystick.getOriginX() - restX), abs(joystick.getOriginY() - restY));
+
+    // Two slow turns around the drifted rest position, the second one with the travel learned
+    for (int step = 0; step < 720; step++) {
+        int angle = step % 360;
+        double radians = angle * PI / 180.0;
+        hal.setAnalog(SCENARIO_X_PIN, max(0, min(4095, (int) lround(restX + CAL_RADIUS * cos(radians)))));
+        hal.setAnalog(SCENARIO_Y_PIN, max(0, min(4095, (int) lround(restY + CAL_RADIUS * sin(radians)))));
+        for (int i = 0; i < 10; i++) {
+            joystick.sample();
+            hal.advance(SAMPLE_INTERVAL_MS * 1000UL);
+        }
+        int error = abs(joystick.readAngle() - angle);
+        if (step >= 360) run.angleError = max(run.angleError, min(error, 360 - error));
+    }
+    return run;
+}
+
+/**
+ * @brief Sweeps, presses and a value write over BLE, repeated every RECORDER_SESSION_MS.
+ */
+static void scriptRecorderSession(unsigned long durationMs) {
+    stickCentered(0);
+    for (unsigned long start = 0; start < durationMs; start += RECORDER_SESSION_MS) {
+        sweep(start + 300, 1500, 0, 200);
+        stickCentered(start + 2000);
+        bouncyButton(start + 2500, true);
+        bouncyButton(start + 2600, false);
+        sweep(start + 3200, 1500, 300, 60);
+        stickCentered(start + 4800);
+        button(start + 5500, true);
+        button(start + 6300, false);
+        sweep(start + 6800, 800, 100, 250);
+        stickCentered(start + 7700);
+    }
+}
+
+RecorderRun runRecorderSession(unsigned long durationMs, bool record) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    tone->getRecorder().setEnabled(record);
+    hal.connect();
+    hal.setAdcNoise(8);
+    scenarioStartMs = hal.millis();
+    scriptRecorderSession(durationMs);
+
+    RecorderRun run = {};
+    run.hostNs.reserve(durationMs + 1);
+    while (hal.millis() < scenarioStartMs + durationMs) {
+        if ((hal.millis() - scenarioStartMs) % RECORDER_SESSION_MS == RECORDER_COMMAND_MS) hal.write("val:42");
+        auto hostStart = std::chrono::steady_clock::now();
+        tone->update();
+        auto hostEnd = std::chrono::steady_clock::now();
+        run.hostNs.push_back(std::chrono::duration<double, std::nano>(hostEnd - hostStart).count());
+        hal.advance(1000);
+    }
+    run.bytes = tone->getRecorder().size();
+    run.dropped = tone->getRecorder().getDropped();
+
+    hal.clearRecordings();
+    hal.serialInput(CMD_DUMP_LOG "\n");
+    for (unsigned long end = hal.millis() + 5000; hal.millis() < end;) {
+        tone->update();
+        hal.advance(1000);
+        if (hal.serialOutput().find("#end") != std::string::npos) break;
+    }
+    run.dumped = parseLogDump(hal.serialOutput(), run.log);
+    delete tone;
+    return run;
+}
+
+replayResult replayRecorded(const eventLog &log, size_t &records, size_t skipKeyframes) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    std::vector<recordEntry> events;
+    decodeEventLog(log, events);
+    records = events.size();
+    auto start = events.begin();
+    for (; start != events.end(); ++start) {
+        if (start->type == REC_KEYFRAME && start->channel == 0 && skipKeyframes-- == 0) break;
+    }
+    events.erase(events.begin(), start);
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    replayResult result = replayEventLog(events, *tone, SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN);
+    delete tone;
+    return result;
+}
+
+static float dutyCycleBetween(const powerReport &from, const powerReport &to) {
+    unsigned long ms = to.totalMs - from.totalMs;
+    return ms == 0 ? 0 : (to.busyUs - from.busyUs) / (ms * 1000.0f);
+}
+
+PowerRun runPowerLoop(bool connected) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    if (connected) hal.connect();
+    scenarioStartMs = hal.millis();
+    hal.setAdcNoise(8);
+    stickCentered(0);
+    sweep(POWER_SWEEP_MS, POWER_SWEEP_END_MS - POWER_SWEEP_MS, 0, 200);
+    stickCentered(2600);
+    button(POWER_WAKE_MS, true);             // Wakes the blank ring
+    button(POWER_WAKE_MS + 100, false);
+    button(POWER_WAKE_MS + 1000, true);      // Switches the mode
+    button(POWER_WAKE_MS + 1100, false);
+    sweep(POWER_WAKE_MS + 5000, 1000, 300, 200);
+    stickCentered(POWER_WAKE_MS + 6100);
+
+    PowerRun run = {};
+    powerReport sweepStart = {}, sweepEnd = {}, blankStart = {}, blankEnd = {};
+    int modeBeforeWake = -1;
+    int lastValue = tone->getCurrentValue();
+    while (hal.millis() < scenarioStartMs + POWER_RUN_MS) {
+        unsigned long now = hal.millis();
+        unsigned long t = now - scenarioStartMs;
+        tone->update();
+        run.updates++;
+        if (tone->getCurrentValue() != lastValue) {
+            lastValue = tone->getCurrentValue();
+            if (t >= POWER_WAKE_MS + 5000 && run.wakeLatencyMs == 0) run.wakeLatencyMs = t - (POWER_WAKE_MS + 5000);
+        }
+        // Last state seen before the dim and sleep deadlines pass
+        powerReport report = tone->getPower().getReport(now);
+        if (t < POWER_SWEEP_MS) sweepStart = report;
+        if (t < POWER_SWEEP_END_MS) sweepEnd = report;
+        if (t < POWER_SLEEP_MS) blankStart = report;
+        if (t < POWER_WAKE_MS) blankEnd = report;
+        if (t < POWER_SLEEP_MS) run.dimBrightness = tone->getPixel()->getBrightness();
+        if (t < POWER_WAKE_MS) {
+            run.sleepBrightness = tone->getPixel()->getBrightness();
+            run.sleepAdvertising = BLEDevice::getAdvertising()->getMinInterval();
+            modeBeforeWake = tone->getCurrentModeIndex();
+        }
+        if (t >= POWER_WAKE_MS && t < POWER_WAKE_MS + 1000) {
+            run.wakePressSwallowed = tone->getCurrentModeIndex() == modeBeforeWake;
+        }
+        if (t >= POWER_WAKE_MS + 1000 && t < POWER_WAKE_MS + 5000) {
+            run.secondPressActed = tone->getCurrentModeIndex() != modeBeforeWake;
+        }
+
+        unsigned long wait = tone->getIdleTime(now);
+        if (wait == 0) {
+            hal.advance(1000);
+        } else if (tone->getPower().canSleep()) {
+            unsigned long slept = 0;
+            bool byButton = false;
+            while (slept < wait * 1000 && !byButton) {
+                hal.advance(1000);
+                slept += 1000;
+                byButton = hal.digitalRead(SCENARIO_SW_PIN) == LOW;
+            }
+            tone->sleptFor(slept, byButton);
+        } else {
+            hal.advance(wait * 1000);
+        }
+    }
+    run.report = tone->getPower().getReport(hal.millis());
+    run.sweepDutyCycle = dutyCycleBetween(sweepStart, sweepEnd);
+    run.blankDutyCycle = dutyCycleBetween(blankStart, blankEnd);
+    delete tone;
+    return run;
+}
+
+const FanoutSpec FANOUT_SPECS[FANOUT_SPEC_COUNT] = {
+        {"desktop", 0, 6,  247, false},
+        {"phone",   1, 24, 185, true},
+        {"monitor", 2, 80, 23,  false},
+};
+
+FanoutRun runFanoutSession(size_t clients) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    for (size_t i = 0; i < clients; i++) {
+        const FanoutSpec &spec = FANOUT_SPECS[i];
+        hal.connect(spec.interval, spec.connId, spec.mtu);
+        if (spec.binary) hal.write(FORMAT_CMD_BINARY, nullptr, spec.connId);
+    }
+    scenarioStartMs = hal.millis();
+    scriptFastSweep();
+    hal.clearRecordings();
+
+    double hostNs = 0;
+    unsigned long updates = 0;
+    while (hal.millis() < scenarioStartMs + FANOUT_RUN_MS) {
+        if (hal.millis() == scenarioStartMs + FANOUT_GET_MS && clients > 1) {
+            hal.write("9@" CMD_SNAPSHOT, nullptr, FANOUT_SPECS[1].connId);
+        }
+        auto hostStart = std::chrono::steady_clock::now();
+        tone->update();
+        hostNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - hostStart).count();
+        updates++;
+        hal.advance(1000);
+    }
+
+    FanoutRun run;
+    run.finalValue = tone->getCurrentValue();
+    const NotifyFanout &fanout = tone->getBluetooth()->getFanout();
+    run.published = fanout.getPublished();
+    run.jsonEncoded = fanout.getJsonEncoded();
+    run.binaryEncoded = fanout.getBinaryEncoded();
+    run.updateHostNsMean = hostNs / updates;
+    for (size_t i = 0; i < clients; i++) {
+        const FanoutSpec &spec = FANOUT_SPECS[i];
+        FanoutClientRun &client = run.clients[i];
+        uint16_t mtu = std::min(spec.mtu, (uint16_t) BLE_LOCAL_MTU);
+        std::vector<SimNotify> payloads = payloadsOf(spec.connId, mtu);
+        std::vector<SimNotify> states;
+        for (const SimNotify &payload : payloads) {
+            if (payload.payload.find("\"ack\"") != std::string::npos) client.acks++;
+            else if (payload.payload.find("\"min\"") != std::string::npos) client.configs++;
+            else states.push_back(payload);
+        }
+        for (const SimNotify &notify : hal.notifies()) {
+            if (notify.connId != spec.connId) continue;
+            client.notifies++;
+            client.bytes += notify.payload.size();
+        }
+        client.payloads = states.size();
+        client.rejected = hal.notifiesRejected(spec.connId);
+        client.latency = percentiles(notifyLatencies(states));
+        if (!states.empty()) client.lastValue = notifiedValue(states.back().payload);
+        for (uint8_t slot = 0; slot < TONE_MAX_CLIENTS; slot++) {
+            if (fanout.getSlot(slot).active && fanout.getSlot(slot).connId == spec.connId) client.stats = fanout.getSlot(slot);
+        }
+    }
+    delete tone;
+    return run;
+}
+
+const int CHANNEL_COUNTS[3] = {1, 2, 4};
+static const int CHANNEL_TARGETS[TONE_MAX_CHANNELS] = {300, 240, 180, 120}; ///< Angle each stick stops at
+
+/**
+ * @brief Pin of a channel: 0 X, 1 Y, 2 switch, 3 ring. Channel 0 uses the SCENARIO_* pins.
+ */
+static uint8_t channelPin(int channel, int pin) {
+    static const uint8_t SCENARIO_PINS[] = {SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN};
+    return channel == 0 ? SCENARIO_PINS[pin] : CHANNEL_PIN_BASE + (channel - 1) * 4 + pin;
+}
+
+/**
+ * @brief Moves the stick of a channel, radius 0 centers it.
+ */
+static void channelStickAt(int channel, unsigned long timeMs, int angle, int radius) {
+    double radians = (angle - 90) * PI / 180.0;
+    SimHal &hal = SimHal::instance();
+    timeMs += scenarioStartMs;
+    hal.addTraceEvent({timeMs, true, channelPin(channel, 0), (int) lround(2048 + radius * cos(radians))});
+    hal.addTraceEvent({timeMs, true, channelPin(channel, 1), (int) lround(2048 + radius * sin(radians))});
+}
+
+/**
+ * @brief Channel and value of every state in a JSON or binary state payload, plain or batch.
+ */
+static std::vector<std::pair<int, int>> statesOf(const std::string &payload) {
+    std::vector<std::pair<int, int>> states;
+    const uint8_t *bytes = (const uint8_t *) payload.data();
+    if (!payload.empty() && bytes[0] == TONE_PROTOCOL_VERSION) {
+        if (!(bytes[1] & FRAME_BATCH)) {
+            states.push_back({0, notifiedValue(payload)});
+            return states;
+        }
+        size_t offset = 4;
+        for (uint8_t i = 0; i < bytes[3] && offset + 5 <= payload.size(); i++) {
+            uint8_t flags = bytes[offset + 1];
+            states.push_back({bytes[offset], (int16_t) (bytes[offset + 3] | (bytes[offset + 4] << 8))});
+            offset += 5;
+            if (flags & FRAME_HAS_NAME) offset += 1 + bytes[offset];
+            if (flags & FRAME_HAS_COLOR) offset += 3;
+        }
+        return states;
+    }
+    for (size_t start = payload.find('{'); start != std::string::npos; start = payload.find('{', start + 1)) {
+        std::string object = payload.substr(start, payload.find('}', start) - start + 1);
+        size_t channel = object.find("\"ch\": \"");
+        states.push_back({channel == std::string::npos ? 0 : atoi(object.c_str() + channel + 7), notifiedValue(object)});
+    }
+    return states;
+}
+
+/**
+ * @brief Takes every frame due for the client until none is left.
+ * @param last Receives the last value delivered per channel, left alone for channels without one.
+ */
+static void drainFanout(NotifyFanout &fanout, unsigned long &now, int *last) {
+    fanoutSend send;
+    for (int i = 0; i < 4 * FANOUT_QUEUE; i++, now += NOTIFY_DEFAULT_INTERVAL_MS) {
+        if (!fanout.next(now, send)) continue;
+        for (const std::pair<int, int> &state : statesOf(std::string((const char *) send.data, send.length))) {
+            if (state.first < TONE_MAX_CHANNELS) last[state.first] = state.second;
+        }
+    }
+}
+
+FanoutOrderRun runFanoutOrder(ToneFormat format) {
+    NotifyFanout *fanout = new NotifyFanout();
+    fanout->addClient(1, NOTIFY_DEFAULT_INTERVAL_MS);
+    fanout->setSubscribed(1, true);
+    fanout->setFormat(1, format);
+    unsigned long now = 1000;
+    toneState state;
+    auto publish = [&](uint8_t channel, uint8_t modeIndex, int value) {
+        state.channel = channel;
+        state.modeIndex = modeIndex;
+        state.value = value;
+        fanout->publish(&state, 1);
+    };
+
+    int last[TONE_MAX_CHANNELS];
+    std::fill(last, last + TONE_MAX_CHANNELS, -1);
+    FanoutOrderRun run;
+    publish(0, 0, 0);
+    drainFanout(*fanout, now, last);
+    publish(0, 0, 1);
+    publish(0, 1, 5);
+    publish(0, 0, 3);
+    drainFanout(*fanout, now, last);
+    run.switchedValue = last[0];
+
+    publish(1, 0, 7);
+    for (int i = 0; i < FANOUT_QUEUE; i++) publish(0, i, 10 + i);
+    drainFanout(*fanout, now, last);
+    run.droppedValue = last[1];
+    run.finalValue = last[0];
+    delete fanout;
+    return run;
+}
+
+SubscriptionRun runSubscriptions() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    hal.connect(24, 0);
+    hal.connect(24, 1, SIM_CLIENT_MTU, false);
+    hal.connect(24, 2, 23);
+    scenarioStartMs = hal.millis();
+    scriptFastSweep();
+    hal.clearRecordings();
+
+    SubscriptionRun run;
+    while (hal.millis() < scenarioStartMs + SUBSCRIBE_RUN_MS) {
+        if (hal.millis() == scenarioStartMs + SUBSCRIBE_AT_MS) {
+            for (const SimNotify &notify : hal.notifies()) run.unsubscribedNotifies += notify.connId == 1;
+            hal.subscribe(1);
+        }
+        tone->update();
+        hal.advance(1000);
+    }
+    run.finalValue = tone->getCurrentValue();
+    for (const SimNotify &payload : payloadsOf(1, SIM_CLIENT_MTU)) run.lateValue = notifiedValue(payload.payload);
+    for (const SimNotify &payload : payloadsOf(2, 23)) run.smallMtuValue = notifiedValue(payload.payload);
+    for (const SimNotify &notify : hal.notifies()) run.emptyNotifies += notify.payload.empty();
+
+    // 20 and 40 bytes with their newline
+    const std::string lines[] = {"#0000 0102030405060", "#0010 0102030405060708090a0b0c0d0e0f101"};
+    hal.clearRecordings();
+    for (const std::string &line : lines) tone->getBluetooth()->sendText(line.c_str(), 2);
+    tone->update();
+    std::vector<SimNotify> payloads = payloadsOf(2, 23);
+    for (size_t i = 0; i < payloads.size() && i < 2; i++) run.linesWhole += payloads[i].payload == lines[i] + "\n";
+    for (const SimNotify &notify : hal.notifies()) run.emptyNotifies += notify.payload.empty();
+    delete tone;
+    return run;
+}
+
+static ChannelClientRun channelClientRun(ToneController &tone, uint16_t connId, int channels) {
+    ChannelClientRun run;
+    int lastValues[TONE_MAX_CHANNELS];
+    std::fill(lastValues, lastValues + TONE_MAX_CHANNELS, -1);
+    for (const SimNotify &payload : payloadsOf(connId, SIM_CLIENT_MTU)) {
+        std::vector<std::pair<int, int>> states = statesOf(payload.payload);
+        run.payloads++;
+        run.states += states.size();
+        run.maxStates = std::max(run.maxStates, states.size());
+        for (const std::pair<int, int> &state : states) {
+            if (state.first < TONE_MAX_CHANNELS) lastValues[state.first] = state.second;
+        }
+    }
+    for (int channel = 0; channel < channels; channel++) {
+        run.finalValues &= lastValues[channel] == tone.getCurrentValue(channel);
+    }
+    return run;
+}
+
+ChannelRun runChannelSession(int channels) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    for (int channel = 1; channel < channels; channel++) {
+        tone.addChannel(channelPin(channel, 0), channelPin(channel, 1), channelPin(channel, 2), channelPin(channel, 3),
+                        SCENARIO_PIXELS);
+    }
+    tone.begin();
+    for (int channel = 0; channel < channels; channel++) {
+        for (int index = 0; index < 3; index++) {
+            tone.setMode(channel, index, &LEVEL_MODES[index]);
+        }
+        tone.setCurrentMode(channel, 0);
+    }
+    hal.connect(24, 0);
+    hal.connect(24, 1);
+    hal.write(FORMAT_CMD_BINARY, nullptr, 1);
+
+    scenarioStartMs = hal.millis();
+    for (int channel = 0; channel < channels; channel++) {
+        channelStickAt(channel, 0, 0, 0);
+        for (int angle = 0; angle <= CHANNEL_TARGETS[channel]; angle++) {
+            channelStickAt(channel, 200 + 1500UL * angle / CHANNEL_TARGETS[channel], angle, SCENARIO_RADIUS);
+        }
+        channelStickAt(channel, 2000, 0, 0);
+    }
+    hal.clearRecordings();
+
+    std::vector<double> sampleNs;
+    std::vector<double> simUs;
+    unsigned long samples = 0;
+    unsigned long readsBefore = hal.analogReads();
+    while (hal.millis() < scenarioStartMs + CHANNEL_RUN_MS) {
+        unsigned long reads = hal.analogReads();
+        unsigned long simStart = hal.micros();
+        auto hostStart = std::chrono::steady_clock::now();
+        tone.update();
+        double hostNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - hostStart).count();
+        simUs.push_back(hal.micros() - simStart);
+        if (hal.analogReads() != reads) {
+            sampleNs.push_back(hostNs);
+            samples++;
+        }
+        hal.advance(1000);
+    }
+
+    ChannelRun run;
+    run.sampleHostNs = percentiles(sampleNs);
+    run.blockedSimUs = percentiles(simUs);
+    run.adcReadsPerSample = samples ? (double) (hal.analogReads() - readsBefore) / samples : 0;
+    const NotifyScheduler &scheduler = tone.getBluetooth()->getScheduler();
+    run.valueChanges = scheduler.getSent() + scheduler.getCoalesced();
+    run.json = channelClientRun(tone, 0, channels);
+    run.binary = channelClientRun(tone, 1, channels);
+    return run;
+}
+
+/**
+ * @brief Button edge of a channel at timeMs after scenarioStartMs.
+ */
+static void channelButton(int channel, unsigned long timeMs, bool pressed) {
+    SimHal::instance().addTraceEvent({scenarioStartMs + timeMs, false, channelPin(channel, 2), pressed ? LOW : HIGH});
+}
+
+ChannelWakeRun runChannelWake() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    tone.addChannel(channelPin(1, 0), channelPin(1, 1), channelPin(1, 2), channelPin(1, 3), SCENARIO_PIXELS);
+    tone.begin();
+    for (int channel = 0; channel < 2; channel++) {
+        for (int index = 0; index < 3; index++) {
+            tone.setMode(channel, index, &LEVEL_MODES[index]);
+        }
+        tone.setCurrentMode(channel, 0);
+    }
+
+    scenarioStartMs = hal.millis();
+    for (int channel = 0; channel < 2; channel++) {
+        channelStickAt(channel, 0, 0, 0);
+    }
+    channelButton(1, CHANNEL_WAKE_MS, true);
+    channelButton(0, CHANNEL_WAKE_MS + 20, true);
+    channelButton(0, CHANNEL_WAKE_MS + 80, false);
+    channelButton(1, CHANNEL_WAKE_MS + 200, false);
+    channelButton(1, CHANNEL_WAKE_MS + 2000, true);
+    channelButton(1, CHANNEL_WAKE_MS + 2100, false);
+
+    ChannelWakeRun run = {};
+    while (hal.millis() < scenarioStartMs + CHANNEL_WAKE_MS + 4000) {
+        unsigned long now = hal.millis();
+        tone.update();
+        if (now - scenarioStartMs < CHANNEL_WAKE_MS + 2000) {
+            run.wakeModes[0] = tone.getCurrentModeIndex(0);
+            run.wakeModes[1] = tone.getCurrentModeIndex(1);
+        }
+
+        // Light sleep like runPowerLoop(), any held button wakes the chip
+        unsigned long wait = tone.getIdleTime(now);
+        if (wait == 0) {
+            hal.advance(1000);
+        } else if (tone.getPower().canSleep()) {
+            unsigned long slept = 0;
+            bool byButton = false;
+            while (slept < wait * 1000 && !byButton) {
+                hal.advance(1000);
+                slept += 1000;
+                byButton = hal.digitalRead(channelPin(0, 2)) == LOW || hal.digitalRead(channelPin(1, 2)) == LOW;
+            }
+            tone.sleptFor(slept, byButton);
+        } else {
+            hal.advance(wait * 1000);
+        }
+    }
+    run.finalModes[0] = tone.getCurrentModeIndex(0);
+    run.finalModes[1] = tone.getCurrentModeIndex(1);
+    return run;
+}
+
+const int OUTPUT_SIZES[2] = {12, 60};
+static const uint8_t OUTPUT_PINS[] = {SCENARIO_PIXEL_PIN, SCENARIO_PIXEL_PIN + 1}; ///< Data pins of the parallel strips
+
+/**
+ * @brief Completion callbacks of one strip.
+ */
+struct OutputStrip {
+    unsigned long shown = 0;    ///< Frames reported sent
+    unsigned long shownAt = 0;  ///< Simulated time of the last report in microseconds
+};
+
+static void countShown(void *strip) {
+    OutputStrip *self = static_cast<OutputStrip *>(strip);
+    self->shown++;
+    self->shownAt = SimHal::instance().micros();
+}
+
+OutputRun runOutputSession(int pixels, int strips, bool rmt) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+
+    PixelController *rings[PIXEL_RMT_CHANNELS];
+    OutputStrip callbacks[PIXEL_RMT_CHANNELS];
+    for (int i = 0; i < strips; i++) {
+        PixelOutput *output = PixelOutput::create(OUTPUT_PINS[i], pixels, rmt ? PIXEL_RMT_CHANNELS - 1 - i : -1);
+        output->setShownCallback(countShown, &callbacks[i]);
+        rings[i] = new PixelController(output, pixels);
+        rings[i]->begin();
+        rings[i]->waitSent();
+    }
+    hal.clearRecordings();
+
+    OutputRun run;
+    unsigned long blockedUs = 0, doneUs = 0;
+    for (int frame = 0; frame < OUTPUT_FRAMES; frame++) {
+        for (int i = 0; i < strips; i++) {
+            rings[i]->setLevel((int32_t) frame * 37 % (pixels * LEVEL_ONE), LEVEL_MODES[i].color[0] << 16 | 0x40FF);
+        }
+        unsigned long simStart = hal.micros();
+        for (int i = 0; i < strips; i++) {
+            rings[i]->show();
+        }
+        blockedUs += hal.micros() - simStart;
+
+        hal.advance(PIXEL_FRAME_MS * 1000UL);
+        unsigned long done = 0;
+        for (int i = 0; i < strips; i++) {
+            done = std::max(done, callbacks[i].shownAt - simStart);
+        }
+        doneUs += done;
+    }
+
+    run.blockedUs = (double) blockedUs / OUTPUT_FRAMES;
+    run.doneUs = (double) doneUs / OUTPUT_FRAMES;
+    for (int i = 0; i < strips; i++) {
+        run.shown += callbacks[i].shown;
+        delete rings[i];
+    }
+    run.badSymbols = hal.rmtBadSymbols();
+    run.frames = hal.frames();
+    return run;
+}
+
+bool sameFrames(const std::vector<SimFrame> &a, const std::vector<SimFrame> &b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].pin != b[i].pin || a[i].pixels != b[i].pixels) return false;
+    }
+    return true;
+}
+
+BackToBackRun runBackToBack() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    PixelController ring(PixelOutput::create(SCENARIO_PIXEL_PIN, OUTPUT_SIZES[1], 0), OUTPUT_SIZES[1]);
+    ring.setGamma(false);
+    ring.begin();
+    ring.waitSent();
+    hal.clearRecordings();
+    for (int i = 1; i <= 3; i++) {
+        ring.setAllPixelsColor(60 * i, 60 * i, 60 * i);
+        ring.show();
+    }
+
+    BackToBackRun run;
+    run.waited = ring.isSending();
+    while (ring.isSending()) {
+        hal.advance(100);
+        ring.poll();
+    }
+    const std::vector<SimFrame> &sent = hal.frames();
+    run.sent = sent.size();
+    run.replaced = ring.getOutput()->getFramesReplaced();
+    run.lastSent = !sent.empty() && sent.back().pixels[0] == Adafruit_NeoPixel::Color(180, 180, 180);
+    return run;
+}
+
+ShortFrameRun runShortFrames() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    uint16_t count = OUTPUT_SIZES[1];
+    PixelOutput *output = PixelOutput::create(SCENARIO_PIXEL_PIN, count, 0);
+    output->begin();
+    hal.clearRecordings();
+
+    std::vector<uint32_t> colors(count, Adafruit_NeoPixel::Color(60, 120, 180));
+    for (uint16_t pixels : {count, (uint16_t) (count / 2), count, (uint16_t) (count / 2)}) {
+        output->write(colors.data(), pixels);
+        output->wait();
+    }
+
+    ShortFrameRun run;
+    for (const SimFrame &frame : hal.frames()) run.sizes.push_back(frame.pixels.size());
+    run.badSymbols = hal.rmtBadSymbols();
+    delete output;
+    return run;
+}
+
+#if TONE_METRICS
+/**
+ * @brief Reads a little endian uint32 of a metrics snapshot.
+ */
+static uint32_t snapshotU32(const std::string &snapshot, size_t offset) {
+    const uint8_t *bytes = (const uint8_t *) snapshot.data() + offset;
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t) bytes[3] << 24);
+}
+
+/**
+ * @brief True if a snapshot has the current layout and the count of every metric as recorded.
+ */
+static bool snapshotMatches(const std::string &snapshot) {
+    if (snapshot.size() != METRIC_SNAPSHOT_SIZE || snapshot[0] != METRIC_SNAPSHOT_VERSION
+        || snapshot[1] != METRIC_COUNT) {
+        return false;
+    }
+    for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+        const metricHistogram &histogram = ToneMetrics::get((ToneMetric) metric);
+        size_t record = 2 + metric * METRIC_RECORD_SIZE;
+        if (snapshotU32(snapshot, record) != histogram.count || snapshotU32(snapshot, record + 8) != histogram.maxNs) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MetricsRun runMetrics() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    inputs.clear();
+    ToneMetrics::reset();
+
+    bool restored;
+    ToneController *tone = bootController(restored);
+    hal.connect(24, 0, SIM_CLIENT_MTU);
+    hal.write("1@" CMD_LIVE_METRICS + std::to_string(METRICS_LIVE_MS));
+    scenarioStartMs = hal.millis();
+    scriptFastSweep();
+    hal.clearRecordings();
+
+    MetricsRun run;
+    allocationCount = 0;
+    countAllocations = true;
+    while (hal.millis() < scenarioStartMs + METRICS_RUN_MS) {
+        tone->update();
+        hal.advance(1000);
+    }
+    countAllocations = false;
+    run.allocations = allocationCount;
+
+    // Live snapshots, reassembled from their MTU sized parts; the ack of the subscription is on the state characteristic
+    uint16_t stateHandle = 0;
+    for (const SimNotify &notify : hal.notifies()) {
+        if (stateHandle == 0 && notify.payload.find("\"ack\"") != std::string::npos) stateHandle = notify.handle;
+    }
+    bool complete = true;
+    std::string partial;
+    for (const SimNotify &notify : hal.notifies()) {
+        if (notify.handle == stateHandle) continue;
+        partial += notify.payload;
+        // A snapshot that fills its last part ends with it, its layout gives its length
+        size_t length = partial.size() < 2 ? 2 : 2 + (uint8_t) partial[1] * METRIC_RECORD_SIZE;
+        if (notify.payload.size() == SIM_CLIENT_MTU - 3 && partial.size() < length) continue;
+        run.liveSnapshots++;
+        complete &= partial.size() == METRIC_SNAPSHOT_SIZE && partial[0] == METRIC_SNAPSHOT_VERSION;
+        partial.clear();
+    }
+    run.liveComplete = complete && run.liveSnapshots > 0;
+
+    run.readMatches = snapshotMatches(hal.read(METRICS_CHARACTERISTIC_UUID));
+    hal.serialInput(CMD_DUMP_METRICS "\n");
+    tone->update();
+    const std::string &serial = hal.serialOutput();
+    size_t dumpLines = 0;
+    for (size_t at = serial.find("#metric "); at != std::string::npos; at = serial.find("#metric ", at + 1)) dumpLines++;
+    run.dumped = serial.find("#metrics " + std::to_string(METRIC_COUNT)) != std::string::npos && dumpLines == METRIC_COUNT;
+
+    for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+        run.histograms[metric] = ToneMetrics::get((ToneMetric) metric);
+        run.p50Ns[metric] = ToneMetrics::percentile((ToneMetric) metric, 50);
+        run.p99Ns[metric] = ToneMetrics::percentile((ToneMetric) metric, 99);
+    }
+
+    hal.serialInput(CMD_RESET_METRICS "\n");
+    tone->update();
+    run.cleared = ToneMetrics::get(METRIC_JOY_READ).count == 0 && ToneMetrics::get(METRIC_NOTIFY).count == 0;
+    delete tone;
+    return run;
+}
+#endif
@@ -0,0 +1,469 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Scripted sessions shared by toneos_bench and toneos_tests: input scripts on the simulated joystick and button,
+// sessions that drive a controller through them, and helpers that read the notifications back.
+// A session returns what it observed; the bench prints the numbers, the tests check them.
+//
+
+#ifndef SIMSCENARIO_H
+#define SIMSCENARIO_H
+
+#include "SimHal.h"
+#include "ToneController.h"
+#include "EventReplay.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define SCENARIO_X_PIN     3
+#define SCENARIO_Y_PIN     4
+#define SCENARIO_SW_PIN    5
+#define SCENARIO_PIXEL_PIN 10
+#define SCENARIO_PIXELS    11
+#define SCENARIO_RADIUS    1800
+
+/**
+ * @brief Heap allocations made while countAllocations is set, outside the simulator's own recording.
+ */
+extern unsigned long allocationCount;
+extern bool countAllocations;
+
+/**
+ * @brief ScenarioInput values that are not a mode value.
+ */
+#define INPUT_NO_VALUE -1 ///< Stick centered
+#define INPUT_PRESS    -2 ///< Button pressed, the stick is ignored until the release
+#define INPUT_RELEASE  -3 ///< Button released, the stick asks for its value again
+
+/**
+ * @brief An input the scenario expects to produce `value` on the active mode, or one of the INPUT_ codes.
+ */
+struct ScenarioInput {
+    unsigned long timeMs;
+    int value;
+};
+
+extern std::vector<ScenarioInput> inputs;
+extern unsigned long scenarioStartMs; ///< Simulated time when setup finished, scripts are relative to it
+
+int expectedValue(int angle);  // Value the default 0..100 modes map an angle to
+void stickAt(unsigned long timeMs, int angle, int radius = SCENARIO_RADIUS);
+void stickCentered(unsigned long timeMs);
+void button(unsigned long timeMs, bool pressed);
+void bouncyButton(unsigned long timeMs, bool pressed, int bounces = 4);  // Bounces two edges per millisecond, then settles
+void sweep(unsigned long startMs, unsigned long durationMs, int fromAngle, int toAngle);
+void scriptFastSweep();
+
+struct Percentiles {
+    double p50 = 0, p99 = 0, max = 0;
+};
+
+Percentiles percentiles(std::vector<double> values);
+
+/**
+ * @brief Extracts the value from a JSON or binary state notification, -1 if there is none.
+ */
+int notifiedValue(const std::string &payload);
+
+/**
+ * @brief For every notify that answers an input, the time since the input after which the notified value was
+ * expected: the first of the inputs in a row asking for it. While the button is held the stick asks for nothing,
+ * the release asks for the value it points at. Each input is answered once, so a value that comes back on noise
+ * is not attributed to it again, and values reported after the stick was centered or the button pressed are not
+ * attributed to older inputs.
+ */
+std::vector<double> notifyLatencies(const std::vector<SimNotify> &notifies);
+
+/**
+ * @brief Joins the notifications of one connection into payloads: a part that fills the MTU is continued
+ * by the next one, unless it completes the payload. Each payload gets the time of its last part.
+ */
+std::vector<SimNotify> payloadsOf(uint16_t connId, uint16_t mtu);
+
+/**
+ * @brief Boots a controller with the sketch's three modes and restores the saved state if there is one.
+ */
+ToneController *bootController(bool &restored);
+
+/**
+ * @brief Modes covered by level_monotonic: the sketch's modes plus a signed and a fine grained one.
+ */
+extern const modeSpec LEVEL_MODES[5];
+
+// --- Input scenarios ---
+
+struct Scenario {
+    const char *name;
+    unsigned long durationMs;
+    void (*script)();
+    JoyFilter filter;
+};
+
+extern const Scenario SCENARIOS[9];
+
+struct ScenarioRun {
+    std::vector<double> hostNs;       ///< Host time of every update()
+    size_t shows = 0;                 ///< Frames sent to the ring
+    unsigned long showsSkipped = 0;   ///< Frames left out because nothing changed
+    unsigned long valueChanges = 0;   ///< Values handed to the notify scheduler
+    size_t notifyBytes = 0;
+    std::vector<SimNotify> notifies;
+    std::vector<double> latencies;    ///< Input to notify, see notifyLatencies()
+    unsigned long allocations = 0;    ///< Allocations inside update()
+};
+
+/**
+ * @brief Runs a scenario with a client connected, calling update() every tickUs.
+ */
+ScenarioRun runScenario(const Scenario &scenario, unsigned long tickUs);
+
+// --- Handoff between threads ---
+
+#define HANDOFF_COUNT 2000000
+
+struct HandoffRun {
+    unsigned long takes = 0;     ///< Values the consumer read
+    unsigned long full = 0;      ///< Pushes retried on a full queue
+    unsigned long torn = 0;      ///< Values mixing fields of two writes
+    unsigned long reordered = 0; ///< Values older than one read before
+    unsigned long lost = 0;      ///< Queued values that never arrived
+    bool latestDelivered = false;
+    double hostMs = 0;
+};
+
+HandoffRun runMailboxHandoff();  // One thread posts HANDOFF_COUNT states, another takes the newest
+HandoffRun runCommandQueueHandoff();  // One thread queues HANDOFF_COUNT commands, another pops them
+
+struct MessageRun {
+    size_t modes = 0;            ///< Modes configured, every slot
+    size_t configs = 0;          ///< Mode configurations of the `get` snapshot the client got
+    size_t acks = 0;             ///< Acknowledgements of the `get`
+    size_t sentByInput = 0;      ///< Notifications sendText() sent itself, on the input side
+    size_t sentByNotify = 0;     ///< Notifications the next BluetoothController::update() sent
+    unsigned long dropped = 0;   ///< Payloads lost to a full message queue
+};
+
+/**
+ * @brief Fills every mode slot and asks for a snapshot, then sends a text line and runs the notify side
+ * on its own: payloads of the input side only go out with the notify task.
+ */
+MessageRun runMessages();
+
+// --- LED effects ---
+
+#define EFFECT_FRAMES 20000
+
+struct EffectRun {
+    std::vector<double> hostNs;     ///< Host time of every render()
+    unsigned long blockedUs = 0;    ///< Simulated time that passed inside render(), 0 unless the effect blocks
+};
+
+struct EffectCase {
+    const char *name;
+    EffectRun (*run)();
+};
+
+/**
+ * @brief Renders EFFECT_FRAMES frames of each effect PIXEL_FRAME_MS apart.
+ */
+extern const EffectCase EFFECT_CASES[5];
+
+// --- Persistence ---
+
+#define PERSIST_SWEEPS 10
+#define PERSIST_SWEEP_GAP_MS 8000
+
+struct PersistenceRun {
+    unsigned long valueChanges = 0;
+    unsigned long flashWrites = 0;
+    size_t flashBytes = 0;
+    bool firstBootRestored = false;
+    unsigned long firstBootMs = 0;
+    unsigned long restoredBootMs = 0;
+    double restoreHostUs = 0;
+    bool restored = false;          ///< The reboot restored the mode and value of the first boot
+    bool corruptRejected = false;   ///< A record with a flipped bit was ignored
+};
+
+/**
+ * @brief Sweeps PERSIST_SWEEPS times, reboots, then reboots again with the saved record corrupted.
+ */
+PersistenceRun runPersistence();
+
+// --- Calibration ---
+
+struct CalibrationRun {
+    bool settled = false;
+    unsigned long startupUs = 0;
+    int originError = 0;         ///< Largest axis error of the origin after startup
+    int deadZone = 0;
+    unsigned long samples = 0;   ///< Samples while the rest position drifts
+    unsigned long phantom = 0;   ///< Drift samples that left the origin
+    int driftError = 0;          ///< Largest axis error of the origin after the drift
+    int angleError = 0;          ///< Largest angle error in degrees over a turn
+};
+
+/**
+ * @brief Starts the joystick on a supply ramp with noise, lets its rest position drift and turns it once.
+ */
+CalibrationRun runCalibration();
+
+// --- Event recorder ---
+
+#define RECORDER_SESSION_MS 8000
+#define RECORDER_WRAP_MS 30000
+#define RECORDER_COMMAND_MS 5000
+
+struct RecorderRun {
+    std::vector<double> hostNs;
+    size_t bytes;
+    unsigned long dropped;
+    eventLog log;
+    bool dumped;
+};
+
+/**
+ * @brief Runs sweeps, presses and a value write over BLE for durationMs, then dumps the log over Serial.
+ */
+RecorderRun runRecorderSession(unsigned long durationMs, bool record);
+
+/**
+ * @brief Replays a dumped log into a freshly booted controller.
+ * @param skipKeyframes Keyframes to skip, the replay starts at the one after them. replayResult::keyframe is false
+ * once the log has no more.
+ */
+replayResult replayRecorded(const eventLog &log, size_t &records, size_t skipKeyframes = 0);
+
+// --- Power ---
+
+#define POWER_RUN_MS 200000
+#define POWER_SWEEP_MS 500
+#define POWER_SWEEP_END_MS 2500
+#define POWER_WAKE_MS 180000
+
+struct PowerRun {
+    unsigned long updates;
+    powerReport report;
+    float sweepDutyCycle;  ///< Busy share of the stick sweep, host time
+    float blankDutyCycle;  ///< Busy share from POWER_SLEEP_MS to the wake press, host time
+    int dimBrightness;
+    int sleepBrightness;
+    uint16_t sleepAdvertising;
+    bool wakePressSwallowed;
+    bool secondPressActed;
+    long wakeLatencyMs;
+};
+
+/**
+ * @brief Runs the input loop like the input task: update(), then wait or light sleep for getIdleTime().
+ * Sleep ends early when the button is pressed, like the GPIO wake up.
+ */
+PowerRun runPowerLoop(bool connected);
+
+// --- Several clients ---
+
+/**
+ * @brief A simulated client of the fanout session.
+ */
+struct FanoutSpec {
+    const char *name;
+    uint16_t connId;
+    uint16_t interval; ///< Connection interval in 1.25 ms units
+    uint16_t mtu;      ///< MTU the client asks for
+    bool binary;       ///< Selects binary frames
+};
+
+#define FANOUT_SPEC_COUNT 3
+#define FANOUT_RUN_MS 4500
+#define FANOUT_GET_MS 4000
+
+extern const FanoutSpec FANOUT_SPECS[FANOUT_SPEC_COUNT];
+
+struct FanoutClientRun {
+    size_t payloads = 0;
+    size_t notifies = 0;
+    size_t bytes = 0;
+    unsigned long rejected = 0;
+    fanoutClient stats;
+    int lastValue = -1;
+    size_t acks = 0;
+    size_t configs = 0;
+    Percentiles latency;
+};
+
+struct FanoutRun {
+    FanoutClientRun clients[FANOUT_SPEC_COUNT];
+    int finalValue = 0;
+    unsigned long published = 0;
+    unsigned long jsonEncoded = 0;
+    unsigned long binaryEncoded = 0;
+    double updateHostNsMean = 0;
+};
+
+/**
+ * @brief Runs the fast sweep with the first `clients` FANOUT_SPECS connected. The phone asks for a
+ * snapshot at the end, which only it should receive.
+ */
+FanoutRun runFanoutSession(size_t clients);
+
+struct FanoutOrderRun {
+    int switchedValue = -1; ///< Channel 0 value the client ends on after switching mode 0 to 1 and back
+    int droppedValue = -1;  ///< Channel 1 value the client ends on after the only frame carrying it was dropped
+    int finalValue = -1;    ///< Channel 0 value the client ends on after the overflow
+};
+
+/**
+ * @brief Publishes straight into a NotifyFanout with one client in the given format, without sending in
+ * between: mode 0 (value 1), mode 1 (value 5) and mode 0 again (value 3) of channel 0, then channel 1 (value 7)
+ * followed by enough channel 0 frames (values 10..) to overflow the client queue.
+ */
+FanoutOrderRun runFanoutOrder(ToneFormat format);
+
+#define SUBSCRIBE_AT_MS 1500 ///< When the late client enables notifications, halfway through the sweep
+#define SUBSCRIBE_RUN_MS 4500
+
+struct SubscriptionRun {
+    size_t unsubscribedNotifies = 0; ///< Notifications to the late client before it enabled them
+    int lateValue = -1;              ///< Last value the late client got after enabling them
+    int smallMtuValue = -1;          ///< Last value the client with the default MTU got
+    int finalValue = -1;             ///< Value of the device at the end
+    size_t emptyNotifies = 0;        ///< Notifications without payload, over all clients
+    size_t linesWhole = 0;           ///< Text lines of exactly one and two parts the small MTU client got whole
+};
+
+/**
+ * @brief Runs the fast sweep with a client that enables notifications at SUBSCRIBE_AT_MS, one that does from
+ * the start and one with the default MTU (20 byte parts), then sends the latter text lines that fill one
+ * and two parts exactly.
+ */
+SubscriptionRun runSubscriptions();
+
+// --- Several channels ---
+
+#define CHANNEL_RUN_MS 3000
+#define CHANNEL_PIN_BASE 20 ///< Channels above 0 use four pins each from here: X, Y, switch, ring
+
+extern const int CHANNEL_COUNTS[3];
+
+struct ChannelClientRun {
+    size_t payloads = 0;  ///< Reassembled notifications
+    size_t states = 0;    ///< States carried by them
+    size_t maxStates = 0; ///< Most states in one notification
+    bool finalValues = true; ///< The last state of every channel has the channel's final value
+};
+
+struct ChannelRun {
+    Percentiles sampleHostNs;  ///< update() calls that sampled the joysticks
+    Percentiles blockedSimUs;  ///< Simulated time inside update(), only the NeoPixel fallback ring blocks
+    double adcReadsPerSample = 0;
+    unsigned long valueChanges = 0;
+    ChannelClientRun json, binary;
+};
+
+/**
+ * @brief All sticks sweep at the same time, a JSON and a binary client listen.
+ */
+ChannelRun runChannelSession(int channels);
+
+#define CHANNEL_WAKE_MS (POWER_SLEEP_MS + 10000) ///< Channel 1's button wakes the blank rings
+
+struct ChannelWakeRun {
+    int wakeModes[2];   ///< Modes after channel 1 woke the rings and channel 0 was pressed during its press
+    int finalModes[2];  ///< Modes after a second press of channel 1
+};
+
+/**
+ * @brief Two channels sleep until channel 1's button wakes them; channel 0's button is pressed and released
+ * while channel 1's is still held, so channel 0 reports its press first. Only channel 1's press should be
+ * swallowed.
+ */
+ChannelWakeRun runChannelWake();
+
+// --- Pixel output ---
+
+#define OUTPUT_FRAMES 2000
+
+extern const int OUTPUT_SIZES[2];
+
+struct OutputRun {
+    double blockedUs = 0;       ///< Simulated time spent inside show() per frame
+    double doneUs = 0;          ///< Time from the first show() until every strip reported its frame sent
+    unsigned long shown = 0;    ///< Completion callbacks
+    unsigned long badSymbols = 0;  ///< RMT symbols outside the WS2812 timing
+    std::vector<SimFrame> frames;
+};
+
+/**
+ * @brief Sends OUTPUT_FRAMES level frames to `strips` rings through Adafruit_NeoPixel or RMT.
+ */
+OutputRun runOutputSession(int pixels, int strips, bool rmt);
+
+bool sameFrames(const std::vector<SimFrame> &a, const std::vector<SimFrame> &b);
+
+struct BackToBackRun {
+    size_t sent = 0;               ///< Frames the strip received
+    unsigned long replaced = 0;    ///< Frames replaced while waiting
+    bool waited = false;           ///< A frame waited for the transmission before it
+    bool lastSent = false;         ///< The newest frame reached the strip
+};
+
+/**
+ * @brief Writes three frames within one RMT transmission: the second waits and is replaced by the third.
+ */
+BackToBackRun runBackToBack();
+
+struct ShortFrameRun {
+    std::vector<size_t> sizes;       ///< Pixels of every frame the strip received
+    unsigned long badSymbols = 0;    ///< Symbols outside the WS2812 timing
+};
+
+/**
+ * @brief Writes frames of all and of half the pixels in turn through one RMT output, so each buffer holds
+ * a longer frame when the shorter one is encoded into it.
+ */
+ShortFrameRun runShortFrames();
+
+/**
+ * @brief Output that keeps the last frame written instead of sending it.
+ */
+class CaptureOutput : public PixelOutput {
+public:
+    std::vector<uint32_t> last;
+
+    explicit CaptureOutput(uint16_t count) : last(count, 0) {}
+
+    void begin() override {}
+
+    void write(const uint32_t *colors, uint16_t count) override {
+        std::copy(colors, colors + std::min((size_t) count, last.size()), last.begin());
+    }
+};
+
+// --- Metrics ---
+
+#if TONE_METRICS
+#define METRICS_RUN_MS 4000
+#define METRICS_LIVE_MS 500
+
+struct MetricsRun {
+    metricHistogram histograms[METRIC_COUNT];  ///< Every path after the run
+    uint32_t p50Ns[METRIC_COUNT] = {};
+    uint32_t p99Ns[METRIC_COUNT] = {};
+    unsigned long allocations = 0;  ///< Allocations of the run, timers and live snapshots included
+    size_t liveSnapshots = 0;
+    bool liveComplete = false;      ///< Every live snapshot was whole and of the current version
+    bool readMatches = false;       ///< A read of the characteristic matched the histograms
+    bool dumped = false;            ///< `metrics` on Serial printed every path
+    bool cleared = false;           ///< `metrics-` cleared the histograms
+};
+
+/**
+ * @brief Runs the fast sweep with a client subscribed to live metrics, then reads the metrics
+ * characteristic, dumps them on Serial and clears them. Durations are host nanoseconds.
+ */
+MetricsRun runMetrics();
+#endif
+
+#endif //SIMSCENARIO_H
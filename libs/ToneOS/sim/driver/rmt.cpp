@@ -0,0 +1,53 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+
+#include "driver/rmt.h"
+#include "SimHal.h"
+
+static rmt_config_t configs[RMT_CHANNEL_MAX];
+static rmt_tx_end_callback_t endCallback = {};
+
+/**
+ * @brief Forwards the end of a SimHal transmission to the registered driver callback.
+ */
+static void transmissionEnded(uint8_t channel, void *arg) {
+    if (endCallback.function != nullptr) endCallback.function((rmt_channel_t) channel, endCallback.arg);
+}
+
+esp_err_t rmt_config(const rmt_config_t *rmt_param) {
+    if (rmt_param->channel >= RMT_CHANNEL_MAX || rmt_param->rmt_mode != RMT_MODE_TX) return ESP_FAIL;
+    configs[rmt_param->channel] = *rmt_param;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags) {
+    if (channel >= RMT_CHANNEL_MAX) return ESP_FAIL;
+    const rmt_config_t &config = configs[channel];
+    return SimHal::instance().rmtInstall(channel, config.gpio_num, config.clk_div) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+    SimHal::instance().rmtUninstall(channel);
+    return ESP_OK;
+}
+
+esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num, bool wait_tx_done) {
+    SimHal &hal = SimHal::instance();
+    hal.rmtWait(channel);
+    if (!hal.rmtWrite(channel, (const uint32_t *) rmt_item, item_num)) return ESP_FAIL;
+    if (wait_tx_done) hal.rmtWait(channel);
+    return ESP_OK;
+}
+
+esp_err_t rmt_wait_tx_done(rmt_channel_t channel, TickType_t wait_time) {
+    SimHal::instance().rmtWait(channel);
+    return ESP_OK;
+}
+
+rmt_tx_end_callback_t rmt_register_tx_end_callback(rmt_tx_end_fn_t function, void *arg) {
+    rmt_tx_end_callback_t previous = endCallback;
+    endCallback = {function, arg};
+    SimHal::instance().rmtSetEndCallback(transmissionEnded, nullptr);
+    return previous;
+}
@@ -0,0 +1,492 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Benchmarks ToneController on the simulator with repeatable input scenarios.
+// Prints one JSON document with per scenario update cost, LED and BLE traffic,
+// input-to-notify latency and heap allocations, for tracking regressions between builds.
+// The handoff scenarios hammer the lock-free mailbox and command queue from two std::threads,
+// standing in for the input and BLE tasks, and report how often the producer had to wait.
+// The effect scenarios time every LED effect frame by frame.
+// persistence counts flash writes over repeated sweeps and times the restore on a reboot.
+// calibration starts the joystick on a supply ramp with noise, lets its rest position drift and
+// reports the startup time, the dead zone and the origin and angle errors.
+// jog_replay has a simulated user dial in target values in absolute and relative (jog) modes
+// and counts the samples it takes.
+// recorder measures the update cost and the size of the event log and the timing of its replay.
+// power runs the input loop the way the input task does (waiting and light sleeping as told) through
+// use, a long idle phase and a wake up, and reports the time per power state and the estimated duty cycle.
+// fanout connects a fast desktop, a phone in binary format and a slow monitor on the default MTU at once,
+// and compares what each of them receives with the desktop connected alone.
+// channels sweeps 1, 2 and 4 joysticks at once and reports how the sampling cost grows with the channel
+// count, and how many channel states each notification carries.
+// pixel_output sends the same frames through Adafruit_NeoPixel and the RMT output, to one ring and to two in
+// parallel, and compares the time show() blocks and the time until every frame is on the strips.
+// It also times the RMT symbol encoder alone.
+// pixel_ring times pixel writes, bulk fills, levels and whole frames of StaticPixelRing and PixelController.
+// metrics reports the timed paths of a fast sweep and the cost of a timer.
+//
+// Whether the results are right is checked by toneos_tests; this program only reports numbers.
+//
+// Usage: toneos_bench [--tick us] [scenario ...]
+//
+
+#include "SimScenario.h"
+#include "StaticPixelRing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef TONEOS_BUILD_ID
+#define TONEOS_BUILD_ID "unknown"
+#endif
+
+static void printPercentiles(const char *name, const Percentiles &p) {
+    printf("\"%s\": {\"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f}", name, p.p50, p.p99, p.max);
+}
+
+static void printScenario(const Scenario &scenario, unsigned long tickUs, bool first) {
+    ScenarioRun run = runScenario(scenario, tickUs);
+    printf("%s\n    {\"name\": \"%s\", \"duration_ms\": %lu, \"updates\": %zu, ",
+           first ? "" : ",", scenario.name, scenario.durationMs, run.hostNs.size());
+    printPercentiles("update_host_ns", percentiles(run.hostNs));
+    printf(", \"shows\": %zu, \"shows_skipped\": %lu, \"value_changes\": %lu, \"notifies\": %zu, "
+           "\"notify_bytes\": %zu, \"latency_samples\": %zu, ",
+           run.shows, run.showsSkipped, run.valueChanges, run.notifies.size(), run.notifyBytes, run.latencies.size());
+    printPercentiles("input_to_notify_ms", percentiles(run.latencies));
+    printf(", \"allocations\": %lu, \"allocations_per_update\": %.4f}",
+           run.allocations, run.hostNs.empty() ? 0.0 : (double) run.allocations / run.hostNs.size());
+}
+
+static void printMailboxHandoff(bool first) {
+    HandoffRun run = runMailboxHandoff();
+    printf("%s\n    {\"name\": \"mailbox_handoff\", \"posts\": %d, \"takes\": %lu, \"host_ms\": %.1f}",
+           first ? "" : ",", HANDOFF_COUNT, run.takes, run.hostMs);
+}
+
+static void printCommandQueueHandoff(bool first) {
+    HandoffRun run = runCommandQueueHandoff();
+    printf("%s\n    {\"name\": \"command_queue_handoff\", \"commands\": %d, \"queue_full\": %lu, \"host_ms\": %.1f}",
+           first ? "" : ",", HANDOFF_COUNT, run.full, run.hostMs);
+}
+
+template<int EFFECT>
+static void printEffect(bool first) {
+    const EffectCase &effect = EFFECT_CASES[EFFECT];
+    EffectRun run = effect.run();
+    printf("%s\n    {\"name\": \"%s\", \"frames\": %d, ", first ? "" : ",", effect.name, EFFECT_FRAMES);
+    printPercentiles("render_host_ns", percentiles(run.hostNs));
+    printf("}");
+}
+
+static void printPersistence(bool first) {
+    PersistenceRun run = runPersistence();
+    printf("%s\n    {\"name\": \"persistence\", \"sweeps\": %d, \"value_changes\": %lu, \"flash_writes\": %lu, "
+           "\"flash_bytes\": %zu, \"first_boot_sim_ms\": %lu, \"restored_boot_sim_ms\": %lu, \"restore_host_us\": %.1f}",
+           first ? "" : ",", PERSIST_SWEEPS, run.valueChanges, run.flashWrites, run.flashBytes, run.firstBootMs,
+           run.restoredBootMs, run.restoreHostUs);
+}
+
+static void printCalibration(bool first) {
+    CalibrationRun run = runCalibration();
+    printf("%s\n    {\"name\": \"calibration\", \"startup_ms\": %.2f, \"origin_error\": %d, \"dead_zone\": %d, "
+           "\"travel_lost_pct\": %.1f, \"drift_samples\": %lu, \"drift_origin_error\": %d, \"angle_error_max_deg\": %d}",
+           first ? "" : ",", run.startupUs / 1000.0, run.originError, run.deadZone,
+           100.0 * run.deadZone / (JOY_ADC_MAX + 1), run.samples, run.driftError, run.angleError);
+}
+
+#define JOG_TIMEOUT_TICKS 1500
+#define JOG_AIM_ERROR 4
+
+static const modeSpec JOG_MODES[] = {
+        {"Absolute", 0, 100, {255, 255, 155}, 150, MODE_INPUT_ABSOLUTE},
+        {"Jog", 0, 100, {255, 255, 155}, 150, MODE_INPUT_RELATIVE},
+        {"FineAbsolute", 0, 1000, {255, 255, 255}, 150, MODE_INPUT_ABSOLUTE},
+        {"FineJog", 0, 1000, {255, 255, 255}, 150, MODE_INPUT_RELATIVE},
+};
+
+static const int JOG_TARGETS_100[] = {37, 62, 63, 20};
+static const int JOG_TARGETS_1000[] = {613, 250, 251, 747};
+
+/**
+ * @brief Moves the stick to an angle (0 = start of the ring) or to the center, then runs one joystick sample.
+ */
+static void jogTick(ToneController &tone, int angle, bool deflected) {
+    SimHal &hal = SimHal::instance();
+    double radians = (angle - 90) * PI / 180.0;
+    hal.setAnalog(SCENARIO_X_PIN, deflected ? (int) lround(2048 + SCENARIO_RADIUS * cos(radians)) : 2048);
+    hal.setAnalog(SCENARIO_Y_PIN, deflected ? (int) lround(2048 + SCENARIO_RADIUS * sin(radians)) : 2048);
+    for (int i = 0; i < SAMPLE_INTERVAL_MS; i++) {
+        tone.update();
+        hal.advance(1000);
+    }
+}
+
+/**
+ * @brief Simulated user dialing in a target. Absolute: point at the target's angle, missing it by
+ * JOG_AIM_ERROR degrees, then nudge one degree at a time. Relative: turn with a speed that follows
+ * the remaining distance in steps, reversing on overshoot.
+ * @return Samples until the value equals the target, JOG_TIMEOUT_TICKS if it never does.
+ */
+static int dialTarget(ToneController &tone, const modeSpec &spec, int target, int aim) {
+    long range = spec.maxValue - spec.minValue;
+    int angle = spec.input == MODE_INPUT_RELATIVE ? 0 : (int) ((target - spec.minValue) * MAX_MAPPED_ANGLE / range) + aim;
+    for (int tick = 1; tick <= JOG_TIMEOUT_TICKS; tick++) {
+        jogTick(tone, (angle % 360 + 360) % 360, true);
+        int error = target - tone.getCurrentValue();
+        if (error == 0) {
+            for (int i = 0; i < 20; i++) jogTick(tone, 0, false);
+            return tick;
+        }
+        if (spec.input == MODE_INPUT_RELATIVE) {
+            angle += (error > 0 ? 1 : -1) * min(12, 1 + abs(error) / 3);
+        } else {
+            angle += error > 0 ? 1 : -1;
+        }
+    }
+    for (int i = 0; i < 20; i++) jogTick(tone, 0, false);
+    return JOG_TIMEOUT_TICKS;
+}
+
+static void runJogReplay(bool first) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    tone.begin();
+    int modeCount = sizeof(JOG_MODES) / sizeof(JOG_MODES[0]);
+    for (int i = 0; i < modeCount; i++) tone.setMode(i, &JOG_MODES[i]);
+    hal.setAdcNoise(20);
+
+    printf("%s\n    {\"name\": \"jog_replay\", \"tick_ms\": %d", first ? "" : ",", SAMPLE_INTERVAL_MS);
+    for (int i = 0; i < modeCount; i++) {
+        tone.setCurrentMode(i);
+        const int *targets = JOG_MODES[i].maxValue == 100 ? JOG_TARGETS_100 : JOG_TARGETS_1000;
+        int total = 0, reached = 0;
+        printf(", \"%s\": {\"ticks\": [", JOG_MODES[i].name);
+        for (int t = 0; t < 4; t++) {
+            int ticks = dialTarget(tone, JOG_MODES[i], targets[t], t % 2 ? -JOG_AIM_ERROR : JOG_AIM_ERROR);
+            total += ticks;
+            if (ticks < JOG_TIMEOUT_TICKS) reached++;
+            printf("%s%d", t ? ", " : "", ticks);
+        }
+        printf("], \"total\": %d, \"reached\": %d}", total, reached);
+    }
+    printf("}");
+}
+
+#define RECORDER_RECORDS 1000000
+
+static void runRecorder(bool first) {
+    runRecorderSession(RECORDER_SESSION_MS, false);  // Warm up
+    RecorderRun off = runRecorderSession(RECORDER_SESSION_MS, false);
+    RecorderRun on = runRecorderSession(RECORDER_SESSION_MS, true);
+    Percentiles offNs = percentiles(off.hostNs);
+    Percentiles onNs = percentiles(on.hostNs);
+    double offMean = 0, onMean = 0;
+    for (double ns : off.hostNs) offMean += ns / off.hostNs.size();
+    for (double ns : on.hostNs) onMean += ns / on.hostNs.size();
+
+    // Raw cost of one sample record, the most frequent one
+    EventRecorder *recorder = new EventRecorder();
+    auto hostStart = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < RECORDER_RECORDS; i++) {
+        recorder->recordSample(i / 10, 0, i & 0xFFF, (i >> 3) & 0xFFF);
+    }
+    auto hostEnd = std::chrono::steady_clock::now();
+    double recordNs = std::chrono::duration<double, std::nano>(hostEnd - hostStart).count() / RECORDER_RECORDS;
+    delete recorder;
+
+    size_t records;
+    replayResult replay = replayRecorded(on.log, records);
+
+    // A log that wrapped: the replay starts at the first keyframe left in the ring
+    RecorderRun wrapped = runRecorderSession(RECORDER_WRAP_MS, true);
+    size_t wrappedRecords;
+    replayResult wrappedReplay = replayRecorded(wrapped.log, wrappedRecords);
+
+    printf("%s\n    {\"name\": \"recorder\", \"ring_bytes\": %d, ", first ? "" : ",", RECORDER_BYTES);
+    printPercentiles("update_host_ns_off", offNs);
+    printf(", ");
+    printPercentiles("update_host_ns_on", onNs);
+    printf(", \"update_host_ns_mean_off\": %.1f, \"update_host_ns_mean_on\": %.1f", offMean, onMean);
+    printf(", \"record_sample_host_ns\": %.2f, \"log_bytes\": %zu, \"records\": %zu, \"bytes_per_s\": %.0f, "
+           "\"records_per_s\": %.0f, \"replay_expected\": %zu, \"replay_max_skew_ms\": %ld, \"wrapped_dropped\": %lu, "
+           "\"wrapped_expected\": %zu, \"wrapped_max_skew_ms\": %ld}",
+           recordNs, on.bytes, records, on.bytes * 1000.0 / RECORDER_SESSION_MS,
+           records * 1000.0 / RECORDER_SESSION_MS, replay.expected, replay.maxSkewMs, wrapped.dropped,
+           wrappedReplay.expected, wrappedReplay.maxSkewMs);
+}
+
+static void printPowerRun(const char *name, const PowerRun &run) {
+    static const char *const STATE_NAMES[POWER_STATES] = {"active", "idle", "dim", "sleep"};
+    printf("\"%s\": {\"updates\": %lu, \"state_ms\": {", name, run.updates);
+    for (int i = 0; i < POWER_STATES; i++) {
+        printf("%s\"%s\": %lu", i ? ", " : "", STATE_NAMES[i], run.report.stateMs[i]);
+    }
+    printf("}, \"busy_us\": %lu, \"sleep_ms\": %lu, \"wakes\": %lu, \"duty_cycle_pct\": %.3f, "
+           "\"sweep_duty_cycle_pct\": %.3f, \"blank_duty_cycle_pct\": %.4f, \"average_ua\": %.0f, "
+           "\"dim_brightness\": %d, \"sleep_brightness\": %d, \"sleep_adv_interval\": %u, "
+           "\"idle_stick_to_value_ms\": %ld}",
+           run.report.busyUs, run.report.sleepUs / 1000, run.report.wakes, run.report.dutyCycle * 100,
+           run.sweepDutyCycle * 100, run.blankDutyCycle * 100, run.report.averageUa, run.dimBrightness,
+           run.sleepBrightness, run.sleepAdvertising, run.wakeLatencyMs);
+}
+
+static void runPower(bool first) {
+    PowerRun alone = runPowerLoop(false);
+    PowerRun connected = runPowerLoop(true);
+
+    // The old loop: update() every millisecond, a sample every SAMPLE_INTERVAL_MS, never asleep
+    unsigned long fixedUpdates = POWER_RUN_MS;
+    printf("%s\n    {\"name\": \"power\", \"duration_ms\": %d, \"fixed_loop_updates\": %lu, ",
+           first ? "" : ",", POWER_RUN_MS, fixedUpdates);
+    printPowerRun("no_client", alone);
+    printf(", ");
+    printPowerRun("connected", connected);
+    printf("}");
+}
+
+static void printFanoutClient(const FanoutSpec &spec, const FanoutClientRun &client) {
+    printf("\"%s\": {\"interval_ms\": %.2f, \"mtu\": %u, \"format\": \"%s\", \"states\": %zu, "
+           "\"notifies\": %zu, \"bytes\": %zu, \"coalesced\": %lu, \"lost\": %lu, \"rejected\": %lu, "
+           "\"acks\": %zu, \"configs\": %zu, ",
+           spec.name, spec.interval * 1.25, client.stats.mtu, spec.binary ? "bin" : "json", client.payloads,
+           client.notifies, client.bytes, client.stats.coalesced, client.stats.lost, client.rejected,
+           client.acks, client.configs);
+    printPercentiles("input_to_notify_ms", client.latency);
+    printf("}");
+}
+
+static void runFanout(bool first) {
+    FanoutRun alone = runFanoutSession(1);
+    FanoutRun shared = runFanoutSession(FANOUT_SPEC_COUNT);
+
+    printf("%s\n    {\"name\": \"fanout\", \"alone\": {", first ? "" : ",");
+    printFanoutClient(FANOUT_SPECS[0], alone.clients[0]);
+    printf(", \"update_host_ns_mean\": %.1f}, \"shared\": {", alone.updateHostNsMean);
+    for (size_t i = 0; i < FANOUT_SPEC_COUNT; i++) {
+        printFanoutClient(FANOUT_SPECS[i], shared.clients[i]);
+        printf(", ");
+    }
+    printf("\"update_host_ns_mean\": %.1f}, \"published\": %lu, \"json_encoded\": %lu, \"binary_encoded\": %lu}",
+           shared.updateHostNsMean, shared.published, shared.jsonEncoded, shared.binaryEncoded);
+}
+
+static void printChannelClient(const char *name, const ChannelClientRun &run) {
+    printf("\"%s\": {\"notifies\": %zu, \"states\": %zu, \"states_per_notify\": %.2f, \"max_states_per_notify\": %zu}",
+           name, run.payloads, run.states, run.payloads ? (double) run.states / run.payloads : 0.0, run.maxStates);
+}
+
+static void runChannels(bool first) {
+    printf("%s\n    {\"name\": \"channels\", \"duration_ms\": %d, \"runs\": [", first ? "" : ",", CHANNEL_RUN_MS);
+    for (size_t i = 0; i < sizeof(CHANNEL_COUNTS) / sizeof(CHANNEL_COUNTS[0]); i++) {
+        ChannelRun run = runChannelSession(CHANNEL_COUNTS[i]);
+        printf("%s{\"channels\": %d, ", i ? ", " : "", CHANNEL_COUNTS[i]);
+        printPercentiles("sample_host_ns", run.sampleHostNs);
+        printf(", ");
+        printPercentiles("blocked_sim_us", run.blockedSimUs);
+        printf(", \"adc_reads_per_sample\": %.1f, \"value_changes\": %lu, ", run.adcReadsPerSample, run.valueChanges);
+        printChannelClient("json", run.json);
+        printf(", ");
+        printChannelClient("binary", run.binary);
+        printf("}");
+    }
+    printf("]}");
+}
+
+#define OUTPUT_ENCODES 100000
+#define OUTPUT_ENCODE_PIXELS 60
+
+static void printOutputRun(const char *name, const OutputRun &run) {
+    printf("\"%s\": {\"blocked_sim_us\": %.1f, \"frame_sent_us\": %.1f, \"shown_callbacks\": %lu}", name,
+           run.blockedUs, run.doneUs, run.shown);
+}
+
+static void runPixelOutput(bool first) {
+    // Encoder alone, the CPU time of an RMT show() (the simulated strip's decoding would swamp it)
+    uint32_t colors[OUTPUT_ENCODE_PIXELS];
+    static uint32_t symbols[PIXEL_SYMBOLS(OUTPUT_ENCODE_PIXELS)];
+    volatile uint32_t checksum = 0;
+    for (int i = 0; i < OUTPUT_ENCODE_PIXELS; i++) colors[i] = 0x010203 * i;
+    auto encodeStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < OUTPUT_ENCODES; i++) {
+        colors[i % OUTPUT_ENCODE_PIXELS] ^= i;
+        PixelEncoder::encode(colors, OUTPUT_ENCODE_PIXELS, symbols);
+        checksum = checksum ^ symbols[i % PIXEL_SYMBOLS(OUTPUT_ENCODE_PIXELS)];
+    }
+    double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - encodeStart).count();
+
+    printf("%s\n    {\"name\": \"pixel_output\", \"frames\": %d, \"encode_ns_per_pixel\": %.2f, \"runs\": [",
+           first ? "" : ",", OUTPUT_FRAMES, encodeNs / OUTPUT_ENCODES / OUTPUT_ENCODE_PIXELS);
+    bool firstRun = true;
+    for (int pixels : OUTPUT_SIZES) {
+        for (int strips = 1; strips <= PIXEL_RMT_CHANNELS; strips++) {
+            OutputRun neoPixel = runOutputSession(pixels, strips, false);
+            OutputRun rmt = runOutputSession(pixels, strips, true);
+            printf("%s{\"pixels\": %d, \"strips\": %d, ", firstRun ? "" : ", ", pixels, strips);
+            printOutputRun("neopixel", neoPixel);
+            printf(", ");
+            printOutputRun("rmt", rmt);
+            printf("}");
+            firstRun = false;
+        }
+    }
+    printf("]}");
+}
+
+#define RING_OPS 200000
+
+struct RingTiming {
+    double setPixelNs = 0; ///< setPixelColor() of one pixel
+    double firstNNs = 0;   ///< setFirstnPixelColor() of up to the whole ring
+    double levelNs = 0;    ///< setLevel()
+    double frameNs = 0;    ///< setLevel() and show()
+};
+
+template<typename Ring>
+static RingTiming timeRing(Ring &ring, int pixels) {
+    RingTiming timing;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RING_OPS; i++) {
+        ring.setPixelColor(i % pixels, (uint32_t) i & 0xFFFFFF);
+    }
+    timing.setPixelNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RING_OPS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RING_OPS; i++) {
+        ring.setFirstnPixelColor(i % pixels + 1, i & 0xFF, 0, 40);
+    }
+    timing.firstNNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RING_OPS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RING_OPS; i++) {
+        ring.setLevel((int32_t) i * 37 % (pixels * LEVEL_ONE), 0xFF8000);
+    }
+    timing.levelNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RING_OPS;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RING_OPS; i++) {
+        ring.setLevel((int32_t) i * 37 % (pixels * LEVEL_ONE), 0xFF8000);
+        ring.show();
+    }
+    timing.frameNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / RING_OPS;
+    return timing;
+}
+
+static void printRingTiming(const char *name, const RingTiming &timing) {
+    printf("\"%s\": {\"set_pixel_ns\": %.2f, \"first_n_ns\": %.2f, \"level_ns\": %.2f, \"level_show_ns\": %.2f}", name,
+           timing.setPixelNs, timing.firstNNs, timing.levelNs, timing.frameNs);
+}
+
+/**
+ * @brief Times a runtime and a compile-time ring of the same geometry.
+ */
+template<int N, int OFFSET, bool REVERSE>
+static void runRingTiming(bool first) {
+    PixelController runtime(new CaptureOutput(N), N, OFFSET, REVERSE);
+    StaticPixelRing<N, OFFSET, REVERSE> ring(new CaptureOutput(N));
+    RingTiming runtimeTiming = timeRing(runtime, N);
+    RingTiming staticTiming = timeRing(ring, N);
+    printf("%s{\"pixels\": %d, \"offset\": %d, \"reverse\": %s, ", first ? "" : ", ", N, OFFSET,
+           REVERSE ? "true" : "false");
+    printRingTiming("runtime", runtimeTiming);
+    printf(", ");
+    printRingTiming("static", staticTiming);
+    printf(", \"object_bytes\": {\"runtime\": %zu, \"static\": %zu}}",
+           sizeof(PixelController) + N * (sizeof(bool) + 2 * sizeof(uint32_t)), sizeof(ring));
+}
+
+static void runPixelRing(bool first) {
+    printf("%s\n    {\"name\": \"pixel_ring\", \"ops\": %d, \"runs\": [", first ? "" : ",", RING_OPS);
+    runRingTiming<SCENARIO_PIXELS, 0, true>(true);
+    runRingTiming<12, 5, false>(false);
+    runRingTiming<60, 17, true>(false);
+    printf("]}");
+}
+
+#if TONE_METRICS
+#define METRICS_TIMER_LOOPS 1000000
+
+static void printMetrics(bool first) {
+    MetricsRun run = runMetrics();
+    printf("%s\n    {\"name\": \"metrics\", \"paths\": {", first ? "" : ",");
+    for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+        const metricHistogram &histogram = run.histograms[metric];
+        printf("%s\"%s\": {\"count\": %lu, \"mean_ns\": %lu, \"p50_ns\": %lu, \"p99_ns\": %lu, \"max_ns\": %lu}",
+               metric ? ", " : "", ToneMetrics::name((ToneMetric) metric), (unsigned long) histogram.count,
+               (unsigned long) (histogram.count ? histogram.totalNs / histogram.count : 0),
+               (unsigned long) run.p50Ns[metric], (unsigned long) run.p99Ns[metric], (unsigned long) histogram.maxNs);
+    }
+
+    // Cost of a timer itself: an empty scope
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < METRICS_TIMER_LOOPS; i++) {
+        TONE_METRIC_SCOPE(METRIC_MAPPING);
+    }
+    double timerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+                     / METRICS_TIMER_LOOPS;
+    ToneMetrics::reset();
+
+    printf("}, \"live_snapshots\": %zu, \"timer_ns\": %.1f, \"snapshot_bytes\": %d}", run.liveSnapshots, timerNs,
+           (int) METRIC_SNAPSHOT_SIZE);
+}
+#endif
+
+struct HostCheck {
+    const char *name;
+    void (*run)(bool first);
+};
+
+static const HostCheck HOST_CHECKS[] = {
+        {"mailbox_handoff",       printMailboxHandoff},
+        {"command_queue_handoff", printCommandQueueHandoff},
+        {"effect_blink",          printEffect<0>},
+        {"effect_wipe",           printEffect<1>},
+        {"effect_pulse",          printEffect<2>},
+        {"effect_level",          printEffect<3>},
+        {"effect_crossfade",      printEffect<4>},
+        {"persistence",           printPersistence},
+        {"calibration",           printCalibration},
+        {"jog_replay",            runJogReplay},
+        {"recorder",              runRecorder},
+        {"power",                 runPower},
+        {"fanout",                runFanout},
+        {"channels",              runChannels},
+        {"pixel_output",          runPixelOutput},
+        {"pixel_ring",            runPixelRing},
+#if TONE_METRICS
+        {"metrics",               printMetrics},
+#endif
+};
+
+static bool isSelected(const std::vector<const char *> &selected, const char *name) {
+    bool wanted = selected.empty();
+    for (const char *entry : selected) wanted |= !strcmp(entry, name);
+    return wanted;
+}
+
+int main(int argc, char **argv) {
+    unsigned long tickUs = 1000;
+    std::vector<const char *> selected;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--tick") && i + 1 < argc) tickUs = strtoul(argv[++i], nullptr, 10);
+        else selected.push_back(argv[i]);
+    }
+
+    printf("{\"build\": \"%s\", \"tick_us\": %lu, \"scenarios\": [", TONEOS_BUILD_ID, tickUs);
+    bool first = true;
+    for (const Scenario &scenario : SCENARIOS) {
+        if (!isSelected(selected, scenario.name)) continue;
+        printScenario(scenario, tickUs, first);
+        first = false;
+    }
+    for (const HostCheck &check : HOST_CHECKS) {
+        if (!isSelected(selected, check.name)) continue;
+        check.run(first);
+        first = false;
+    }
+    printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,71 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Replays an event log dumped by a device (`log` command) into the unmodified toneOS sketch
+// and checks that it makes the same mode and value changes.
+//
+// Usage: toneos_replay <dump.txt> [--tick us] [--events]
+//
+
+#include "SimHal.h"
+#include "EventReplay.h"
+#include "../toneOS.ino"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static const char *const RECORD_NAMES[REC_TYPES] = {
+    "time", "sample", "button", "mode", "value", "command", "notify", "connect", "disconnect", "keyframe",
+    "channel"
+};
+
+int main(int argc, char **argv) {
+    const char *dumpPath = nullptr;
+    unsigned long tickUs = 1000;
+    bool listEvents = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--tick") && i + 1 < argc) tickUs = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--events")) listEvents = true;
+        else if (argv[i][0] != '-' && dumpPath == nullptr) dumpPath = argv[i];
+        else {
+            dumpPath = nullptr;
+            break;
+        }
+    }
+    if (dumpPath == nullptr) {
+        fprintf(stderr, "usage: %s <dump.txt> [--tick us] [--events]\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream file(dumpPath);
+    std::stringstream text;
+    text << file.rdbuf();
+    eventLog log;
+    if (!file || !parseLogDump(text.str(), log)) {
+        fprintf(stderr, "cannot read a log dump from %s\n", dumpPath);
+        return 1;
+    }
+    std::vector<recordEntry> events;
+    bool complete = decodeEventLog(log, events);
+
+    if (listEvents) {
+        for (const recordEntry &event : events) {
+            printf("%lu %u %s", event.time, event.channel, RECORD_NAMES[event.type]);
+            for (int32_t arg : event.args) printf(" %d", (int) arg);
+            printf("\n");
+        }
+    }
+
+    setup();
+    replayResult result = replayEventLog(events, tne, XPIN, YPIN, SWPIN, tickUs);
+    printf("{\"bytes\": %zu, \"records\": %zu, \"complete\": %s, \"keyframe\": %s, \"events\": %zu, "
+           "\"expected\": %zu, \"replayed\": %zu, \"mismatches\": %zu, \"max_skew_ms\": %ld, "
+           "\"skipped_commands\": %zu, \"notifies\": %lu, \"replayed_notifies\": %lu}\n",
+           log.bytes.size(), events.size(), complete ? "true" : "false", result.keyframe ? "true" : "false",
+           result.events, result.expected, result.replayed, result.mismatches, result.maxSkewMs,
+           result.skippedCommands, result.notifies, result.replayedNotifies);
+    return result.keyframe && result.mismatches == 0 ? 0 : 1;
+}
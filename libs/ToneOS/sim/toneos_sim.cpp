@@ -0,0 +1,87 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Runs the unmodified toneOS sketch against SimHal.
+//
+// Usage: toneos_sim [--trace file] [--duration ms] [--tick us] [--connect] [--echo]
+//                   [--frames file.csv] [--notifies file.csv]
+//
+
+#include "SimHal.h"
+#include "../toneOS.ino"
+
+#include <cstdio>
+#include <cstring>
+
+static void writeFrames(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) return;
+    fprintf(file, "time_us,pin,brightness,pixels\n");
+    for (const SimFrame &frame : SimHal::instance().frames()) {
+        fprintf(file, "%lu,%d,%u,", frame.time, frame.pin, frame.brightness);
+        for (size_t i = 0; i < frame.pixels.size(); i++) {
+            fprintf(file, "%s%06X", i ? " " : "", (unsigned) frame.pixels[i]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+static void writeNotifies(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == nullptr) return;
+    fprintf(file, "time_us,conn_id,length,payload_hex\n");
+    for (const SimNotify &notify : SimHal::instance().notifies()) {
+        fprintf(file, "%lu,%u,%zu,", notify.time, notify.connId, notify.payload.size());
+        for (unsigned char c : notify.payload) fprintf(file, "%02X", c);
+        fprintf(file, "\n");
+    }
+    fclose(file);
+}
+
+int main(int argc, char **argv) {
+    const char *tracePath = nullptr;
+    const char *framesPath = nullptr;
+    const char *notifiesPath = nullptr;
+    unsigned long durationMs = 5000;
+    unsigned long tickUs = 1000;
+    bool connect = false;
+
+    SimHal &hal = SimHal::instance();
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--trace") && i + 1 < argc) tracePath = argv[++i];
+        else if (!strcmp(argv[i], "--duration") && i + 1 < argc) durationMs = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--tick") && i + 1 < argc) tickUs = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--frames") && i + 1 < argc) framesPath = argv[++i];
+        else if (!strcmp(argv[i], "--notifies") && i + 1 < argc) notifiesPath = argv[++i];
+        else if (!strcmp(argv[i], "--connect")) connect = true;
+        else if (!strcmp(argv[i], "--echo")) hal.setSerialEcho(true);
+        else {
+            fprintf(stderr, "usage: %s [--trace file] [--duration ms] [--tick us] [--connect] [--echo] "
+                            "[--frames file.csv] [--notifies file.csv]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (tracePath != nullptr && !hal.loadTrace(tracePath)) {
+        fprintf(stderr, "cannot read trace %s\n", tracePath);
+        return 1;
+    }
+
+    setup();
+    if (connect) hal.connect();
+
+    while (hal.millis() < durationMs) {
+        loop();
+        hal.advance(tickUs);
+    }
+
+    size_t notifyBytes = 0;
+    for (const SimNotify &notify : hal.notifies()) notifyBytes += notify.payload.size();
+    printf("{\"duration_ms\": %lu, \"frames\": %zu, \"notifies\": %zu, \"notify_bytes\": %zu}\n",
+           hal.millis(), hal.frames().size(), hal.notifies().size(), notifyBytes);
+
+    if (framesPath != nullptr) writeFrames(framesPath);
+    if (notifiesPath != nullptr) writeNotifies(notifiesPath);
+    return 0;
+}
@@ -0,0 +1,756 @@
+//
+// Created by Ata Can Yaymacı on 17.10.2026.
+//
+// Pass/fail checks of ToneOS on the simulator, registered with CTest. Every test runs sessions of
+// SimScenario and prints each expectation that did not hold; the exit code is 1 if any test failed.
+// Timings are not checked here, toneos_bench reports them.
+//
+// Usage: toneos_tests [test ...]
+//
+
+#include "SimScenario.h"
+#include "StaticPixelRing.h"
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define RING_STEPS 5000
+#define CAL_ANGLE_TOLERANCE 4 ///< Degrees the calibrated joystick may be off after a full turn
+#define ANGLE_TOLERANCE 1     ///< Degrees the integer angle routine may differ from atan2()
+#define SWEEP_STEP_MS 1       ///< Time between two values of the scheduler sweep
+#define LATENCY_BUDGET_MS 150 ///< Worst input to notify latency of any scenario
+#define CHANNEL_RECORDS 20000 ///< Samples of the channel tagging check, the ring wraps many times
+#define CHANNEL_X_STEP 1000   ///< Stick X of a tagging sample: channel * CHANNEL_X_STEP + sequence
+
+static bool testFailed = false;
+
+/**
+ * @brief Fails the running test with a message if the condition does not hold.
+ */
+static void expect(bool condition, const char *format, ...) {
+    if (condition) return;
+    testFailed = true;
+    va_list args;
+    va_start(args, format);
+    printf("    ");
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+/**
+ * @brief Sweeps every pair of ADC readings, centered like a calibrated stick, through the integer angle routine
+ * and the float atan2() path. fastAtan2() must stay within ANGLE_TOLERANCE of the exact angle, and the whole
+ * degrees readAngle() reports with JOY_FAST_ANGLE 1 and 0 may differ by no more than that.
+ */
+static void testAngle() {
+    double worstError = 0;
+    int worstDegrees = 0;
+    int worstX = 0, worstY = 0;
+    for (int adcX = 0; adcX <= JOY_ADC_MAX; adcX++) {
+        for (int adcY = 0; adcY <= JOY_ADC_MAX; adcY++) {
+            int x = adcX - JOY_AXIS_SPAN;
+            int y = adcY - JOY_AXIS_SPAN;
+            if (x == 0 && y == 0) continue;
+
+            double exact = atan2((double) y, (double) x) * 180.0 / PI;
+            if (exact < 0) exact += 360;
+            double error = fabs(JoystickController::fastAtan2(y, x) / (double) JOY_ANGLE_SCALE - exact);
+            error = std::min(error, 360 - error);
+            if (error > worstError) {
+                worstError = error;
+                worstX = x;
+                worstY = y;
+            }
+
+            int degrees = abs(JoystickController::angleOf(y, x, 90) - JoystickController::angleOfFloat(y, x, 90));
+            worstDegrees = std::max(worstDegrees, std::min(degrees, 360 - degrees));
+        }
+    }
+    expect(worstError <= ANGLE_TOLERANCE, "fastAtan2() off by %.3f degrees at (%d, %d)", worstError, worstX, worstY);
+    expect(worstDegrees <= ANGLE_TOLERANCE, "readAngle() paths differ by %d degrees", worstDegrees);
+}
+
+/**
+ * @brief Submits a 0 to 100 sweep, one value every SWEEP_STEP_MS, to a NotifyScheduler polled on a fake clock.
+ * The intermediate values must be coalesced to one notification per interval, in order, ending at 100.
+ * Then switches mode 0 to mode 1 and back within one interval: the host must end on mode 0 and its last value.
+ */
+static void testNotifyScheduler() {
+    NotifyScheduler scheduler;
+    toneState state;
+    toneState out[TONE_MAX_CHANNELS];
+    unsigned long now = 1000;
+    size_t notifies = 0;
+    int lastValue = -1;
+    bool ordered = true;
+
+    auto poll = [&]() {
+        uint8_t count = scheduler.next(now, out);
+        if (count == 0) return;
+        notifies++;
+        if (out[0].value <= lastValue) ordered = false;
+        lastValue = out[0].value;
+    };
+
+    for (int value = 0; value <= 100; value++) {
+        state.value = value;
+        scheduler.submit(state);
+        poll();
+        now += SWEEP_STEP_MS;
+    }
+    // Drain what the rate limit still holds
+    for (unsigned long t = 0; t < 2 * NOTIFY_DEFAULT_INTERVAL_MS; t++) {
+        poll();
+        now++;
+    }
+
+    size_t budget = 100 * SWEEP_STEP_MS / NOTIFY_DEFAULT_INTERVAL_MS + 2;
+    expect(notifies <= budget, "%zu notifications for the sweep, at most %zu expected", notifies, budget);
+    expect(lastValue == 100, "last value delivered %d, 100 expected", lastValue);
+    expect(ordered, "a value was delivered after a newer one");
+    expect(scheduler.getQueueDepth() == 0, "%u states still pending", scheduler.getQueueDepth());
+    expect(scheduler.getSent() + scheduler.getCoalesced() == 101, "%lu sent and %lu coalesced of 101 values",
+           scheduler.getSent(), scheduler.getCoalesced());
+
+    const struct {
+        uint8_t modeIndex;
+        int value;
+    } switches[] = {{0, 1}, {1, 5}, {0, 3}};
+    for (const auto &change : switches) {
+        state.modeIndex = change.modeIndex;
+        state.value = change.value;
+        scheduler.submit(state);
+    }
+    toneState last;
+    for (unsigned long t = 0; t < 4 * NOTIFY_DEFAULT_INTERVAL_MS; t++, now++) {
+        if (scheduler.next(now, out) > 0) last = out[0];
+    }
+    expect(last.modeIndex == 0 && last.value == 3, "mode switches: host ends on mode %u value %d, mode 0 value 3",
+           last.modeIndex, (int) last.value);
+}
+
+/**
+ * @brief Runs every scenario on the simulated clock, updating every millisecond, and checks the worst input to
+ * notify latency against LATENCY_BUDGET_MS.
+ */
+static void testLatency() {
+    size_t samples = 0;
+    for (const Scenario &scenario : SCENARIOS) {
+        ScenarioRun run = runScenario(scenario, 1000);
+        samples += run.latencies.size();
+        double worst = percentiles(run.latencies).max;
+        expect(worst <= LATENCY_BUDGET_MS, "%s: input to notify took %.0f ms", scenario.name, worst);
+    }
+    expect(samples > 0, "no notify answered an input");
+}
+
+/**
+ * @brief Runs every scenario at 1 ms and 250 us update ticks and checks that update() never allocates once
+ * begin() has returned.
+ */
+static void testAllocations() {
+    for (const Scenario &scenario : SCENARIOS) {
+        for (unsigned long tickUs : {1000UL, 250UL}) {
+            ScenarioRun run = runScenario(scenario, tickUs);
+            expect(run.allocations == 0, "%s at %lu us: %lu allocations in update()", scenario.name, tickUs,
+                   run.allocations);
+        }
+    }
+}
+
+static void testHandoff() {
+    HandoffRun mailbox = runMailboxHandoff();
+    expect(mailbox.torn == 0, "mailbox: %lu torn states", mailbox.torn);
+    expect(mailbox.reordered == 0, "mailbox: %lu states older than one taken before", mailbox.reordered);
+    expect(mailbox.latestDelivered, "mailbox: the last state posted was never taken");
+
+    HandoffRun queue = runCommandQueueHandoff();
+    expect(queue.torn == 0, "command queue: %lu torn commands", queue.torn);
+    expect(queue.lost == 0, "command queue: %lu commands lost", queue.lost);
+    expect(queue.latestDelivered, "command queue: the last command never arrived");
+
+    MessageRun messages = runMessages();
+    expect(messages.configs == messages.modes, "messages: %zu of %zu mode configurations", messages.configs,
+           messages.modes);
+    expect(messages.acks == 1, "messages: %zu acknowledgements of get", messages.acks);
+    expect(messages.dropped == 0, "messages: %lu payloads dropped", messages.dropped);
+    expect(messages.sentByInput == 0, "messages: sendText() sent %zu notifications itself", messages.sentByInput);
+    expect(messages.sentByNotify == 1, "messages: update() sent %zu notifications", messages.sentByNotify);
+}
+
+static void testEffects() {
+    for (const EffectCase &effect : EFFECT_CASES) {
+        EffectRun run = effect.run();
+        expect(run.blockedUs == 0, "%s: render() blocked for %lu us", effect.name, run.blockedUs);
+    }
+}
+
+/**
+ * @brief Total light of the last transmitted frame, the sum of every output channel.
+ */
+static unsigned long frameLight() {
+    unsigned long light = 0;
+    for (uint32_t color : SimHal::instance().frames().back().pixels) {
+        light += ((color >> 16) & 0xFF) + ((color >> 8) & 0xFF) + (color & 0xFF);
+    }
+    return light;
+}
+
+/**
+ * @brief Sets every value of every LEVEL_MODES mode over BLE and checks that the light of the ring never
+ * drops when the value grows.
+ */
+static void testLevelMonotonic() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    tone.begin();
+    int modeCount = sizeof(LEVEL_MODES) / sizeof(LEVEL_MODES[0]);
+    for (int i = 0; i < modeCount; i++) tone.setMode(i, &LEVEL_MODES[i]);
+    hal.connect();
+
+    char command[TONE_COMMAND_MAX + 1];
+    for (int i = 0; i < modeCount; i++) {
+        tone.setCurrentMode(i);
+        unsigned long previous = 0, decreases = 0, steps = 0, visibleSteps = 0;
+        int firstDecrease = 0;
+        for (int value = LEVEL_MODES[i].minValue; value <= LEVEL_MODES[i].maxValue; value++) {
+            snprintf(command, sizeof(command), "val:%d", value);
+            hal.write(command);
+            // Past the mode flash on the first value, past the level easing on the others
+            unsigned long settleMs = value == LEVEL_MODES[i].minValue ? MODE_FLASH_MS + 2 * MODE_FADE_MS : 8 * LEVEL_EASE_MS;
+            for (unsigned long t = 0; t < settleMs; t++) {
+                tone.update();
+                hal.advance(1000);
+            }
+
+            unsigned long light = frameLight();
+            if (value > LEVEL_MODES[i].minValue) {
+                steps++;
+                if (light > previous) visibleSteps++;
+                if (light < previous && decreases++ == 0) firstDecrease = value;
+            }
+            previous = light;
+        }
+        expect(decreases == 0, "%s: %lu of %lu steps decrease the light, the first at value %d", LEVEL_MODES[i].name,
+               decreases, steps, firstDecrease);
+        expect(visibleSteps > 0, "%s: no step changes the light", LEVEL_MODES[i].name);
+    }
+}
+
+/**
+ * @brief Configures modes with and without an input field: `cfg` keeps the input of the slot when it has none,
+ * `mode+` adds an absolute mode, and an unknown input is rejected.
+ */
+static void testModeInput() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    tone.begin();
+    tone.setMode(0, "Jog", 0, 100, 255, 255, 255, 150, MODE_INPUT_RELATIVE);
+    hal.connect();
+
+    struct {
+        const char *command;
+        int slot;
+        ModeInput input;
+    } const steps[] = {
+        {"cfg:0,Jog,0,50,255,255,255,150", 0, MODE_INPUT_RELATIVE},
+        {"mode+:Abs,0,100,255,255,255,150", 1, MODE_INPUT_ABSOLUTE},
+        {"mode+:Rel,0,100,255,255,255,150,1", 2, MODE_INPUT_RELATIVE},
+        {"cfg:0,Jog,0,50,255,255,255,150,0", 0, MODE_INPUT_ABSOLUTE},
+        {"cfg:1,Abs,0,100,255,255,255,150,2", 1, MODE_INPUT_ABSOLUTE},
+    };
+    for (const auto &step : steps) {
+        hal.write(step.command);
+        for (int t = 0; t < 10; t++) {
+            tone.update();
+            hal.advance(1000);
+        }
+        const modeSpec *spec = tone.getModeSpec(step.slot);
+        expect(spec != nullptr && spec->input == step.input, "%s: slot %d has input %d, expected %d", step.command,
+               step.slot, spec != nullptr ? spec->input : -1, step.input);
+    }
+    const modeSpec *jog = tone.getModeSpec(0);
+    expect(jog != nullptr && jog->maxValue == 50, "cfg did not reconfigure slot 0");
+}
+
+/**
+ * @brief Sends `cfg` and `mode+` writes with arguments outside int16_t (min, max) or uint8_t (color, brightness):
+ * each must be acknowledged with "ok": "0" and leave the modes as they were.
+ */
+static void testModeRanges() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    ToneController tone(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN, SCENARIO_PIXEL_PIN, SCENARIO_PIXELS);
+    tone.begin();
+    tone.setMode(0, "Volume", 0, 100, 255, 255, 255, 150);
+    hal.connect();
+
+    const char *const rejected[] = {
+        "cfg:0,x,0,70000,255,255,255,150",
+        "cfg:0,x,-40000,0,255,255,255,150",
+        "cfg:0,x,50,10,255,255,255,150",
+        "cfg:0,x,0,100,256,0,0,150",
+        "cfg:0,x,0,100,0,0,-1,150",
+        "cfg:0,x,0,100,0,0,0,300",
+        "mode+:x,0,70000,255,255,255,150",
+        "mode+:x,0,100,255,255,255,-5",
+    };
+    for (const char *command : rejected) {
+        hal.clearRecordings();
+        hal.write(command);
+        for (int t = 0; t < 10; t++) {
+            tone.update();
+            hal.advance(1000);
+        }
+        bool refused = false;
+        for (const SimNotify &notify : hal.notifies()) {
+            if (notify.payload.find("\"ack\"") != std::string::npos) {
+                refused = notify.payload.find("\"ok\": \"0\"") != std::string::npos;
+            }
+        }
+        expect(refused, "%s: not refused in its acknowledgement", command);
+        const modeSpec *spec = tone.getModeSpec(0);
+        expect(tone.getModeCount() == 1 && spec != nullptr && spec->maxValue == 100 && spec->brightness == 150,
+               "%s: changed the modes", command);
+    }
+    expect(tone.addMode("x", 0, 70000, 255, 255, 255, 150) == -1, "addMode() accepted a maximum above int16_t");
+
+    static const modeSpec inverted = {"Inverted", 50, 10, {255, 0, 0}, 150};
+    tone.setMode(0, 0, &inverted);
+    tone.setMode(0, 1, &inverted);
+    const modeSpec *spec = tone.getModeSpec(0);
+    expect(tone.getModeCount() == 1 && spec != nullptr && spec->maxValue == 100,
+           "setMode() accepted a spec with maxValue < minValue");
+    ModeRegistry registry;
+    expect(!registry.set(0, &inverted) && !registry.set(0, "x", 50, 10, 0, 0, 0, 150) && registry.count() == 0,
+           "ModeRegistry::set() accepted maxValue < minValue");
+}
+
+static void testPersistence() {
+    PersistenceRun run = runPersistence();
+    expect(!run.firstBootRestored, "a state was restored from empty flash");
+    expect(run.flashWrites <= PERSIST_SWEEPS + 2, "%lu flash writes for %d sweeps", run.flashWrites, PERSIST_SWEEPS);
+    expect(run.restored, "the reboot did not restore the mode and value");
+    expect(run.corruptRejected, "a corrupted record was restored");
+}
+
+static void testCalibration() {
+    CalibrationRun run = runCalibration();
+    expect(run.settled, "the rest position never settled");
+    expect(run.phantom == 0, "%lu of %lu drift samples left the origin", run.phantom, run.samples);
+    expect(run.angleError <= CAL_ANGLE_TOLERANCE, "angle off by %d degrees", run.angleError);
+}
+
+/**
+ * @brief Replays a log from each of its keyframes in turn; some fall into a held or released press or a sweep.
+ * @return Keyframes replayed from.
+ */
+static size_t replayEveryKeyframe(const eventLog &log, const char *name) {
+    size_t records;
+    size_t keyframes = 0;
+    for (replayResult replay = replayRecorded(log, records); replay.keyframe;
+         replay = replayRecorded(log, records, ++keyframes)) {
+        expect(replay.mismatches == 0, "%s, from keyframe %zu: %zu of %zu changes differ in the replay", name,
+               keyframes, replay.mismatches, replay.expected);
+    }
+    return keyframes;
+}
+
+static void testRecorder() {
+    RecorderRun run = runRecorderSession(RECORDER_SESSION_MS, true);
+    expect(run.dumped, "the log dump did not parse");
+    size_t records;
+    replayResult replay = replayRecorded(run.log, records);
+    expect(replay.keyframe, "the log has no keyframe");
+    expect(replay.expected > 0, "the log has no mode or value changes");
+    expect(replay.mismatches == 0, "%zu of %zu changes differ in the replay", replay.mismatches, replay.expected);
+    expect(replayEveryKeyframe(run.log, "session") > 1, "the log has a single keyframe");
+
+    RecorderRun wrapped = runRecorderSession(RECORDER_WRAP_MS, true);
+    expect(wrapped.dumped && wrapped.dropped > 0, "the wrapped log dump did not parse or did not wrap");
+    expect(replayEveryKeyframe(wrapped.log, "wrapped") > 1, "the wrapped log has a single keyframe");
+}
+
+/**
+ * @brief Records samples of channels 0..TONE_MAX_CHANNELS - 1 in irregular runs, their X encoding the channel,
+ * until the ring has wrapped many times. Decoded from startChannel(), every sample must carry its own channel.
+ */
+static void testRecorderChannels() {
+    EventRecorder *recorder = new EventRecorder();
+    for (unsigned long i = 0; i < CHANNEL_RECORDS; i++) {
+        uint8_t channel = (i * i / 7) % TONE_MAX_CHANNELS;
+        recorder->recordSample(i / 4, channel, channel * CHANNEL_X_STEP + i % CHANNEL_X_STEP, 0);
+    }
+
+    eventLog log;
+    log.start = recorder->startTime();
+    log.channel = recorder->startChannel();
+    log.bytes.resize(recorder->size());
+    recorder->read(0, log.bytes.data(), log.bytes.size());
+    expect(recorder->getDropped() > CHANNEL_RECORDS / 2, "the log did not wrap, %lu records dropped",
+           recorder->getDropped());
+    delete recorder;
+
+    std::vector<recordEntry> events;
+    expect(decodeEventLog(log, events), "the log did not decode");
+    size_t samples = 0, wrong = 0;
+    for (const recordEntry &event : events) {
+        if (event.type != REC_SAMPLE) continue;
+        samples++;
+        if (event.channel != event.args[0] / CHANNEL_X_STEP) wrong++;
+    }
+    expect(samples > 0, "no samples in the log");
+    expect(wrong == 0, "%zu of %zu samples decoded with another channel", wrong, samples);
+}
+
+static void testPower() {
+    for (bool connected : {false, true}) {
+        PowerRun run = runPowerLoop(connected);
+        const char *name = connected ? "connected" : "no client";
+        expect(run.wakePressSwallowed, "%s: the press that woke the ring switched the mode", name);
+        expect(run.secondPressActed, "%s: the press after waking did not switch the mode", name);
+        expect(run.sweepDutyCycle > 0, "%s: no busy time during the sweep", name);
+        expect(run.blankDutyCycle < run.sweepDutyCycle, "%s: duty cycle %.4f%% with a blank ring, %.4f%% sweeping",
+               name, run.blankDutyCycle * 100, run.sweepDutyCycle * 100);
+    }
+}
+
+static void testFanout() {
+    FanoutRun run = runFanoutSession(FANOUT_SPEC_COUNT);
+    for (size_t i = 0; i < FANOUT_SPEC_COUNT; i++) {
+        const FanoutClientRun &client = run.clients[i];
+        expect(client.lastValue == run.finalValue, "%s: last value %d, controller at %d", FANOUT_SPECS[i].name,
+               client.lastValue, run.finalValue);
+        expect(client.rejected == 0, "%s: %lu notifications refused by the link", FANOUT_SPECS[i].name, client.rejected);
+        // Only the phone selected the binary format and asked for a snapshot, both writes are acknowledged
+        expect(client.acks == (i == 1 ? 2U : 0U), "%s: %zu acks", FANOUT_SPECS[i].name, client.acks);
+    }
+
+    for (ToneFormat format : {FORMAT_JSON, FORMAT_BINARY}) {
+        const char *name = format == FORMAT_JSON ? "json" : "binary";
+        FanoutOrderRun order = runFanoutOrder(format);
+        expect(order.switchedValue == 3, "%s: ends on value %d after mode 0, 1, 0, 3 expected", name,
+               order.switchedValue);
+        expect(order.droppedValue == 7, "%s: channel 1 ends on %d after its frame was dropped, 7 expected", name,
+               order.droppedValue);
+        expect(order.finalValue == 10 + FANOUT_QUEUE - 1, "%s: channel 0 ends on %d after the overflow, %d expected",
+               name, order.finalValue, 10 + FANOUT_QUEUE - 1);
+    }
+}
+
+/**
+ * @brief Clients get notifications only once they enabled them, and payloads that fill their last part
+ * are not followed by an empty one.
+ */
+static void testSubscriptions() {
+    SubscriptionRun run = runSubscriptions();
+    expect(run.unsubscribedNotifies == 0, "%zu notifications before the client enabled them",
+           run.unsubscribedNotifies);
+    expect(run.lateValue == run.finalValue, "late client ends on %d, controller at %d", run.lateValue,
+           run.finalValue);
+    expect(run.smallMtuValue == run.finalValue, "default MTU client ends on %d, controller at %d", run.smallMtuValue,
+           run.finalValue);
+    expect(run.emptyNotifies == 0, "%zu empty notifications", run.emptyNotifies);
+    expect(run.linesWhole == 2, "%zu of 2 lines filling their parts arrived whole", run.linesWhole);
+}
+
+/**
+ * @brief Switches a client to binary and back with sequenced `fmt:` writes: each must be acknowledged with
+ * its sequence number and ok 1, and change the format of that client only.
+ */
+static void testFormatCommand() {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    bool restored;
+    ToneController *tone = bootController(restored);
+    hal.connect(24, 0);
+    hal.connect(24, 1);
+
+    const struct {
+        const char *command;
+        const char *ack;
+        ToneFormat format;
+    } steps[] = {
+        {"7@" FORMAT_CMD_BINARY, "\"ack\": \"7\", \"ok\": \"1\"", FORMAT_BINARY},
+        {"8@" FORMAT_CMD_JSON, "\"ack\": \"8\", \"ok\": \"1\"", FORMAT_JSON},
+    };
+    for (const auto &step : steps) {
+        hal.clearRecordings();
+        hal.write(step.command, nullptr, 1);
+        for (int t = 0; t < 10; t++) {
+            tone->update();
+            hal.advance(1000);
+        }
+        bool acked = false;
+        for (const SimNotify &notify : hal.notifies()) {
+            if (notify.connId == 1 && notify.payload.find(step.ack) != std::string::npos) acked = true;
+        }
+        expect(acked, "%s: no acknowledgement with ok 1", step.command);
+        const NotifyFanout &fanout = tone->getBluetooth()->getFanout();
+        for (uint8_t slot = 0; slot < TONE_MAX_CLIENTS; slot++) {
+            const fanoutClient &client = fanout.getSlot(slot);
+            if (!client.active) continue;
+            ToneFormat expected = client.connId == 1 ? step.format : FORMAT_JSON;
+            expect(client.format == expected, "%s: client %u uses format %d", step.command, client.connId,
+                   client.format);
+        }
+    }
+    delete tone;
+}
+
+static void testChannels() {
+    for (int channels : CHANNEL_COUNTS) {
+        ChannelRun run = runChannelSession(channels);
+        expect(run.json.finalValues, "%d channels: JSON client missed a final value", channels);
+        expect(run.binary.finalValues, "%d channels: binary client missed a final value", channels);
+        expect(run.json.maxStates <= (size_t) channels, "%d channels: %zu states in one notification", channels,
+               run.json.maxStates);
+    }
+
+    ChannelWakeRun wake = runChannelWake();
+    expect(wake.wakeModes[1] == 0, "wake: the press that woke the rings switched channel 1 to mode %d",
+           wake.wakeModes[1]);
+    expect(wake.wakeModes[0] == 1, "wake: channel 0 on mode %d after its press, 1 expected", wake.wakeModes[0]);
+    expect(wake.finalModes[1] == 1, "wake: channel 1 on mode %d after its second press, 1 expected",
+           wake.finalModes[1]);
+}
+
+static void testPixelOutput() {
+    for (int pixels : OUTPUT_SIZES) {
+        for (int strips = 1; strips <= PIXEL_RMT_CHANNELS; strips++) {
+            OutputRun neoPixel = runOutputSession(pixels, strips, false);
+            OutputRun rmt = runOutputSession(pixels, strips, true);
+            expect(sameFrames(neoPixel.frames, rmt.frames), "%d pixels, %d strips: RMT frames differ", pixels, strips);
+            expect(rmt.badSymbols == 0, "%d pixels, %d strips: %lu bad RMT symbols", pixels, strips, rmt.badSymbols);
+            expect(rmt.shown == neoPixel.shown, "%d pixels, %d strips: %lu shown callbacks, %lu expected", pixels,
+                   strips, rmt.shown, neoPixel.shown);
+        }
+    }
+
+    BackToBackRun run = runBackToBack();
+    expect(run.waited, "back to back: the second frame did not wait");
+    expect(run.sent == 2 && run.replaced == 1, "back to back: %zu frames sent, %lu replaced", run.sent, run.replaced);
+    expect(run.lastSent, "back to back: the newest frame was not sent");
+
+    ShortFrameRun shortFrames = runShortFrames();
+    std::vector<size_t> sizes = {(size_t) OUTPUT_SIZES[1], (size_t) OUTPUT_SIZES[1] / 2, (size_t) OUTPUT_SIZES[1],
+                                 (size_t) OUTPUT_SIZES[1] / 2};
+    expect(shortFrames.sizes == sizes, "short frames: %zu frames sent, not sized as written",
+           shortFrames.sizes.size());
+    expect(shortFrames.badSymbols == 0, "short frames: %lu bad RMT symbols", shortFrames.badSymbols);
+}
+
+static void scriptButtonEvents() {
+    bouncyButton(100, true);        // Short press
+    bouncyButton(200, false);
+    bouncyButton(1000, true, 8);    // Short press, heavy bounce
+    bouncyButton(1090, false, 8);
+    bouncyButton(2000, true);       // Long press
+    bouncyButton(3000, false);
+    bouncyButton(4000, true);       // Double press
+    bouncyButton(4080, false);
+    bouncyButton(4200, true);
+    bouncyButton(4280, false);
+    button(5000, true);             // 5 ms glitch, no event
+    button(5005, false);
+    bouncyButton(6000, true);       // Short press, then a long one inside the double press gap
+    bouncyButton(6080, false);
+    bouncyButton(6200, true);
+    bouncyButton(7200, false);
+    bouncyButton(8000, true, 40);   // Short press bouncing past the edge ring
+    bouncyButton(8200, false);
+}
+
+/**
+ * @brief A gesture and the earliest time the debouncer can report it: BUTTON_LONG_MS into a press, the end of the
+ * double press gap after a short press, BUTTON_DEBOUNCE_MS after the release of a double press. Slower polling
+ * may only delay it, by less than one poll.
+ */
+struct ButtonExpectation {
+    char event;
+    unsigned long atMs;
+};
+
+static const ButtonExpectation BUTTON_EXPECTED[] = {
+        {'S', 453}, {'S', 1345}, {'L', 2602}, {'D', 4312}, {'S', 6802}, {'L', 6802}, {'S', 8453},
+};
+
+/**
+ * @brief Feeds the scripted edges through the interrupt handler and the debouncer, polling every pollMs.
+ * @return The gestures in order, 'S', 'L' or 'D', with the time they were reported.
+ */
+static std::vector<ButtonExpectation> runButtonEvents(unsigned long pollMs) {
+    SimHal &hal = SimHal::instance();
+    hal.reset();
+    hal.clearFlash();
+    scenarioStartMs = 0;
+
+    JoystickController joystick(SCENARIO_X_PIN, SCENARIO_Y_PIN, SCENARIO_SW_PIN);
+    joystick.begin(false);
+    ButtonDebouncer debouncer;
+    scriptButtonEvents();
+
+    std::vector<ButtonExpectation> events;
+    while (hal.millis() < 10000) {
+        buttonEdge edge;
+        while (joystick.takeEdge(edge)) debouncer.addEdge(edge);
+        for (ButtonEvent event = debouncer.update(hal.millis()); event != BUTTON_NONE;
+             event = debouncer.update(hal.millis())) {
+            events.push_back({event == BUTTON_SHORT ? 'S' : event == BUTTON_LONG ? 'L' : 'D', hal.millis()});
+        }
+        hal.advance(pollMs * 1000UL);
+    }
+    return events;
+}
+
+static void testButtonEvents() {
+    size_t expectedCount = sizeof(BUTTON_EXPECTED) / sizeof(BUTTON_EXPECTED[0]);
+    for (unsigned long pollMs : {1UL, 50UL}) {
+        std::vector<ButtonExpectation> events = runButtonEvents(pollMs);
+        expect(events.size() == expectedCount, "%lu ms polling: %zu gestures, %zu expected", pollMs, events.size(),
+               expectedCount);
+        for (size_t i = 0; i < std::min(events.size(), expectedCount); i++) {
+            const ButtonExpectation &expected = BUTTON_EXPECTED[i];
+            expect(events[i].event == expected.event, "%lu ms polling: gesture %zu is %c, %c expected", pollMs, i,
+                   events[i].event, expected.event);
+            expect(events[i].atMs >= expected.atMs && events[i].atMs < expected.atMs + pollMs,
+                   "%lu ms polling: gesture %zu at %lu ms, %lu ms expected", pollMs, i, events[i].atMs, expected.atMs);
+        }
+    }
+}
+
+/**
+ * @brief Applies the same random operations to a PixelController and a StaticPixelRing of one geometry
+ * and compares frame, status and the frames sent after every step.
+ */
+template<int N, int OFFSET, bool REVERSE>
+static bool sameRing(uint32_t seed) {
+    CaptureOutput *runtimeOutput = new CaptureOutput(N);
+    CaptureOutput *staticOutput = new CaptureOutput(N);
+    PixelController runtime(runtimeOutput, N, OFFSET, REVERSE);
+    StaticPixelRing<N, OFFSET, REVERSE> ring(staticOutput);
+    runtime.begin();
+    ring.begin();
+
+    for (int step = 0; step < RING_STEPS; step++) {
+        seed = seed * 1664525 + 1013904223;
+        uint32_t color = seed & 0xFFFFFF;
+        int pixel = (seed >> 8) % N;
+        switch ((seed >> 28) % 8) {
+            case 0:
+            case 1:
+                runtime.setPixelColor(pixel, color);
+                ring.setPixelColor(pixel, color);
+                break;
+            case 2:
+                runtime.setFirstnPixelColor(pixel + 1, color >> 16, (color >> 8) & 0xFF, color & 0xFF);
+                ring.setFirstnPixelColor(pixel + 1, color >> 16, (color >> 8) & 0xFF, color & 0xFF);
+                break;
+            case 3:
+            case 4:
+                runtime.setLevel((int32_t) (seed % (N * LEVEL_ONE + 2 * LEVEL_ONE)) - LEVEL_ONE, color);
+                ring.setLevel((int32_t) (seed % (N * LEVEL_ONE + 2 * LEVEL_ONE)) - LEVEL_ONE, color);
+                break;
+            case 5:
+                runtime.setBrightness(seed & 0xFF);
+                ring.setBrightness(seed & 0xFF);
+                break;
+            case 6:
+                runtime.setCurrentPixelColor(color >> 16, (color >> 8) & 0xFF, color & 0xFF);
+                ring.setCurrentPixelColor(color >> 16, (color >> 8) & 0xFF, color & 0xFF);
+                break;
+            default:
+                runtime.clear();
+                ring.clear();
+                break;
+        }
+        runtime.show();
+        ring.show();
+        for (int i = 0; i < N; i++) {
+            if (runtime.getPixelColor(i) != ring.getPixelColor(i) || runtime.isPixelOn(i) != ring.isPixelOn(i)) return false;
+        }
+        if (runtimeOutput->last != staticOutput->last) return false;
+    }
+    return runtime.getFramesFlushed() == ring.getFramesFlushed();
+}
+
+static void testPixelRing() {
+    expect(sameRing<12, 0, false>(1), "12 pixels: static ring differs");
+    expect(sameRing<12, 0, true>(2), "12 pixels, reversed: static ring differs");
+    expect(sameRing<12, 5, false>(3), "12 pixels, offset 5: static ring differs");
+    expect(sameRing<12, -3, true>(4), "12 pixels, offset -3, reversed: static ring differs");
+    expect(sameRing<SCENARIO_PIXELS, 0, true>(5), "%d pixels, reversed: static ring differs", SCENARIO_PIXELS);
+    expect(sameRing<60, 17, true>(6), "60 pixels, offset 17, reversed: static ring differs");
+}
+
+#if TONE_METRICS
+static void testMetrics() {
+    MetricsRun run = runMetrics();
+    expect(run.allocations == 0, "%lu allocations with the timers and live metrics on", run.allocations);
+    expect(run.liveComplete, "%zu live snapshots, not all of them whole", run.liveSnapshots);
+    expect(run.readMatches, "the characteristic does not match the histograms");
+    expect(run.dumped, "the Serial dump misses paths");
+    expect(run.cleared, "metrics- left durations behind");
+    for (uint8_t metric = 0; metric < METRIC_COUNT; metric++) {
+        expect(run.histograms[metric].count > 0, "%s was never timed", ToneMetrics::name((ToneMetric) metric));
+    }
+}
+#endif
+
+struct HostTest {
+    const char *name;
+    void (*run)();
+};
+
+static const HostTest HOST_TESTS[] = {
+        {"angle",        testAngle},
+        {"scheduler",    testNotifyScheduler},
+        {"latency",      testLatency},
+        {"allocations",  testAllocations},
+        {"handoff",      testHandoff},
+        {"effects",      testEffects},
+        {"level_monotonic", testLevelMonotonic},
+        {"mode_input",   testModeInput},
+        {"mode_ranges",  testModeRanges},
+        {"persistence",  testPersistence},
+        {"calibration",  testCalibration},
+        {"button_events", testButtonEvents},
+        {"recorder",     testRecorder},
+        {"recorder_channels", testRecorderChannels},
+        {"power",        testPower},
+        {"fanout",       testFanout},
+        {"subscriptions", testSubscriptions},
+        {"format_command", testFormatCommand},
+        {"channels",     testChannels},
+        {"pixel_output", testPixelOutput},
+        {"pixel_ring",   testPixelRing},
+#if TONE_METRICS
+        {"metrics",      testMetrics},
+#endif
+};
+
+int main(int argc, char **argv) {
+    int failures = 0;
+    for (const HostTest &test : HOST_TESTS) {
+        bool wanted = argc < 2;
+        for (int i = 1; i < argc; i++) wanted |= !strcmp(argv[i], test.name);
+        if (!wanted) continue;
+
+        testFailed = false;
+        printf("%s\n", test.name);
+        test.run();
+        printf("%s %s\n", testFailed ? "FAIL" : "ok", test.name);
+        if (testFailed) failures++;
+    }
+    return failures ? 1 : 0;
+}
@@ -18,23 +18,32 @@
 */
 
 
+// name, minValue, maxValue, {r, g, b}, brightness
+static const modeSpec VOLUME = {"Volume", 0, 100, {255, 255, 155}, 150};
+static const modeSpec BASS = {"Bass", 0, 100, {122, 50, 245}, 150};
+static const modeSpec TREBLE = {"Treble", 0, 100, {90, 240, 255}, 150};
+
 ToneController tne(XPIN, YPIN, SWPIN, PIXELPIN, NUMPIXELS);
+bool tasksStarted = false;
 
 void setup() {
     Serial.begin(115200);
     tne.begin();
 
-    // index, name, minValue, maxValue, r, g, b, brightness
-    tne.setMode(0, "Volume", 0, 100, 255, 255, 155, 150);
-    tne.setMode(1, "Bass", 0, 100, 122, 50, 245, 150);
-    tne.setMode(2, "Treble", 0, 100, 90, 240, 255, 150);
-    tne.setCurrentMode(0);
+    tne.setMode(0, &VOLUME);
+    tne.setMode(1, &BASS);
+    tne.setMode(2, &TREBLE);
+    if (!tne.restoreState()) tne.setCurrentMode(0);
+    tasksStarted = tne.startTasks();
 
-    delay(1000);
     Serial.println("ToneOS started");
 }
 
 void loop() {
-    tne.update();
-    delay(100);
+#if TONE_TASKS
+    if (tasksStarted) {
+        vTaskDelete(nullptr);  // Input and BLE run in their own tasks
+    }
+#endif
+    tne.update();  // Tasks disabled (TONE_TASKS 0) or could not be created
 }
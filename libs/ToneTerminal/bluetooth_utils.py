@@ -3,6 +3,7 @@ import os
 from bleak import BleakScanner, BLEDevice, BleakClient, BleakGATTServiceCollection, BleakGATTCharacteristic
 from dotenv import load_dotenv
 import json
+import struct
 
 from utils import log, set_volume_mac, get_volume_data_as_int
 
@@ -14,6 +15,36 @@ tone_device_name = os.getenv("DEVICE_NAME", "Tone Equalizer")
 characteristic_uuid = os.getenv("CHARACTERISTIC_UUID", "your_characteristic_uuid_here")
 service_uuid = os.getenv("SERVICE_UUID", "your_service_uuid_here")
 operating_system = os.uname().sysname
+data_format = os.getenv("DATA_FORMAT", "json")  # "json" or "bin"
+
+# === Binary protocol ===
+PROTOCOL_VERSION = 1
+FRAME_HAS_NAME = 0x01
+FRAME_HAS_COLOR = 0x02
+FRAME_BATCH = 0x80
+last_frame_states = {}  # channel -> last decoded state, name and color are only sent when they change
+
+# === Commands ===
+command_sequence = 0
+pending_commands = {}  # sequence -> command, removed when the device acknowledges it
+device_modes = {}  # mode index -> configuration from the last snapshot
+
+# === Notifications ===
+notify_part_size = 0  # MTU - 3: a notification of this size is continued by the next one, unless it ends the payload
+notify_partial = bytearray()  # Parts of the payload in progress
+
+# === Event log dump ===
+log_dump_path = os.getenv("LOG_DUMP_PATH", "tone_log.txt")
+log_dump_lines = []  # '#' lines of the dump in progress, written to log_dump_path at '#end'
+
+# === Metrics ===
+metrics_uuid = os.getenv("METRICS_UUID", "abcdefab-1234-1234-1234-abcdefab0002")
+metrics_interval_ms = int(os.getenv("METRICS_INTERVAL_MS", "0"))  # Live metrics while connected, 0 for none
+METRIC_SNAPSHOT_VERSION = 1
+METRIC_NAMES = ["joy_read", "mapping", "show", "notify", "control"]
+METRIC_BUCKETS = 16
+METRIC_BUCKET_SHIFT = 8  # Bucket 0 holds durations below 256 ns, every further bucket doubles
+metrics_partial = bytearray()  # Parts of the live snapshot in progress
 
 
 # === BLE (Bluetooth Low Energy) ===
@@ -47,8 +78,8 @@ def connect_to_ble_device() -> bool:
     global tone_device
     global tone_client
     global characteristic_uuid
+    global notify_part_size
     current_volume = get_volume_data_as_int(operating_system)
-    current_vol_str = f"vol:{current_volume}"
     log(f"Current volume: {current_volume}")
 
     if tone_device is None:
@@ -59,8 +90,16 @@ def connect_to_ble_device() -> bool:
             async with BleakClient(tone_device.address) as client:
                 status = 'Connected' if client.is_connected else 'Not connected'
                 log(f"{status} to {tone_device.name} ({tone_device.address})")
-                await client.write_gatt_char(find_notify_uuid(client.services), current_vol_str.encode('utf-8'))
-                await client.start_notify(find_notify_uuid(client.services), handle_notification)
+                characteristic = find_notify_uuid(client.services)
+                notify_part_size = client.mtu_size - 3
+                await client.start_notify(characteristic, handle_notification)
+                if data_format == "bin":
+                    await send_command(client, characteristic, "fmt:bin")
+                await send_command(client, characteristic, "get")
+                await send_command(client, characteristic, f"val:{current_volume}")
+                if metrics_interval_ms > 0:
+                    await client.start_notify(metrics_uuid, handle_metrics_notification)
+                    await send_command(client, characteristic, f"metrics:{metrics_interval_ms}")
                 log("Listening for messages...")
                 await asyncio.sleep(9999)
                 return True
@@ -72,28 +111,261 @@ def connect_to_ble_device() -> bool:
 
 
 def handle_notification(sender: BleakGATTCharacteristic, data: bytearray):
+    global notify_partial
+    # The device splits payloads longer than the MTU allows; a shorter part ends them, a full one only if complete
+    notify_partial += data
+    if notify_part_size and len(data) == notify_part_size and not payload_complete(notify_partial):
+        return
+    data, notify_partial = notify_partial, bytearray()
     if not data:
         return
     try:
-        str_data = data.decode('utf-8', errors='ignore')
-        json_data = json.loads(str_data)
-        log(f"From {sender.uuid}: {json_data}", "TONE")
-        if operating_system == "Darwin":  # macOS
-            set_volume_mac(int(json_data.get("value", 0)))
-        elif operating_system == "nt":
-            set_volume_windows(int(json_data.get("value", 0)))
+        if data[:7] == b"#metric":
+            log(data.decode('utf-8', errors='ignore')[1:].rstrip("\n"), "METRICS")
+            return
+        if data[:1] == b"#":
+            handle_log_line(data.decode('utf-8', errors='ignore').rstrip("\n"))
+            return
+        if data[0] == PROTOCOL_VERSION:
+            states = decode_binary_frame(data)
+        else:
+            str_data = data.decode('utf-8', errors='ignore')
+            json_data = json.loads(str_data)
+            if "ack" in json_data:
+                handle_ack(json_data)
+                return
+            if "min" in json_data:
+                device_modes[int(json_data["index"])] = json_data
+                return
+            # Several channels send an array with one object per changed channel
+            states = json_data if isinstance(json_data, list) else [json_data]
+        for state in states:
+            log(f"From {sender.uuid}: {state}", "TONE")
+            # The volume follows channel 0
+            if int(state.get("ch", 0)) != 0:
+                continue
+            if operating_system == "Darwin":  # macOS
+                set_volume_mac(int(state.get("value", 0)))
+            elif operating_system == "nt":
+                set_volume_windows(int(state.get("value", 0)))
 
     except Exception as e:
         log(f"Error decoding data: {e}", "ERROR")
         return
 
 
+async def send_command(client: BleakClient, characteristic: BleakGATTCharacteristic, command: str) -> int:
+    """
+    Writes a command (val:<n>, mode:<index>, get, cfg:..., mode+:..., mode-:<index>, log, metrics..., fmt:...)
+    with a new sequence number.
+    The device answers with {"ack": seq, "ok": 0|1, "result": n}.
+    """
+    global command_sequence
+    command_sequence += 1
+    pending_commands[command_sequence] = command
+    await client.write_gatt_char(characteristic, f"{command_sequence}@{command}".encode('utf-8'))
+    return command_sequence
+
+
+def handle_ack(ack: dict):
+    sequence = int(ack["ack"])
+    command = pending_commands.pop(sequence, None)
+    if int(ack.get("ok", 0)):
+        log(f"Command {command} done: {ack.get('result')}", "TONE")
+    else:
+        log(f"Command {command} rejected by the device", "ERROR")
+
+
+def payload_complete(data: bytearray) -> bool:
+    """
+    Tells whether the parts received so far hold a whole payload; the device sends nothing after a payload
+    that fills its last part. Binary frames end by their layout, text lines with a newline, JSON with its
+    closing bracket.
+    """
+    if not data:
+        return False
+    if data[:1] == b"#":
+        return data.endswith(b"\n")
+    if data[0] == PROTOCOL_VERSION:
+        return binary_frame_length(data) <= len(data)
+    try:
+        json.loads(data.decode('utf-8', errors='ignore'))
+        return True
+    except ValueError:
+        return False
+
+
+def binary_frame_length(data: bytearray) -> int:
+    """
+    Length of the binary frame at the start of data, longer than data while parts of it are missing.
+    """
+    batch = len(data) > 1 and data[1] & FRAME_BATCH
+    if len(data) < 6:
+        return len(data) + 1
+    count, offset = (data[3], 4) if batch else (1, 1)
+    for _ in range(count):
+        if offset + 5 > len(data):
+            return len(data) + 1
+        flags = data[offset + 1] if batch else data[offset]
+        offset += 5
+        if flags & FRAME_HAS_NAME:
+            if offset >= len(data):
+                return len(data) + 1
+            offset += 1 + data[offset]
+        if flags & FRAME_HAS_COLOR:
+            offset += 3
+    return offset
+
+
+def handle_log_line(line: str):
+    """
+    Collects the lines of an event log dump (`log` command). The saved file can be replayed
+    on the host with toneos_replay.
+    """
+    if line.startswith("#log "):
+        log_dump_lines.clear()
+    log_dump_lines.append(line)
+    if line == "#end":
+        with open(log_dump_path, "w") as file:
+            file.write("\n".join(log_dump_lines) + "\n")
+        log(f"Event log saved to {log_dump_path}", "TONE")
+        log_dump_lines.clear()
+
+
+def pull_metrics_once() -> bool:
+    """
+    Connects, reads the metrics characteristic once and prints it.
+    """
+    if tone_device is None:
+        log("No BLE device found to connect.", "ERROR")
+        return False
+    try:
+        async def pull():
+            async with BleakClient(tone_device.address) as client:
+                print_metrics(decode_metrics(await client.read_gatt_char(metrics_uuid)))
+                return True
+
+        return asyncio.run(pull())
+    except Exception as e:
+        log(f"Metrics Error: {e}", "ERROR")
+        return False
+
+
+def handle_metrics_notification(sender: BleakGATTCharacteristic, data: bytearray):
+    """
+    Prints live metrics (`metrics:<ms>` command). Snapshots are split into MTU-3 byte parts like states,
+    one that fills its last part ends with it: version, count, then 12 + 2 * METRIC_BUCKETS bytes per metric.
+    """
+    global metrics_partial
+    metrics_partial += data
+    length = 2 + metrics_partial[1] * (12 + 2 * METRIC_BUCKETS) if len(metrics_partial) >= 2 else 2
+    if notify_part_size and len(data) == notify_part_size and len(metrics_partial) < length:
+        return
+    data, metrics_partial = metrics_partial, bytearray()
+    try:
+        print_metrics(decode_metrics(data))
+    except Exception as e:
+        log(f"Error decoding metrics: {e}", "ERROR")
+
+
+def decode_metrics(data: bytearray) -> list:
+    """
+    Decodes a metrics snapshot into one dict per metric, durations in ns.
+
+    Layout: version, metric count, then per metric: count, mean, max (uint32 LE), buckets (16 x uint16 LE)
+    """
+    if data[0] != METRIC_SNAPSHOT_VERSION:
+        raise ValueError(f"unknown metrics version {data[0]}")
+    metrics = []
+    offset = 2
+    for index in range(data[1]):
+        count, mean, maximum = struct.unpack_from("<III", data, offset)
+        buckets = list(struct.unpack_from(f"<{METRIC_BUCKETS}H", data, offset + 12))
+        name = METRIC_NAMES[index] if index < len(METRIC_NAMES) else f"metric{index}"
+        metrics.append({"name": name, "count": count, "mean": mean, "max": maximum, "buckets": buckets})
+        offset += 12 + 2 * METRIC_BUCKETS
+    return metrics
+
+
+def metric_percentile(metric: dict, percent: int) -> int:
+    """
+    Upper bound of the bucket holding a percentile, like the firmware's estimate.
+    """
+    rank = (sum(metric["buckets"]) * percent + 99) // 100
+    seen = 0
+    for bucket, count in enumerate(metric["buckets"][:-1]):
+        seen += count
+        if rank and seen >= rank:
+            return min(1 << (bucket + METRIC_BUCKET_SHIFT), metric["max"])
+    return metric["max"]
+
+
+def format_duration(ns: int) -> str:
+    return f"{ns / 1000:.1f} us" if ns >= 1000 else f"{ns} ns"
+
+
+def print_metrics(metrics: list):
+    """
+    Prints a metrics snapshot as a table, with the histogram of every metric as a bar of bucket shares.
+    """
+    shades = " .:-=+*#"
+    print(f"{'path':<10}{'count':>9}{'mean':>11}{'p50':>11}{'p99':>11}{'max':>11}  histogram (256 ns .. 4 ms+)")
+    for metric in metrics:
+        total = sum(metric["buckets"]) or 1
+        bar = "".join(shades[min(len(shades) - 1, (count * len(shades) + total - 1) // total)]
+                      for count in metric["buckets"])
+        print(f"{metric['name']:<10}{metric['count']:>9}{format_duration(metric['mean']):>11}"
+              f"{format_duration(metric_percentile(metric, 50)):>11}{format_duration(metric_percentile(metric, 99)):>11}"
+              f"{format_duration(metric['max']):>11}  |{bar}|")
+
+
+def decode_binary_frame(data: bytearray) -> list:
+    """
+    Decodes a binary state frame into states with the same keys as the JSON format.
+    Name and color are only present when they change, so the last known values of the channel are reused.
+
+    Layout: version, flags, sequence, mode, value (int16 LE), [name length, name], [r, g, b]
+    Batch (flags & FRAME_BATCH): version, flags, sequence, count, then per channel:
+    channel, flags, mode, value (int16 LE), [name length, name], [r, g, b]
+    """
+    if not data[1] & FRAME_BATCH:
+        _, flags, sequence, mode_index, value = struct.unpack_from("<BBBBh", data, 0)
+        state, _ = decode_frame_state(data, 6, 0, flags, mode_index, value)
+        return [dict(state, seq=sequence)]
+
+    _, _, sequence, count = struct.unpack_from("<BBBB", data, 0)
+    offset = 4
+    states = []
+    for _ in range(count):
+        channel, flags, mode_index, value = struct.unpack_from("<BBBh", data, offset)
+        state, offset = decode_frame_state(data, offset + 5, channel, flags, mode_index, value)
+        states.append(dict(state, seq=sequence))
+    return states
+
+
+def decode_frame_state(data: bytearray, offset: int, channel: int, flags: int, mode_index: int, value: int):
+    """
+    Reads the optional name and color of one state at offset.
+    Returns the state and the offset after it.
+    """
+    state = last_frame_states.setdefault(channel, {"mode": "", "value": 0, "r": 0, "g": 0, "b": 0})
+    if flags & FRAME_HAS_NAME:
+        name_length = data[offset]
+        state["mode"] = bytes(data[offset + 1:offset + 1 + name_length]).decode('utf-8', errors='ignore')
+        offset += 1 + name_length
+    if flags & FRAME_HAS_COLOR:
+        state["r"], state["g"], state["b"] = data[offset:offset + 3]
+        offset += 3
+    state["value"] = value
+    return dict(state, ch=channel, index=mode_index), offset
+
+
 def find_notify_uuid(client_services: BleakGATTServiceCollection):
     """
-    Finds the first characteristic with notification support in the given service.
+    Finds the first characteristic with notification support in the given service, other than the metrics one.
     """
     for service in client_services:
         for characteristic in service.characteristics:
-            if 'notify' in characteristic.properties:
+            if 'notify' in characteristic.properties and characteristic.uuid != metrics_uuid:
                 return characteristic
     return None
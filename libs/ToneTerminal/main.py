@@ -1,3 +1,5 @@
+import sys
+
 from bluetooth_utils import *
 from utils import log
 
@@ -10,4 +12,8 @@ if __name__ == '__main__':
         isDeviceNearby = is_ble_device_connected_sync('Tone Equalizer')
 
     log("Device is nearby, proceeding with the application.", "BLE")
-    connect_to_ble_device()
+    # `python main.py metrics` prints the hot path timings once instead of following the device
+    if sys.argv[1:] == ["metrics"]:
+        pull_metrics_once()
+    else:
+        connect_to_ble_device()